@@ -141,6 +141,18 @@ function broadcast(msg: ServerMsg) {
   }
 }
 
+// A slider drag sends a setComponentParam per input event; the state goes out at most once a frame.
+const PARAM_BROADCAST_MS = 16;
+let paramBroadcastTimer: ReturnType<typeof setTimeout> | null = null;
+
+function scheduleStateBroadcast() {
+  if (paramBroadcastTimer) return;
+  paramBroadcastTimer = setTimeout(() => {
+    paramBroadcastTimer = null;
+    broadcast({ type: 'state', state });
+  }, PARAM_BROADCAST_MS);
+}
+
 wss.on('connection', (ws) => {
   clients.add(ws);
   ws.send(JSON.stringify({ type: 'state', state } satisfies ServerMsg));
@@ -242,7 +254,7 @@ wss.on('connection', (ws) => {
         if (pedal) {
           (pedal.params as any)[key] = value;
           state.updatedAt = Date.now();
-          broadcast({ type: 'state', state });
+          scheduleStateBroadcast();
           return;
         }
 
@@ -250,7 +262,7 @@ wss.on('connection', (ws) => {
         if (state.amp && state.amp.id === componentId) {
           (state.amp.params as any)[key] = value;
           state.updatedAt = Date.now();
-          broadcast({ type: 'state', state });
+          scheduleStateBroadcast();
           return;
         }
 
@@ -258,7 +270,7 @@ wss.on('connection', (ws) => {
         if (state.cabinet && state.cabinet.id === componentId) {
           (state.cabinet.params as any)[key] = value;
           state.updatedAt = Date.now();
-          broadcast({ type: 'state', state });
+          scheduleStateBroadcast();
           return;
         }
 
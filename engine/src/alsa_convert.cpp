@@ -0,0 +1,707 @@
+#include "alsa_convert.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <strings.h>
+
+// AArch64 only: the NEON path needs vcvtnq/vmaxvq, which 32-bit ARM lacks.
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define PEDAL_CONVERT_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define PEDAL_CONVERT_SSE2 1
+#endif
+
+namespace alsa_convert
+{
+
+  // S32 full scale. +1.0f * 2^31 does not fit an int32, so positive samples stop at the largest
+  // float below it.
+  static constexpr float kInvS32 = 1.0f / 2147483648.0f;
+  static constexpr float kMaxS32 = 2147483520.0f;
+  static constexpr float kInvS24 = 1.0f / 8388608.0f;
+  static constexpr float kInvS16 = 1.0f / 32768.0f;
+
+  size_t bytesPerSample(Format f)
+  {
+    switch (f)
+    {
+    case Format::S32LE:
+      return 4;
+    case Format::S24_3LE:
+      return 3;
+    case Format::S16LE:
+      return 2;
+    }
+    return 4;
+  }
+
+  const char *formatName(Format f)
+  {
+    switch (f)
+    {
+    case Format::S32LE:
+      return "S32_LE";
+    case Format::S24_3LE:
+      return "S24_3LE";
+    case Format::S16LE:
+      return "S16_LE";
+    }
+    return "?";
+  }
+
+  bool parseFormat(const char *s, Format &out)
+  {
+    if (!s)
+      return false;
+    if (::strcasecmp(s, "S32_LE") == 0)
+      out = Format::S32LE;
+    else if (::strcasecmp(s, "S24_3LE") == 0)
+      out = Format::S24_3LE;
+    else if (::strcasecmp(s, "S16_LE") == 0)
+      out = Format::S16LE;
+    else
+      return false;
+    return true;
+  }
+
+  static inline int32_t loadS24(const uint8_t *p)
+  {
+    // Sign-extend through the top byte of an int32.
+    const uint32_t u = (uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24;
+    return (int32_t)u >> 8;
+  }
+
+  static inline int16_t loadS16(const uint8_t *p)
+  {
+    int16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline int32_t loadS32(const uint8_t *p)
+  {
+    int32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static inline float clampUnit(float x) { return std::min(1.0f, std::max(-1.0f, x)); }
+
+  // Generic paths: any format, any channel count.
+  static float decodeScalar(const uint8_t *src, Format f, unsigned channels, float *mono, uint32_t frames,
+                            double &sumSq)
+  {
+    const size_t bps = bytesPerSample(f);
+    const float norm = (f == Format::S32LE ? kInvS32 : f == Format::S24_3LE ? kInvS24
+                                                                            : kInvS16) /
+                       (float)channels;
+    float peak = 0.0f;
+    float sq = 0.0f;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+      float acc = 0.0f;
+      for (unsigned c = 0; c < channels; c++, src += bps)
+      {
+        switch (f)
+        {
+        case Format::S32LE:
+          acc += (float)loadS32(src);
+          break;
+        case Format::S24_3LE:
+          acc += (float)loadS24(src);
+          break;
+        case Format::S16LE:
+          acc += (float)loadS16(src);
+          break;
+        }
+      }
+      mono[i] = acc * norm;
+      peak = std::max(peak, std::fabs(mono[i]));
+      sq += mono[i] * mono[i];
+    }
+    sumSq += sq;
+    return peak;
+  }
+
+  static void encodeScalar(const float *mono, Format f, unsigned channels, uint8_t *dst, uint32_t frames)
+  {
+    for (uint32_t i = 0; i < frames; i++)
+    {
+      const float x = clampUnit(mono[i]);
+      switch (f)
+      {
+      case Format::S32LE:
+      {
+        const int32_t v = (int32_t)std::lrintf(std::min(x * 2147483647.0f, kMaxS32));
+        for (unsigned c = 0; c < channels; c++, dst += 4)
+          std::memcpy(dst, &v, 4);
+        break;
+      }
+      case Format::S24_3LE:
+      {
+        const int32_t v = (int32_t)std::lrintf(x * 8388607.0f);
+        for (unsigned c = 0; c < channels; c++, dst += 3)
+        {
+          dst[0] = (uint8_t)v;
+          dst[1] = (uint8_t)(v >> 8);
+          dst[2] = (uint8_t)(v >> 16);
+        }
+        break;
+      }
+      case Format::S16LE:
+      {
+        const int16_t v = (int16_t)std::lrintf(x * 32767.0f);
+        for (unsigned c = 0; c < channels; c++, dst += 2)
+          std::memcpy(dst, &v, 2);
+        break;
+      }
+      }
+    }
+  }
+
+  static inline void storeSample(float x, Format f, uint8_t *dst)
+  {
+    switch (f)
+    {
+    case Format::S32LE:
+    {
+      const int32_t v = (int32_t)std::lrintf(std::min(x * 2147483647.0f, kMaxS32));
+      std::memcpy(dst, &v, 4);
+      break;
+    }
+    case Format::S24_3LE:
+    {
+      const int32_t v = (int32_t)std::lrintf(x * 8388607.0f);
+      dst[0] = (uint8_t)v;
+      dst[1] = (uint8_t)(v >> 8);
+      dst[2] = (uint8_t)(v >> 16);
+      break;
+    }
+    case Format::S16LE:
+    {
+      const int16_t v = (int16_t)std::lrintf(x * 32767.0f);
+      std::memcpy(dst, &v, 2);
+      break;
+    }
+    }
+  }
+
+  static void encodeStereoScalar(const float *l, const float *r, Format f, unsigned channels, uint8_t *dst,
+                                 uint32_t frames)
+  {
+    const size_t bps = bytesPerSample(f);
+    for (uint32_t i = 0; i < frames; i++)
+    {
+      if (channels == 1)
+      {
+        storeSample(clampUnit(0.5f * (l[i] + r[i])), f, dst);
+        dst += bps;
+        continue;
+      }
+      const float xl = clampUnit(l[i]);
+      const float xr = clampUnit(r[i]);
+      for (unsigned c = 0; c < channels; c++, dst += bps)
+        storeSample((c & 1u) ? xr : xl, f, dst);
+    }
+  }
+
+  // Output stage for one sample: meters x into the chain accumulators, applies gain and (optionally)
+  // zeroes a non-finite result, then meters what will be converted. Peaks skip NaNs but keep
+  // infinities; sums of squares only take finite values.
+  struct StageAcc
+  {
+    float chainPeak = 0.0f;
+    float chainSq = 0.0f;
+    float outPeak = 0.0f;
+    float outSq = 0.0f;
+    uint64_t nonFinite = 0;
+
+    float run(float x, float gain, bool sanitize)
+    {
+      const float ax = std::fabs(x);
+      if (ax > chainPeak)
+        chainPeak = ax;
+      if (ax <= FLT_MAX)
+        chainSq += x * x;
+      float y = x * gain;
+      float ay = std::fabs(y);
+      if (ay <= FLT_MAX)
+      {
+        outSq += y * y;
+      }
+      else if (sanitize)
+      {
+        y = 0.0f;
+        ay = 0.0f;
+        nonFinite++;
+      }
+      if (ay > outPeak)
+        outPeak = ay;
+      return y;
+    }
+  };
+
+  static void encodeOutputScalar(const float *l, const float *r, float gain, bool sanitize, Format f,
+                                 unsigned channels, uint8_t *dst, uint32_t frames, StageAcc &acc)
+  {
+    const size_t bps = bytesPerSample(f);
+    for (uint32_t i = 0; i < frames; i++)
+    {
+      if (!r)
+      {
+        // Convert once, copy the bytes to the other channels.
+        storeSample(clampUnit(acc.run(l[i], gain, sanitize)), f, dst);
+        for (unsigned c = 1; c < channels; c++)
+          std::memcpy(dst + c * bps, dst, bps);
+        dst += channels * bps;
+        continue;
+      }
+      const float yl = acc.run(l[i], gain, sanitize);
+      const float yr = acc.run(r[i], gain, sanitize);
+      if (channels == 1)
+      {
+        storeSample(clampUnit(0.5f * (yl + yr)), f, dst);
+        dst += bps;
+        continue;
+      }
+      const float xl = clampUnit(yl);
+      const float xr = clampUnit(yr);
+      for (unsigned c = 0; c < channels; c++, dst += bps)
+        storeSample((c & 1u) ? xr : xl, f, dst);
+    }
+  }
+
+  // Vector paths for the common S32 mono/stereo layouts; tails go through the scalar code.
+
+#if defined(PEDAL_CONVERT_NEON)
+  static uint32_t decodeS32Neon(const int32_t *src, unsigned channels, float *mono, uint32_t frames, float &peak,
+                                double &sumSq)
+  {
+    const uint32_t vf = frames & ~3u;
+    float32x4_t pk = vdupq_n_f32(0.0f);
+    float32x4_t sq = vdupq_n_f32(0.0f);
+    if (channels == 1)
+    {
+      const float32x4_t k = vdupq_n_f32(kInvS32);
+      for (uint32_t i = 0; i < vf; i += 4)
+      {
+        const float32x4_t m = vmulq_f32(vcvtq_f32_s32(vld1q_s32(src + i)), k);
+        vst1q_f32(mono + i, m);
+        pk = vmaxq_f32(pk, vabsq_f32(m));
+        sq = vfmaq_f32(sq, m, m);
+      }
+    }
+    else
+    {
+      const float32x4_t k = vdupq_n_f32(kInvS32 * 0.5f);
+      for (uint32_t i = 0; i < vf; i += 4)
+      {
+        const int32x4x2_t lr = vld2q_s32(src + 2 * i);
+        const float32x4_t m = vmulq_f32(vaddq_f32(vcvtq_f32_s32(lr.val[0]), vcvtq_f32_s32(lr.val[1])), k);
+        vst1q_f32(mono + i, m);
+        pk = vmaxq_f32(pk, vabsq_f32(m));
+        sq = vfmaq_f32(sq, m, m);
+      }
+    }
+    peak = vmaxvq_f32(pk);
+    sumSq += (double)vaddvq_f32(sq);
+    return vf;
+  }
+
+  static uint32_t encodeS32Neon(const float *mono, unsigned channels, int32_t *dst, uint32_t frames)
+  {
+    const uint32_t vf = frames & ~3u;
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(2147483647.0f);
+    const float32x4_t top = vdupq_n_f32(kMaxS32);
+    for (uint32_t i = 0; i < vf; i += 4)
+    {
+      const float32x4_t x = vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(mono + i)));
+      const int32x4_t v = vcvtnq_s32_f32(vminq_f32(vmulq_f32(x, scale), top));
+      if (channels == 1)
+      {
+        vst1q_s32(dst + i, v);
+      }
+      else
+      {
+        int32x4x2_t lr;
+        lr.val[0] = v;
+        lr.val[1] = v;
+        vst2q_s32(dst + 2 * i, lr);
+      }
+    }
+    return vf;
+  }
+
+  static uint32_t encodeS32StereoNeon(const float *l, const float *r, int32_t *dst, uint32_t frames)
+  {
+    const uint32_t vf = frames & ~3u;
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(2147483647.0f);
+    const float32x4_t top = vdupq_n_f32(kMaxS32);
+    for (uint32_t i = 0; i < vf; i += 4)
+    {
+      const float32x4_t xl = vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(l + i)));
+      const float32x4_t xr = vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(r + i)));
+      int32x4x2_t lr;
+      lr.val[0] = vcvtnq_s32_f32(vminq_f32(vmulq_f32(xl, scale), top));
+      lr.val[1] = vcvtnq_s32_f32(vminq_f32(vmulq_f32(xr, scale), top));
+      vst2q_s32(dst + 2 * i, lr);
+    }
+    return vf;
+  }
+
+  // encodeOutput for S32 with a mono source fanned out to channels <= 2, or (Stereo) L/R to 2.
+  template <bool Stereo>
+  static uint32_t encodeOutputS32Neon(const float *l, const float *r, float gain, bool sanitize, unsigned channels,
+                                      int32_t *dst, uint32_t frames, StageAcc &acc)
+  {
+    const uint32_t vf = frames & ~3u;
+    const float32x4_t g = vdupq_n_f32(gain);
+    const float32x4_t fmax = vdupq_n_f32(FLT_MAX);
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(2147483647.0f);
+    const float32x4_t top = vdupq_n_f32(kMaxS32);
+    float32x4_t chPk = vdupq_n_f32(0.0f);
+    float32x4_t chSq = vdupq_n_f32(0.0f);
+    float32x4_t outPk = vdupq_n_f32(0.0f);
+    float32x4_t outSq = vdupq_n_f32(0.0f);
+    uint64_t bad = 0;
+
+    auto masked = [](float32x4_t v, uint32x4_t m) {
+      return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(v), m));
+    };
+    auto stage = [&](float32x4_t x) {
+      const float32x4_t ax = vabsq_f32(x);
+      chPk = vmaxnmq_f32(chPk, ax); // maxnm: a NaN lane keeps the running peak
+      chSq = vaddq_f32(chSq, masked(vmulq_f32(x, x), vcleq_f32(ax, fmax)));
+      float32x4_t y = vmulq_f32(x, g);
+      float32x4_t ay = vabsq_f32(y);
+      const uint32x4_t finite = vcleq_f32(ay, fmax);
+      if (sanitize && vminvq_u32(finite) == 0)
+      {
+        bad += 4 - vaddvq_u32(vshrq_n_u32(finite, 31));
+        y = masked(y, finite);
+        ay = masked(ay, finite);
+      }
+      outPk = vmaxnmq_f32(outPk, ay);
+      outSq = vaddq_f32(outSq, masked(vmulq_f32(y, y), finite));
+      return vcvtnq_s32_f32(vminq_f32(vmulq_f32(vminq_f32(hi, vmaxq_f32(lo, y)), scale), top));
+    };
+
+    for (uint32_t i = 0; i < vf; i += 4)
+    {
+      int32x4x2_t lr;
+      lr.val[0] = stage(vld1q_f32(l + i));
+      if (Stereo)
+      {
+        lr.val[1] = stage(vld1q_f32(r + i));
+        vst2q_s32(dst + 2 * i, lr);
+      }
+      else if (channels == 1)
+      {
+        vst1q_s32(dst + i, lr.val[0]);
+      }
+      else
+      {
+        lr.val[1] = lr.val[0];
+        vst2q_s32(dst + 2 * i, lr);
+      }
+    }
+    acc.chainPeak = std::max(acc.chainPeak, vmaxvq_f32(chPk));
+    acc.chainSq += vaddvq_f32(chSq);
+    acc.outPeak = std::max(acc.outPeak, vmaxvq_f32(outPk));
+    acc.outSq += vaddvq_f32(outSq);
+    acc.nonFinite += bad;
+    return vf;
+  }
+#elif defined(PEDAL_CONVERT_SSE2)
+  static float hmax(__m128 v)
+  {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, v);
+    return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+  }
+
+  static float hsum(__m128 v)
+  {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, v);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  }
+
+  static uint32_t decodeS32Sse2(const int32_t *src, unsigned channels, float *mono, uint32_t frames, float &peak,
+                                double &sumSq)
+  {
+    const uint32_t vf = frames & ~3u;
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 pk = _mm_setzero_ps();
+    __m128 sq = _mm_setzero_ps();
+    if (channels == 1)
+    {
+      const __m128 k = _mm_set1_ps(kInvS32);
+      for (uint32_t i = 0; i < vf; i += 4)
+      {
+        const __m128 m = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + i))), k);
+        _mm_storeu_ps(mono + i, m);
+        pk = _mm_max_ps(pk, _mm_and_ps(m, absMask));
+        sq = _mm_add_ps(sq, _mm_mul_ps(m, m));
+      }
+    }
+    else
+    {
+      const __m128 k = _mm_set1_ps(kInvS32 * 0.5f);
+      for (uint32_t i = 0; i < vf; i += 4)
+      {
+        // L0 R0 L1 R1 | L2 R2 L3 R3 -> L0 L1 L2 L3 / R0 R1 R2 R3
+        const __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + 2 * i)));
+        const __m128 b = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + 2 * i + 4)));
+        const __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m128 m = _mm_mul_ps(_mm_add_ps(l, r), k);
+        _mm_storeu_ps(mono + i, m);
+        pk = _mm_max_ps(pk, _mm_and_ps(m, absMask));
+        sq = _mm_add_ps(sq, _mm_mul_ps(m, m));
+      }
+    }
+    peak = hmax(pk);
+    sumSq += (double)hsum(sq);
+    return vf;
+  }
+
+  static uint32_t encodeS32Sse2(const float *mono, unsigned channels, int32_t *dst, uint32_t frames)
+  {
+    const uint32_t vf = frames & ~3u;
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(2147483647.0f);
+    const __m128 top = _mm_set1_ps(kMaxS32);
+    for (uint32_t i = 0; i < vf; i += 4)
+    {
+      const __m128 x = _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(mono + i)));
+      const __m128i v = _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(x, scale), top)); // round to nearest
+      if (channels == 1)
+      {
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+      }
+      else
+      {
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi32(v, v));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 4), _mm_unpackhi_epi32(v, v));
+      }
+    }
+    return vf;
+  }
+
+  static uint32_t encodeS32StereoSse2(const float *l, const float *r, int32_t *dst, uint32_t frames)
+  {
+    const uint32_t vf = frames & ~3u;
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(2147483647.0f);
+    const __m128 top = _mm_set1_ps(kMaxS32);
+    for (uint32_t i = 0; i < vf; i += 4)
+    {
+      const __m128 xl = _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(l + i)));
+      const __m128 xr = _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(r + i)));
+      const __m128i vl = _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(xl, scale), top));
+      const __m128i vr = _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(xr, scale), top));
+      _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi32(vl, vr));
+      _mm_storeu_si128((__m128i *)(dst + 2 * i + 4), _mm_unpackhi_epi32(vl, vr));
+    }
+    return vf;
+  }
+
+  // encodeOutput for S32 with a mono source fanned out to channels <= 2, or (Stereo) L/R to 2.
+  template <bool Stereo>
+  static uint32_t encodeOutputS32Sse2(const float *l, const float *r, float gain, bool sanitize, unsigned channels,
+                                      int32_t *dst, uint32_t frames, StageAcc &acc)
+  {
+    const uint32_t vf = frames & ~3u;
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 fmax = _mm_set1_ps(FLT_MAX);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(2147483647.0f);
+    const __m128 top = _mm_set1_ps(kMaxS32);
+    __m128 chPk = _mm_setzero_ps();
+    __m128 chSq = _mm_setzero_ps();
+    __m128 outPk = _mm_setzero_ps();
+    __m128 outSq = _mm_setzero_ps();
+    uint64_t bad = 0;
+
+    auto stage = [&](__m128 x) {
+      const __m128 ax = _mm_and_ps(x, absMask);
+      chPk = _mm_max_ps(ax, chPk); // maxps returns the second operand for a NaN lane
+      chSq = _mm_add_ps(chSq, _mm_and_ps(_mm_mul_ps(x, x), _mm_cmple_ps(ax, fmax)));
+      __m128 y = _mm_mul_ps(x, g);
+      __m128 ay = _mm_and_ps(y, absMask);
+      const __m128 finite = _mm_cmple_ps(ay, fmax);
+      if (sanitize)
+      {
+        const int m = _mm_movemask_ps(finite);
+        if (m != 0xF)
+        {
+          bad += 4 - (uint64_t)__builtin_popcount((unsigned)m);
+          y = _mm_and_ps(y, finite);
+          ay = _mm_and_ps(ay, finite);
+        }
+      }
+      outPk = _mm_max_ps(ay, outPk);
+      outSq = _mm_add_ps(outSq, _mm_and_ps(_mm_mul_ps(y, y), finite));
+      return _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(_mm_min_ps(hi, _mm_max_ps(lo, y)), scale), top));
+    };
+
+    for (uint32_t i = 0; i < vf; i += 4)
+    {
+      const __m128i vl = stage(_mm_loadu_ps(l + i));
+      if (Stereo)
+      {
+        const __m128i vr = stage(_mm_loadu_ps(r + i));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi32(vl, vr));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 4), _mm_unpackhi_epi32(vl, vr));
+      }
+      else if (channels == 1)
+      {
+        _mm_storeu_si128((__m128i *)(dst + i), vl);
+      }
+      else
+      {
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi32(vl, vl));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 4), _mm_unpackhi_epi32(vl, vl));
+      }
+    }
+    acc.chainPeak = std::max(acc.chainPeak, hmax(chPk));
+    acc.chainSq += hsum(chSq);
+    acc.outPeak = std::max(acc.outPeak, hmax(outPk));
+    acc.outSq += hsum(outSq);
+    acc.nonFinite += bad;
+    return vf;
+  }
+#endif
+
+  static float decode(const void *src, Format f, unsigned channels, float *mono, uint32_t frames, double &sumSq)
+  {
+    const uint8_t *p = static_cast<const uint8_t *>(src);
+    uint32_t done = 0;
+    float peak = 0.0f;
+#if defined(PEDAL_CONVERT_NEON)
+    if (f == Format::S32LE && channels <= 2)
+      done = decodeS32Neon(static_cast<const int32_t *>(src), channels, mono, frames, peak, sumSq);
+#elif defined(PEDAL_CONVERT_SSE2)
+    if (f == Format::S32LE && channels <= 2)
+      done = decodeS32Sse2(static_cast<const int32_t *>(src), channels, mono, frames, peak, sumSq);
+#endif
+    if (done < frames)
+    {
+      const size_t frameBytes = bytesPerSample(f) * channels;
+      peak = std::max(peak,
+                      decodeScalar(p + (size_t)done * frameBytes, f, channels, mono + done, frames - done, sumSq));
+    }
+    return peak;
+  }
+
+  float decodeMono(const void *src, Format f, unsigned channels, float *mono, uint32_t frames) noexcept
+  {
+    if (channels == 0 || frames == 0)
+      return 0.0f;
+    double sumSq = 0.0;
+    return decode(src, f, channels, mono, frames, sumSq);
+  }
+
+  void decodeInput(const void *src, Format f, unsigned channels, float *mono, uint32_t frames, Meter &in) noexcept
+  {
+    if (channels == 0 || frames == 0)
+      return;
+    in.peak = std::max(in.peak, decode(src, f, channels, mono, frames, in.sumSq));
+    in.samples += frames;
+  }
+
+  void encodeFanout(const float *mono, Format f, unsigned channels, void *dst, uint32_t frames) noexcept
+  {
+    if (channels == 0 || frames == 0)
+      return;
+
+    uint8_t *p = static_cast<uint8_t *>(dst);
+    uint32_t done = 0;
+#if defined(PEDAL_CONVERT_NEON)
+    if (f == Format::S32LE && channels <= 2)
+      done = encodeS32Neon(mono, channels, static_cast<int32_t *>(dst), frames);
+#elif defined(PEDAL_CONVERT_SSE2)
+    if (f == Format::S32LE && channels <= 2)
+      done = encodeS32Sse2(mono, channels, static_cast<int32_t *>(dst), frames);
+#endif
+    if (done < frames)
+    {
+      const size_t frameBytes = bytesPerSample(f) * channels;
+      encodeScalar(mono + done, f, channels, p + (size_t)done * frameBytes, frames - done);
+    }
+  }
+
+  void encodeStereo(const float *l, const float *r, Format f, unsigned channels, void *dst, uint32_t frames) noexcept
+  {
+    if (channels == 0 || frames == 0)
+      return;
+
+    uint8_t *p = static_cast<uint8_t *>(dst);
+    uint32_t done = 0;
+#if defined(PEDAL_CONVERT_NEON)
+    if (f == Format::S32LE && channels == 2)
+      done = encodeS32StereoNeon(l, r, static_cast<int32_t *>(dst), frames);
+#elif defined(PEDAL_CONVERT_SSE2)
+    if (f == Format::S32LE && channels == 2)
+      done = encodeS32StereoSse2(l, r, static_cast<int32_t *>(dst), frames);
+#endif
+    if (done < frames)
+    {
+      const size_t frameBytes = bytesPerSample(f) * channels;
+      encodeStereoScalar(l + done, r + done, f, channels, p + (size_t)done * frameBytes, frames - done);
+    }
+  }
+
+  void encodeOutput(const float *l, const float *r, float gain, bool sanitize, Format f, unsigned channels, void *dst,
+                    uint32_t frames, Meter &chain, Meter &out, uint64_t &nonFinite) noexcept
+  {
+    if (channels == 0 || frames == 0)
+      return;
+
+    uint8_t *p = static_cast<uint8_t *>(dst);
+    StageAcc acc;
+    uint32_t done = 0;
+#if defined(PEDAL_CONVERT_NEON)
+    if (f == Format::S32LE && !r && channels <= 2)
+      done = encodeOutputS32Neon<false>(l, r, gain, sanitize, channels, static_cast<int32_t *>(dst), frames, acc);
+    else if (f == Format::S32LE && r && channels == 2)
+      done = encodeOutputS32Neon<true>(l, r, gain, sanitize, channels, static_cast<int32_t *>(dst), frames, acc);
+#elif defined(PEDAL_CONVERT_SSE2)
+    if (f == Format::S32LE && !r && channels <= 2)
+      done = encodeOutputS32Sse2<false>(l, r, gain, sanitize, channels, static_cast<int32_t *>(dst), frames, acc);
+    else if (f == Format::S32LE && r && channels == 2)
+      done = encodeOutputS32Sse2<true>(l, r, gain, sanitize, channels, static_cast<int32_t *>(dst), frames, acc);
+#endif
+    if (done < frames)
+    {
+      const size_t frameBytes = bytesPerSample(f) * channels;
+      encodeOutputScalar(l + done, r ? r + done : nullptr, gain, sanitize, f, channels, p + (size_t)done * frameBytes,
+                         frames - done, acc);
+    }
+
+    const uint64_t samples = (uint64_t)frames * (r ? 2 : 1);
+    chain.peak = std::max(chain.peak, acc.chainPeak);
+    chain.sumSq += (double)acc.chainSq;
+    chain.samples += samples;
+    out.peak = std::max(out.peak, acc.outPeak);
+    out.sumSq += (double)acc.outSq;
+    out.samples += samples;
+    nonFinite += acc.nonFinite;
+  }
+
+} // namespace alsa_convert
@@ -0,0 +1,57 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Sample conversion between ALSA's interleaved device formats and the engine's float buffers.
+// Decoding downmixes (averages) all channels; encoding clamps to [-1, 1] and writes the same sample
+// to every channel (or L/R pairs from a stereo chain). All work in place on a DMA ring (ALSA_MMAP)
+// as well as on a plain buffer.
+namespace alsa_convert
+{
+  enum class Format
+  {
+    S32LE,
+    S24_3LE,
+    S16LE,
+  };
+
+  size_t bytesPerSample(Format f);
+  const char *formatName(Format f);
+  // Accepts the ALSA names (S32_LE, S24_3LE, S16_LE); case-insensitive.
+  bool parseFormat(const char *s, Format &out);
+
+  // mono[i] = mean over channels of src frame i; returns max |mono[i]|.
+  float decodeMono(const void *src, Format f, unsigned channels, float *mono, uint32_t frames) noexcept;
+
+  // Every channel of dst frame i = mono[i], clamped to full scale.
+  void encodeFanout(const float *mono, Format f, unsigned channels, void *dst, uint32_t frames) noexcept;
+
+  // Even channels of dst frame i = l[i], odd ones = r[i], clamped to full scale. A single channel
+  // gets (l[i] + r[i]) / 2.
+  void encodeStereo(const float *l, const float *r, Format f, unsigned channels, void *dst, uint32_t frames) noexcept;
+
+  // What a fused stage saw; accumulates over calls until the caller resets it.
+  struct Meter
+  {
+    float peak = 0.0f;    // max |x|; NaNs are skipped, infinities kept
+    double sumSq = 0.0;   // sum of x^2 over the finite samples
+    uint64_t samples = 0; // frames, or twice that for a stereo source
+    float rms() const { return samples ? (float)std::sqrt(sumSq / (double)samples) : 0.0f; }
+    void add(const Meter &o)
+    {
+      peak = peak > o.peak ? peak : o.peak;
+      sumSq += o.sumSq;
+      samples += o.samples;
+    }
+  };
+
+  // decodeMono, metering mono into `in` in the same pass.
+  void decodeInput(const void *src, Format f, unsigned channels, float *mono, uint32_t frames, Meter &in) noexcept;
+
+  // The output stage in one pass: x -> meter `chain` -> y = x * gain -> (sanitize) non-finite y
+  // becomes 0 and counts in nonFinite -> meter `out` -> clamp, convert and fan out like
+  // encodeFanout (r == nullptr) or interleave like encodeStereo. l/r are left untouched.
+  void encodeOutput(const float *l, const float *r, float gain, bool sanitize, Format f, unsigned channels, void *dst,
+                    uint32_t frames, Meter &chain, Meter &out, uint64_t &nonFinite) noexcept;
+} // namespace alsa_convert
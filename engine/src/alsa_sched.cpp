@@ -0,0 +1,116 @@
+#include "alsa_sched.h"
+
+#include <algorithm>
+
+namespace alsa_sched
+{
+
+  // Don't trim for less than this; a few frames of fill are within scheduling jitter anyway.
+  static constexpr uint32_t kMinTrimFrames = 8;
+  // Only step the period down if the chain's worst period used less than this much of it. Halving
+  // the period roughly keeps the fraction (per-block overhead makes it a little worse).
+  static constexpr double kStepDownMaxLoadPct = 45.0;
+
+  void Window::add(double v) noexcept
+  {
+    if (count == 0)
+    {
+      min = v;
+      max = v;
+    }
+    else
+    {
+      min = std::min(min, v);
+      max = std::max(max, v);
+    }
+    sum += v;
+    count++;
+  }
+
+  void FillTrimmer::reset(uint32_t margin, uint32_t period) noexcept
+  {
+    margin_ = margin;
+    period_ = period;
+    windowMin_ = 0.0;
+    seen_ = false;
+    calm_ = 0;
+  }
+
+  void FillTrimmer::observe(double queued) noexcept
+  {
+    windowMin_ = seen_ ? std::min(windowMin_, queued) : queued;
+    seen_ = true;
+  }
+
+  uint32_t FillTrimmer::review() noexcept
+  {
+    if (!seen_)
+      return 0;
+    seen_ = false;
+
+    const double excess = windowMin_ - (double)margin_;
+    const uint32_t slack = std::max(kMinTrimFrames, period_ / 8);
+    if (excess <= (double)slack)
+    {
+      calm_ = 0;
+      return 0;
+    }
+    if (++calm_ < 2)
+      return 0;
+
+    // Spread big trims over several blocks so one block never loses more than half its frames.
+    calm_ = 0;
+    return std::min((uint32_t)excess, period_ / 2);
+  }
+
+  void FillTrimmer::onXrun(uint32_t maxMargin) noexcept
+  {
+    margin_ = std::min(std::max(margin_ * 2, period_ / 4), maxMargin);
+    seen_ = false;
+    calm_ = 0;
+  }
+
+  void PeriodAdvisor::reset(uint32_t period, uint32_t minPeriod, uint32_t maxPeriod, uint32_t stableSecs) noexcept
+  {
+    period_ = period;
+    min_ = minPeriod;
+    max_ = std::max(maxPeriod, minPeriod);
+    floor_ = minPeriod;
+    stableSecs_ = std::max(1u, stableSecs);
+    clean_ = 0;
+  }
+
+  uint32_t PeriodAdvisor::review(uint64_t xruns, double loadPct) noexcept
+  {
+    if (xruns > 0)
+    {
+      clean_ = 0;
+      floor_ = std::max(floor_, period_ * 2);
+      return (period_ * 2 <= max_) ? period_ * 2 : 0;
+    }
+
+    if (++clean_ < stableSecs_)
+      return 0;
+    const uint32_t down = period_ / 2;
+    if (down < floor_ || down < min_ || loadPct >= kStepDownMaxLoadPct)
+      return 0;
+    clean_ = 0;
+    return down;
+  }
+
+  void PeriodAdvisor::switched(uint32_t period) noexcept
+  {
+    period_ = period;
+    clean_ = 0;
+  }
+
+  void PeriodAdvisor::rejected(uint32_t period) noexcept
+  {
+    if (period < period_)
+      floor_ = std::max(floor_, period_);
+    else
+      max_ = period_;
+    clean_ = 0;
+  }
+
+} // namespace alsa_sched
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+
+// Policy half of the poll scheduler (ALSA_SCHED=poll|adaptive). main_alsa.cpp owns the ALSA calls
+// and feeds measurements in; nothing here blocks, allocates or touches the device, so it is safe
+// on the audio thread.
+namespace alsa_sched
+{
+  // min/avg/max over one reporting window.
+  struct Window
+  {
+    double min = 0.0;
+    double max = 0.0;
+    double sum = 0.0;
+    uint64_t count = 0;
+
+    void add(double v) noexcept;
+    double avg() const noexcept { return count ? sum / (double)count : 0.0; }
+    void reset() noexcept { *this = Window{}; }
+  };
+
+  // Keeps the playback queue at margin frames ahead of the device at the moment a block is written.
+  // Extra fill (boot priming, xrun recovery, drift between unlinked clocks) is latency for nothing;
+  // once it has been stable for two reviews the excess is dropped from the next block.
+  class FillTrimmer
+  {
+  public:
+    void reset(uint32_t margin, uint32_t period) noexcept;
+    uint32_t margin() const noexcept { return margin_; }
+
+    // Frames still queued on the device just before a block is written.
+    void observe(double queued) noexcept;
+
+    // Once per second: frames to drop from the head of the next block (0 = none).
+    uint32_t review() noexcept;
+
+    // Playback xrun: the margin was too small for this system, double it (up to maxMargin).
+    void onXrun(uint32_t maxMargin) noexcept;
+
+  private:
+    uint32_t margin_ = 0;
+    uint32_t period_ = 0;
+    double windowMin_ = 0.0;
+    bool seen_ = false;
+    uint32_t calm_ = 0;
+  };
+
+  // Adaptive period size. Steps one power of two down after stableSecs clean seconds with chain
+  // load headroom, and one step up as soon as a second has xruns. A period that xruns (or that the
+  // device rejects) becomes the floor for the rest of the session, so the search settles on the
+  // lowest stable size instead of oscillating.
+  class PeriodAdvisor
+  {
+  public:
+    void reset(uint32_t period, uint32_t minPeriod, uint32_t maxPeriod, uint32_t stableSecs) noexcept;
+
+    // Once per second with that second's xrun count and worst chain time as % of the period.
+    // Returns the period to switch to, or 0 to stay.
+    uint32_t review(uint64_t xruns, double loadPct) noexcept;
+
+    // The switch to period went through / failed (device refused, mismatch). Either way the
+    // stability clock restarts.
+    void switched(uint32_t period) noexcept;
+    void rejected(uint32_t period) noexcept;
+
+    uint32_t floor() const noexcept { return floor_; }
+
+  private:
+    uint32_t period_ = 0;
+    uint32_t min_ = 0;
+    uint32_t max_ = 0;
+    uint32_t floor_ = 0;
+    uint32_t stableSecs_ = 0;
+    uint32_t clean_ = 0;
+  };
+} // namespace alsa_sched
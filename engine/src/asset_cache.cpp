@@ -0,0 +1,133 @@
+#include "asset_cache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+#include "fft_convolver.h"
+#include "get_dsp.h"
+#include "nam_binary.h"
+
+namespace pedal::dsp
+{
+
+  template <typename T>
+  std::shared_ptr<const T> AssetCache::Lru<T>::find(const std::string &key)
+  {
+    auto it = index.find(key);
+    if (it == index.end())
+      return nullptr;
+    items.splice(items.begin(), items, it->second);
+    return it->second->second;
+  }
+
+  template <typename T>
+  void AssetCache::Lru<T>::put(const std::string &key, std::shared_ptr<const T> v, size_t cap)
+  {
+    if (cap == 0)
+      return;
+    auto it = index.find(key);
+    if (it != index.end())
+    {
+      it->second->second = std::move(v);
+      items.splice(items.begin(), items, it->second);
+      return;
+    }
+    items.emplace_front(key, std::move(v));
+    index[key] = items.begin();
+    trim(cap);
+  }
+
+  template <typename T>
+  void AssetCache::Lru<T>::trim(size_t cap)
+  {
+    while (items.size() > cap)
+    {
+      index.erase(items.back().first);
+      items.pop_back();
+    }
+  }
+
+  void AssetCache::setMaxEntries(size_t maxEntries)
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    maxEntries_ = maxEntries;
+    nam_.trim(maxEntries_);
+    ir_.trim(maxEntries_);
+  }
+
+  std::string AssetCache::fileKey(const std::string &path)
+  {
+    std::error_code ec;
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+      return {};
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec)
+      return {};
+    return path + "|" + std::to_string((long long)mtime.time_since_epoch().count()) + "|" + std::to_string(size);
+  }
+
+  std::shared_ptr<const nam::dspData> AssetCache::namData(const std::string &path)
+  {
+    // Key on the file actually read, so packing or re-packing a .namb next to the .nam misses.
+    const std::string file = resolveNamPath(path);
+    const std::string key = fileKey(file);
+
+    if (!key.empty())
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (auto hit = nam_.find(key))
+      {
+        hits_++;
+        std::fprintf(stderr, "Assets: NAM cache hit %s\n", path.c_str());
+        return hit;
+      }
+      misses_++;
+    }
+
+    auto loaded = std::make_shared<nam::dspData>();
+    loadNamData(file, *loaded);
+    if (!key.empty())
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      nam_.put(key, loaded, maxEntries_);
+    }
+    return loaded;
+  }
+
+  std::shared_ptr<const CachedIr> AssetCache::ir(const std::string &key, const IrBuilder &make, std::string &err)
+  {
+    if (!key.empty())
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (auto hit = ir_.find(key))
+      {
+        hits_++;
+        return hit;
+      }
+      misses_++;
+    }
+
+    auto built = make(err);
+    if (built && !key.empty())
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      ir_.put(key, built, maxEntries_);
+    }
+    return built;
+  }
+
+  size_t AssetCache::hits() const
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return hits_;
+  }
+
+  size_t AssetCache::misses() const
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return misses_;
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace nam
+{
+  struct dspData;
+}
+
+struct NonUniformFilter;
+
+namespace pedal::dsp
+{
+
+  // A prepared IR: spectra ready for FFTConvolverNonUniform::init, plus any warning the preparation
+  // produced (so cache hits report the same thing as the original build).
+  struct CachedIr
+  {
+    std::shared_ptr<const NonUniformFilter> filter;
+    std::string warning;
+  };
+
+  // Content-keyed cache of what node builds derive from disk assets: parsed NAM model data and
+  // prepared IR spectra. Keys start with fileKey() (path + mtime + size), so replacing a file on disk
+  // misses the cache. Entries are immutable and handed out as shared_ptr<const>, so live nodes are
+  // unaffected by eviction. Thread-safe; used from build threads only, never from the audio thread.
+  class AssetCache
+  {
+  public:
+    // Keeps up to `maxEntries` of each kind, least recently used evicted first (0 = no caching).
+    explicit AssetCache(size_t maxEntries = 8) : maxEntries_(maxEntries) {}
+
+    void setMaxEntries(size_t maxEntries);
+
+    // Parsed model data for `path` (.nam, or .namb / a packed sibling, see resolveNamPath), for
+    // NamInference::create; a hit skips the file read and parse. Throws like nam::get_dsp on failure.
+    std::shared_ptr<const nam::dspData> namData(const std::string &path);
+
+    // Prepared IR for `key`; `make` runs on a miss (outside the lock) and its result is cached unless
+    // it returns nullptr, in which case err is whatever `make` set.
+    using IrBuilder = std::function<std::shared_ptr<const CachedIr>(std::string &err)>;
+    std::shared_ptr<const CachedIr> ir(const std::string &key, const IrBuilder &make, std::string &err);
+
+    // "path|mtime|size", or empty if the file can't be stat'ed (callers then skip the cache).
+    static std::string fileKey(const std::string &path);
+
+    size_t hits() const;
+    size_t misses() const;
+
+  private:
+    template <typename T>
+    struct Lru
+    {
+      std::list<std::pair<std::string, std::shared_ptr<const T>>> items; // front = most recent
+      std::unordered_map<std::string, typename decltype(items)::iterator> index;
+
+      std::shared_ptr<const T> find(const std::string &key);
+      void put(const std::string &key, std::shared_ptr<const T> v, size_t cap);
+      void trim(size_t cap);
+    };
+
+    size_t maxEntries_;
+    mutable std::mutex mutex_;
+    Lru<nam::dspData> nam_;
+    Lru<CachedIr> ir_;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,38 @@
+#include "chain_arena.h"
+
+#include <cstring>
+#include <new>
+
+#include <unistd.h>
+
+namespace pedal::dsp
+{
+
+  size_t ChainArena::reserve(size_t floats)
+  {
+    constexpr size_t kAlignFloats = kAlignBytes / sizeof(float);
+    const size_t off = floats_;
+    floats_ += (floats + kAlignFloats - 1) / kAlignFloats * kAlignFloats;
+    return off;
+  }
+
+  void ChainArena::commit()
+  {
+    long page = ::sysconf(_SC_PAGESIZE);
+    if (page < (long)kAlignBytes)
+      page = 4096;
+
+    const size_t bytes = (floats_ * sizeof(float) + (size_t)page - 1) / (size_t)page * (size_t)page;
+    if (bytes == 0)
+      return;
+
+    void *p = std::aligned_alloc((size_t)page, bytes);
+    if (!p)
+      throw std::bad_alloc();
+    std::memset(p, 0, bytes);
+
+    mem_.reset(static_cast<float *>(p));
+    bytes_ = bytes;
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+
+namespace pedal::dsp
+{
+
+  // One page-aligned, pre-faulted block a SignalChain carves its per-period buffers out of, so a
+  // chain's working set is a few contiguous pages rather than vectors scattered over the heap.
+  //
+  // Two phases, both non-RT: reserve() every region, then commit() once. Offsets returned by
+  // reserve() turn into pointers with at() after commit().
+  class ChainArena
+  {
+  public:
+    static constexpr size_t kAlignBytes = 64; // every region starts on its own cache line
+
+    ChainArena() = default;
+
+    ChainArena(const ChainArena &) = delete;
+    ChainArena &operator=(const ChainArena &) = delete;
+
+    // Returns the region's offset in floats.
+    size_t reserve(size_t floats);
+    // Allocates, zeroes and thereby faults in every page (locked too, under mlockall(MCL_FUTURE)).
+    // Throws std::bad_alloc like the vectors it replaces.
+    void commit();
+
+    float *at(size_t offset) const noexcept { return mem_.get() + offset; }
+    size_t bytes() const noexcept { return bytes_; }
+
+  private:
+    struct Free
+    {
+      void operator()(float *p) const noexcept { std::free(p); }
+    };
+
+    std::unique_ptr<float, Free> mem_;
+    size_t floats_ = 0;
+    size_t bytes_ = 0;
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,420 @@
+#include "chain_build_service.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "rt_worker_pool.h"
+
+namespace pedal::control
+{
+
+  // Helpers for BuildChainOptions::parallelFor. The caller works on the batch too, so a pool of N
+  // runs N + 1 nodes at once.
+  class ChainBuildService::NodePool
+  {
+  public:
+    explicit NodePool(int threads)
+    {
+      for (int i = 0; i < threads; i++)
+        threads_.emplace_back([this] { work(); });
+    }
+
+    ~NodePool()
+    {
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+      }
+      cv_.notify_all();
+      for (auto &t : threads_)
+        t.join();
+    }
+
+    void parallelFor(size_t n, const std::function<void(size_t)> &fn)
+    {
+      if (threads_.empty() || n <= 1)
+      {
+        for (size_t i = 0; i < n; i++)
+          fn(i);
+        return;
+      }
+
+      auto batch = std::make_shared<Batch>();
+      batch->fn = &fn;
+      batch->n = n;
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        batch_ = batch;
+        gen_++;
+      }
+      cv_.notify_all();
+
+      drain(*batch);
+      std::unique_lock<std::mutex> lk(batch->mutex);
+      batch->cv.wait(lk, [&] { return batch->finished == batch->n; });
+    }
+
+  private:
+    struct Batch
+    {
+      const std::function<void(size_t)> *fn = nullptr;
+      size_t n = 0;
+      std::atomic<size_t> next{0};
+      std::mutex mutex;
+      std::condition_variable cv;
+      size_t finished = 0;
+    };
+
+    static void drain(Batch &b)
+    {
+      for (;;)
+      {
+        const size_t i = b.next.fetch_add(1, std::memory_order_relaxed);
+        if (i >= b.n)
+          return;
+        (*b.fn)(i);
+        std::lock_guard<std::mutex> lk(b.mutex);
+        if (++b.finished == b.n)
+          b.cv.notify_all();
+      }
+    }
+
+    void work()
+    {
+      pedal::dsp::dropToNormalPriority("Control: build helper");
+
+      uint64_t seen = 0;
+      for (;;)
+      {
+        std::shared_ptr<Batch> b;
+        {
+          std::unique_lock<std::mutex> lk(mutex_);
+          cv_.wait(lk, [&] { return stop_ || gen_ != seen; });
+          if (stop_)
+            return;
+          seen = gen_;
+          b = batch_;
+        }
+        if (b)
+          drain(*b);
+      }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    uint64_t gen_ = 0;
+    std::shared_ptr<Batch> batch_;
+  };
+
+  ChainBuildService::ChainBuildService() = default;
+
+  ChainBuildService::~ChainBuildService()
+  {
+    stop();
+  }
+
+  bool ChainBuildService::start(int nodeThreads)
+  {
+    if (thread_.joinable())
+      return true;
+    wakeFd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd_ < 0)
+      return false;
+    pool_ = std::make_unique<NodePool>(nodeThreads > 0 ? nodeThreads : 0);
+    stop_ = false;
+    thread_ = std::thread([this] { run(); });
+    return true;
+  }
+
+  void ChainBuildService::stop()
+  {
+    if (!thread_.joinable())
+      return;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+      queued_.reset();
+      standby_.clear();
+    }
+    cancel_.store(true, std::memory_order_relaxed);
+    cv_.notify_all();
+    thread_.join();
+    pool_.reset();
+    ::close(wakeFd_);
+    wakeFd_ = -1;
+  }
+
+  void ChainBuildService::supersedeLocked(uint64_t id, const std::string &slot, bool &woke)
+  {
+    Result r;
+    r.id = id;
+    r.slot = slot;
+    r.superseded = true;
+    r.error = "superseded by a newer chain";
+    results_.push_back(std::move(r));
+    woke = true;
+  }
+
+  void ChainBuildService::cancelMainLocked(bool &woke)
+  {
+    if (queued_)
+    {
+      supersedeLocked(queued_->id, {}, woke);
+      queued_.reset();
+    }
+    if (buildingId_ != 0 && buildingSlot_.empty())
+      cancel_.store(true, std::memory_order_relaxed);
+  }
+
+  static void wake(int fd)
+  {
+    const uint64_t one = 1;
+    (void)!::write(fd, &one, sizeof(one));
+  }
+
+  uint64_t ChainBuildService::submit(pedal::chain::ChainSpec spec, const pedal::dsp::ProcessContext &ctx,
+                                     bool persist)
+  {
+    uint64_t id;
+    bool woke = false;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      id = nextId_++;
+      cancelMainLocked(woke);
+      // A standby build gives way; run() puts it back in the queue.
+      if (buildingId_ != 0 && !buildingSlot_.empty())
+      {
+        preempted_ = true;
+        cancel_.store(true, std::memory_order_relaxed);
+      }
+      queued_ = Job{id, {}, std::move(spec), ctx, persist};
+    }
+    cv_.notify_all();
+    if (woke)
+      wake(wakeFd_);
+    return id;
+  }
+
+  void ChainBuildService::cancel()
+  {
+    bool woke = false;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      cancelMainLocked(woke);
+    }
+    if (woke)
+      wake(wakeFd_);
+  }
+
+  uint64_t ChainBuildService::submitStandby(std::string slot, pedal::chain::ChainSpec spec,
+                                            const pedal::dsp::ProcessContext &ctx)
+  {
+    uint64_t id;
+    bool woke = false;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      id = nextId_++;
+      for (auto it = standby_.begin(); it != standby_.end(); ++it)
+      {
+        if (it->slot != slot)
+          continue;
+        supersedeLocked(it->id, slot, woke);
+        standby_.erase(it);
+        break;
+      }
+      if (buildingId_ != 0 && buildingSlot_ == slot)
+      {
+        dropped_ = true;
+        cancel_.store(true, std::memory_order_relaxed);
+      }
+      standby_.push_back(Job{id, std::move(slot), std::move(spec), ctx, false});
+    }
+    cv_.notify_all();
+    if (woke)
+      wake(wakeFd_);
+    return id;
+  }
+
+  void ChainBuildService::cancelStandby(const std::string &slot)
+  {
+    bool woke = false;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (auto it = standby_.begin(); it != standby_.end(); ++it)
+      {
+        if (it->slot != slot)
+          continue;
+        supersedeLocked(it->id, slot, woke);
+        standby_.erase(it);
+        break;
+      }
+      if (buildingId_ != 0 && buildingSlot_ == slot)
+      {
+        dropped_ = true;
+        cancel_.store(true, std::memory_order_relaxed);
+      }
+    }
+    if (woke)
+      wake(wakeFd_);
+  }
+
+  std::vector<ChainBuildService::Result> ChainBuildService::takeResults()
+  {
+    uint64_t count;
+    (void)!::read(wakeFd_, &count, sizeof(count));
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<Result> out;
+    out.swap(results_);
+    return out;
+  }
+
+  std::optional<pedal::chain::ChainSpec> ChainBuildService::inFlightSpec() const
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (queued_)
+      return queued_->spec;
+    if (buildingId_ != 0 && buildingSlot_.empty())
+      return buildingSpec_;
+    return std::nullopt;
+  }
+
+  nlohmann::json ChainBuildService::status() const
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    nlohmann::json j;
+    if (buildingId_ != 0)
+    {
+      j["state"] = "building";
+      j["jobId"] = buildingId_;
+      j["nodesDone"] = nodesDone_.load(std::memory_order_relaxed);
+      j["nodesTotal"] = nodesTotal_.load(std::memory_order_relaxed);
+      if (!buildingSlot_.empty())
+        j["slot"] = buildingSlot_;
+    }
+    else
+    {
+      j["state"] = queued_ ? "queued" : "idle";
+    }
+    if (queued_)
+      j["queuedJobId"] = queued_->id;
+    if (!standby_.empty())
+      j["standbyQueued"] = standby_.size();
+    if (!last_.is_null())
+      j["last"] = last_;
+    return j;
+  }
+
+  void ChainBuildService::finish(Result r)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (!r.superseded && r.slot.empty())
+      {
+        last_ = nlohmann::json{{"jobId", r.id}, {"ok", r.ok}, {"buildMs", r.buildMs}};
+        if (!r.error.empty())
+          last_["error"] = r.error;
+        if (!r.warning.empty())
+          last_["warning"] = r.warning;
+      }
+      buildingId_ = 0;
+      buildingSlot_.clear();
+      results_.push_back(std::move(r));
+    }
+    wake(wakeFd_);
+  }
+
+  void ChainBuildService::run()
+  {
+    pedal::dsp::dropToNormalPriority("Control: build thread");
+
+    for (;;)
+    {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cv_.wait(lk, [&] { return stop_ || queued_.has_value() || !standby_.empty(); });
+        if (stop_)
+          return;
+        if (queued_)
+        {
+          job = std::move(*queued_);
+          queued_.reset();
+        }
+        else
+        {
+          job = std::move(standby_.front());
+          standby_.pop_front();
+        }
+        buildingId_ = job.id;
+        buildingSlot_ = job.slot;
+        buildingSpec_ = job.spec;
+        preempted_ = false;
+        dropped_ = false;
+        cancel_.store(false, std::memory_order_relaxed);
+        nodesDone_.store(0, std::memory_order_relaxed);
+        nodesTotal_.store(job.spec.chain.size(), std::memory_order_relaxed);
+      }
+
+      pedal::dsp::BuildChainOptions opts;
+      opts.parallelFor = [this](size_t n, const std::function<void(size_t)> &fn) { pool_->parallelFor(n, fn); };
+      opts.cancel = &cancel_;
+      opts.progress = [this](size_t done, size_t) { nodesDone_.store(done, std::memory_order_relaxed); };
+
+      const auto t0 = std::chrono::steady_clock::now();
+      std::string err;
+      auto built = pedal::dsp::buildChain(job.spec, job.ctx, err, opts);
+
+      bool superseded = cancel_.load(std::memory_order_relaxed);
+      if (!job.slot.empty())
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        superseded = dropped_;
+        if (!superseded && preempted_ && (!built || !built->chain))
+        {
+          // Gave way to a main job: back to the front of the line.
+          buildingId_ = 0;
+          buildingSlot_.clear();
+          standby_.push_front(std::move(job));
+          continue;
+        }
+      }
+
+      Result r;
+      r.id = job.id;
+      r.slot = job.slot;
+      r.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+      r.blockFrames = job.ctx.maxBlockFrames;
+      r.persist = job.persist;
+      // A build that completed anyway after a newer submit() still loses to it.
+      if (superseded)
+      {
+        r.superseded = true;
+        r.error = "superseded by a newer chain";
+      }
+      else if (!built || !built->chain)
+      {
+        r.error = err;
+      }
+      else
+      {
+        r.ok = true;
+        r.warning = built->warning;
+        r.chain = std::move(built->chain);
+        r.spec = std::move(job.spec);
+        if (r.slot.empty())
+          std::printf("Control: chain job %llu built in %.1f ms\n", (unsigned long long)r.id, r.buildMs);
+        else
+          std::printf("Control: chain job %llu built in %.1f ms for standby slot '%s'\n", (unsigned long long)r.id,
+                      r.buildMs, r.slot.c_str());
+      }
+      finish(std::move(r));
+    }
+  }
+
+} // namespace pedal::control
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "signal_chain.h"
+#include "signal_chain_schema.h"
+
+namespace pedal::control
+{
+
+  // Background chain builds for the control server. One job builds at a time on the service's own
+  // thread, and its nodes build in parallel on a few helpers, so a NAM load and an IR FFT overlap.
+  // All of them drop the inherited SCHED_FIFO for SCHED_OTHER, below the audio thread and its
+  // workers. A newer submit() supersedes the queued job and cancels the one in flight at the
+  // next node boundary, like pendingChain coalescing on the audio side: only the newest spec comes
+  // out as a chain. Finished jobs (including superseded ones, so their requesters get an answer)
+  // wait in takeResults(); wakeFd() is readable while there are any.
+  //
+  // Standby builds (preload_chain) queue separately, one per slot, and only run while no main job
+  // is queued: a main submit() preempts a standby build in flight, which then starts over.
+  class ChainBuildService
+  {
+  public:
+    struct Result
+    {
+      uint64_t id = 0;
+      std::string slot; // standby slot it was built for; empty = the main chain
+      bool ok = false;
+      bool superseded = false; // replaced by a newer submit(); chain is null
+      std::string error;
+      std::string warning;
+      pedal::chain::ChainSpec spec;
+      uint32_t blockFrames = 0; // ctx.maxBlockFrames it was built for
+      bool persist = false;
+      double buildMs = 0.0;
+      std::shared_ptr<pedal::dsp::SignalChain> chain;
+    };
+
+    ChainBuildService();
+    ~ChainBuildService();
+
+    ChainBuildService(const ChainBuildService &) = delete;
+    ChainBuildService &operator=(const ChainBuildService &) = delete;
+
+    // nodeThreads helpers besides the build thread itself (0 = nodes build one after the other).
+    bool start(int nodeThreads);
+    // Cancels the build in flight and joins; queued jobs are dropped.
+    void stop();
+
+    // Queues a build of `spec` with `ctx` (copied); returns the job id (never 0).
+    uint64_t submit(pedal::chain::ChainSpec spec, const pedal::dsp::ProcessContext &ctx, bool persist);
+    // Supersedes the main job queued or building without queueing a new one.
+    void cancel();
+
+    // Queues a standby build for `slot`, superseding an older one for the same slot.
+    uint64_t submitStandby(std::string slot, pedal::chain::ChainSpec spec, const pedal::dsp::ProcessContext &ctx);
+    // Supersedes the standby job for `slot` (queued or building), if any.
+    void cancelStandby(const std::string &slot);
+
+    int wakeFd() const { return wakeFd_; }
+    std::vector<Result> takeResults();
+
+    // Spec of the newest main job still queued or building, if any.
+    std::optional<pedal::chain::ChainSpec> inFlightSpec() const;
+
+    // {"state":"idle"|"queued"|"building","jobId","nodesDone","nodesTotal","last":{...}}; "slot" when
+    // the build is a standby one, "standbyQueued" while any are waiting.
+    nlohmann::json status() const;
+
+  private:
+    struct Job
+    {
+      uint64_t id = 0;
+      std::string slot;
+      pedal::chain::ChainSpec spec;
+      pedal::dsp::ProcessContext ctx;
+      bool persist = false;
+    };
+
+    class NodePool;
+
+    void run();
+    void finish(Result r);
+    // mutex_ held; the caller writes wakeFd_ afterwards if `woke` got set.
+    void supersedeLocked(uint64_t id, const std::string &slot, bool &woke);
+    void cancelMainLocked(bool &woke);
+
+    std::unique_ptr<NodePool> pool_;
+    std::thread thread_;
+    int wakeFd_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    uint64_t nextId_ = 1;
+    std::optional<Job> queued_;
+    std::deque<Job> standby_; // at most one per slot, oldest first
+    uint64_t buildingId_ = 0;
+    std::string buildingSlot_;
+    pedal::chain::ChainSpec buildingSpec_;
+    bool preempted_ = false; // the standby build in flight gave way to a main job
+    bool dropped_ = false;   // ... or was superseded for its slot
+    std::vector<Result> results_;
+    nlohmann::json last_; // summary of the newest finished, non-superseded job
+
+    std::atomic<bool> cancel_{false};
+    std::atomic<size_t> nodesDone_{0};
+    std::atomic<size_t> nodesTotal_{0};
+  };
+
+} // namespace pedal::control
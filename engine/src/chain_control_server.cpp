@@ -1,18 +1,25 @@
 #include "chain_control_server.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <map>
 
 #include <fcntl.h>
-#include <poll.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#include "chain_build_service.h"
 #include "signal_chain_nodes.h"
+#include "signal_taps.h"
+#include "standby_chains.h"
+#include "telemetry.h"
 
 namespace pedal::control
 {
@@ -24,57 +31,75 @@ namespace pedal::control
     ::unlink(p.c_str());
   }
 
-  static bool writeAll(int fd, const char *buf, size_t n)
+  using Clock = std::chrono::steady_clock;
+
+  // Longest request line; a client that sends more without a newline is dropped.
+  static constexpr size_t kMaxLineBytes = 1024 * 1024;
+  // Output queued for a client that doesn't read it; past this the client is dropped.
+  static constexpr size_t kMaxQueuedBytes = 8 * 1024 * 1024;
+  static constexpr size_t kMaxClients = 32;
+  // subscribe intervals are clamped to this range.
+  static constexpr uint32_t kMinStreamMs = 10;
+  static constexpr uint32_t kMaxStreamMs = 60000;
+  // epoll_wait timeout with nothing due sooner (persist, period size requests).
+  static constexpr int kIdleWaitMs = 200;
+
+  // One subscribe stream of a client; off while interval is 0.
+  struct Stream
+  {
+    std::chrono::milliseconds interval{0};
+    Clock::time_point due{};
+  };
+
+  // A connected client. It sends newline-delimited requests on one connection for as long as it
+  // likes; replies and subscribe events are queued in `out` and written as the socket takes them.
+  struct Client
+  {
+    int fd = -1;
+    std::string in;       // read, not yet a whole line
+    std::string out;      // not yet written
+    uint32_t events = 0;  // registered with epoll
+    bool eof = false;     // peer shut down its side: close once nothing is owed
+    bool broken = false;
+    uint32_t waiting = 0; // replies waiting for a build
+    Stream levels;
+    Stream stats;
+    Stream costs;
+    pedal::telemetry::Levels levelsAcc; // since this client's last levels event
+  };
+
+  // Keyed by a connection id that is never reused (unlike fds), so a reply to a client that hung
+  // up while its build ran can't reach a newer one.
+  using ClientMap = std::map<uint64_t, Client>;
+
+  // Writes what the socket takes now; the rest waits for EPOLLOUT.
+  static void flushOut(Client &c)
   {
     size_t off = 0;
-    while (off < n)
+    while (off < c.out.size())
     {
-      ssize_t w = ::write(fd, buf + off, n - off);
+      // MSG_NOSIGNAL: a client that hung up must not SIGPIPE the engine.
+      ssize_t w = ::send(c.fd, c.out.data() + off, c.out.size() - off, MSG_NOSIGNAL);
       if (w < 0)
       {
         if (errno == EINTR)
           continue;
-        return false;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+          c.broken = true;
+        break;
       }
       off += (size_t)w;
     }
-    return true;
+    c.out.erase(0, off);
   }
 
-  static bool sendJsonLine(int fd, const Json &j)
+  static void sendJsonLine(Client &c, const Json &j)
   {
-    std::string s = j.dump();
-    s.push_back('\n');
-    return writeAll(fd, s.data(), s.size());
-  }
-
-  static std::optional<std::string> readLine(int fd, size_t maxBytes)
-  {
-    std::string out;
-    out.reserve(1024);
-
-    char c;
-    while (out.size() < maxBytes)
-    {
-      ssize_t r = ::read(fd, &c, 1);
-      if (r == 0)
-        break;
-      if (r < 0)
-      {
-        if (errno == EINTR)
-          continue;
-        if (errno == EAGAIN || errno == EWOULDBLOCK)
-          continue;
-        return std::nullopt;
-      }
-      if (c == '\n')
-        break;
-      out.push_back(c);
-    }
-
-    if (out.empty())
-      return std::nullopt;
-    return out;
+    const bool idle = c.out.empty();
+    c.out += j.dump();
+    c.out.push_back('\n');
+    if (idle)
+      flushOut(c);
   }
 
   bool persistChainToDisk(const std::string &path, const pedal::chain::ChainSpec &spec, std::string &err)
@@ -114,7 +139,194 @@ namespace pedal::control
     }
   }
 
-  static Json handleRequest(ChainRuntimeState *state, const Json &req)
+  // set_param writes are deferred this long after the first unsaved edit.
+  static constexpr std::chrono::milliseconds kPersistDelay{1000};
+
+  static void flushPendingPersist(ChainRuntimeState *state, bool force)
+  {
+    if (!state->persistPending)
+      return;
+    if (!force && std::chrono::steady_clock::now() < state->persistDue)
+      return;
+
+    state->persistPending = false;
+    std::string err;
+    if (!persistChainToDisk(state->configPath, state->lastSpec, err))
+      std::fprintf(stderr, "Control: persist failed: %s\n", err.c_str());
+  }
+
+  // The spec the next rebuild should start from: the newest one submitted, else the published one.
+  static pedal::chain::ChainSpec newestSpec(ChainRuntimeState *state)
+  {
+    if (auto spec = state->builds->inFlightSpec())
+      return std::move(*spec);
+    return state->lastSpec;
+  }
+
+  // Rebuilds the newest spec for a new period size requested by the audio thread. Not persisted:
+  // the spec itself didn't change.
+  static void applyBlockFramesRequest(ChainRuntimeState *state)
+  {
+    const uint32_t frames = state->requestedBlockFrames.load(std::memory_order_acquire);
+    if (frames == 0 || frames == state->ctx.maxBlockFrames)
+      return;
+
+    state->ctx.maxBlockFrames = frames;
+    const uint64_t id = state->builds->submit(newestSpec(state), state->ctx, false);
+    std::printf("Control: chain job %llu rebuilds for %u-frame periods\n", (unsigned long long)id, frames);
+
+    // Standby chains too; each slot is "building" again until its rebuild lands.
+    for (auto &[slot, spec] : state->standby->specs())
+    {
+      std::string err;
+      (void)state->standby->reserve(slot, state->builds->submitStandby(slot, spec, state->ctx), spec, err);
+    }
+  }
+
+  // Queues a validated spec for a background build. The reply goes out when the job finishes
+  // (waitFor = job id), or immediately if the request asked for "async".
+  static Json submitChain(ChainRuntimeState *state, const pedal::chain::ChainSpec &validated, const Json &req,
+                          uint64_t &waitFor)
+  {
+    const uint64_t id = state->builds->submit(validated, state->ctx, true);
+    if (req.contains("async") && req["async"].is_boolean() && req["async"].get<bool>())
+      return Json{{"ok", true}, {"jobId", id}, {"queued", true}};
+    waitFor = id;
+    return Json::object();
+  }
+
+  // preload_chain: reserves the slot, then builds like set_chain without publishing.
+  static Json submitStandby(ChainRuntimeState *state, const std::string &slot, const pedal::chain::ChainSpec &validated,
+                            const Json &req, uint64_t &waitFor)
+  {
+    // The id only exists after the submit; reserve first so a full table never queues a build.
+    std::string err;
+    if (!state->standby->reserve(slot, 0, validated, err))
+      return Json{{"ok", false}, {"error", err}};
+    const uint64_t id = state->builds->submitStandby(slot, validated, state->ctx);
+    (void)state->standby->reserve(slot, id, validated, err);
+    if (req.contains("async") && req["async"].is_boolean() && req["async"].get<bool>())
+      return Json{{"ok", true}, {"slot", slot}, {"jobId", id}, {"queued", true}};
+    waitFor = id;
+    return Json{{"slot", slot}};
+  }
+
+  // A reply to `client` that waits for chain job `jobId`; `resp` holds fields already known.
+  struct PendingReply
+  {
+    uint64_t jobId;
+    uint64_t client;
+    Json resp;
+  };
+
+  // Publishes finished builds and sends the replies waiting on them.
+  static void finishBuilds(ChainRuntimeState *state, std::vector<PendingReply> &waiting, ClientMap &clients)
+  {
+    for (auto &r : state->builds->takeResults())
+    {
+      Json resp;
+      if (r.ok && r.blockFrames != state->ctx.maxBlockFrames)
+      {
+        // Built for a period size that has since changed; the rebuild for the new one is queued.
+        r.ok = false;
+        r.superseded = true;
+        r.error = "superseded by a newer chain";
+      }
+      if (!r.slot.empty())
+      {
+        // Standby: parked in its slot instead of published, unless the slot was dropped or
+        // preloaded again since.
+        if (r.ok && !state->standby->install(r.slot, r.id, r.chain))
+        {
+          r.ok = false;
+          r.superseded = true;
+          r.error = "superseded by a newer chain";
+        }
+        if (!r.ok)
+          state->standby->release(r.slot, r.id);
+      }
+      else if (r.ok)
+      {
+        state->lastSpec = std::move(r.spec);
+        state->latestChain = r.chain;
+        std::atomic_store_explicit(&state->pendingChain, r.chain, std::memory_order_release);
+        if (r.persist)
+        {
+          state->persistPending = true;
+          state->persistDue = std::chrono::steady_clock::now();
+        }
+      }
+
+      if (r.ok)
+      {
+        resp = Json{{"ok", true}, {"jobId", r.id}, {"buildMs", r.buildMs}};
+        if (!r.warning.empty())
+          resp["warning"] = r.warning;
+      }
+      else
+      {
+        if (!r.superseded)
+          std::fprintf(stderr, "Control: chain job %llu failed: %s\n", (unsigned long long)r.id, r.error.c_str());
+        resp = Json{{"ok", false}, {"jobId", r.id}, {"error", r.error}};
+        if (r.superseded)
+          resp["superseded"] = true;
+      }
+
+      for (auto it = waiting.begin(); it != waiting.end();)
+      {
+        if (it->jobId != r.id)
+        {
+          ++it;
+          continue;
+        }
+        auto c = clients.find(it->client);
+        if (c != clients.end())
+        {
+          Json out = std::move(it->resp);
+          out.update(resp);
+          if (!r.ok)
+            out.erase("live");
+          sendJsonLine(c->second, out);
+          c->second.waiting--;
+        }
+        it = waiting.erase(it);
+      }
+    }
+  }
+
+  // The validated spec in req["chain"], or nullopt with `error` set to the reply.
+  static std::optional<pedal::chain::ChainSpec> requestChain(ChainRuntimeState *state, const Json &req, Json &error)
+  {
+    if (!req.contains("chain"))
+    {
+      error = Json{{"ok", false}, {"error", "missing chain"}};
+      return std::nullopt;
+    }
+
+    pedal::chain::ValidationError verr;
+    auto parsed = pedal::chain::parseChainJson(req["chain"], verr);
+    if (!parsed)
+    {
+      error = Json{{"ok", false}, {"error", verr.message}};
+      return std::nullopt;
+    }
+
+    parsed->sampleRate = state->ctx.sampleRate;
+
+    auto validated = pedal::chain::validateChainSpec(*parsed, verr);
+    if (!validated)
+      error = Json{{"ok", false}, {"error", verr.message}};
+    return validated;
+  }
+
+  static std::optional<std::string> requestSlot(const Json &req)
+  {
+    if (!req.contains("slot") || !req["slot"].is_string() || req["slot"].get<std::string>().empty())
+      return std::nullopt;
+    return req["slot"].get<std::string>();
+  }
+
+  static Json handleRequest(ChainRuntimeState *state, const Json &req, uint64_t &waitFor)
   {
     if (!req.is_object())
       return Json{{"ok", false}, {"error", "request must be an object"}};
@@ -135,47 +347,488 @@ namespace pedal::control
       if (!current)
         return Json{{"ok", false}, {"error", "no active chain"}};
 
-      return Json{{"ok", true}, {"chain", pedal::chain::chainSpecToJson(current->spec())}};
+      return Json{{"ok", true},
+                  {"chain", pedal::chain::chainSpecToJson(current->spec())},
+                  {"channels", current->channels()},
+                  {"bufferBytes", current->arenaBytes()}};
+    }
+
+    if (cmd == "get_build")
+    {
+      return Json{{"ok", true}, {"build", state->builds->status()}};
+    }
+
+    if (cmd == "get_stats")
+    {
+      if (!state->telemetry || !state->telemetry->running())
+        return Json{{"ok", false}, {"error", "telemetry disabled"}};
+
+      const bool reset = req.contains("reset") && req["reset"].is_boolean() && req["reset"].get<bool>();
+      return Json{{"ok", true}, {"stats", pedal::telemetry::summaryToJson(state->telemetry->snapshot(reset))}};
+    }
+
+    if (cmd == "get_node_costs")
+    {
+      if (!state->telemetry || !state->telemetry->running())
+        return Json{{"ok", false}, {"error", "telemetry disabled"}};
+
+      pedal::telemetry::NodeCostTable t;
+      if (!state->telemetry->nodeCosts(t))
+        return Json{{"ok", false}, {"error", "no node costs yet"}};
+
+      // Only report the table of the chain that is running now, not one that was just replaced.
+      auto current = std::atomic_load_explicit(&state->activeChain, std::memory_order_acquire);
+      if (!current || current->serial() != t.chainSerial)
+        return Json{{"ok", false}, {"error", "no node costs yet"}};
+
+      return Json{{"ok", true}, {"costs", pedal::telemetry::nodeCostsToJson(t)}};
     }
 
     if (cmd == "set_chain")
     {
-      if (!req.contains("chain"))
-        return Json{{"ok", false}, {"error", "missing chain"}};
+      Json error;
+      auto validated = requestChain(state, req, error);
+      if (!validated)
+        return error;
 
-      pedal::chain::ValidationError verr;
-      auto parsed = pedal::chain::parseChainJson(req["chain"], verr);
-      if (!parsed)
-        return Json{{"ok", false}, {"error", verr.message}};
+      return submitChain(state, *validated, req, waitFor);
+    }
 
-      parsed->sampleRate = state->ctx.sampleRate;
+    if (cmd == "preload_chain")
+    {
+      const auto slot = requestSlot(req);
+      if (!slot)
+        return Json{{"ok", false}, {"error", "preload_chain needs a non-empty string slot"}};
 
-      auto validated = pedal::chain::validateChainSpec(*parsed, verr);
+      Json error;
+      auto validated = requestChain(state, req, error);
       if (!validated)
-        return Json{{"ok", false}, {"error", verr.message}};
+        return error;
+
+      return submitStandby(state, *slot, *validated, req, waitFor);
+    }
+
+    if (cmd == "activate_chain")
+    {
+      const auto slot = requestSlot(req);
+      if (!slot)
+        return Json{{"ok", false}, {"error", "activate_chain needs a non-empty string slot"}};
+
+      pedal::chain::ChainSpec spec;
+      std::string err;
+      auto chain = state->standby->take(*slot, spec, err);
+      if (!chain)
+        return Json{{"ok", false}, {"error", err}};
+
+      // Published like a finished set_chain, which it also overrides if one is still building.
+      state->builds->cancel();
+      state->lastSpec = spec;
+      state->latestChain = chain;
+      std::atomic_store_explicit(&state->pendingChain, chain, std::memory_order_release);
+      state->persistPending = true;
+      state->persistDue = std::chrono::steady_clock::now();
+
+      // The slot keeps the preset: a fresh copy builds in the background.
+      Json resp{{"ok", true}, {"slot", *slot}};
+      std::string refillErr;
+      const uint64_t id = state->builds->submitStandby(*slot, spec, state->ctx);
+      if (state->standby->reserve(*slot, id, spec, refillErr))
+        resp["refillJobId"] = id;
+      return resp;
+    }
+
+    if (cmd == "drop_chain")
+    {
+      const auto slot = requestSlot(req);
+      if (!slot)
+        return Json{{"ok", false}, {"error", "drop_chain needs a non-empty string slot"}};
+
+      state->builds->cancelStandby(*slot);
+      if (!state->standby->drop(*slot))
+        return Json{{"ok", false}, {"error", "unknown standby slot: " + *slot}};
+      return Json{{"ok", true}};
+    }
+
+    if (cmd == "list_standby")
+    {
+      return Json{{"ok", true}, {"standby", state->standby->status()}};
+    }
+
+    if (cmd == "start_tap" || cmd == "stop_tap" || cmd == "list_taps")
+    {
+      if (!state->taps)
+        return Json{{"ok", false}, {"error", "taps disabled"}};
+
+      if (cmd == "list_taps")
+        return Json{{"ok", true}, {"taps", state->taps->status()}};
+
+      if (cmd == "stop_tap")
+      {
+        if (!req.contains("tap") || !req["tap"].is_number_integer())
+          return Json{{"ok", false}, {"error", "stop_tap needs integer tap"}};
+        Json summary;
+        if (!state->taps->close(req["tap"].get<int>(), &summary))
+          return Json{{"ok", false}, {"error", "no such tap"}};
+        summary["ok"] = true;
+        return summary;
+      }
+
+      if (!req.contains("point") || !req["point"].is_string() || !req.contains("path") || !req["path"].is_string())
+        return Json{{"ok", false}, {"error", "start_tap needs string point and path"}};
+      const std::string format = (req.contains("format") && req["format"].is_string())
+                                     ? req["format"].get<std::string>()
+                                     : std::string("wav");
+      if (format != "wav" && format != "raw")
+        return Json{{"ok", false}, {"error", "format must be wav or raw"}};
+      const double seconds =
+          (req.contains("seconds") && req["seconds"].is_number()) ? req["seconds"].get<double>() : 0.0;
+
+      // A node point must name a node of the running chain; it records once the node is in the plan.
+      const std::string point = req["point"].get<std::string>();
+      if (point != pedal::dsp::SignalTaps::kInput && point != pedal::dsp::SignalTaps::kOutput)
+      {
+        auto current = std::atomic_load_explicit(&state->activeChain, std::memory_order_acquire);
+        bool found = false;
+        for (size_t i = 0; current && i < current->nodeCount() && !found; i++)
+          found = current->nodeId(i) == point;
+        if (!found)
+          return Json{{"ok", false}, {"error", "unknown point: " + point}};
+      }
+
+      std::string err;
+      const int id = state->taps->open(point, req["path"].get<std::string>(), format == "raw", seconds, err);
+      if (id < 0)
+        return Json{{"ok", false}, {"error", err}};
+      return Json{{"ok", true}, {"tap", id}};
+    }
+
+    if (cmd == "set_param")
+    {
+      if (!req.contains("nodeId") || !req["nodeId"].is_string() || !req.contains("key") || !req["key"].is_string() ||
+          !req.contains("value"))
+        return Json{{"ok", false}, {"error", "set_param needs string nodeId, string key and value"}};
 
-      std::string buildErr;
-      auto built = pedal::dsp::buildChain(*validated, state->ctx, buildErr);
-      if (!built || !built->chain)
-        return Json{{"ok", false}, {"error", buildErr}};
+      const std::string nodeId = req["nodeId"].get<std::string>();
+      const std::string key = req["key"].get<std::string>();
+      const Json &value = req["value"];
 
-      // Persist to disk and publish as pending.
-      std::string persistErr;
-      if (!persistChainToDisk(state->configPath, *validated, persistErr))
-        return Json{{"ok", false}, {"error", "persist failed: " + persistErr}};
+      // While a rebuild is in flight, edits apply on top of it and go through a rebuild themselves:
+      // the chain a live update would reach is about to be replaced.
+      const bool building = state->builds->inFlightSpec().has_value();
+      pedal::chain::ChainSpec next = newestSpec(state);
+      auto it = std::find_if(next.chain.begin(), next.chain.end(),
+                             [&](const pedal::chain::NodeSpec &n)
+                             { return n.id == nodeId; });
+      if (it == next.chain.end())
+        return Json{{"ok", false}, {"error", "unknown nodeId: " + nodeId}};
 
-      state->lastSpec = *validated;
-      std::atomic_store_explicit(&state->pendingChain, built->chain, std::memory_order_release);
+      if (key == "enabled")
+      {
+        if (!value.is_boolean())
+          return Json{{"ok", false}, {"error", "enabled must be a bool"}};
+        it->enabled = value.get<bool>();
+      }
+      else
+      {
+        if (!value.is_primitive() || value.is_null())
+          return Json{{"ok", false}, {"error", "value must be a number, bool or string"}};
+        if (!it->params.is_object())
+          it->params = Json::object();
+        it->params[key] = value;
+      }
+
+      pedal::chain::ValidationError verr;
+      auto validated = pedal::chain::validateChainSpec(std::move(next), verr);
+      if (!validated)
+        return Json{{"ok", false}, {"error", verr.message}};
 
-      Json resp{{"ok", true}};
-      if (!built->warning.empty())
-        resp["warning"] = built->warning;
+      for (const auto &n : validated->chain)
+      {
+        if (n.id != nodeId)
+          continue;
+        if (!building && state->latestChain && state->latestChain->updateNodeParams(n))
+        {
+          state->lastSpec = *validated;
+          if (!state->persistPending)
+            state->persistDue = std::chrono::steady_clock::now() + kPersistDelay;
+          state->persistPending = true;
+          return Json{{"ok", true}, {"live", true}};
+        }
+        break;
+      }
+
+      // Not a live param (or no chain yet): same path as set_chain.
+      Json resp = submitChain(state, *validated, req, waitFor);
+      resp["live"] = false;
       return resp;
     }
 
+    if (cmd == "set_trim")
+    {
+      if (!req.contains("db") || !req["db"].is_number())
+        return Json{{"ok", false}, {"error", "set_trim needs number db"}};
+      if (!state->ctx.inputTrimDb || !state->ctx.inputTrimLin)
+        return Json{{"ok", false}, {"error", "no input trim"}};
+
+      const float db = std::clamp(req["db"].get<float>(), -24.0f, 24.0f);
+      state->ctx.inputTrimDb->store(db);
+      state->ctx.inputTrimLin->store(std::pow(10.0f, db / 20.0f));
+      return Json{{"ok", true}, {"db", db}};
+    }
+
+    if (cmd == "batch")
+    {
+      if (!req.contains("requests") || !req["requests"].is_array())
+        return Json{{"ok", false}, {"error", "batch needs an array requests"}};
+
+      Json replies = Json::array();
+      for (const Json &sub : req["requests"])
+      {
+        if (!sub.is_object())
+        {
+          replies.push_back(Json{{"ok", false}, {"error", "request must be an object"}});
+          continue;
+        }
+        const Json subCmd = sub.value("cmd", Json());
+        if (subCmd == "batch" || subCmd == "subscribe" || subCmd == "unsubscribe")
+        {
+          replies.push_back(Json{{"ok", false}, {"error", "not allowed in a batch"}});
+          continue;
+        }
+
+        // A build in a batch doesn't hold up the rest of it: it answers like "async".
+        Json asyncReq = sub;
+        asyncReq["async"] = true;
+        uint64_t subWait = 0;
+        Json r = handleRequest(state, asyncReq, subWait);
+        if (sub.contains("id"))
+          r["id"] = sub["id"];
+        replies.push_back(std::move(r));
+      }
+      return Json{{"ok", true}, {"replies", std::move(replies)}};
+    }
+
     return Json{{"ok", false}, {"error", "unknown cmd"}};
   }
 
+  // subscribe / unsubscribe: which telemetry streams `c` gets pushed, and how often.
+  static Json handleSubscribe(ChainRuntimeState *state, const ClientMap &clients, Client &c, const Json &req)
+  {
+    const bool hadLevels = c.levels.interval.count() > 0;
+    if (req["cmd"] == "unsubscribe")
+    {
+      c.levels = c.stats = c.costs = Stream{};
+      return Json{{"ok", true}};
+    }
+
+    if (!state->telemetry || !state->telemetry->running())
+      return Json{{"ok", false}, {"error", "telemetry disabled"}};
+
+    const auto now = Clock::now();
+    Json resp{{"ok", true}};
+    Stream streams[3];
+    const char *keys[3] = {"levelsMs", "statsMs", "costsMs"};
+    for (int i = 0; i < 3; i++)
+    {
+      if (!req.contains(keys[i]))
+        continue;
+      if (!req[keys[i]].is_number() || req[keys[i]].get<double>() < 0.0)
+        return Json{{"ok", false}, {"error", std::string(keys[i]) + " must be a non-negative number"}};
+      const double ms = req[keys[i]].get<double>();
+      if (ms == 0.0)
+        continue;
+      streams[i].interval =
+          std::chrono::milliseconds((int64_t)std::clamp(ms, (double)kMinStreamMs, (double)kMaxStreamMs));
+      streams[i].due = now + streams[i].interval;
+      resp[keys[i]] = streams[i].interval.count();
+    }
+    if (resp.size() == 1)
+      return Json{{"ok", false}, {"error", "subscribe needs levelsMs, statsMs or costsMs"}};
+
+    c.levels = streams[0];
+    c.stats = streams[1];
+    c.costs = streams[2];
+    if (c.levels.interval.count() > 0 && !hadLevels)
+    {
+      // Levels are taken for every subscriber at once; with no other one, what piled up since the
+      // last take is stale.
+      bool others = false;
+      for (const auto &[id, o] : clients)
+        others |= &o != &c && o.levels.interval.count() > 0;
+      if (!others)
+        (void)state->telemetry->takeLevels();
+      c.levelsAcc = pedal::telemetry::Levels{};
+    }
+    return resp;
+  }
+
+  // Sends the subscribe events that are due at `now`. A client still working through earlier output
+  // skips the event (levels keep accumulating for it) instead of having more queued.
+  static void pumpStreams(ChainRuntimeState *state, ClientMap &clients, Clock::time_point now)
+  {
+    if (!state->telemetry || !state->telemetry->running())
+      return;
+
+    bool levelsDue = false;
+    for (const auto &[id, c] : clients)
+      levelsDue |= c.levels.interval.count() > 0 && now >= c.levels.due;
+    if (levelsDue)
+    {
+      // One take for every subscriber: each accumulator sees every period once.
+      const pedal::telemetry::Levels l = state->telemetry->takeLevels();
+      for (auto &[id, c] : clients)
+      {
+        if (c.levels.interval.count() > 0)
+          c.levelsAcc.add(l);
+      }
+    }
+
+    std::optional<Json> stats;
+    std::optional<Json> costs;
+    for (auto &[id, c] : clients)
+    {
+      if (c.levels.interval.count() > 0 && now >= c.levels.due)
+      {
+        c.levels.due = now + c.levels.interval;
+        // Nothing drained since the last event: no event either.
+        if (c.out.empty() && c.levelsAcc.periods > 0)
+        {
+          Json e = pedal::telemetry::levelsToJson(c.levelsAcc);
+          e["event"] = "levels";
+          sendJsonLine(c, e);
+          c.levelsAcc = pedal::telemetry::Levels{};
+        }
+      }
+
+      if (c.stats.interval.count() > 0 && now >= c.stats.due)
+      {
+        c.stats.due = now + c.stats.interval;
+        if (c.out.empty())
+        {
+          if (!stats)
+            stats = Json{{"event", "stats"},
+                         {"stats", pedal::telemetry::summaryToJson(state->telemetry->snapshot(false))}};
+          sendJsonLine(c, *stats);
+        }
+      }
+
+      if (c.costs.interval.count() > 0 && now >= c.costs.due)
+      {
+        c.costs.due = now + c.costs.interval;
+        if (c.out.empty())
+        {
+          if (!costs)
+          {
+            // Like get_node_costs: only the table of the chain running now.
+            pedal::telemetry::NodeCostTable t;
+            auto current = std::atomic_load_explicit(&state->activeChain, std::memory_order_acquire);
+            if (state->telemetry->nodeCosts(t) && current && current->serial() == t.chainSerial)
+              costs = Json{{"event", "costs"}, {"costs", pedal::telemetry::nodeCostsToJson(t)}};
+            else
+              costs = Json();
+          }
+          if (!costs->is_null())
+            sendJsonLine(c, *costs);
+        }
+      }
+    }
+  }
+
+  // Milliseconds until the next subscribe event, at most kIdleWaitMs.
+  static int nextStreamWaitMs(const ClientMap &clients, Clock::time_point now)
+  {
+    auto next = now + std::chrono::milliseconds(kIdleWaitMs);
+    for (const auto &[id, c] : clients)
+    {
+      for (const Stream *st : {&c.levels, &c.stats, &c.costs})
+      {
+        if (st->interval.count() > 0)
+          next = std::min(next, st->due);
+      }
+    }
+    if (next <= now)
+      return 0;
+    // Rounded up, so an event isn't polled for a millisecond early.
+    return (int)std::chrono::ceil<std::chrono::milliseconds>(next - now).count();
+  }
+
+  // One request line from client `id`.
+  static void handleLine(ChainRuntimeState *state, ClientMap &clients, uint64_t id, const std::string &line,
+                         std::vector<PendingReply> &waiting)
+  {
+    Client &c = clients.at(id);
+    Json resp;
+    uint64_t waitFor = 0;
+    try
+    {
+      Json req = Json::parse(line);
+      const Json cmd = req.is_object() ? req.value("cmd", Json()) : Json();
+      if (cmd == "subscribe" || cmd == "unsubscribe")
+        resp = handleSubscribe(state, clients, c, req);
+      else
+        resp = handleRequest(state, req, waitFor);
+      // A reply that waits for a build comes after later ones, so replies echo the request's id.
+      if (req.is_object() && req.contains("id"))
+        resp["id"] = req["id"];
+    }
+    catch (const std::exception &e)
+    {
+      resp = Json{{"ok", false}, {"error", std::string("parse error: ") + e.what()}};
+      waitFor = 0;
+    }
+
+    if (waitFor != 0)
+    {
+      waiting.push_back(PendingReply{waitFor, id, std::move(resp)});
+      c.waiting++;
+      return;
+    }
+    sendJsonLine(c, resp);
+  }
+
+  // Reads what client `id` sent and handles each complete line. False once it must be dropped.
+  static bool readClient(ChainRuntimeState *state, ClientMap &clients, uint64_t id, std::vector<PendingReply> &waiting)
+  {
+    Client &c = clients.at(id);
+    char buf[64 * 1024];
+    ssize_t r;
+    do
+      r = ::recv(c.fd, buf, sizeof(buf), 0);
+    while (r < 0 && errno == EINTR);
+    if (r < 0)
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    if (r == 0)
+      c.eof = true;
+    c.in.append(buf, (size_t)r);
+
+    // Whole lines; at EOF an unterminated last one counts too (echo ... | socat).
+    size_t start = 0;
+    while (start < c.in.size())
+    {
+      size_t nl = c.in.find('\n', start);
+      if (nl == std::string::npos)
+      {
+        if (!c.eof)
+          break;
+        nl = c.in.size();
+      }
+      std::string line = c.in.substr(start, nl - start);
+      start = std::min(nl + 1, c.in.size());
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (!line.empty())
+        handleLine(state, clients, id, line, waiting);
+    }
+    c.in.erase(0, start);
+
+    if (c.in.size() > kMaxLineBytes)
+    {
+      sendJsonLine(c, Json{{"ok", false}, {"error", "request line too long"}});
+      return false;
+    }
+    return true;
+  }
+
   std::thread startControlServer(ChainRuntimeState *state)
   {
     return std::thread([state]()
@@ -204,7 +857,7 @@ namespace pedal::control
 
     ::chmod(sockPath.c_str(), 0666);
 
-    if (::listen(srv, 4) < 0)
+    if (::listen(srv, 16) < 0)
     {
       std::fprintf(stderr, "Control: listen() failed: %s\n", std::strerror(errno));
       ::close(srv);
@@ -213,58 +866,170 @@ namespace pedal::control
 
     std::printf("Control: unix socket %s\n", sockPath.c_str());
 
-    // Non-blocking accept so we can exit cleanly on shutdown.
+    // Non-blocking accept: a client that went away between the wakeup and accept() can't stall us.
     int flags = ::fcntl(srv, F_GETFL, 0);
     if (flags >= 0)
       ::fcntl(srv, F_SETFL, flags | O_NONBLOCK);
 
-    while (state->running.load(std::memory_order_relaxed))
+    ChainBuildService builds;
+    if (!builds.start(state->buildThreads))
+    {
+      std::fprintf(stderr, "Control: build service failed to start\n");
+      ::close(srv);
+      return;
+    }
+    state->builds = &builds;
+
+    StandbyChains standby;
+    StandbyChains::Config standbyCfg;
+    standbyCfg.maxSlots = state->standbySlots;
+    standbyCfg.warmMs = state->standbyWarmMs;
+    standbyCfg.threadInit = state->standbyThreadInit;
+    standby.start(standbyCfg, state->inputHistory);
+    state->standby = &standby;
+
+    // Level-triggered: the listening socket, the build service's wakeup and every client.
+    constexpr uint64_t kListenKey = 0;
+    constexpr uint64_t kBuildsKey = 1;
+    int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    const auto watch = [&](int fd, uint64_t key, uint32_t events) {
+      epoll_event ev{};
+      ev.events = events;
+      ev.data.u64 = key;
+      return ::epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) == 0;
+    };
+    const bool serving = ep >= 0 && watch(srv, kListenKey, EPOLLIN) && watch(builds.wakeFd(), kBuildsKey, EPOLLIN);
+    if (!serving)
+      std::fprintf(stderr, "Control: epoll setup failed: %s\n", std::strerror(errno));
+
+    ClientMap clients;
+    uint64_t nextClient = kBuildsKey + 1;
+    std::vector<PendingReply> waiting;
+
+    const auto dropClient = [&](ClientMap::iterator it) {
+      ::epoll_ctl(ep, EPOLL_CTL_DEL, it->second.fd, nullptr);
+      ::close(it->second.fd);
+      return clients.erase(it);
+    };
+
+    while (serving && state->running.load(std::memory_order_relaxed))
     {
-      pollfd pfd{};
-      pfd.fd = srv;
-      pfd.events = POLLIN;
-      int pr = ::poll(&pfd, 1, 200);
-      if (pr < 0)
+      epoll_event events[64];
+      int n = ::epoll_wait(ep, events, 64, nextStreamWaitMs(clients, Clock::now()));
+      if (n < 0)
       {
         if (errno == EINTR)
           continue;
-        std::fprintf(stderr, "Control: poll() failed: %s\n", std::strerror(errno));
+        std::fprintf(stderr, "Control: epoll_wait() failed: %s\n", std::strerror(errno));
         break;
       }
-      if (pr == 0)
-        continue;
+      applyBlockFramesRequest(state);
 
-      int cfd = ::accept(srv, nullptr, nullptr);
-      if (cfd < 0)
+      bool buildsDone = false;
+      for (int i = 0; i < n; i++)
       {
-        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+        const uint64_t key = events[i].data.u64;
+        if (key == kBuildsKey)
+        {
+          buildsDone = true;
           continue;
-        std::fprintf(stderr, "Control: accept() failed: %s\n", std::strerror(errno));
-        break;
-      }
+        }
 
-      auto line = readLine(cfd, 1024 * 1024);
-      if (!line)
-      {
-        ::close(cfd);
-        continue;
-      }
+        if (key == kListenKey)
+        {
+          for (;;)
+          {
+            int cfd = ::accept4(srv, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (cfd < 0)
+            {
+              if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED)
+                std::fprintf(stderr, "Control: accept() failed: %s\n", std::strerror(errno));
+              break;
+            }
+            if (clients.size() >= kMaxClients)
+            {
+              const std::string busy = Json{{"ok", false}, {"error", "too many clients"}}.dump() + "\n";
+              (void)::send(cfd, busy.data(), busy.size(), MSG_NOSIGNAL);
+              ::close(cfd);
+              continue;
+            }
+            const uint64_t id = nextClient++;
+            if (!watch(cfd, id, EPOLLIN | EPOLLRDHUP))
+            {
+              ::close(cfd);
+              continue;
+            }
+            Client &c = clients[id];
+            c.fd = cfd;
+            c.events = EPOLLIN | EPOLLRDHUP;
+          }
+          continue;
+        }
 
-      Json resp;
-      try
-      {
-        Json req = Json::parse(*line);
-        resp = handleRequest(state, req);
+        auto it = clients.find(key);
+        if (it == clients.end())
+          continue;
+        Client &c = it->second;
+        if (events[i].events & EPOLLOUT)
+          flushOut(c);
+        const uint32_t ev = events[i].events;
+        if ((ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !c.eof && !readClient(state, clients, key, waiting))
+          c.broken = true;
+        // Hung up both ways (or failed): nobody is left to read a reply.
+        if (ev & (EPOLLERR | EPOLLHUP))
+          c.broken = true;
       }
-      catch (const std::exception &e)
+
+      if (buildsDone)
+        finishBuilds(state, waiting, clients);
+      // After the replies: a finished set_chain is written out here, not on its response path.
+      flushPendingPersist(state, false);
+      pumpStreams(state, clients, Clock::now());
+
+      // Drop what is finished or broken; wait for EPOLLOUT only while output is queued.
+      for (auto it = clients.begin(); it != clients.end();)
       {
-        resp = Json{{"ok", false}, {"error", std::string("parse error: ") + e.what()}};
+        Client &c = it->second;
+        if (c.broken || c.out.size() > kMaxQueuedBytes || (c.eof && c.waiting == 0 && c.out.empty()))
+        {
+          it = dropClient(it);
+          continue;
+        }
+        // Once the peer is done sending there is nothing left to read, so no more EPOLLIN for it.
+        uint32_t want = c.eof ? 0u : (uint32_t)(EPOLLIN | EPOLLRDHUP);
+        if (!c.out.empty())
+          want |= EPOLLOUT;
+        if (want != c.events)
+        {
+          epoll_event ev{};
+          ev.events = want;
+          ev.data.u64 = it->first;
+          ::epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+          c.events = want;
+        }
+        ++it;
       }
-
-      sendJsonLine(cfd, resp);
-      ::close(cfd);
     }
 
+    builds.stop();
+    state->builds = nullptr;
+    standby.stop();
+    state->standby = nullptr;
+    for (auto &w : waiting)
+    {
+      auto it = clients.find(w.client);
+      if (it != clients.end())
+        sendJsonLine(it->second, Json{{"ok", false}, {"jobId", w.jobId}, {"error", "engine shutting down"}});
+    }
+    // Best effort: whatever the sockets take without blocking.
+    for (auto it = clients.begin(); it != clients.end();)
+    {
+      flushOut(it->second);
+      it = dropClient(it);
+    }
+    if (ep >= 0)
+      ::close(ep);
+    flushPendingPersist(state, true);
     ::close(srv);
     unlinkIfExists(sockPath); });
   }
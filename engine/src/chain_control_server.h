@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
@@ -9,9 +10,23 @@
 #include "signal_chain.h"
 #include "signal_chain_schema.h"
 
+namespace pedal::telemetry
+{
+  class Telemetry;
+}
+
+namespace pedal::dsp
+{
+  class InputHistory;
+  class SignalTaps;
+}
+
 namespace pedal::control
 {
 
+  class ChainBuildService;
+  class StandbyChains;
+
   struct ChainRuntimeState
   {
     // Atomic ops on shared_ptr use std::atomic_load/store/exchange free functions.
@@ -22,20 +37,87 @@ namespace pedal::control
     // Only accessed on the control thread.
     pedal::chain::ChainSpec lastSpec;
 
+    // Newest chain built from lastSpec; may still be waiting to be swapped in. set_param edits it in
+    // place. Only accessed on the control thread.
+    std::shared_ptr<pedal::dsp::SignalChain> latestChain;
+
+    // set_param persists lazily so a knob sweep ends up as one write once it settles.
+    // Only accessed on the control thread.
+    bool persistPending = false;
+    std::chrono::steady_clock::time_point persistDue{};
+
+    // Only accessed on the control thread once the server runs.
     pedal::dsp::ProcessContext ctx;
 
+    // Set by the audio thread when it switches to a new period size (ALSA_SCHED=adaptive). The
+    // control thread then moves ctx.maxBlockFrames over and republishes lastSpec built for it.
+    std::atomic<uint32_t> requestedBlockFrames{0};
+
+    // Engine telemetry served by get_stats; null when ALSA_TELEMETRY=0. Set before the server starts.
+    pedal::telemetry::Telemetry *telemetry = nullptr;
+
+    // Helper threads that build a chain's nodes in parallel (ALSA_BUILD_THREADS). Set before the
+    // server starts.
+    int buildThreads = 2;
+
+    // Background chain builds; owned and set by the control thread while the server runs.
+    ChainBuildService *builds = nullptr;
+
+    // Recent engine input (written by the audio thread) that standby chains are fed from; null = they
+    // only get their build-time prewarm. Set before the server starts, like the standby knobs:
+    // ALSA_STANDBY_CHAINS slots, ALSA_STANDBY_WARM_MS of input, and the warming thread's init hook.
+    pedal::dsp::InputHistory *inputHistory = nullptr;
+    size_t standbySlots = 8;
+    uint32_t standbyWarmMs = 250;
+    void (*standbyThreadInit)() = nullptr;
+
+    // preload_chain slots; owned and set by the control thread while the server runs.
+    StandbyChains *standby = nullptr;
+
+    // Record points for start_tap / stop_tap / list_taps; null = no taps. Set before the server starts.
+    pedal::dsp::SignalTaps *taps = nullptr;
+
     std::atomic<bool> running{true};
 
     std::string configPath = "/opt/pedal/config/chain.json";
     std::string socketPath = "/tmp/pedal-dsp.sock";
   };
 
-  // Starts a simple line-delimited JSON Unix-domain socket control server.
-  // Requests (one per line):
+  // Starts a line-delimited JSON Unix-domain socket control server. One epoll thread serves many
+  // clients at once, each on a connection it keeps open for as many requests as it likes.
+  // Requests (one per line, optional "id" echoed in the reply):
   //   {"cmd":"get_chain"}
-  //   {"cmd":"set_chain","chain":{...}}
+  //   {"cmd":"set_chain","chain":{...}} (optional "async":true)
+  //   {"cmd":"set_param","nodeId":"...","key":"...","value":...} (optional "async":true)
+  //   {"cmd":"get_build"}
   //   {"cmd":"list_types"}
-  // Responses are one JSON per line.
+  //   {"cmd":"get_stats"} or {"cmd":"get_stats","reset":true}
+  //   {"cmd":"get_node_costs"}
+  //   {"cmd":"preload_chain","slot":"...","chain":{...}} (optional "async":true)
+  //   {"cmd":"activate_chain","slot":"..."}
+  //   {"cmd":"drop_chain","slot":"..."}
+  //   {"cmd":"list_standby"}
+  //   {"cmd":"start_tap","point":"...","path":"..."} (optional "seconds", "format":"wav"|"raw")
+  //   {"cmd":"stop_tap","tap":N}
+  //   {"cmd":"list_taps"}
+  //   {"cmd":"set_trim","db":N}
+  //   {"cmd":"batch","requests":[{...},...]}
+  //   {"cmd":"subscribe"} with any of "levelsMs", "statsMs", "costsMs"; {"cmd":"unsubscribe"}
+  // Responses are one JSON per line. set_param applies live params (see nodeTypeManifest) to the
+  // running chain without a rebuild and answers "live":true; anything else falls back to a rebuild.
+  // Rebuilds run on a ChainBuildService while the server keeps answering other clients; the
+  // requester gets its reply when the build finishes (or right away with "jobId" if it asked for
+  // "async", then polls get_build). A newer rebuild supersedes older ones still in flight, which
+  // answer "superseded":true. A published chain is persisted after the reply went out.
+  // preload_chain builds a chain into a named standby slot (StandbyChains) without publishing it;
+  // activate_chain publishes a ready slot at once, as if set_chain had just finished, and rebuilds the
+  // slot so the preset stays preloaded.
+  // start_tap streams a node's output (by id), or "input"/"output", to a float32 file until
+  // stop_tap or its "seconds" run out (SignalTaps).
+  // batch answers {"ok":true,"replies":[...]} in request order; builds in it answer like "async".
+  // subscribe pushes {"event":"levels"|"stats"|"costs",...} lines at those intervals (Telemetry
+  // takeLevels, snapshot and nodeCosts) until unsubscribe or the connection closes; a client that
+  // hasn't read its earlier output skips events rather than piling them up.
   std::thread startControlServer(ChainRuntimeState *state);
 
   // Writes canonical chain JSON to disk atomically.
@@ -0,0 +1,654 @@
+// Offline chain renderer / benchmark: runs a chain.json (or a UI preset) through SignalChain::process
+// at fixed block sizes as fast as possible and prints a JSON report.
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sndfile.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "cycle_clock.h"
+#include "json.hpp"
+#include "rt_worker_pool.h"
+#include "signal_chain.h"
+#include "signal_chain_schema.h"
+#include "telemetry.h"
+
+using Json = nlohmann::json;
+
+// -------------------- Allocation counting --------------------
+// Every operator new while gCountAllocs is set counts as an allocation on the process path (any
+// thread, so pipeline workers are included). malloc() calls from C libraries are not seen.
+static std::atomic<bool> gCountAllocs{false};
+static std::atomic<uint64_t> gAllocCount{0};
+static std::atomic<uint64_t> gAllocBytes{0};
+
+static void *countedAlloc(size_t n, size_t align)
+{
+  if (gCountAllocs.load(std::memory_order_relaxed))
+  {
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    gAllocBytes.fetch_add(n, std::memory_order_relaxed);
+  }
+  if (n == 0)
+    n = 1;
+  void *p = (align > alignof(std::max_align_t)) ? std::aligned_alloc(align, (n + align - 1) / align * align)
+                                                : std::malloc(n);
+  return p;
+}
+
+void *operator new(size_t n)
+{
+  if (void *p = countedAlloc(n, 0))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t n)
+{
+  if (void *p = countedAlloc(n, 0))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new(size_t n, std::align_val_t a)
+{
+  if (void *p = countedAlloc(n, (size_t)a))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t n, std::align_val_t a)
+{
+  if (void *p = countedAlloc(n, (size_t)a))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new(size_t n, const std::nothrow_t &) noexcept { return countedAlloc(n, 0); }
+void *operator new[](size_t n, const std::nothrow_t &) noexcept { return countedAlloc(n, 0); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { std::free(p); }
+
+// -------------------- Args --------------------
+struct Args
+{
+  std::string chainPath;
+  std::string presetPath;
+  std::string namPath; // preset mode: model for the amp block
+  std::string irPath;  // preset mode: IR for the cabinet block
+  std::string inPath;
+  std::string outPath;
+  std::string jsonPath;
+  std::string referencePath; // accuracy report against this render
+  std::vector<uint32_t> blocks{128};
+  int repeat = 1;
+  int warmup = 16;
+  int pipeline = 1;
+  bool failOnAlloc = false;
+};
+
+static void usage(const char *argv0)
+{
+  std::fprintf(stderr,
+               "Usage: %s (--chain <chain.json> | --preset <preset.json> [--nam <model.nam>] [--ir <ir.wav>])\n"
+               "          --in <in.wav> [--out <out.wav>] [--json <report.json>] [--block 64,128,256]\n"
+               "          [--repeat 1] [--warmup 16] [--pipeline 1] [--fail-on-alloc] [--reference <ref.wav>]\n",
+               argv0);
+}
+
+static std::vector<uint32_t> parseBlockList(const char *s)
+{
+  std::vector<uint32_t> out;
+  while (s && *s)
+  {
+    char *end = nullptr;
+    const long v = std::strtol(s, &end, 10);
+    if (end == s)
+    {
+      s++;
+      continue;
+    }
+    if (v > 0 && v <= 8192)
+      out.push_back((uint32_t)v);
+    s = end;
+  }
+  return out;
+}
+
+static bool parseArgs(int argc, char **argv, Args &a)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string k = argv[i];
+    auto need = [&](const char *name) -> const char *
+    {
+      if (i + 1 >= argc)
+      {
+        std::fprintf(stderr, "Missing value for %s\n", name);
+        return nullptr;
+      }
+      return argv[++i];
+    };
+    auto str = [&](const char *name, std::string &dst)
+    {
+      const char *v = need(name);
+      if (v)
+        dst = v;
+      return v != nullptr;
+    };
+    auto num = [&](const char *name, int &dst)
+    {
+      const char *v = need(name);
+      if (v)
+        dst = std::atoi(v);
+      return v != nullptr;
+    };
+
+    bool ok = true;
+    if (k == "--chain")
+      ok = str("--chain", a.chainPath);
+    else if (k == "--preset")
+      ok = str("--preset", a.presetPath);
+    else if (k == "--nam")
+      ok = str("--nam", a.namPath);
+    else if (k == "--ir")
+      ok = str("--ir", a.irPath);
+    else if (k == "--in")
+      ok = str("--in", a.inPath);
+    else if (k == "--out")
+      ok = str("--out", a.outPath);
+    else if (k == "--json")
+      ok = str("--json", a.jsonPath);
+    else if (k == "--reference")
+      ok = str("--reference", a.referencePath);
+    else if (k == "--block")
+    {
+      const char *v = need("--block");
+      ok = (v != nullptr);
+      if (v)
+        a.blocks = parseBlockList(v);
+    }
+    else if (k == "--repeat")
+      ok = num("--repeat", a.repeat);
+    else if (k == "--warmup")
+      ok = num("--warmup", a.warmup);
+    else if (k == "--pipeline")
+      ok = num("--pipeline", a.pipeline);
+    else if (k == "--fail-on-alloc")
+      a.failOnAlloc = true;
+    else if (k == "-h" || k == "--help")
+      return false;
+    else
+    {
+      std::fprintf(stderr, "Unknown arg: %s\n", k.c_str());
+      return false;
+    }
+    if (!ok)
+      return false;
+  }
+
+  if (a.chainPath.empty() == a.presetPath.empty() || a.inPath.empty() || a.blocks.empty())
+    return false;
+  a.repeat = std::max(1, a.repeat);
+  a.warmup = std::max(0, a.warmup);
+  a.pipeline = std::clamp(a.pipeline, 1, 8);
+  return true;
+}
+
+// -------------------- Chain loading --------------------
+static std::optional<Json> readJsonFile(const std::string &path)
+{
+  try
+  {
+    std::ifstream f(path);
+    if (!f.is_open())
+    {
+      std::fprintf(stderr, "Could not open %s\n", path.c_str());
+      return std::nullopt;
+    }
+    Json j;
+    f >> j;
+    return j;
+  }
+  catch (const std::exception &e)
+  {
+    std::fprintf(stderr, "Invalid JSON in %s: %s\n", path.c_str(), e.what());
+    return std::nullopt;
+  }
+}
+
+// UI presets (app/neural-pedal-interface/presets) describe pedals/amp/cabinet by model name and
+// carry no asset paths, so the amp and cabinet assets come from the command line. Drive-type
+// pedals map to the overdrive node; other pedal categories have no engine node yet and are skipped.
+static pedal::chain::ChainSpec presetToChainSpec(const Json &p, const Args &a, std::vector<std::string> &warnings)
+{
+  using pedal::chain::NodeSpec;
+  pedal::chain::ChainSpec spec;
+
+  NodeSpec in;
+  in.id = "input";
+  in.type = "input";
+  in.category = "utility";
+  spec.chain.push_back(in);
+
+  if (p.contains("pedals") && p["pedals"].is_array())
+  {
+    std::vector<Json> pedals(p["pedals"].begin(), p["pedals"].end());
+    std::stable_sort(pedals.begin(), pedals.end(), [](const Json &x, const Json &y)
+                     { return x.value("position", 0) < y.value("position", 0); });
+    for (const Json &pd : pedals)
+    {
+      const std::string cat = pd.value("category", "");
+      if (cat != "overdrive" && cat != "distortion" && cat != "fuzz" && cat != "boost")
+      {
+        warnings.push_back("preset pedal '" + pd.value("id", "?") + "' (" + cat + ") has no engine node; skipped");
+        continue;
+      }
+      NodeSpec n;
+      n.id = pd.value("id", "pedal");
+      n.type = "overdrive";
+      n.category = "fx";
+      n.enabled = pd.value("enabled", true);
+      n.params = Json::object();
+      if (pd.contains("params") && pd["params"].is_object())
+      {
+        for (const char *key : {"drive", "tone", "mix"})
+        {
+          if (pd["params"].contains(key) && pd["params"][key].is_number())
+            n.params[key] = pd["params"][key];
+        }
+      }
+      spec.chain.push_back(n);
+    }
+  }
+
+  const Json amp = p.value("amp", Json());
+  NodeSpec nam;
+  nam.id = amp.is_object() ? amp.value("id", "amp") : "amp";
+  nam.type = "nam_model";
+  nam.category = "amp";
+  nam.enabled = amp.is_object() && amp.value("enabled", true);
+  if (!a.namPath.empty())
+    nam.asset = pedal::chain::AssetRef{a.namPath};
+  spec.chain.push_back(nam);
+
+  const Json cab = p.value("cabinet", Json());
+  NodeSpec ir;
+  ir.id = cab.is_object() ? cab.value("id", "cabinet") : "cabinet";
+  ir.type = "ir_convolver";
+  ir.category = "cab";
+  ir.enabled = cab.is_object() && cab.value("enabled", true) &&
+               !(amp.is_object() && amp.value("includesCabinet", false));
+  if (!a.irPath.empty())
+    ir.asset = pedal::chain::AssetRef{a.irPath};
+  spec.chain.push_back(ir);
+
+  NodeSpec out;
+  out.id = "output";
+  out.type = "output";
+  out.category = "utility";
+  spec.chain.push_back(out);
+  return spec;
+}
+
+static std::optional<pedal::chain::ChainSpec> loadSpec(const Args &a, std::vector<std::string> &warnings)
+{
+  const bool preset = !a.presetPath.empty();
+  auto j = readJsonFile(preset ? a.presetPath : a.chainPath);
+  if (!j)
+    return std::nullopt;
+
+  pedal::chain::ValidationError verr;
+  std::optional<pedal::chain::ChainSpec> parsed;
+  try
+  {
+    parsed = preset ? presetToChainSpec(*j, a, warnings) : pedal::chain::parseChainJson(*j, verr);
+  }
+  catch (const std::exception &e)
+  {
+    verr.message = e.what();
+  }
+  if (!parsed)
+  {
+    std::fprintf(stderr, "Invalid chain (parse): %s\n", verr.message.c_str());
+    return std::nullopt;
+  }
+  auto validated = pedal::chain::validateChainSpec(*parsed, verr);
+  if (!validated)
+    std::fprintf(stderr, "Invalid chain (validate): %s\n", verr.message.c_str());
+  return validated;
+}
+
+// -------------------- WAV I/O --------------------
+// First channel only: the engine's input is mono.
+static bool readWavMono(const std::string &path, std::vector<float> &x, int &sr)
+{
+  SF_INFO info{};
+  SNDFILE *sf = sf_open(path.c_str(), SFM_READ, &info);
+  if (!sf)
+  {
+    std::fprintf(stderr, "Failed to open input wav %s: %s\n", path.c_str(), sf_strerror(nullptr));
+    return false;
+  }
+  std::vector<float> inter((size_t)info.frames * (size_t)info.channels);
+  const sf_count_t got = sf_readf_float(sf, inter.data(), info.frames);
+  sf_close(sf);
+
+  x.resize((size_t)got);
+  for (sf_count_t i = 0; i < got; i++)
+    x[(size_t)i] = inter[(size_t)i * (size_t)info.channels];
+  sr = info.samplerate;
+  return got > 0;
+}
+
+// All channels, one vector each.
+static bool readWavChannels(const std::string &path, std::vector<std::vector<float>> &y, int &sr)
+{
+  SF_INFO info{};
+  SNDFILE *sf = sf_open(path.c_str(), SFM_READ, &info);
+  if (!sf)
+  {
+    std::fprintf(stderr, "Failed to open reference wav %s: %s\n", path.c_str(), sf_strerror(nullptr));
+    return false;
+  }
+  std::vector<float> inter((size_t)info.frames * (size_t)info.channels);
+  const sf_count_t got = sf_readf_float(sf, inter.data(), info.frames);
+  sf_close(sf);
+
+  y.assign((size_t)info.channels, std::vector<float>((size_t)got));
+  for (sf_count_t i = 0; i < got; i++)
+    for (int c = 0; c < info.channels; c++)
+      y[(size_t)c][(size_t)i] = inter[(size_t)i * (size_t)info.channels + (size_t)c];
+  sr = info.samplerate;
+  return got > 0;
+}
+
+// One channel per entry of y (a stereo chain renders two).
+static bool writeWav(const std::string &path, const std::vector<std::vector<float>> &y, int sr)
+{
+  SF_INFO info{};
+  info.samplerate = sr;
+  info.channels = (int)y.size();
+  info.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+
+  const size_t frames = y.front().size();
+  std::vector<float> inter(frames * y.size());
+  for (size_t i = 0; i < frames; i++)
+    for (size_t c = 0; c < y.size(); c++)
+      inter[i * y.size() + c] = y[c][i];
+
+  SNDFILE *sf = sf_open(path.c_str(), SFM_WRITE, &info);
+  if (!sf)
+  {
+    std::fprintf(stderr, "Failed to open output wav: %s\n", sf_strerror(nullptr));
+    return false;
+  }
+  const sf_count_t wrote = sf_writef_float(sf, inter.data(), (sf_count_t)frames);
+  sf_close(sf);
+  return wrote == (sf_count_t)frames;
+}
+
+// -------------------- Accuracy --------------------
+// Per output channel, against the same channel of a reference render (a mono reference serves
+// every channel): peak error and error energy, both relative to the reference.
+static Json accuracyReport(const std::vector<std::vector<float>> &y, const std::vector<std::vector<float>> &ref)
+{
+  auto db = [](double ratio) { return ratio > 0.0 ? std::round(200.0 * std::log10(ratio)) / 10.0 : -999.0; };
+  Json channels = Json::array();
+  for (size_t c = 0; c < y.size(); c++)
+  {
+    const std::vector<float> &r = ref[std::min(c, ref.size() - 1)];
+    const size_t n = std::min(y[c].size(), r.size());
+    double maxErr = 0.0, peak = 0.0, errEnergy = 0.0, refEnergy = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+      const double e = (double)y[c][i] - (double)r[i];
+      maxErr = std::max(maxErr, std::fabs(e));
+      peak = std::max(peak, std::fabs((double)r[i]));
+      errEnergy += e * e;
+      refEnergy += (double)r[i] * (double)r[i];
+    }
+    channels.push_back(Json{{"frames", n},
+                            {"maxAbsErr", maxErr},
+                            {"maxErrDb", peak > 0.0 ? db(maxErr / peak) : 0.0},
+                            {"errRmsDb", refEnergy > 0.0 ? db(std::sqrt(errEnergy / refEnergy)) : 0.0}});
+  }
+  return channels;
+}
+
+// -------------------- Render --------------------
+static void configureDenormals()
+{
+#if defined(__SSE__)
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#ifdef _MM_DENORMALS_ZERO_ON
+  _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+#endif
+#endif
+}
+
+static Json histToJson(const pedal::telemetry::LatencyHistogram &h)
+{
+  return Json{{"count", h.count()},
+              {"mean", std::round(h.mean())},
+              {"p50", h.percentile(0.50)},
+              {"p99", h.percentile(0.99)},
+              {"p999", h.percentile(0.999)},
+              {"max", h.max()}};
+}
+
+// Renders x once per repeat at `block` frames per process() call. Returns the report entry. y gets the
+// first pass, one vector per chain output channel.
+static std::optional<Json> renderAt(const pedal::chain::ChainSpec &spec, const Args &a, uint32_t block,
+                                    const std::vector<float> &x, std::vector<std::vector<float>> *y,
+                                    pedal::dsp::RtWorkerPool *workers, std::vector<std::string> &warnings)
+{
+  pedal::dsp::ProcessContext ctx;
+  ctx.sampleRate = spec.sampleRate;
+  ctx.maxBlockFrames = block;
+  ctx.nodeTicks = true;
+  ctx.workers = workers;
+  ctx.pipelineStages = (uint32_t)a.pipeline;
+
+  std::string err;
+  auto built = pedal::dsp::buildChain(spec, ctx, err);
+  if (!built || !built->chain)
+  {
+    std::fprintf(stderr, "buildChain failed (block=%u): %s\n", block, err.c_str());
+    return std::nullopt;
+  }
+  if (!built->warning.empty() && block == a.blocks.front())
+    warnings.push_back(built->warning);
+  pedal::dsp::SignalChain &chain = *built->chain;
+
+  const double nsPerTick = pedal::dsp::nsPerCycle();
+  const size_t nodes = std::min(chain.nodeCount(), pedal::telemetry::PeriodRecord::kMaxNodes);
+  std::vector<uint64_t> nodeTicks(nodes, 0);
+  uint32_t ticks[pedal::telemetry::PeriodRecord::kMaxNodes];
+
+  const uint32_t channels = chain.channels();
+  std::vector<float> in(block);
+  std::vector<std::vector<float>> out(channels, std::vector<float>(block));
+  float *outs[pedal::dsp::kMaxChannels] = {};
+  for (uint32_t c = 0; c < channels; c++)
+    outs[c] = out[c].data();
+  if (y)
+    y->assign(channels, std::vector<float>(x.size(), 0.0f));
+  pedal::telemetry::LatencyHistogram blockNs;
+  uint64_t chainTicks = 0;
+  uint64_t timedFrames = 0;
+  uint64_t blockIndex = 0;
+  gAllocCount.store(0, std::memory_order_relaxed);
+  gAllocBytes.store(0, std::memory_order_relaxed);
+
+  for (int pass = 0; pass < a.repeat; pass++)
+  {
+    for (size_t idx = 0; idx < x.size(); idx += block)
+    {
+      const size_t n = std::min<size_t>(block, x.size() - idx);
+      std::memcpy(in.data(), x.data() + idx, sizeof(float) * n);
+      if (n < block)
+        std::memset(in.data() + n, 0, sizeof(float) * (block - n));
+
+      gCountAllocs.store(true, std::memory_order_relaxed);
+      const uint64_t t0 = pedal::dsp::cycleCount();
+      chain.process(in.data(), outs, block);
+      const uint64_t t1 = pedal::dsp::cycleCount();
+      chain.idle();
+      gCountAllocs.store(false, std::memory_order_relaxed);
+
+      // Warm-up blocks (first caches, FFTW wisdom, lazy state) don't count toward timing.
+      if (blockIndex++ >= (uint64_t)a.warmup)
+      {
+        blockNs.record((uint64_t)((double)(t1 - t0) * nsPerTick));
+        chainTicks += t1 - t0;
+        timedFrames += block;
+        const size_t got = chain.copyNodeTicks(ticks, nodes);
+        for (size_t i = 0; i < got; i++)
+          nodeTicks[i] += ticks[i];
+      }
+
+      if (y && pass == 0)
+        for (uint32_t c = 0; c < channels; c++)
+          std::memcpy((*y)[c].data() + idx, outs[c], sizeof(float) * n);
+    }
+  }
+
+  const double chainNs = (double)chainTicks * nsPerTick;
+  const double audioNs = (double)timedFrames * 1e9 / (double)spec.sampleRate;
+  Json nodeJson = Json::array();
+  for (size_t i = 0; i < nodes; i++)
+  {
+    const double ns = (double)nodeTicks[i] * nsPerTick;
+    nodeJson.push_back(Json{{"id", chain.nodeId(i)},
+                            {"type", chain.nodeType(i)},
+                            {"nsPerSample", timedFrames ? std::round(ns / (double)timedFrames * 100.0) / 100.0 : 0.0},
+                            {"sharePct", chainNs > 0.0 ? std::round(ns * 1000.0 / chainNs) / 10.0 : 0.0}});
+  }
+
+  return Json{{"blockFrames", block},
+              {"blocks", blockIndex},
+              {"timedBlocks", blockNs.count()},
+              {"pipelineStages", chain.pipelineStages()},
+              {"channels", channels},
+              {"deadlineNs", (uint64_t)((double)block * 1e9 / (double)spec.sampleRate)},
+              {"realtimeFactor", chainNs > 0.0 ? std::round(audioNs / chainNs * 10.0) / 10.0 : 0.0},
+              {"nsPerSample", timedFrames ? std::round(chainNs / (double)timedFrames * 100.0) / 100.0 : 0.0},
+              {"blockNs", histToJson(blockNs)},
+              {"allocations", gAllocCount.load(std::memory_order_relaxed)},
+              {"allocatedBytes", gAllocBytes.load(std::memory_order_relaxed)},
+              {"nodes", std::move(nodeJson)}};
+}
+
+int main(int argc, char **argv)
+{
+  Args a;
+  if (!parseArgs(argc, argv, a))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+  configureDenormals();
+
+  std::vector<std::string> warnings;
+  std::vector<float> x;
+  int sr = 0;
+  if (!readWavMono(a.inPath, x, sr))
+    return 1;
+
+  auto spec = loadSpec(a, warnings);
+  if (!spec)
+    return 1;
+  spec->sampleRate = (uint32_t)sr;
+
+  // Pipeline stages need workers; no RT priority offline, the point is throughput.
+  pedal::dsp::RtWorkerPool workers;
+  if (a.pipeline > 1)
+  {
+    pedal::dsp::RtWorkerPool::Config wc;
+    wc.workers = a.pipeline - 1;
+    wc.threadInit = &configureDenormals;
+    if (!workers.start(wc))
+      warnings.push_back("could not start pipeline workers; rendering serially");
+  }
+
+  std::vector<std::vector<float>> ref;
+  if (!a.referencePath.empty())
+  {
+    int refSr = 0;
+    if (!readWavChannels(a.referencePath, ref, refSr))
+      return 1;
+    if (refSr != sr)
+      warnings.push_back("reference sample rate " + std::to_string(refSr) + " differs from the input's");
+  }
+
+  std::vector<std::vector<float>> y;
+  const bool keepOutput = !a.outPath.empty() || !ref.empty();
+
+  Json runs = Json::array();
+  bool allocFree = true;
+  for (uint32_t block : a.blocks)
+  {
+    std::fprintf(stderr, "chain_render: block=%u frames=%zu repeat=%d\n", block, x.size(), a.repeat);
+    auto run = renderAt(*spec, a, block, x, (block == a.blocks.front() && keepOutput) ? &y : nullptr,
+                        workers.size() > 0 ? &workers : nullptr, warnings);
+    if (!run)
+      return 1;
+    allocFree = allocFree && (*run)["allocations"].get<uint64_t>() == 0;
+    runs.push_back(std::move(*run));
+  }
+  workers.stop();
+
+  Json report{{"chain", a.presetPath.empty() ? a.chainPath : a.presetPath},
+              {"input", a.inPath},
+              {"sampleRate", sr},
+              {"inputFrames", x.size()},
+              {"repeat", a.repeat},
+              {"warmupBlocks", a.warmup},
+              {"nsPerTick", pedal::dsp::nsPerCycle()},
+              {"warnings", warnings},
+              {"runs", std::move(runs)}};
+  if (!ref.empty() && !y.empty())
+    report["accuracy"] = Json{{"reference", a.referencePath}, {"channels", accuracyReport(y, ref)}};
+
+  const std::string text = report.dump(2);
+  if (a.jsonPath.empty())
+  {
+    std::printf("%s\n", text.c_str());
+  }
+  else
+  {
+    std::ofstream f(a.jsonPath);
+    f << text << "\n";
+    if (!f)
+    {
+      std::fprintf(stderr, "Failed to write %s\n", a.jsonPath.c_str());
+      return 1;
+    }
+  }
+
+  if (!y.empty() && !a.outPath.empty() && !writeWav(a.outPath, y, sr))
+    return 1;
+  if (a.failOnAlloc && !allocFree)
+  {
+    std::fprintf(stderr, "chain_render: allocations on the process path\n");
+    return 3;
+  }
+  return 0;
+}
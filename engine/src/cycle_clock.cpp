@@ -0,0 +1,28 @@
+#include "cycle_clock.h"
+
+#include <thread>
+
+namespace pedal::dsp
+{
+
+  double nsPerCycle()
+  {
+    static const double ns = []
+    {
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+      using Clock = std::chrono::steady_clock;
+      const auto t0 = Clock::now();
+      const uint64_t c0 = cycleCount();
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      const uint64_t c1 = cycleCount();
+      const auto t1 = Clock::now();
+      const double elapsed = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+      return (c1 > c0) ? elapsed / (double)(c1 - c0) : 1.0;
+#else
+      return 1.0;
+#endif
+    }();
+    return ns;
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace pedal::dsp
+{
+
+  // Cheapest monotonic tick source on this CPU: the TSC on x86, the generic timer (cntvct_el0) on
+  // AArch64, steady_clock nanoseconds elsewhere. Realtime-safe; a handful of cycles, no syscall.
+  inline uint64_t cycleCount() noexcept
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+  }
+
+  // Nanoseconds per cycleCount() tick. Calibrated against steady_clock on first use (sleeps ~20 ms),
+  // so call it once off the audio thread before relying on it there.
+  double nsPerCycle();
+
+} // namespace pedal::dsp
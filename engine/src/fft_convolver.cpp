@@ -1,10 +1,45 @@
 #include "fft_convolver.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
 #include <utility>
 
+using fftw_planner::planC2R;
+using fftw_planner::planR2C;
+
+// y partition yFirst + c += sum_{k=k0}^{k1-1} X[n + lag - k] * H_c[k], each filter clipped to its own
+// partitions (a null filter has none). Where both channels have partitions, one dual pass reads X
+// once for the two of them.
+static void accumulateChannels(const FrequencyDelayLine &x, const PartitionedFilter *const *h, int channels,
+                               int k0, int k1, SplitSpectrumArena &y, int yFirst, int lag = 0) noexcept
+{
+  int end[FFTConvolverPartitioned::kMaxChannels] = {k0, k0};
+  for (int c = 0; c < channels; c++)
+  {
+    if (h[c])
+      end[c] = std::min(k1, h[c]->parts);
+  }
+
+  int from = k0;
+  if (channels == 2)
+  {
+    const int both = std::min(end[0], end[1]);
+    if (both > k0)
+    {
+      x.accumulateDual(h[0]->h, h[1]->h, k0, both, y.re(yFirst), y.im(yFirst), y.re(yFirst + 1), y.im(yFirst + 1),
+                       lag);
+      from = both;
+    }
+  }
+  for (int c = 0; c < channels; c++)
+  {
+    if (h[c])
+      x.accumulate(h[c]->h, from, end[c], y.re(yFirst + c), y.im(yFirst + c), lag);
+  }
+}
+
 FFTConvolverPartitioned::FFTConvolverPartitioned(FFTConvolverPartitioned &&other) noexcept
 {
   *this = std::move(other);
@@ -21,18 +56,21 @@ FFTConvolverPartitioned &FFTConvolverPartitioned::operator=(FFTConvolverPartitio
   mFFT = other.mFFT;
   mBins = other.mBins;
   mParts = other.mParts;
-  mWrite = other.mWrite;
+  mChannels = other.mChannels;
   mReady = other.mReady;
+  mPushed = other.mPushed;
+  for (int i = 0; i < 2; i++)
+    mTailSeq[i].store(other.mTailSeq[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
 
   mTimeIn = std::move(other.mTimeIn);
   mTimeOut = std::move(other.mTimeOut);
   mOverlap = std::move(other.mOverlap);
 
-  mFreqY = other.mFreqY;
-  other.mFreqY = nullptr;
-
-  mH = std::move(other.mH);
+  for (int c = 0; c < kMaxChannels; c++)
+    mFilter[c] = std::move(other.mFilter[c]);
   mX = std::move(other.mX);
+  mY = std::move(other.mY);
+  mTail = std::move(other.mTail);
 
   mPlanFwd = other.mPlanFwd;
   other.mPlanFwd = nullptr;
@@ -43,10 +81,9 @@ FFTConvolverPartitioned &FFTConvolverPartitioned::operator=(FFTConvolverPartitio
   other.mFFT = 0;
   other.mBins = 0;
   other.mParts = 0;
-  other.mWrite = 0;
+  other.mChannels = 1;
   other.mReady = false;
-  other.mH.clear();
-  other.mX.clear();
+  other.mPushed = 0;
 
   return *this;
 }
@@ -57,167 +94,669 @@ void FFTConvolverPartitioned::clear()
 {
   if (mPlanFwd)
   {
-    fftwf_destroy_plan(mPlanFwd);
+    fftw_planner::destroy(mPlanFwd);
     mPlanFwd = nullptr;
   }
   if (mPlanInv)
   {
-    fftwf_destroy_plan(mPlanInv);
+    fftw_planner::destroy(mPlanInv);
     mPlanInv = nullptr;
   }
-  if (mFreqY)
-  {
-    fftwf_free(mFreqY);
-    mFreqY = nullptr;
-  }
 
-  for (auto *p : mH)
-    if (p)
-      fftwf_free(p);
-  for (auto *p : mX)
-    if (p)
-      fftwf_free(p);
-  mH.clear();
-  mX.clear();
+  for (auto &f : mFilter)
+    f.reset();
+  mX.release();
+  mY.release();
+  mTail.release();
 
   mTimeIn.clear();
   mTimeOut.clear();
   mOverlap.clear();
 
-  mBlock = mFFT = mBins = mParts = mWrite = 0;
+  mBlock = mFFT = mBins = mParts = 0;
+  mChannels = 1;
   mReady = false;
+  mPushed = 0;
+  mTailSeq[0].store(0, std::memory_order_relaxed);
+  mTailSeq[1].store(0, std::memory_order_relaxed);
 }
 
-bool FFTConvolverPartitioned::init(const std::vector<float> &ir, int blockSize)
+std::shared_ptr<const PartitionedFilter> PartitionedFilter::build(const float *ir, size_t len, int part)
 {
-  clear();
-  if (blockSize <= 0)
-    return false;
-
-  mBlock = blockSize;
-  mFFT = 2 * mBlock;
-  mBins = mFFT / 2 + 1;
+  if (part <= 0 || len == 0)
+    return nullptr;
 
-  mParts = (int)((ir.size() + (size_t)mBlock - 1) / (size_t)mBlock);
-  if (mParts <= 0)
-    return false;
+  auto f = std::make_shared<PartitionedFilter>();
+  f->part = part;
+  f->fft = 2 * part;
+  f->bins = f->fft / 2 + 1;
+  f->parts = (int)((len + (size_t)part - 1) / (size_t)part);
 
   if (const char *e = std::getenv("ALSA_LOG_IR_INIT"))
   {
     if (std::atoi(e) != 0)
     {
       std::fprintf(stderr,
-                   "IR init: len=%zu block=%d fft=%d bins=%d parts=%d\n",
-                   ir.size(), mBlock, mFFT, mBins, mParts);
+                   "IR init: len=%zu block=%d fft=%d bins=%d parts=%d kernel=%s\n",
+                   len, part, f->fft, f->bins, f->parts, spectral::cmacKernelName());
     }
   }
 
-  mTimeIn.assign((size_t)mFFT, 0.0f);
-  mTimeOut.assign((size_t)mFFT, 0.0f);
-  mOverlap.assign((size_t)mBlock, 0.0f);
-
-  mFreqY = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * (size_t)mBins);
-  if (!mFreqY)
-    return false;
-
-  // Allocate spectra arrays
-  mH.resize((size_t)mParts);
-  mX.resize((size_t)mParts);
-  for (int k = 0; k < mParts; k++)
-  {
-    mH[(size_t)k] = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * (size_t)mBins);
-    mX[(size_t)k] = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * (size_t)mBins);
-    if (!mH[(size_t)k] || !mX[(size_t)k])
-      return false;
-    std::memset(mH[(size_t)k], 0, sizeof(fftwf_complex) * (size_t)mBins);
-    std::memset(mX[(size_t)k], 0, sizeof(fftwf_complex) * (size_t)mBins);
-  }
+  if (!f->h.allocate(f->parts, f->bins))
+    return nullptr;
 
-  // Plans (use ESTIMATE to keep init fast; MEASURE can be done later)
-  mPlanFwd = fftwf_plan_dft_r2c_1d(mFFT, mTimeIn.data(), mX[0], FFTW_ESTIMATE);
-  mPlanInv = fftwf_plan_dft_c2r_1d(mFFT, mFreqY, mTimeOut.data(), FFTW_ESTIMATE);
-  if (!mPlanFwd || !mPlanInv)
-    return false;
+  fftw_planner::FftwRealBuffer time;
+  time.assign((size_t)f->fft, 0.0f);
+  fftwf_plan plan = planR2C(f->fft, time.data(), f->h.re(0), f->h.im(0));
+  if (!plan)
+    return nullptr;
 
   // Precompute IR partitions in frequency domain
   // For each partition: time = [ir_part (N), 0... (N)]  -> FFT size 2N
-  for (int k = 0; k < mParts; k++)
+  for (int k = 0; k < f->parts; k++)
   {
-    std::fill(mTimeIn.begin(), mTimeIn.end(), 0.0f);
-    const size_t start = (size_t)k * (size_t)mBlock;
-    const size_t end = std::min(start + (size_t)mBlock, ir.size());
+    std::fill(time.begin(), time.end(), 0.0f);
+    const size_t start = (size_t)k * (size_t)part;
+    const size_t end = std::min(start + (size_t)part, len);
     for (size_t i = start; i < end; i++)
     {
-      mTimeIn[i - start] = ir[i];
+      time[i - start] = ir[i];
     }
-    // Temporarily use mX[0] as FFT output then copy into H[k]
-    fftwf_execute_dft_r2c(mPlanFwd, mTimeIn.data(), mX[0]);
-    std::memcpy(mH[(size_t)k], mX[0], sizeof(fftwf_complex) * (size_t)mBins);
+    fftwf_execute_split_dft_r2c(plan, time.data(), f->h.re(k), f->h.im(k));
   }
+  fftw_planner::destroy(plan);
+  return f;
+}
 
-  // IMPORTANT: Clear all mX buffers after computing H partitions
-  // mX is the input signal history ring buffer and must start clean
-  for (int k = 0; k < mParts; k++)
-  {
-    std::memset(mX[(size_t)k], 0, sizeof(fftwf_complex) * (size_t)mBins);
-  }
+bool FFTConvolverPartitioned::init(const std::vector<float> &ir, int blockSize)
+{
+  clear();
+  auto filter = PartitionedFilter::build(ir.data(), ir.size(), blockSize);
+  return filter && init(std::move(filter));
+}
+
+bool FFTConvolverPartitioned::init(std::shared_ptr<const PartitionedFilter> filter,
+                                   std::shared_ptr<const PartitionedFilter> filter2)
+{
+  clear();
+  if (!filter || filter->parts <= 0)
+    return false;
+  if (filter2 && (filter2->parts <= 0 || filter2->part != filter->part))
+    return false;
+
+  mBlock = filter->part;
+  mFFT = filter->fft;
+  mBins = filter->bins;
+  mParts = std::max(filter->parts, filter2 ? filter2->parts : 0);
+  mChannels = filter2 ? 2 : 1;
+  mFilter[0] = std::move(filter);
+  mFilter[1] = std::move(filter2);
+
+  mTimeIn.assign((size_t)mFFT, 0.0f);
+  mTimeOut.assign((size_t)mFFT, 0.0f);
+  mOverlap.assign((size_t)mChannels * (size_t)mBlock, 0.0f);
+
+  // Allocate per-instance spectra (zeroed); the IR spectra are shared via mFilter. The history is
+  // as deep as the longer filter.
+  if (!mX.init(mParts, mBins) || !mY.allocate(mChannels, mBins) || !mTail.allocate(2 * mChannels, mBins))
+    return false;
+
+  // Plans come from wisdom when available; otherwise ESTIMATE now and measured in the background
+  // for the next init (see fftw_planner).
+  mPlanFwd = planR2C(mFFT, mTimeIn.data(), mX.writeRe(), mX.writeIm());
+  mPlanInv = planC2R(mFFT, mY.re(0), mY.im(0), mTimeOut.data());
+  if (!mPlanFwd || !mPlanInv)
+    return false;
+
+  // mX is the input signal history and must start clean
+  mX.reset();
 
-  mWrite = 0;
   mReady = true;
   return true;
 }
 
 bool FFTConvolverPartitioned::processBlock(const float *in, float *out, int n)
+{
+  return pushInput(in, n) && finishBlock(out, n);
+}
+
+bool FFTConvolverPartitioned::processBlock(const float *in, float *const *out, int n)
+{
+  return pushInput(in, n) && finishBlock(out, n);
+}
+
+bool FFTConvolverPartitioned::pushInput(const float *in, int n)
 {
   if (!mReady || n != mBlock)
     return false;
 
-  // Write new input block spectrum into ring
+  // Write new input block spectrum into the delay line
   // Only need to clear the second half of the FFT input.
   std::memcpy(mTimeIn.data(), in, sizeof(float) * (size_t)mBlock);
   std::memset(mTimeIn.data() + (size_t)mBlock, 0, sizeof(float) * (size_t)mBlock);
-  fftwf_execute_dft_r2c(mPlanFwd, mTimeIn.data(), mX[(size_t)mWrite]);
+  fftwf_execute_split_dft_r2c(mPlanFwd, mTimeIn.data(), mX.writeRe(), mX.writeIm());
+  mX.push();
+  mPushed++;
+  return true;
+}
+
+bool FFTConvolverPartitioned::finishBlock(float *out, int n)
+{
+  return mChannels == 1 && finishBlock(&out, n);
+}
+
+bool FFTConvolverPartitioned::finishBlock(float *const *out, int n)
+{
+  if (!mReady || n != mBlock)
+    return false;
+
+  // Y_c = sum_{k} X[n-k] * H_c[k]; if presumTail() finished for this block only k = 0 is left.
+  const PartitionedFilter *h[kMaxChannels] = {mFilter[0].get(), mFilter[1].get()};
+  const size_t planeBytes = sizeof(float) * 2u * (size_t)mY.stride();
+  const int slot = (int)(mPushed & 1u);
+  if (mTailSeq[slot].load(std::memory_order_acquire) == mPushed)
+  {
+    for (int c = 0; c < mChannels; c++)
+      std::memcpy(mY.re(c), mTail.re(slot * mChannels + c), planeBytes);
+    accumulateChannels(mX, h, mChannels, 0, 1, mY, 0);
+  }
+  else
+  {
+    std::memset(mY.re(0), 0, planeBytes * (size_t)mChannels);
+    accumulateChannels(mX, h, mChannels, 0, mParts, mY, 0);
+  }
 
-  // Y = sum_{k} X[n-k] * H[k]
-  std::memset(mFreqY, 0, sizeof(fftwf_complex) * (size_t)mBins);
+  // FFTW doesn't normalize; divide by FFT size
+  const float invFFT = 1.0f / (float)mFFT;
 
-  for (int k = 0; k < mParts; k++)
+  for (int c = 0; c < mChannels; c++)
   {
-    int idx = mWrite - k;
-    if (idx < 0)
-      idx += mParts;
+    // IFFT to time
+    fftwf_execute_split_dft_c2r(mPlanInv, mY.re(c), mY.im(c), mTimeOut.data());
+
+    // Overlap-add: first N samples + previous overlap
+    float *overlap = mOverlap.data() + (size_t)c * (size_t)mBlock;
+    float *o = out[c];
+    for (int i = 0; i < mBlock; i++)
+    {
+      float y = (mTimeOut[(size_t)i] * invFFT) + overlap[i];
+      o[i] = y;
+    }
 
-    fftwf_complex *Xk = mX[(size_t)idx];
-    fftwf_complex *Hk = mH[(size_t)k];
-    for (int b = 0; b < mBins; b++)
+    // Save new overlap = second half
+    for (int i = 0; i < mBlock; i++)
     {
-      cmul_acc(mFreqY[(size_t)b], Xk[(size_t)b], Hk[(size_t)b]);
+      overlap[i] = (mTimeOut[(size_t)(i + mBlock)] * invFFT);
     }
   }
 
-  // IFFT to time
-  fftwf_execute_dft_c2r(mPlanInv, mFreqY, mTimeOut.data());
+  return true;
+}
 
-  // FFTW doesn't normalize; divide by FFT size
-  const float invFFT = 1.0f / (float)mFFT;
+void FFTConvolverPartitioned::presumTail() noexcept
+{
+  const uint64_t next = mPushed + 1;
+  const int slot = (int)(next & 1u);
+  if (!mReady || mTailSeq[slot].load(std::memory_order_relaxed) == next)
+    return;
+
+  // Next block n+1 needs sum_{k>=1} X[n+1-k] * H[k]: everything but its own spectrum.
+  const PartitionedFilter *h[kMaxChannels] = {mFilter[0].get(), mFilter[1].get()};
+  std::memset(mTail.re(slot * mChannels), 0, sizeof(float) * 2u * (size_t)mTail.stride() * (size_t)mChannels);
+  accumulateChannels(mX, h, mChannels, 1, mParts, mTail, slot * mChannels, 1);
+  mTailSeq[slot].store(next, std::memory_order_release);
+}
 
-  // Overlap-add: first N samples + previous overlap
-  for (int i = 0; i < mBlock; i++)
+// -------------------- Non-uniform partitioned convolution --------------------
+
+// One tail stage: uniform partitions of size mPart over IR samples [mOffset, mOffset + mParts*mPart).
+// Input accumulates for mRatio periods; the resulting block job (FFT, MAC over partitions, IFFT)
+// then runs one slice per period for the next mRatio periods, starting mDelay periods late.
+// Stereo stages share the FFT and input history; a channel whose IR ends before this stage has no
+// filter and contributes nothing.
+struct FFTConvolverNonUniform::TailStage
+{
+  int mBlock = 0;
+  int mPart = 0;
+  int mRatio = 0; // mPart / mBlock
+  int mFFT = 0;
+  int mBins = 0;
+  int mParts = 0;
+  int mOffset = 0;
+  int mDelay = 0; // periods between block completion and FFT (phase stagger)
+  int mChannels = 1;
+
+  std::vector<float> mAcc; // input accumulation (size mPart)
+  int mAccFill = 0;
+
+  bool mHasBlock = false; // completed block waiting for its job to start
+  int mCountdown = 0;
+  uint64_t mPendingStart = 0;
+
+  int mPhase = -1; // -1 = idle, else 0..mRatio-1
+  uint64_t mJobStart = 0;
+
+  fftw_planner::FftwRealBuffer mTimeIn;  // FFT input (size mFFT); second half stays zero
+  fftw_planner::FftwRealBuffer mTimeOut; // IFFT output (size mFFT)
+  std::shared_ptr<const PartitionedFilter> mFilter[FFTConvolverPartitioned::kMaxChannels];
+  FrequencyDelayLine mX;
+  SplitSpectrumArena mY; // 1 partition per channel
+
+  fftwf_plan mPlanFwd = nullptr;
+  fftwf_plan mPlanInv = nullptr;
+
+  TailStage() = default;
+  TailStage(const TailStage &) = delete;
+  TailStage &operator=(const TailStage &) = delete;
+
+  ~TailStage()
+  {
+    fftw_planner::destroy(mPlanFwd);
+    fftw_planner::destroy(mPlanInv);
+  }
+
+  // stages[c]: this stage of channel c's filter, or nullptr; at least one is set, and set ones
+  // share their layout (see FFTConvolverNonUniform::init).
+  bool init(int block, const NonUniformFilter::Stage *const *stages, int channels)
+  {
+    const NonUniformFilter::Stage *layout = stages[0] ? stages[0] : stages[1];
+    mChannels = channels;
+    mParts = 0;
+    for (int c = 0; c < channels; c++)
+    {
+      if (!stages[c])
+        continue;
+      mFilter[c] = stages[c]->filter;
+      mParts = std::max(mParts, mFilter[c]->parts);
+    }
+    const PartitionedFilter &f = *layout->filter;
+    mBlock = block;
+    mPart = f.part;
+    mRatio = mPart / block;
+    mFFT = f.fft;
+    mBins = f.bins;
+    mOffset = layout->offset;
+    mDelay = layout->delay;
+    if (mParts <= 0 || mRatio < 2)
+      return false;
+
+    mAcc.assign((size_t)mPart, 0.0f);
+    mTimeIn.assign((size_t)mFFT, 0.0f);
+    mTimeOut.assign((size_t)mFFT, 0.0f);
+
+    if (!mX.init(mParts, mBins) || !mY.allocate(mChannels, mBins))
+      return false;
+
+    mPlanFwd = planR2C(mFFT, mTimeIn.data(), mX.writeRe(), mX.writeIm());
+    mPlanInv = planC2R(mFFT, mY.re(0), mY.im(0), mTimeOut.data());
+    return mPlanFwd && mPlanInv;
+  }
+
+  // Called once per period with the period's input, on the audio thread; `now` is the absolute time
+  // of in[0]. Only buffers input and schedules; the heavy part is work().
+  void feed(const float *in, uint64_t now)
   {
-    float y = (mTimeOut[(size_t)i] * invFFT) + mOverlap[(size_t)i];
-    out[i] = y;
+    std::memcpy(mAcc.data() + mAccFill, in, sizeof(float) * (size_t)mBlock);
+    mAccFill += mBlock;
+    if (mAccFill == mPart)
+    {
+      // The previous job always finishes before the next block completes, so mTimeIn is free.
+      std::memcpy(mTimeIn.data(), mAcc.data(), sizeof(float) * (size_t)mPart);
+      mAccFill = 0;
+      mHasBlock = true;
+      mCountdown = mDelay;
+      mPendingStart = now + (uint64_t)mBlock - (uint64_t)mPart;
+    }
+
+    if (mHasBlock)
+    {
+      if (mCountdown == 0)
+      {
+        mHasBlock = false;
+        mPhase = 0;
+        mJobStart = mPendingStart;
+      }
+      else
+      {
+        mCountdown--;
+      }
+    }
   }
 
-  // Save new overlap = second half
-  for (int i = 0; i < mBlock; i++)
+  // This period's slice of the current block job (if any). Runs after feed() and before the next
+  // feed(); may be on another thread. Channel c's ring starts at ring + c * ringStride.
+  void work(float *ring, size_t ringStride, uint64_t mask)
   {
-    mOverlap[(size_t)i] = (mTimeOut[(size_t)(i + mBlock)] * invFFT);
+    if (mPhase < 0)
+      return;
+
+    if (mPhase == 0)
+    {
+      fftwf_execute_split_dft_r2c(mPlanFwd, mTimeIn.data(), mX.writeRe(), mX.writeIm());
+      mX.push();
+      std::memset(mY.re(0), 0, sizeof(float) * 2u * (size_t)mY.stride() * (size_t)mChannels);
+    }
+
+    // This phase's share of sum_k X[n-k] * H[k].
+    const PartitionedFilter *h[FFTConvolverPartitioned::kMaxChannels] = {mFilter[0].get(), mFilter[1].get()};
+    const int k0 = (mPhase * mParts) / mRatio;
+    const int k1 = ((mPhase + 1) * mParts) / mRatio;
+    accumulateChannels(mX, h, mChannels, k0, k1, mY, 0);
+
+    if (mPhase == mRatio - 1)
+    {
+      const float invFFT = 1.0f / (float)mFFT;
+      const uint64_t base = mJobStart + (uint64_t)mOffset;
+      for (int c = 0; c < mChannels; c++)
+      {
+        if (!h[c])
+          continue;
+        fftwf_execute_split_dft_c2r(mPlanInv, mY.re(c), mY.im(c), mTimeOut.data());
+
+        // Overlap-add the full 2P result straight into the shared output ring.
+        float *r = ring + (size_t)c * ringStride;
+        for (int i = 0; i < mFFT; i++)
+          r[(base + (uint64_t)i) & mask] += mTimeOut[(size_t)i] * invFFT;
+      }
+
+      mPhase = -1;
+      return;
+    }
+
+    mPhase++;
   }
+};
 
-  // advance ring write index
-  mWrite++;
-  if (mWrite >= mParts)
-    mWrite = 0;
+FFTConvolverNonUniform::FFTConvolverNonUniform() = default;
+
+FFTConvolverNonUniform::~FFTConvolverNonUniform() { clear(); }
+
+FFTConvolverNonUniform::FFTConvolverNonUniform(FFTConvolverNonUniform &&other) noexcept
+{
+  *this = std::move(other);
+}
+
+FFTConvolverNonUniform &FFTConvolverNonUniform::operator=(FFTConvolverNonUniform &&other) noexcept
+{
+  if (this == &other)
+    return *this;
+
+  clear();
+
+  mBlock = other.mBlock;
+  mReady = other.mReady;
+  mTime = other.mTime;
+  for (int c = 0; c < FFTConvolverPartitioned::kMaxChannels; c++)
+    mFilter[c] = std::move(other.mFilter[c]);
+  mHead = std::move(other.mHead);
+  mStages = std::move(other.mStages);
+  mOutRing = std::move(other.mOutRing);
+  mRingSize = other.mRingSize;
+  mOutMask = other.mOutMask;
+
+  other.mBlock = 0;
+  other.mReady = false;
+  other.mTime = 0;
+  other.mStages.clear();
+  other.mOutRing.clear();
+  other.mRingSize = 0;
+  other.mOutMask = 0;
+  return *this;
+}
+
+void FFTConvolverNonUniform::clear()
+{
+  mStages.clear();
+  for (auto &f : mFilter)
+    f.reset();
+  mOutRing.clear();
+  mRingSize = 0;
+  mOutMask = 0;
+  mTime = 0;
+  mBlock = 0;
+  mReady = false;
+}
+
+// Output of block k (input samples [kP, kP+P)) lands at kP + offset; the last slice of its job runs in
+// period (k+2)*ratio - 2 + delay, so offset >= 2P - 2*block + delay*block keeps writes ahead of reads.
+// If work() may run after that period's output was drained (offloaded), one more block is needed.
+static int minStageOffset(int part, int block, int delay, bool offload)
+{
+  return 2 * part - 2 * block + delay * block + (offload ? block : 0);
+}
+
+std::shared_ptr<const NonUniformFilter> NonUniformFilter::build(const std::vector<float> &ir, int blockSize,
+                                                                int maxTailStages, bool offloadTail)
+{
+  if (blockSize <= 0 || ir.empty())
+    return nullptr;
+
+  auto f = std::make_shared<NonUniformFilter>();
+  f->block = blockSize;
+  f->offloadTail = offloadTail;
+  f->irLen = ir.size();
+  maxTailStages = std::max(0, std::min(maxTailStages, kMaxTailStages));
+
+  // Lay out stages: stage s uses partition blockSize*4^s. Each stage gets the smallest phase stagger
+  // whose FFT/IFFT periods don't collide with an earlier stage, then starts at the earliest IR offset
+  // that stagger allows.
+  struct Layout
+  {
+    int part;
+    int offset;
+    int delay;
+  };
+  std::vector<Layout> layout;
+
+  const int maxRatio = 1 << (2 * std::max(1, maxTailStages));
+  std::vector<uint8_t> busy((size_t)maxRatio, 0);
+  int part = blockSize;
+  for (int s = 0; s < maxTailStages; s++)
+  {
+    part *= 4;
+    const int ratio = part / blockSize;
+
+    int delay = 0;
+    for (int d = 0; d < ratio; d++)
+    {
+      const int fftPhase = (ratio - 1 + d) % ratio;
+      const int ifftPhase = (ratio - 2 + d) % ratio;
+      bool clash = false;
+      for (int p = 0; p < maxRatio && !clash; p++)
+      {
+        const int r = p % ratio;
+        if ((r == fftPhase || r == ifftPhase) && busy[(size_t)p])
+          clash = true;
+      }
+      if (!clash)
+      {
+        delay = d;
+        break;
+      }
+    }
+
+    const int offset = minStageOffset(part, blockSize, delay, offloadTail);
+    if ((size_t)offset >= ir.size())
+      break;
+
+    for (int p = 0; p < maxRatio; p++)
+    {
+      const int r = p % ratio;
+      if (r == (ratio - 1 + delay) % ratio || r == (ratio - 2 + delay) % ratio)
+        busy[(size_t)p] = 1;
+    }
+    layout.push_back(Layout{part, offset, delay});
+  }
+
+  const size_t headLen = layout.empty() ? ir.size() : (size_t)layout.front().offset;
+  f->head = PartitionedFilter::build(ir.data(), headLen, blockSize);
+  if (!f->head)
+    return nullptr;
+
+  for (size_t s = 0; s < layout.size(); s++)
+  {
+    const size_t end = (s + 1 < layout.size()) ? (size_t)layout[s + 1].offset : ir.size();
+    Stage st;
+    st.offset = layout[s].offset;
+    st.delay = layout[s].delay;
+    st.filter = PartitionedFilter::build(ir.data() + st.offset, end - (size_t)st.offset, layout[s].part);
+    if (!st.filter)
+      return nullptr;
+    f->stages.push_back(std::move(st));
+  }
+
+  if (const char *e = std::getenv("ALSA_LOG_IR_INIT"))
+  {
+    if (std::atoi(e) != 0)
+    {
+      std::fprintf(stderr, "IR init (non-uniform): len=%zu block=%d head=%zu offload=%d", ir.size(), blockSize,
+                   headLen, offloadTail ? 1 : 0);
+      for (const auto &st : f->stages)
+        std::fprintf(stderr, " [part=%d offset=%d parts=%d delay=%d]", st.filter->part, st.offset,
+                     st.filter->parts, st.delay);
+      std::fprintf(stderr, "\n");
+    }
+  }
+  return f;
+}
+
+size_t NonUniformFilter::bytes() const
+{
+  size_t n = head ? head->h.bytes() : 0;
+  for (const auto &st : stages)
+    n += st.filter->h.bytes();
+  return n;
+}
+
+bool FFTConvolverNonUniform::init(const std::vector<float> &ir, int blockSize, int maxTailStages, bool offloadTail)
+{
+  clear();
+  auto filter = NonUniformFilter::build(ir, blockSize, maxTailStages, offloadTail);
+  return filter && init(std::move(filter));
+}
+
+bool FFTConvolverNonUniform::init(std::shared_ptr<const NonUniformFilter> filter,
+                                  std::shared_ptr<const NonUniformFilter> filter2)
+{
+  clear();
+  if (!filter || !filter->head)
+    return false;
+  if (filter2 && (!filter2->head || filter2->block != filter->block || filter2->offloadTail != filter->offloadTail))
+    return false;
+
+  // The stage layout only depends on block and offload (the IR length just decides how many stages
+  // fit), so stage s of both filters covers the same samples with the same stagger.
+  const size_t stageCount = std::max(filter->stages.size(), filter2 ? filter2->stages.size() : 0);
+  const int channels = filter2 ? 2 : 1;
+  if (filter2)
+  {
+    for (size_t s = 0; s < std::min(filter->stages.size(), filter2->stages.size()); s++)
+    {
+      const auto &a = filter->stages[s];
+      const auto &b = filter2->stages[s];
+      if (a.offset != b.offset || a.delay != b.delay || a.filter->part != b.filter->part)
+        return false;
+    }
+  }
+
+  mBlock = filter->block;
+  if (!mHead.init(filter->head, filter2 ? filter2->head : nullptr))
+    return false;
+
+  size_t ringNeed = (size_t)mBlock;
+  for (size_t s = 0; s < stageCount; s++)
+  {
+    const NonUniformFilter::Stage *stages[FFTConvolverPartitioned::kMaxChannels] = {
+        s < filter->stages.size() ? &filter->stages[s] : nullptr,
+        (filter2 && s < filter2->stages.size()) ? &filter2->stages[s] : nullptr};
+    const NonUniformFilter::Stage &stage = stages[0] ? *stages[0] : *stages[1];
+    auto st = std::make_unique<TailStage>();
+    if (!st->init(mBlock, stages, channels))
+      return false;
+    ringNeed = std::max(ringNeed, (size_t)stage.offset + 2 * (size_t)stage.filter->part + (size_t)mBlock);
+    mStages.push_back(std::move(st));
+  }
+
+  size_t ringSize = 1;
+  while (ringSize < ringNeed)
+    ringSize <<= 1;
+  mOutRing.assign(ringSize * (size_t)channels, 0.0f);
+  mRingSize = ringSize;
+  mOutMask = (uint64_t)ringSize - 1;
+
+  mFilter[0] = std::move(filter);
+  mFilter[1] = std::move(filter2);
+  mTime = 0;
+  mReady = true;
+  return true;
+}
+
+bool FFTConvolverNonUniform::processBlock(const float *in, float *out, int n)
+{
+  return channels() == 1 && processBlock(in, &out, n);
+}
+
+bool FFTConvolverNonUniform::processBlock(const float *in, float *const *out, int n)
+{
+  if (!pushInput(in, n))
+    return false;
+
+  float *ring = mOutRing.data();
+  for (auto &st : mStages)
+    st->work(ring, mRingSize, mOutMask);
+
+  return finishBlock(out, n);
+}
+
+bool FFTConvolverNonUniform::pushInput(const float *in, int n)
+{
+  if (!mReady || n != mBlock)
+    return false;
+
+  for (auto &st : mStages)
+    st->feed(in, mTime);
+  return mHead.pushInput(in, n);
+}
+
+void FFTConvolverNonUniform::tailWork() noexcept
+{
+  if (!mReady)
+    return;
+
+  float *ring = mOutRing.data();
+  for (auto &st : mStages)
+    st->work(ring, mRingSize, mOutMask);
+  mHead.presumTail();
+}
+
+bool FFTConvolverNonUniform::finishBlock(float *out, int n)
+{
+  return channels() == 1 && finishBlock(&out, n);
+}
+
+bool FFTConvolverNonUniform::finishBlock(float *const *out, int n)
+{
+  if (!mReady || n != mBlock)
+    return false;
+
+  if (!mHead.finishBlock(out, n))
+    return false;
+
+  if (!mStages.empty())
+  {
+    for (int c = 0; c < channels(); c++)
+    {
+      float *ring = mOutRing.data() + (size_t)c * mRingSize;
+      float *o = out[c];
+      for (int i = 0; i < n; i++)
+      {
+        float &slot = ring[(mTime + (uint64_t)i) & mOutMask];
+        o[i] += slot;
+        slot = 0.0f;
+      }
+    }
+  }
 
+  mTime += (uint64_t)n;
   return true;
 }
@@ -1,7 +1,29 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <fftw3.h>
 
+#include "fftw_planner.h"
+#include "freq_delay_line.h"
+#include "spectrum_kernels.h"
+
+// IR partition spectra: `parts` partitions of `part` samples, each zero-padded to 2*part and
+// transformed. Immutable once built, so any number of convolvers (chain rebuilds, repeated nodes)
+// can share one copy.
+struct PartitionedFilter
+{
+  int part = 0;
+  int fft = 0;
+  int bins = 0;
+  int parts = 0;
+  SplitSpectrumArena h;
+
+  // ir[0..len) in partitions of `part` samples. Returns nullptr on failure.
+  static std::shared_ptr<const PartitionedFilter> build(const float *ir, size_t len, int part);
+};
+
 class FFTConvolverPartitioned
 {
 public:
@@ -17,12 +39,36 @@ public:
   // blockSize must match JACK buffer size for minimum latency.
   // ir must be mono float at same sample rate as the stream.
   bool init(const std::vector<float> &ir, int blockSize);
+  // Same, with IR spectra built earlier (blockSize = filter->part). Only per-instance state is allocated.
+  // With filter2 the convolver is stereo: one input, output channel 0 through `filter` and channel 1
+  // through `filter2`. The channels share the input FFT and history, and one MAC pass covers both;
+  // the filters need the same partition size but not the same length.
+  bool init(std::shared_ptr<const PartitionedFilter> filter,
+            std::shared_ptr<const PartitionedFilter> filter2 = nullptr);
 
-  // in/out length must be blockSize. Returns false if not initialized.
+  // in/out length must be blockSize. Returns false if not initialized. The float * overloads are
+  // mono only; the float *const * ones write out[c] for every c < channels().
   bool processBlock(const float *in, float *out, int n);
+  bool processBlock(const float *in, float *const *out, int n);
+
+  // processBlock() in two halves: pushInput() transforms the block into the input history,
+  // finishBlock() produces its output. Lets callers schedule other work in between.
+  bool pushInput(const float *in, int n);
+  bool finishBlock(float *out, int n);
+  bool finishBlock(float *const *out, int n);
+
+  // Optional, between blocks: pre-sum the next block's contribution from partitions 1..P-1, which
+  // only depend on input already seen. The next block then only MACs partition 0.
+  // May run on another thread after pushInput(), concurrently with finishBlock(), as long as it
+  // completes before the next pushInput(). The result is double-buffered and tagged with its
+  // block number, so an unfinished pre-sum is simply ignored.
+  void presumTail() noexcept;
 
   int blockSize() const { return mBlock; }
   bool ready() const { return mReady; }
+  int channels() const { return mChannels; }
+
+  static constexpr int kMaxChannels = 2;
 
 private:
   void clear();
@@ -30,27 +76,126 @@ private:
   int mBlock = 0;
   int mFFT = 0;
   int mBins = 0;
-  int mParts = 0;
-  int mWrite = 0;
+  int mParts = 0; // the longer filter's
+  int mChannels = 1;
   bool mReady = false;
+  uint64_t mPushed = 0; // blocks pushed since init; the current block is number mPushed
 
-  std::vector<float> mTimeIn;  // fft input (size mFFT)
-  std::vector<float> mTimeOut; // ifft output (size mFFT)
-  std::vector<float> mOverlap; // overlap (size mBlock)
-  fftwf_complex *mFreqY = nullptr;
+  // mTail partitions (b & 1) * mChannels + c hold the pre-sum for block b once mTailSeq[b & 1] == b.
+  std::atomic<uint64_t> mTailSeq[2] = {0, 0};
 
-  std::vector<fftwf_complex *> mH; // IR partitions spectra
-  std::vector<fftwf_complex *> mX; // ring buffer of input block spectra
+  fftw_planner::FftwRealBuffer mTimeIn;  // fft input (size mFFT)
+  fftw_planner::FftwRealBuffer mTimeOut; // ifft output (size mFFT), one channel at a time
+  std::vector<float> mOverlap; // overlap (mBlock per channel)
+
+  // Split-complex spectra, one contiguous aligned arena each.
+  std::shared_ptr<const PartitionedFilter> mFilter[kMaxChannels]; // IR partition spectra (shared)
+  FrequencyDelayLine mX;    // input block spectra history
+  SplitSpectrumArena mY;    // accumulator (1 partition per channel)
+  SplitSpectrumArena mTail; // pre-summed partitions 1..P-1 (double buffer, 2 * mChannels partitions)
 
   fftwf_plan mPlanFwd = nullptr;
   fftwf_plan mPlanInv = nullptr;
+};
 
-  static inline void cmul_acc(fftwf_complex &y, const fftwf_complex &a, const fftwf_complex &b)
+// Everything FFTConvolverNonUniform precomputes from an IR: the head filter plus the layout and
+// spectra of the tail stages. Shareable like PartitionedFilter.
+struct NonUniformFilter
+{
+  static constexpr int kMaxTailStages = 3;
+
+  struct Stage
   {
-    // y += a*b
-    const float ar = a[0], ai = a[1];
-    const float br = b[0], bi = b[1];
-    y[0] += ar * br - ai * bi;
-    y[1] += ar * bi + ai * br;
-  }
+    int offset = 0; // first IR sample covered
+    int delay = 0;  // phase stagger in periods
+    std::shared_ptr<const PartitionedFilter> filter;
+  };
+
+  int block = 0;
+  bool offloadTail = false;
+  size_t irLen = 0;
+  std::shared_ptr<const PartitionedFilter> head;
+  std::vector<Stage> stages;
+
+  size_t bytes() const;
+
+  // See FFTConvolverNonUniform::init. Returns nullptr on failure.
+  static std::shared_ptr<const NonUniformFilter> build(const std::vector<float> &ir, int blockSize,
+                                                       int maxTailStages = kMaxTailStages, bool offloadTail = false);
+};
+
+// Non-uniform partitioned convolver for long IRs (rooms/reverbs).
+//
+// The first part of the IR (head) runs through a uniform FFTConvolverPartitioned at blockSize, so
+// the output has zero added latency. The rest of the IR is split into tail stages whose partition
+// size grows by 4x per stage (blockSize*4, *16, *64). A stage with partition P only needs a new
+// input spectrum every P/blockSize periods, and its output isn't due until 2P - 2*blockSize
+// samples later. The FFT, multiply-accumulate and IFFT for each stage block are therefore spread
+// over those periods, and stages are phase-staggered so their big FFTs don't land in the same
+// period. Per-period cost stays roughly flat instead of growing with IR length.
+class FFTConvolverNonUniform
+{
+public:
+  static constexpr int kMaxTailStages = NonUniformFilter::kMaxTailStages;
+
+  FFTConvolverNonUniform();
+  ~FFTConvolverNonUniform();
+
+  FFTConvolverNonUniform(const FFTConvolverNonUniform &) = delete;
+  FFTConvolverNonUniform &operator=(const FFTConvolverNonUniform &) = delete;
+
+  FFTConvolverNonUniform(FFTConvolverNonUniform &&other) noexcept;
+  FFTConvolverNonUniform &operator=(FFTConvolverNonUniform &&other) noexcept;
+
+  // maxTailStages=0 degenerates to a plain uniform convolver (head only).
+  // offloadTail lays the stages out so tailWork() may run after finishBlock() (e.g. on a helper
+  // thread); that costs one more block of head length.
+  bool init(const std::vector<float> &ir, int blockSize, int maxTailStages = kMaxTailStages,
+            bool offloadTail = false);
+  // Same, with the filter built earlier (and possibly shared with other instances). filter2 makes
+  // it stereo like FFTConvolverPartitioned: it must come from the same blockSize and offloadTail,
+  // which gives both filters the same stage layout (one may just have fewer stages).
+  bool init(std::shared_ptr<const NonUniformFilter> filter,
+            std::shared_ptr<const NonUniformFilter> filter2 = nullptr);
+
+  // in/out length must be blockSize. in and out must not alias. Returns false if not initialized.
+  // Mono and per-channel overloads as in FFTConvolverPartitioned.
+  bool processBlock(const float *in, float *out, int n);
+  bool processBlock(const float *in, float *const *out, int n);
+
+  // Offloaded use, once per block: pushInput(in) copies/transforms the input (in may be reused
+  // afterwards), then tailWork() and finishBlock(out) may run concurrently on two threads.
+  // tailWork() does the tail stages' slice for this period plus the head pre-sum for the next
+  // block, and must complete before the next pushInput(). Requires init(..., offloadTail=true).
+  bool pushInput(const float *in, int n);
+  void tailWork() noexcept;
+  bool finishBlock(float *out, int n);
+  bool finishBlock(float *const *out, int n);
+
+  // Optional, between blocks; forwards to the head (see FFTConvolverPartitioned::presumTail).
+  void presumTail() noexcept { mHead.presumTail(); }
+
+  int blockSize() const { return mBlock; }
+  bool ready() const { return mReady; }
+  int tailStages() const { return (int)mStages.size(); }
+  int channels() const { return mHead.channels(); }
+
+private:
+  struct TailStage;
+
+  void clear();
+
+  int mBlock = 0;
+  bool mReady = false;
+  uint64_t mTime = 0; // samples processed since init
+
+  std::shared_ptr<const NonUniformFilter> mFilter[FFTConvolverPartitioned::kMaxChannels];
+  FFTConvolverPartitioned mHead;
+  std::vector<std::unique_ptr<TailStage>> mStages;
+
+  // Tail stages overlap-add into these rings (mRingSize per channel); processBlock drains
+  // [mTime, mTime + blockSize).
+  std::vector<float> mOutRing;
+  size_t mRingSize = 0;
+  uint64_t mOutMask = 0;
 };
@@ -0,0 +1,340 @@
+#include "fftw_planner.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+#include <sched.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace fftw_planner
+{
+  namespace
+  {
+    enum class Kind
+    {
+      R2C,
+      C2R
+    };
+
+    constexpr const char *kMeasureArg = "--fftw-measure";
+
+    struct State
+    {
+      std::mutex plannerMutex; // guards every FFTW planner and wisdom call
+
+      std::mutex queueMutex; // guards the fields below
+      std::condition_variable cv;
+      std::deque<std::pair<Kind, int>> queue;
+      std::set<std::pair<Kind, int>> seen;
+      std::thread worker;
+      pid_t child = -1; // measuring process, while one runs
+      bool stop = false;
+
+      bool configured = false;
+      unsigned measureFlag = FFTW_MEASURE;
+      std::string wisdomPath;
+    };
+
+    State &state()
+    {
+      static State s;
+      return s;
+    }
+
+    fftwf_plan makePlan(Kind kind, int n, float *t, float *re, float *im, unsigned flags)
+    {
+      fftwf_iodim dim{n, 1, 1};
+      if (kind == Kind::R2C)
+        return fftwf_plan_guru_split_dft_r2c(1, &dim, 0, nullptr, t, re, im, flags);
+      return fftwf_plan_guru_split_dft_c2r(1, &dim, 0, nullptr, re, im, t, flags);
+    }
+
+    bool saveWisdomLocked(State &s)
+    {
+      if (s.wisdomPath.empty())
+        return false;
+      // Write-then-rename so a power cut mid-save leaves the previous file intact.
+      const std::string tmp = s.wisdomPath + ".tmp";
+      if (!fftwf_export_wisdom_to_filename(tmp.c_str()))
+        return false;
+      return std::rename(tmp.c_str(), s.wisdomPath.c_str()) == 0;
+    }
+
+    // Runs this executable as `<self> --fftw-measure r2c|c2r N measure|patient FILE` (runMeasureChild):
+    // it imports FILE, measures, and writes the result back to FILE.
+    bool measureInChild(State &s, Kind kind, int n, const char *wisdomFile)
+    {
+      char self[PATH_MAX];
+      const ssize_t len = ::readlink("/proc/self/exe", self, sizeof(self) - 1);
+      if (len <= 0)
+        return false;
+      self[len] = '\0';
+
+      std::string nArg = std::to_string(n);
+      std::string kindArg = (kind == Kind::R2C) ? "r2c" : "c2r";
+      std::string flagArg = (s.measureFlag == FFTW_PATIENT) ? "patient" : "measure";
+      std::string measureArg = kMeasureArg;
+      std::string fileArg = wisdomFile;
+      char *argv[] = {self, measureArg.data(), kindArg.data(), nArg.data(), flagArg.data(), fileArg.data(), nullptr};
+
+      // Neither the engine's SCHED_FIFO (whichever thread queued the size) nor its signal mask.
+      posix_spawnattr_t attr;
+      posix_spawnattr_init(&attr);
+      sched_param sp{};
+      posix_spawnattr_setschedpolicy(&attr, SCHED_OTHER);
+      posix_spawnattr_setschedparam(&attr, &sp);
+      sigset_t none;
+      sigemptyset(&none);
+      posix_spawnattr_setsigmask(&attr, &none);
+      posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSCHEDULER | POSIX_SPAWN_SETSIGMASK);
+
+      pid_t pid = -1;
+      int rc = ECANCELED;
+      {
+        std::lock_guard<std::mutex> lk(s.queueMutex);
+        if (!s.stop)
+          rc = ::posix_spawn(&pid, self, nullptr, &attr, argv, environ);
+        if (rc == 0)
+          s.child = pid;
+      }
+      posix_spawnattr_destroy(&attr);
+      if (rc != 0)
+      {
+        if (rc != ECANCELED)
+          std::fprintf(stderr, "FFTW: can't start the planner process: %s\n", std::strerror(rc));
+        return false;
+      }
+
+      int status = 0;
+      while (::waitpid(pid, &status, 0) < 0 && errno == EINTR)
+      {
+      }
+      {
+        std::lock_guard<std::mutex> lk(s.queueMutex);
+        s.child = -1;
+      }
+      return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    void workerMain()
+    {
+      State &s = state();
+      for (;;)
+      {
+        std::pair<Kind, int> job;
+        {
+          std::unique_lock<std::mutex> lk(s.queueMutex);
+          s.cv.wait(lk, [&] { return s.stop || !s.queue.empty(); });
+          if (s.stop)
+            return;
+          job = s.queue.front();
+          s.queue.pop_front();
+        }
+
+        // FFTW has one planner per process and a measurement can take seconds; it runs in a child
+        // process so chain builds and plan destruction here never queue behind it. Only handing the
+        // wisdom over and back takes the planner lock.
+        char path[] = "/tmp/pedal-fftw-XXXXXX";
+        const int fd = ::mkstemp(path);
+        if (fd < 0)
+          continue;
+        ::close(fd);
+
+        const int n = job.second;
+        const auto t0 = std::chrono::steady_clock::now();
+        bool ok = false;
+        {
+          std::lock_guard<std::mutex> lk(s.plannerMutex);
+          ok = fftwf_export_wisdom_to_filename(path) != 0;
+        }
+        ok = ok && measureInChild(s, job.first, n, path);
+        if (ok)
+        {
+          std::lock_guard<std::mutex> lk(s.plannerMutex);
+          ok = fftwf_import_wisdom_from_filename(path) != 0;
+          if (ok)
+            saveWisdomLocked(s);
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        ::unlink(path);
+
+        std::fprintf(stderr, "FFTW: %s %s n=%d (%lld ms)\n",
+                     ok ? "measured" : "failed to measure",
+                     job.first == Kind::R2C ? "r2c" : "c2r", n,
+                     (long long)std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count());
+      }
+    }
+
+    void enqueue(State &s, Kind kind, int n)
+    {
+      std::lock_guard<std::mutex> lk(s.queueMutex);
+      if (s.stop || !s.seen.insert({kind, n}).second)
+        return;
+      s.queue.emplace_back(kind, n);
+      if (!s.worker.joinable())
+        s.worker = std::thread(workerMain);
+      s.cv.notify_one();
+    }
+
+    fftwf_plan plan(Kind kind, int n, float *t, float *re, float *im)
+    {
+      State &s = state();
+      fftwf_plan p = nullptr;
+      {
+        std::lock_guard<std::mutex> lk(s.plannerMutex);
+        if (s.configured && s.measureFlag != FFTW_ESTIMATE)
+          p = makePlan(kind, n, t, re, im, s.measureFlag | FFTW_WISDOM_ONLY);
+        if (p)
+          return p;
+        p = makePlan(kind, n, t, re, im, FFTW_ESTIMATE);
+      }
+      if (s.configured && s.measureFlag != FFTW_ESTIMATE)
+        enqueue(s, kind, n);
+      return p;
+    }
+
+  } // namespace
+
+  void configure()
+  {
+    State &s = state();
+    std::lock_guard<std::mutex> lk(s.plannerMutex);
+    if (s.configured)
+      return;
+
+    const char *path = std::getenv("ALSA_FFTW_WISDOM");
+    s.wisdomPath = path ? path : "/opt/pedal/config/fftw_wisdom";
+
+    if (const char *e = std::getenv("ALSA_FFTW_PLANNER"))
+    {
+      if (std::strcmp(e, "estimate") == 0)
+        s.measureFlag = FFTW_ESTIMATE;
+      else if (std::strcmp(e, "patient") == 0)
+        s.measureFlag = FFTW_PATIENT;
+      else if (std::strcmp(e, "measure") == 0)
+        s.measureFlag = FFTW_MEASURE;
+      else
+        std::fprintf(stderr, "FFTW: unknown ALSA_FFTW_PLANNER=%s (using measure)\n", e);
+    }
+
+    if (!s.wisdomPath.empty())
+    {
+      if (fftwf_import_wisdom_from_filename(s.wisdomPath.c_str()))
+        std::fprintf(stderr, "FFTW: loaded wisdom from %s\n", s.wisdomPath.c_str());
+      else
+        std::fprintf(stderr, "FFTW: no wisdom at %s (plans will be measured on first use)\n", s.wisdomPath.c_str());
+    }
+    s.configured = true;
+  }
+
+  void shutdown()
+  {
+    State &s = state();
+    {
+      std::lock_guard<std::mutex> lk(s.queueMutex);
+      s.stop = true;
+      s.queue.clear();
+      // Its result would be thrown away anyway.
+      if (s.child > 0)
+        ::kill(s.child, SIGTERM);
+    }
+    s.cv.notify_all();
+    if (s.worker.joinable())
+      s.worker.join();
+  }
+
+  int runMeasureChild(int argc, char **argv)
+  {
+    if (argc < 2 || std::strcmp(argv[1], kMeasureArg) != 0)
+      return -1;
+    if (argc != 6)
+      return 2;
+
+    const Kind kind = (std::strcmp(argv[2], "c2r") == 0) ? Kind::C2R : Kind::R2C;
+    const int n = std::atoi(argv[3]);
+    const unsigned flags = (std::strcmp(argv[4], "patient") == 0) ? FFTW_PATIENT : FFTW_MEASURE;
+    const char *wisdom = argv[5];
+    if (n <= 0)
+      return 2;
+
+    // The child inherits the CPU mask of the thread that queued the size, which may be pinned to an
+    // audio core. A measure can take seconds, so let it run on any CPU the kernel allows.
+    const long ncpu = sysconf(_SC_NPROCESSORS_CONF);
+    if (ncpu > 0)
+    {
+      cpu_set_t *all = CPU_ALLOC((int)ncpu);
+      const size_t size = CPU_ALLOC_SIZE((int)ncpu);
+      if (all)
+      {
+        CPU_ZERO_S(size, all);
+        for (long c = 0; c < ncpu; c++)
+          CPU_SET_S((int)c, size, all);
+        if (sched_setaffinity(0, size, all) != 0)
+          std::fprintf(stderr, "FFTW: planner process could not widen its CPU mask: %s\n", std::strerror(errno));
+        CPU_FREE(all);
+      }
+    }
+
+    // What the engine already knows, so sub-problems aren't measured again.
+    (void)fftwf_import_wisdom_from_filename(wisdom);
+
+    const size_t bins = (size_t)n / 2 + 1;
+    float *t = fftwf_alloc_real((size_t)n);
+    float *re = fftwf_alloc_real(bins);
+    float *im = fftwf_alloc_real(bins);
+    bool ok = false;
+    if (t && re && im)
+    {
+      // The plan only exists for its wisdom.
+      fftwf_plan p = makePlan(kind, n, t, re, im, flags);
+      if (p)
+      {
+        fftwf_destroy_plan(p);
+        ok = fftwf_export_wisdom_to_filename(wisdom) != 0;
+      }
+    }
+    fftwf_free(t);
+    fftwf_free(re);
+    fftwf_free(im);
+    return ok ? 0 : 1;
+  }
+
+  fftwf_plan planR2C(int n, float *in, float *re, float *im) { return plan(Kind::R2C, n, in, re, im); }
+
+  fftwf_plan planC2R(int n, float *re, float *im, float *out) { return plan(Kind::C2R, n, out, re, im); }
+
+  void destroy(fftwf_plan p)
+  {
+    if (!p)
+      return;
+    std::lock_guard<std::mutex> lk(state().plannerMutex);
+    fftwf_destroy_plan(p);
+  }
+
+  void FftwRealBuffer::assign(size_t n, float v)
+  {
+    if (n != mSize)
+    {
+      mData.reset(n ? fftwf_alloc_real(n) : nullptr);
+      mSize = mData ? n : 0;
+    }
+    std::fill(begin(), end(), v);
+  }
+
+} // namespace fftw_planner
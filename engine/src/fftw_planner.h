@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <fftw3.h>
+
+// Shared FFTW planning for the convolvers.
+//
+// FFTW's planner (and fftwf_destroy_plan) is not thread-safe, while chains are built and retired on
+// different threads; every plan goes through here under one mutex. Once configure() has run, plans
+// come from wisdom when it is there. A size that isn't yet in wisdom gets an ESTIMATE plan right
+// away (so set_chain stays fast) and is queued for a MEASURE/PATIENT run in a child process (the
+// same executable, see runMeasureChild), so the seconds it takes never hold that mutex; the
+// resulting wisdom is imported, written back to disk and picked up by the next chain built with
+// that size, including after a reboot.
+namespace fftw_planner
+{
+  // Reads ALSA_FFTW_WISDOM (default /opt/pedal/config/fftw_wisdom, empty = no file) and
+  // ALSA_FFTW_PLANNER (estimate|measure|patient, default measure), then imports the wisdom file.
+  // Without this call every plan is plain ESTIMATE (tests, offline tools).
+  void configure();
+
+  // Stops the background planner, killing a measurement in progress. Wisdom is saved after every
+  // measurement, so only that one is lost.
+  void shutdown();
+
+  // Call first thing in main() of an executable that calls configure(): when the process was started
+  // as a measuring child it measures, then returns the exit status; otherwise -1.
+  int runMeasureChild(int argc, char **argv);
+
+  // Split-complex real transforms of size n; arrays should come from FftwRealBuffer /
+  // SplitSpectrumArena so their alignment matches what wisdom was measured with.
+  fftwf_plan planR2C(int n, float *in, float *re, float *im);
+  fftwf_plan planC2R(int n, float *re, float *im, float *out);
+  void destroy(fftwf_plan p);
+
+  // SIMD-aligned float buffer for FFT time-domain data (vector-like subset).
+  class FftwRealBuffer
+  {
+  public:
+    FftwRealBuffer() = default;
+    FftwRealBuffer(FftwRealBuffer &&other) noexcept : mData(std::move(other.mData)), mSize(other.mSize)
+    {
+      other.mSize = 0;
+    }
+    FftwRealBuffer &operator=(FftwRealBuffer &&other) noexcept
+    {
+      mData = std::move(other.mData);
+      mSize = other.mSize;
+      other.mSize = 0;
+      return *this;
+    }
+
+    void assign(size_t n, float v);
+    void clear()
+    {
+      mData.reset();
+      mSize = 0;
+    }
+
+    float *data() { return mData.get(); }
+    const float *data() const { return mData.get(); }
+    size_t size() const { return mSize; }
+    float *begin() { return mData.get(); }
+    float *end() { return mData.get() + mSize; }
+    float &operator[](size_t i) { return mData.get()[i]; }
+    const float &operator[](size_t i) const { return mData.get()[i]; }
+
+  private:
+    struct Free
+    {
+      void operator()(float *p) const noexcept { fftwf_free(p); }
+    };
+    std::unique_ptr<float, Free> mData;
+    size_t mSize = 0;
+  };
+
+} // namespace fftw_planner
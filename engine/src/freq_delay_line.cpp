@@ -0,0 +1,56 @@
+#include "freq_delay_line.h"
+
+#include <cstring>
+
+bool FrequencyDelayLine::init(int slots, int bins)
+{
+  release();
+  if (slots <= 0 || !mX.allocate(2 * slots, bins))
+    return false;
+  mSlots = slots;
+  mWrite = slots - 1; // first push lands in position 0
+  return true;
+}
+
+void FrequencyDelayLine::release()
+{
+  mX.release();
+  mSlots = 0;
+  mWrite = 0;
+}
+
+void FrequencyDelayLine::reset()
+{
+  mX.zero();
+  mWrite = mSlots - 1;
+}
+
+void FrequencyDelayLine::push() noexcept
+{
+  const int w = next();
+  // Mirror into the upper copy; re and im planes are adjacent, so one copy covers both.
+  std::memcpy(mX.re(w + mSlots), mX.re(w), sizeof(float) * 2u * (size_t)mX.stride());
+  mWrite = w;
+}
+
+void FrequencyDelayLine::accumulate(const SplitSpectrumArena &h, int k0, int k1, float *yRe, float *yIm,
+                                    int lag) const noexcept
+{
+  if (k1 <= k0)
+    return;
+  // X[n + lag - k0] lives at mirrored slot mWrite + mSlots + lag - k0; later k walk down from there.
+  const int first = mWrite + mSlots + lag - k0;
+  const std::ptrdiff_t step = 2 * (std::ptrdiff_t)mX.stride();
+  spectral::cmacAccumulate(yRe, yIm, mX.re(first), -step, h.re(k0), step, mX.stride(), k1 - k0, mX.bins());
+}
+
+void FrequencyDelayLine::accumulateDual(const SplitSpectrumArena &h0, const SplitSpectrumArena &h1, int k0, int k1,
+                                        float *y0Re, float *y0Im, float *y1Re, float *y1Im, int lag) const noexcept
+{
+  if (k1 <= k0)
+    return;
+  const int first = mWrite + mSlots + lag - k0;
+  const std::ptrdiff_t step = 2 * (std::ptrdiff_t)mX.stride();
+  spectral::cmacAccumulateDual(y0Re, y0Im, y1Re, y1Im, mX.re(first), -step, h0.re(k0), h1.re(k0), step, mX.stride(),
+                               k1 - k0, mX.bins());
+}
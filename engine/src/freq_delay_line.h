@@ -0,0 +1,40 @@
+#pragma once
+#include "spectrum_kernels.h"
+
+// Frequency-domain delay line (FDL): the spectra of the last `slots` input blocks.
+//
+// Storage is a mirrored split-complex arena of 2*slots partitions: every spectrum is written twice,
+// at ring position w and w + slots. Any window of `slots` consecutive blocks is then one contiguous
+// run of partitions, so sum_k X[n-k] * H[k] is a single linear kernel pass (walking X newest-first,
+// H in natural order) with no modulo and no per-partition pointer table.
+class FrequencyDelayLine
+{
+public:
+  bool init(int slots, int bins);
+  void release();
+  void reset(); // zero history
+
+  int slots() const { return mSlots; }
+  int bins() const { return mX.bins(); }
+  size_t bytes() const { return mX.bytes(); }
+
+  // Planes for the next block's spectrum. Write them (e.g. as FFTW output), then push().
+  float *writeRe() { return mX.re(next()); }
+  float *writeIm() { return mX.im(next()); }
+  void push() noexcept;
+
+  // y += sum_{k=k0}^{k1-1} X[n + lag - k] * H[k], where X[n] is the most recent push.
+  // lag=1 sums the contribution that the *next* output block gets from already-known input
+  // (requires k0 >= 1); this is what lets callers pre-sum old partitions ahead of time.
+  void accumulate(const SplitSpectrumArena &h, int k0, int k1, float *yRe, float *yIm, int lag = 0) const noexcept;
+  // Same for two filters over this input in one pass (y0 from h0, y1 from h1); both need k1 partitions.
+  void accumulateDual(const SplitSpectrumArena &h0, const SplitSpectrumArena &h1, int k0, int k1,
+                      float *y0Re, float *y0Im, float *y1Re, float *y1Im, int lag = 0) const noexcept;
+
+private:
+  int next() const { return (mWrite + 1 == mSlots) ? 0 : mWrite + 1; }
+
+  SplitSpectrumArena mX; // 2*mSlots partitions
+  int mSlots = 0;
+  int mWrite = 0; // ring position of X[n]
+};
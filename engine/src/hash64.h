@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace pedal::dsp
+{
+
+  // 64-bit multiply-xor hash over 8-byte words. Fast enough to run over whole asset files on every
+  // load; catches truncation, bit rot and changed content, not tampering. Part of the .namb and
+  // IR spectra cache formats, so changing it invalidates both.
+  inline uint64_t hash64(const void *p, size_t n, uint64_t seed = 0)
+  {
+    const auto *b = static_cast<const unsigned char *>(p);
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)n ^ seed;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      uint64_t w;
+      std::memcpy(&w, b + i, 8);
+      h = (h ^ w) * 0x100000001b3ull;
+      h ^= h >> 29;
+    }
+    for (; i < n; i++)
+      h = (h ^ b[i]) * 0x100000001b3ull;
+    return h;
+  }
+
+} // namespace pedal::dsp
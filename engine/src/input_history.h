@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace pedal::dsp
+{
+
+  // The last capacity() input samples, written by the audio thread once per period and read by
+  // anyone (standby chain warming). The writer never blocks; a reader whose range was overwritten
+  // while it copied gets false, like a Seqlock load that lost the race, and simply asks for newer
+  // samples. Samples live in relaxed atomics so an overwritten copy is discarded, not a data race.
+  class InputHistory
+  {
+  public:
+    // capacity rounds up to a power of two.
+    explicit InputHistory(size_t capacity = size_t(1) << 17)
+    {
+      size_t c = 1;
+      while (c < capacity)
+        c <<= 1;
+      mask_ = c - 1;
+      buf_ = std::make_unique<std::atomic<float>[]>(c);
+    }
+
+    InputHistory(const InputHistory &) = delete;
+    InputHistory &operator=(const InputHistory &) = delete;
+
+    size_t capacity() const noexcept { return mask_ + 1; }
+
+    // Writer only. RT-safe.
+    void write(const float *in, size_t n) noexcept
+    {
+      const uint64_t end = end_.load(std::memory_order_relaxed);
+      // Readers of [end + n - capacity, end) must see the overwrite coming before it lands.
+      begin_.store(end + n > capacity() ? end + n - capacity() : 0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for (size_t i = 0; i < n; i++)
+        buf_[(end + i) & mask_].store(in[i], std::memory_order_relaxed);
+      end_.store(end + n, std::memory_order_release);
+    }
+
+    // Total samples written so far; sample k (k < written()) is the k-th ever written.
+    uint64_t written() const noexcept { return end_.load(std::memory_order_acquire); }
+
+    // Copies samples [from, from + n) into out. False if any of them isn't written yet or was
+    // overwritten before the copy finished.
+    bool read(uint64_t from, float *out, size_t n) const noexcept
+    {
+      if (from + n > end_.load(std::memory_order_acquire) || n > capacity())
+        return false;
+      for (size_t i = 0; i < n; i++)
+        out[i] = buf_[(from + i) & mask_].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return from >= begin_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::unique_ptr<std::atomic<float>[]> buf_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> begin_{0}; // oldest sample still valid once the write in progress lands
+    std::atomic<uint64_t> end_{0};
+  };
+
+} // namespace pedal::dsp
@@ -3,6 +3,10 @@
 #include <cmath>
 
 bool load_ir_mono(const std::string& path, IRData& out, std::string& err) {
+  return load_ir_channel(path, -1, out, err);
+}
+
+bool load_ir_channel(const std::string& path, int channel, IRData& out, std::string& err) {
   SF_INFO info;
   info.format = 0;
 
@@ -18,6 +22,12 @@ bool load_ir_mono(const std::string& path, IRData& out, std::string& err) {
     return false;
   }
 
+  if (channel >= info.channels) {
+    sf_close(f);
+    err = "IR has " + std::to_string(info.channels) + " channel(s), no channel " + std::to_string(channel);
+    return false;
+  }
+
   std::vector<float> interleaved((size_t)info.frames * (size_t)info.channels);
   sf_count_t got = sf_readf_float(f, interleaved.data(), info.frames);
   sf_close(f);
@@ -28,10 +38,15 @@ bool load_ir_mono(const std::string& path, IRData& out, std::string& err) {
   }
 
   out.sampleRate = info.samplerate;
+  out.channels = info.channels;
   out.mono.resize((size_t)info.frames);
 
   if (info.channels == 1) {
     out.mono = std::move(interleaved);
+  } else if (channel >= 0) {
+    for (sf_count_t i = 0; i < info.frames; i++) {
+      out.mono[(size_t)i] = interleaved[(size_t)i * (size_t)info.channels + (size_t)channel];
+    }
   } else {
     for (sf_count_t i = 0; i < info.frames; i++) {
       double sum = 0.0;
@@ -4,10 +4,15 @@
 
 struct IRData {
   int sampleRate = 0;
+  int channels = 0;        // of the file
   std::vector<float> mono; // normalized float, mono
 };
 
 // Loads a WAV/AIFF/etc via libsndfile, returns mono float IR.
 // If file is multi-channel, it will downmix to mono (average).
-// No resampling: sampleRate must match your JACK rate (48000).
+// No resampling here: sampleRate is the file's; ir_convolver resamples to the engine rate (ir_prep.h).
 bool load_ir_mono(const std::string& path, IRData& out, std::string& err);
+
+// Same, but only file channel `channel` (0-based) goes into out.mono; -1 downmixes like load_ir_mono.
+// Fails if the file has no such channel.
+bool load_ir_channel(const std::string& path, int channel, IRData& out, std::string& err);
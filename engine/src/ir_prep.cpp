@@ -0,0 +1,207 @@
+#include "ir_prep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "fftw_planner.h"
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+
+    constexpr int kZeroCrossings = 32;
+    constexpr int kOversample = 512; // kernel table steps per zero crossing (linear interpolation)
+    constexpr double kKaiserBeta = 10.0;
+    constexpr double kPassband = 0.95;
+    constexpr double kPi = 3.14159265358979323846;
+
+    double besselI0(double x)
+    {
+      double sum = 1.0;
+      double term = 1.0;
+      const double q = x * x / 4.0;
+      for (int k = 1; k < 64 && term > sum * 1e-17; k++)
+      {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+      }
+      return sum;
+    }
+
+    // sinc(u) * kaiser(u / kZeroCrossings) for u = i / kOversample in [0, kZeroCrossings], plus a
+    // trailing zero so interpolation at the edge stays in bounds.
+    const std::vector<double> &kernelTable()
+    {
+      static const std::vector<double> table = []
+      {
+        const size_t n = (size_t)kZeroCrossings * kOversample + 2;
+        std::vector<double> t(n, 0.0);
+        const double i0Beta = besselI0(kKaiserBeta);
+        for (size_t i = 0; i + 1 < n; i++)
+        {
+          const double u = (double)i / kOversample;
+          const double r = u / kZeroCrossings;
+          if (r > 1.0)
+            break;
+          const double sinc = (i == 0) ? 1.0 : std::sin(kPi * u) / (kPi * u);
+          t[i] = sinc * besselI0(kKaiserBeta * std::sqrt(1.0 - r * r)) / i0Beta;
+        }
+        return t;
+      }();
+      return table;
+    }
+
+  } // namespace
+
+  std::vector<float> resampleIr(const std::vector<float> &in, int fromRate, int toRate)
+  {
+    if (in.empty() || fromRate <= 0 || toRate <= 0 || fromRate == toRate)
+      return in;
+
+    const double ratio = (double)toRate / (double)fromRate;
+    const double fc = std::min(1.0, ratio) * kPassband; // cutoff in input Nyquist units
+    const double half = kZeroCrossings / fc;            // kernel half-width in input samples
+    const auto &table = kernelTable();
+
+    const size_t outLen = (size_t)std::llround((double)in.size() * ratio);
+    std::vector<float> out(outLen, 0.0f);
+    const long last = (long)in.size() - 1;
+    for (size_t n = 0; n < outLen; n++)
+    {
+      const double t = (double)n / ratio;
+      const long i0 = std::max(0L, (long)std::ceil(t - half));
+      const long i1 = std::min(last, (long)std::floor(t + half));
+      double acc = 0.0;
+      for (long i = i0; i <= i1; i++)
+      {
+        const double pos = std::fabs(t - (double)i) * fc * kOversample;
+        const size_t k = (size_t)pos;
+        if (k + 1 >= table.size())
+          continue;
+        const double frac = pos - (double)k;
+        acc += (double)in[(size_t)i] * (table[k] + (table[k + 1] - table[k]) * frac);
+      }
+      out[n] = (float)(acc * fc);
+    }
+    return out;
+  }
+
+  bool toMinimumPhase(std::vector<float> &ir)
+  {
+    if (ir.size() < 2)
+      return true;
+
+    // Cepstral aliasing falls off with the zero padding; 8x keeps it well below the trim threshold.
+    int n = 1024;
+    while ((size_t)n < ir.size() * 8 && n < (1 << 24))
+      n *= 2;
+    const int bins = n / 2 + 1;
+
+    fftw_planner::FftwRealBuffer time, re, im;
+    time.assign((size_t)n, 0.0f);
+    re.assign((size_t)bins, 0.0f);
+    im.assign((size_t)bins, 0.0f);
+    fftwf_plan fwd = fftw_planner::planR2C(n, time.data(), re.data(), im.data());
+    fftwf_plan inv = fftw_planner::planC2R(n, re.data(), im.data(), time.data());
+    if (!fwd || !inv)
+    {
+      fftw_planner::destroy(fwd);
+      fftw_planner::destroy(inv);
+      return false;
+    }
+
+    std::copy(ir.begin(), ir.end(), time.begin());
+    fftwf_execute(fwd);
+
+    // log|H|, floored 100 dB below the peak so spectral nulls stay finite.
+    double peak = 0.0;
+    for (int k = 0; k < bins; k++)
+      peak = std::max(peak, std::hypot((double)re[(size_t)k], (double)im[(size_t)k]));
+    if (peak <= 0.0)
+    {
+      fftw_planner::destroy(fwd);
+      fftw_planner::destroy(inv);
+      return true;
+    }
+    const double floor = peak * 1e-5;
+    for (int k = 0; k < bins; k++)
+    {
+      const double mag = std::hypot((double)re[(size_t)k], (double)im[(size_t)k]);
+      re[(size_t)k] = (float)std::log(std::max(mag, floor));
+      im[(size_t)k] = 0.0f;
+    }
+
+    // Real cepstrum, folded onto positive quefrencies (causal part doubled, anti-causal dropped).
+    fftwf_execute(inv);
+    const float scale = 1.0f / (float)n;
+    time[0] *= scale;
+    for (int i = 1; i < n / 2; i++)
+      time[(size_t)i] *= 2.0f * scale;
+    time[(size_t)n / 2] *= scale;
+    std::fill(time.begin() + n / 2 + 1, time.end(), 0.0f);
+
+    // exp() of its spectrum is the minimum-phase spectrum.
+    fftwf_execute(fwd);
+    for (int k = 0; k < bins; k++)
+    {
+      const double mag = std::exp((double)re[(size_t)k]);
+      const double ph = (double)im[(size_t)k];
+      re[(size_t)k] = (float)(mag * std::cos(ph));
+      im[(size_t)k] = (float)(mag * std::sin(ph));
+    }
+    fftwf_execute(inv);
+
+    for (size_t i = 0; i < ir.size(); i++)
+      ir[i] = time[i] * scale;
+
+    fftw_planner::destroy(fwd);
+    fftw_planner::destroy(inv);
+    return true;
+  }
+
+  size_t energyTrimLength(const std::vector<float> &ir, float thresholdDb, size_t minLen)
+  {
+    if (thresholdDb >= 0.0f || ir.size() <= minLen)
+      return ir.size();
+
+    const double total = std::accumulate(ir.begin(), ir.end(), 0.0, [](double a, float v) { return a + (double)v * v; });
+    if (total <= 0.0)
+      return ir.size();
+    const double limit = total * std::pow(10.0, (double)thresholdDb / 10.0);
+
+    // Walk back from the end while the tail still holds less than `limit`.
+    double tail = 0.0;
+    size_t len = ir.size();
+    while (len > minLen)
+    {
+      const double v = ir[len - 1];
+      if (tail + v * v >= limit)
+        break;
+      tail += v * v;
+      len--;
+    }
+    return len;
+  }
+
+  void truncateWithTaper(std::vector<float> &ir, size_t len)
+  {
+    if (len >= ir.size())
+      return;
+    const size_t taper = std::min<size_t>(128, len);
+    if (taper > 1)
+    {
+      const size_t start = len - taper;
+      for (size_t i = 0; i < taper; i++)
+      {
+        const float t = (float)i / (float)(taper - 1);
+        const float g = 0.5f * (1.0f + std::cos((float)kPi * t)); // 1..0
+        ir[start + i] *= g;
+      }
+    }
+    ir.resize(len);
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Load-time IR conditioning, run before the spectra are built (and so cached with them). Non-RT.
+namespace pedal::dsp
+{
+
+  // Band-limited resampling: Kaiser-windowed sinc, 32 zero crossings, cutoff at 95% of the lower
+  // Nyquist (~-100 dB stopband). Zero-delay: output sample n sits at input time n * from / to.
+  std::vector<float> resampleIr(const std::vector<float> &in, int fromRate, int toRate);
+
+  // Replaces `ir` with its minimum-phase counterpart (same magnitude response, energy moved to the
+  // front) via the folded real cepstrum. Keeps the length. False if the transforms can't be planned.
+  bool toMinimumPhase(std::vector<float> &ir);
+
+  // Length that keeps everything but a tail holding less than `thresholdDb` (< 0) of the total
+  // energy, never below minLen. Returns ir.size() when there is nothing to trim.
+  size_t energyTrimLength(const std::vector<float> &ir, float thresholdDb, size_t minLen);
+
+  // Truncates to `len` with a raised-cosine fade over the last min(128, len) samples.
+  void truncateWithTaper(std::vector<float> &ir, size_t len);
+
+} // namespace pedal::dsp
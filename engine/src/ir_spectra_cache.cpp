@@ -0,0 +1,280 @@
+#include "ir_spectra_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "asset_cache.h"
+#include "fft_convolver.h"
+#include "hash64.h"
+#include "mapped_file.h"
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+
+    constexpr char kMagic[8] = {'P', 'D', 'L', 'I', 'R', 'S', 'P', '\0'};
+    // Bump when the file layout or what PartitionedFilter::build stores in the spectra changes.
+    constexpr uint32_t kVersion = 1;
+    constexpr const char *kExt = ".irspec";
+    constexpr size_t kAlign = SplitSpectrumArena::kAlign;
+
+    // Little-endian, as written by this host. Followed by FilterRecord[filterCount] (head first,
+    // then the tail stages), the key and warning texts, padding to kAlign, and the arenas.
+    struct FileHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t headerBytes;
+      uint64_t fileBytes;
+      uint32_t keyBytes;
+      uint32_t warningBytes;
+      uint32_t block;
+      uint32_t offloadTail;
+      uint64_t irLen;
+      uint32_t filterCount;
+      uint32_t reserved;
+      uint64_t dataHash; // over everything from the first arena to the end
+    };
+    static_assert(sizeof(FileHeader) == 64, "FileHeader is part of the file format");
+
+    struct FilterRecord
+    {
+      int32_t offset;
+      int32_t delay;
+      int32_t part;
+      int32_t fft;
+      int32_t bins;
+      int32_t parts;
+      uint64_t dataOffset; // arena: parts * 2 * strideFor(bins) floats
+    };
+    static_assert(sizeof(FilterRecord) == 32, "FilterRecord is part of the file format");
+
+    size_t arenaBytes(const FilterRecord &r)
+    {
+      return (size_t)r.parts * 2u * (size_t)SplitSpectrumArena::strideFor(r.bins) * sizeof(float);
+    }
+
+    size_t alignUp(size_t n) { return (n + kAlign - 1) / kAlign * kAlign; }
+
+  } // namespace
+
+  std::string IrSpectraCache::key(const std::string &irPath, const std::string &params) const
+  {
+    if (!enabled())
+      return {};
+    std::ifstream f(irPath, std::ios::binary);
+    if (!f)
+      return {};
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (bytes.empty())
+      return {};
+    char hex[24];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash64(bytes.data(), bytes.size()));
+    return std::string(hex) + params;
+  }
+
+  std::string IrSpectraCache::fileFor(const std::string &key) const
+  {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash64(key.data(), key.size(), kVersion));
+    return (std::filesystem::path(dir_) / (std::string(name) + kExt)).string();
+  }
+
+  std::shared_ptr<const CachedIr> IrSpectraCache::load(const std::string &key) const
+  {
+    if constexpr (std::endian::native != std::endian::little)
+      return nullptr;
+    if (key.empty())
+      return nullptr;
+
+    const std::string path = fileFor(key);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+      return nullptr;
+    std::string err;
+    const auto map = MappedFile::open(path, err);
+    if (!map)
+      return nullptr;
+    const unsigned char *base = map->data();
+    const size_t size = map->size();
+
+    auto reject = [&](const char *why) -> std::shared_ptr<const CachedIr>
+    {
+      std::fprintf(stderr, "IR cache: ignoring %s (%s)\n", path.c_str(), why);
+      return nullptr;
+    };
+
+    FileHeader h;
+    if (size < sizeof(h))
+      return reject("truncated");
+    std::memcpy(&h, base, sizeof(h));
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kVersion || h.headerBytes != sizeof(h))
+      return reject("bad header");
+    if (h.fileBytes != size || h.filterCount < 1 || h.filterCount > 1u + NonUniformFilter::kMaxTailStages ||
+        h.block == 0)
+      return reject("bad header");
+
+    const size_t recordsEnd = sizeof(h) + (size_t)h.filterCount * sizeof(FilterRecord);
+    const size_t textEnd = recordsEnd + (size_t)h.keyBytes + (size_t)h.warningBytes;
+    if (textEnd > size)
+      return reject("truncated");
+    const auto *text = reinterpret_cast<const char *>(base + recordsEnd);
+    if (std::string_view(text, h.keyBytes) != key)
+      return reject("key mismatch");
+
+    std::vector<FilterRecord> recs(h.filterCount);
+    std::memcpy(recs.data(), base + sizeof(h), recs.size() * sizeof(FilterRecord));
+    const size_t dataStart = alignUp(textEnd);
+    for (const auto &r : recs)
+    {
+      if (r.part <= 0 || r.fft != 2 * r.part || r.bins != r.fft / 2 + 1 || r.parts <= 0 || r.dataOffset % kAlign ||
+          r.dataOffset < dataStart || r.dataOffset > size || arenaBytes(r) > size - r.dataOffset)
+        return reject("bad filter record");
+    }
+    if (dataStart > size || hash64(base + dataStart, size - dataStart) != h.dataHash)
+      return reject("checksum mismatch");
+
+    // The arenas keep the mapping alive; they're never written, so PROT_READ is enough.
+    auto makeFilter = [&](const FilterRecord &r) -> std::shared_ptr<const PartitionedFilter>
+    {
+      auto f = std::make_shared<PartitionedFilter>();
+      f->part = r.part;
+      f->fft = r.fft;
+      f->bins = r.bins;
+      f->parts = r.parts;
+      if (!f->h.adopt(r.parts, r.bins, reinterpret_cast<const float *>(base + r.dataOffset), map))
+        return nullptr;
+      return f;
+    };
+
+    auto filter = std::make_shared<NonUniformFilter>();
+    filter->block = (int)h.block;
+    filter->offloadTail = h.offloadTail != 0;
+    filter->irLen = (size_t)h.irLen;
+    filter->head = makeFilter(recs[0]);
+    if (!filter->head)
+      return reject("bad filter record");
+    for (size_t i = 1; i < recs.size(); i++)
+    {
+      NonUniformFilter::Stage st;
+      st.offset = recs[i].offset;
+      st.delay = recs[i].delay;
+      st.filter = makeFilter(recs[i]);
+      if (!st.filter)
+        return reject("bad filter record");
+      filter->stages.push_back(std::move(st));
+    }
+
+    // Hits refresh the mtime, so prune() drops the least recently used files.
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    auto out = std::make_shared<CachedIr>();
+    out->filter = std::move(filter);
+    out->warning.assign(text + h.keyBytes, h.warningBytes);
+    return out;
+  }
+
+  void IrSpectraCache::store(const std::string &key, const CachedIr &ir) const
+  {
+    if constexpr (std::endian::native != std::endian::little)
+      return;
+    if (key.empty() || !ir.filter || !ir.filter->head)
+      return;
+    const NonUniformFilter &nf = *ir.filter;
+
+    std::vector<const PartitionedFilter *> filters{nf.head.get()};
+    std::vector<FilterRecord> recs{FilterRecord{0, 0, nf.head->part, nf.head->fft, nf.head->bins, nf.head->parts, 0}};
+    for (const auto &st : nf.stages)
+    {
+      filters.push_back(st.filter.get());
+      recs.push_back(
+          FilterRecord{st.offset, st.delay, st.filter->part, st.filter->fft, st.filter->bins, st.filter->parts, 0});
+    }
+
+    FileHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.headerBytes = sizeof(h);
+    h.keyBytes = (uint32_t)key.size();
+    h.warningBytes = (uint32_t)ir.warning.size();
+    h.block = (uint32_t)nf.block;
+    h.offloadTail = nf.offloadTail ? 1u : 0u;
+    h.irLen = nf.irLen;
+    h.filterCount = (uint32_t)recs.size();
+
+    const size_t textEnd = sizeof(h) + recs.size() * sizeof(FilterRecord) + key.size() + ir.warning.size();
+    size_t offset = alignUp(textEnd);
+    const size_t dataStart = offset;
+    for (auto &r : recs)
+    {
+      r.dataOffset = offset;
+      offset += arenaBytes(r); // a multiple of kAlign (planes are padded to 16 floats)
+    }
+    h.fileBytes = offset;
+
+    // Arenas are separate allocations; hash them as the one contiguous range they become on disk.
+    std::vector<unsigned char> data(offset - dataStart);
+    for (size_t i = 0; i < filters.size(); i++)
+      std::memcpy(data.data() + (recs[i].dataOffset - dataStart), filters[i]->h.re(0), arenaBytes(recs[i]));
+    h.dataHash = hash64(data.data(), data.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    const std::string path = fileFor(key);
+    // Nodes build in parallel, so two builders may store the same key at once.
+    static std::atomic<unsigned> seq{0};
+    const std::string tmp = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(seq.fetch_add(1));
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+      std::fprintf(stderr, "IR cache: can't write %s: %s\n", tmp.c_str(), std::strerror(errno));
+      return;
+    }
+    const std::vector<char> pad(dataStart - textEnd, 0);
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+              std::fwrite(recs.data(), sizeof(FilterRecord), recs.size(), f) == recs.size() &&
+              std::fwrite(key.data(), 1, key.size(), f) == key.size() &&
+              std::fwrite(ir.warning.data(), 1, ir.warning.size(), f) == ir.warning.size() &&
+              std::fwrite(pad.data(), 1, pad.size(), f) == pad.size() &&
+              std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+      std::fprintf(stderr, "IR cache: can't write %s: %s\n", path.c_str(), std::strerror(errno));
+      std::remove(tmp.c_str());
+      return;
+    }
+    prune();
+  }
+
+  void IrSpectraCache::prune() const
+  {
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+    for (const auto &e : std::filesystem::directory_iterator(dir_, ec))
+    {
+      if (e.path().extension() == kExt)
+        files.emplace_back(e.last_write_time(ec), e.path());
+    }
+    if (files.size() <= maxFiles_)
+      return;
+    std::sort(files.begin(), files.end());
+    for (size_t i = 0; i + maxFiles_ < files.size(); i++)
+      std::filesystem::remove(files[i].second, ec);
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace pedal::dsp
+{
+
+  struct CachedIr;
+
+  // On-disk tier below AssetCache for prepared IRs: the NonUniformFilter partition spectra, one
+  // file per (IR content, build params). A hit maps the file and the filter's arenas point straight
+  // into the mapping, so there is no WAV decode, normalization or FFT, and no copy. Files are
+  // written via temp file + rename; the oldest are pruned beyond maxFiles. Everything is best-effort:
+  // an unreadable or stale file is a miss, a failed store only logs. Build threads only.
+  class IrSpectraCache
+  {
+  public:
+    // Empty dir = disabled.
+    explicit IrSpectraCache(std::string dir = {}, size_t maxFiles = 64) : dir_(std::move(dir)), maxFiles_(maxFiles) {}
+
+    void setDir(std::string dir) { dir_ = std::move(dir); }
+    const std::string &dir() const { return dir_; }
+    bool enabled() const { return !dir_.empty(); }
+
+    // Hash of the IR file's bytes plus `params` (everything else that shapes the spectra: sample
+    // rate, block size, gain/normalization, trimming, partitioning). Empty if disabled or the file
+    // can't be read.
+    std::string key(const std::string &irPath, const std::string &params) const;
+
+    std::shared_ptr<const CachedIr> load(const std::string &key) const;
+    void store(const std::string &key, const CachedIr &ir) const;
+
+  private:
+    std::string fileFor(const std::string &key) const;
+    void prune() const;
+
+    std::string dir_;
+    size_t maxFiles_;
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,585 @@
+// Microbenchmarks for the hot DSP kernels at realtime block sizes, with a per-architecture baseline
+// file so a change can be measured against the last accepted numbers.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "alsa_convert.h"
+#include "fft_convolver.h"
+#include "json.hpp"
+#include "nonlinear_stage.h"
+#include "signal_chain_nodes.h"
+#include "softclip.h"
+
+using Json = nlohmann::json;
+
+#if defined(__x86_64__)
+static constexpr const char *kArch = "x86_64";
+#elif defined(__aarch64__)
+static constexpr const char *kArch = "aarch64";
+#else
+static constexpr const char *kArch = "other";
+#endif
+
+// Keeps the compiler from discarding a result it can prove unused.
+static inline void keep(const void *p) { asm volatile("" : : "g"(p) : "memory"); }
+
+struct Args
+{
+  std::vector<uint32_t> blocks{16, 32, 64, 128, 256, 512};
+  std::vector<uint32_t> irLengths{1024, 8192, 48000};
+  std::vector<std::string> namPaths;
+  std::string filter;
+  std::string baselinePath;
+  bool writeBaseline = false;
+  double tolerance = 0.10;
+  double minMs = 20.0;
+  int reps = 5;
+};
+
+static void usage(const char *argv0)
+{
+  std::fprintf(stderr,
+               "Usage: %s [--blocks 16,32,64,128,256,512] [--ir-lengths 1024,8192,48000]\n"
+               "          [--nam <model.nam>]... [--nam-dir <dir>] [--filter <substring>]\n"
+               "          [--baseline <file.json> [--write-baseline] [--tolerance 0.10]]\n"
+               "          [--min-ms 20] [--reps 5]\n",
+               argv0);
+}
+
+static std::vector<uint32_t> parseList(const char *s)
+{
+  std::vector<uint32_t> out;
+  while (s && *s)
+  {
+    char *end = nullptr;
+    const long v = std::strtol(s, &end, 10);
+    if (end == s)
+    {
+      s++;
+      continue;
+    }
+    if (v > 0)
+      out.push_back((uint32_t)v);
+    s = end;
+  }
+  return out;
+}
+
+static bool parseArgs(int argc, char **argv, Args &a)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string k = argv[i];
+    auto need = [&](const char *name) -> const char *
+    {
+      if (i + 1 >= argc)
+      {
+        std::fprintf(stderr, "Missing value for %s\n", name);
+        return nullptr;
+      }
+      return argv[++i];
+    };
+
+    const char *v = nullptr;
+    if (k == "--blocks" && (v = need("--blocks")))
+      a.blocks = parseList(v);
+    else if (k == "--ir-lengths" && (v = need("--ir-lengths")))
+      a.irLengths = parseList(v);
+    else if (k == "--nam" && (v = need("--nam")))
+      a.namPaths.push_back(v);
+    else if (k == "--nam-dir" && (v = need("--nam-dir")))
+    {
+      std::error_code ec;
+      for (const auto &e : std::filesystem::directory_iterator(v, ec))
+      {
+        if (e.path().extension() == ".nam")
+          a.namPaths.push_back(e.path().string());
+      }
+      std::sort(a.namPaths.begin(), a.namPaths.end());
+    }
+    else if (k == "--filter" && (v = need("--filter")))
+      a.filter = v;
+    else if (k == "--baseline" && (v = need("--baseline")))
+      a.baselinePath = v;
+    else if (k == "--write-baseline")
+      a.writeBaseline = true;
+    else if (k == "--tolerance" && (v = need("--tolerance")))
+      a.tolerance = std::strtod(v, nullptr);
+    else if (k == "--min-ms" && (v = need("--min-ms")))
+      a.minMs = std::strtod(v, nullptr);
+    else if (k == "--reps" && (v = need("--reps")))
+      a.reps = std::atoi(v);
+    else if (k == "-h" || k == "--help")
+      return false;
+    else
+    {
+      std::fprintf(stderr, "Unknown arg: %s\n", k.c_str());
+      return false;
+    }
+  }
+
+  if (a.blocks.empty() || (a.writeBaseline && a.baselinePath.empty()))
+    return false;
+  a.tolerance = std::clamp(a.tolerance, 0.0, 10.0);
+  a.minMs = std::clamp(a.minMs, 1.0, 10000.0);
+  a.reps = std::clamp(a.reps, 1, 100);
+  return true;
+}
+
+// -------------------- Harness --------------------
+struct Case
+{
+  std::string name;
+  uint32_t frames = 0; // per call
+  std::function<void()> run;
+};
+
+// Median ns per call over `reps` timed runs of at least minMs each.
+static double measureNsPerCall(const Case &c, double minMs, int reps)
+{
+  using Clock = std::chrono::steady_clock;
+  for (int i = 0; i < 8; i++)
+    c.run();
+
+  uint64_t iters = 1;
+  for (;;)
+  {
+    const auto t0 = Clock::now();
+    for (uint64_t i = 0; i < iters; i++)
+      c.run();
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    if (ms >= minMs || iters >= (uint64_t(1) << 30))
+      break;
+    iters = (ms < minMs / 8.0) ? iters * 8 : iters * 2;
+  }
+
+  std::vector<double> perCall;
+  for (int r = 0; r < reps; r++)
+  {
+    const auto t0 = Clock::now();
+    for (uint64_t i = 0; i < iters; i++)
+      c.run();
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    perCall.push_back(ns / (double)iters);
+  }
+  std::nth_element(perCall.begin(), perCall.begin() + perCall.size() / 2, perCall.end());
+  return perCall[perCall.size() / 2];
+}
+
+// -------------------- Cases --------------------
+static std::vector<float> noise(size_t n, float amp, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> d(-amp, amp);
+  std::vector<float> v(n);
+  for (auto &x : v)
+    x = d(rng);
+  return v;
+}
+
+// Exponentially decaying noise, roughly what a cabinet IR looks like to the convolver.
+static std::vector<float> syntheticIr(size_t len, uint32_t seed = 7)
+{
+  std::vector<float> ir = noise(len, 1.0f, seed);
+  const float k = -6.9f / (float)len; // -60 dB at the end
+  for (size_t i = 0; i < len; i++)
+    ir[i] *= std::exp(k * (float)i);
+  return ir;
+}
+
+static void addFftCases(std::vector<Case> &cases, const Args &a)
+{
+  for (uint32_t len : a.irLengths)
+  {
+    const std::vector<float> ir = syntheticIr(len);
+    const std::vector<float> ir2 = syntheticIr(len, 8); // right-hand cab for the stereo cases
+    for (uint32_t b : a.blocks)
+    {
+      auto conv = std::make_shared<FFTConvolverPartitioned>();
+      if (!conv->init(ir, (int)b))
+      {
+        std::fprintf(stderr, "fft_partitioned: init failed (ir=%u block=%u)\n", len, b);
+        continue;
+      }
+      auto in = std::make_shared<std::vector<float>>(noise(b, 0.5f, b));
+      auto out = std::make_shared<std::vector<float>>(b);
+      cases.push_back({"fft_partitioned/ir=" + std::to_string(len) + "/block=" + std::to_string(b), b,
+                       [conv, in, out, b]
+                       {
+                         conv->processBlock(in->data(), out->data(), (int)b);
+                         keep(out->data());
+                       }});
+
+      // Stereo cab: a second IR off the same input FFT and history.
+      auto stereo = std::make_shared<FFTConvolverPartitioned>();
+      if (!stereo->init(PartitionedFilter::build(ir.data(), ir.size(), (int)b),
+                        PartitionedFilter::build(ir2.data(), ir2.size(), (int)b)))
+      {
+        std::fprintf(stderr, "fft_partitioned_stereo: init failed (ir=%u block=%u)\n", len, b);
+        continue;
+      }
+      auto out2 = std::make_shared<std::vector<float>>(2 * (size_t)b);
+      cases.push_back({"fft_partitioned_stereo/ir=" + std::to_string(len) + "/block=" + std::to_string(b), b,
+                       [stereo, in, out2, b]
+                       {
+                         float *outs[2] = {out2->data(), out2->data() + b};
+                         stereo->processBlock(in->data(), outs, (int)b);
+                         keep(out2->data());
+                       }});
+    }
+  }
+}
+
+// Builds a node the way buildChain does, sized for `block`.
+static std::shared_ptr<pedal::dsp::INode> makeNode(const pedal::chain::NodeSpec &spec, uint32_t block)
+{
+  pedal::dsp::ProcessContext ctx;
+  ctx.sampleRate = 48000;
+  ctx.maxBlockFrames = block;
+  std::string err;
+  auto r = pedal::dsp::buildNode(spec, ctx, err);
+  if (!r || !r->node)
+  {
+    std::fprintf(stderr, "%s: build failed: %s\n", spec.type.c_str(), err.c_str());
+    return nullptr;
+  }
+  return std::shared_ptr<pedal::dsp::INode>(std::move(r->node));
+}
+
+static void addNodeCase(std::vector<Case> &cases, const std::string &name, const pedal::chain::NodeSpec &spec,
+                        uint32_t block)
+{
+  auto node = makeNode(spec, block);
+  if (!node)
+    return;
+  // The chain normally hands scratch out of its arena.
+  auto scratch = std::make_shared<std::vector<float>>(node->scratchFloats());
+  if (!scratch->empty())
+    node->bindScratch(scratch->data());
+  auto in = std::make_shared<std::vector<float>>(noise(block, 0.5f, block));
+  auto out = std::make_shared<std::vector<float>>(block);
+  cases.push_back({name, block, [node, scratch, in, out, block]
+                   {
+                     node->process(in->data(), out->data(), block);
+                     keep(out->data());
+                   }});
+}
+
+static std::string namArchitecture(const std::string &path)
+{
+  try
+  {
+    std::ifstream f(path);
+    Json j;
+    f >> j;
+    return j.value("architecture", "unknown");
+  }
+  catch (const std::exception &)
+  {
+    return "unknown";
+  }
+}
+
+static void addNodeCases(std::vector<Case> &cases, const Args &a)
+{
+  pedal::chain::NodeSpec od;
+  od.id = "od";
+  od.type = "overdrive";
+  od.category = "fx";
+  od.params = Json{{"drive", 0.6}, {"tone", 0.5}};
+  for (uint32_t b : a.blocks)
+    addNodeCase(cases, "overdrive/block=" + std::to_string(b), od, b);
+  for (int factor : {2, 4})
+  {
+    pedal::chain::NodeSpec os = od;
+    os.params["oversample"] = factor;
+    os.params["softclipTanh"] = true;
+    for (uint32_t b : a.blocks)
+      addNodeCase(cases, "overdrive/tanh_os=" + std::to_string(factor) + "/block=" + std::to_string(b), os, b);
+  }
+
+  // One case per model file; the name carries the architecture so WaveNet/LSTM/ConvNet line up.
+  for (const std::string &path : a.namPaths)
+  {
+    pedal::chain::NodeSpec nam;
+    nam.id = "amp";
+    nam.type = "nam_model";
+    nam.category = "amp";
+    nam.asset = pedal::chain::AssetRef{path};
+    const std::string label = namArchitecture(path) + "/" + std::filesystem::path(path).stem().string();
+    // nam/ runs what the node picks (ours for WaveNet/LSTM); nam_ref/ pins the vendored nam::DSP;
+    // nam_fp16/ and nam_int8/ are ours with reduced-precision weights.
+    pedal::chain::NodeSpec ref = nam;
+    ref.params["inference"] = "reference";
+    pedal::chain::NodeSpec fp16 = nam;
+    fp16.params["precision"] = "fp16";
+    pedal::chain::NodeSpec int8 = nam;
+    int8.params["precision"] = "int8";
+    for (uint32_t b : a.blocks)
+    {
+      addNodeCase(cases, "nam/" + label + "/block=" + std::to_string(b), nam, b);
+      addNodeCase(cases, "nam_ref/" + label + "/block=" + std::to_string(b), ref, b);
+      addNodeCase(cases, "nam_fp16/" + label + "/block=" + std::to_string(b), fp16, b);
+      addNodeCase(cases, "nam_int8/" + label + "/block=" + std::to_string(b), int8, b);
+    }
+  }
+}
+
+static void addSoftclipCases(std::vector<Case> &cases, const Args &a)
+{
+  for (uint32_t b : a.blocks)
+  {
+    auto buf = std::make_shared<std::vector<float>>(noise(b, 1.5f, b));
+    auto out = std::make_shared<std::vector<float>>(b);
+    cases.push_back({"softclip_fast/block=" + std::to_string(b), b, [buf, out, b]
+                     {
+                       for (uint32_t i = 0; i < b; i++)
+                         (*out)[i] = pedal::dsp::softclipFast((*buf)[i]);
+                       keep(out->data());
+                     }});
+    cases.push_back({"tanh/block=" + std::to_string(b), b, [buf, out, b]
+                     {
+                       for (uint32_t i = 0; i < b; i++)
+                         (*out)[i] = std::tanh((*buf)[i]);
+                       keep(out->data());
+                     }});
+    cases.push_back({"tanh_fast/block=" + std::to_string(b), b, [buf, out, b]
+                     {
+                       for (uint32_t i = 0; i < b; i++)
+                         (*out)[i] = pedal::dsp::tanhFast((*buf)[i]);
+                       keep(out->data());
+                     }});
+
+    // The full clip stage, with its half-band up/down sampling.
+    using Curve = pedal::dsp::NonlinearStage::Curve;
+    for (Curve curve : {Curve::Cubic, Curve::Tanh})
+    {
+      for (int factor : {1, 2, 4})
+      {
+        auto stage = std::make_shared<pedal::dsp::NonlinearStage>();
+        stage->init(factor, curve, b);
+        const std::string name = std::string("clip_stage/") + (curve == Curve::Tanh ? "tanh" : "cubic") +
+                                 "/os=" + std::to_string(factor) + "/block=" + std::to_string(b);
+        cases.push_back({name, b, [buf, out, stage, b]
+                         {
+                           stage->process(buf->data(), out->data(), b);
+                           keep(out->data());
+                         }});
+      }
+    }
+  }
+}
+
+static void addAlsaConvertCases(std::vector<Case> &cases, const Args &a)
+{
+  using alsa_convert::Format;
+  constexpr unsigned kChannels = 2;
+  for (Format f : {Format::S32LE, Format::S24_3LE, Format::S16LE})
+  {
+    const std::string fmt = alsa_convert::formatName(f);
+    for (uint32_t b : a.blocks)
+    {
+      auto mono = std::make_shared<std::vector<float>>(noise(b, 0.9f, b));
+      auto raw = std::make_shared<std::vector<uint8_t>>((size_t)b * kChannels * alsa_convert::bytesPerSample(f));
+      alsa_convert::encodeFanout(mono->data(), f, kChannels, raw->data(), b);
+
+      cases.push_back({"alsa_decode/" + fmt + "/ch=2/block=" + std::to_string(b), b, [f, mono, raw, b]
+                       {
+                         const float peak = alsa_convert::decodeMono(raw->data(), f, kChannels, mono->data(), b);
+                         keep(&peak);
+                         keep(mono->data());
+                       }});
+      cases.push_back({"alsa_encode/" + fmt + "/ch=2/block=" + std::to_string(b), b, [f, mono, raw, b]
+                       {
+                         alsa_convert::encodeFanout(mono->data(), f, kChannels, raw->data(), b);
+                         keep(raw->data());
+                       }});
+      auto right = std::make_shared<std::vector<float>>(noise(b, 0.9f, b + 1));
+      cases.push_back({"alsa_encode_stereo/" + fmt + "/ch=2/block=" + std::to_string(b), b, [f, mono, right, raw, b]
+                       {
+                         alsa_convert::encodeStereo(mono->data(), right->data(), f, kChannels, raw->data(), b);
+                         keep(raw->data());
+                       }});
+      // The fused stages main_alsa runs: metering, output gain and the sanitizer in the same pass.
+      cases.push_back({"alsa_decode_input/" + fmt + "/ch=2/block=" + std::to_string(b), b, [f, mono, raw, b]
+                       {
+                         alsa_convert::Meter m;
+                         alsa_convert::decodeInput(raw->data(), f, kChannels, mono->data(), b, m);
+                         keep(&m);
+                         keep(mono->data());
+                       }});
+      cases.push_back({"alsa_encode_output/" + fmt + "/ch=2/block=" + std::to_string(b), b, [f, mono, raw, b]
+                       {
+                         alsa_convert::Meter chain, out;
+                         uint64_t nonFinite = 0;
+                         alsa_convert::encodeOutput(mono->data(), nullptr, 0.8f, true, f, kChannels, raw->data(), b,
+                                                    chain, out, nonFinite);
+                         keep(&out);
+                         keep(raw->data());
+                       }});
+      cases.push_back({"alsa_encode_output_stereo/" + fmt + "/ch=2/block=" + std::to_string(b), b,
+                       [f, mono, right, raw, b]
+                       {
+                         alsa_convert::Meter chain, out;
+                         uint64_t nonFinite = 0;
+                         alsa_convert::encodeOutput(mono->data(), right->data(), 0.8f, true, f, kChannels, raw->data(),
+                                                    b, chain, out, nonFinite);
+                         keep(&out);
+                         keep(raw->data());
+                       }});
+    }
+  }
+}
+
+// -------------------- Baseline --------------------
+static std::optional<Json> readBaseline(const std::string &path)
+{
+  if (path.empty() || !std::filesystem::exists(path))
+    return std::nullopt;
+  try
+  {
+    std::ifstream f(path);
+    Json j;
+    f >> j;
+    return j;
+  }
+  catch (const std::exception &e)
+  {
+    std::fprintf(stderr, "Ignoring unreadable baseline %s: %s\n", path.c_str(), e.what());
+    return std::nullopt;
+  }
+}
+
+static std::string cpuModel()
+{
+  std::ifstream f("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(f, line))
+  {
+    if (line.rfind("model name", 0) == 0 || line.rfind("Model", 0) == 0)
+    {
+      const size_t colon = line.find(':');
+      if (colon != std::string::npos)
+        return line.substr(line.find_first_not_of(" \t", colon + 1));
+    }
+  }
+  return "";
+}
+
+int main(int argc, char **argv)
+{
+  Args a;
+  if (!parseArgs(argc, argv, a))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Same FP environment as the audio thread.
+#if defined(__SSE__)
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#ifdef _MM_DENORMALS_ZERO_ON
+  _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+#endif
+#endif
+
+  std::vector<Case> cases;
+  addFftCases(cases, a);
+  addNodeCases(cases, a);
+  addSoftclipCases(cases, a);
+  addAlsaConvertCases(cases, a);
+
+  // Baselines are only comparable on the architecture they were recorded on.
+  std::optional<Json> baseline = readBaseline(a.baselinePath);
+  if (baseline && baseline->value("arch", "") != kArch)
+  {
+    std::fprintf(stderr, "Baseline %s is for %s, this is %s; not comparing\n", a.baselinePath.c_str(),
+                 baseline->value("arch", "?").c_str(), kArch);
+    baseline.reset();
+  }
+  const Json baseResults = (baseline && (*baseline)["results"].is_object()) ? (*baseline)["results"] : Json::object();
+
+  std::printf("%-48s %12s %12s %12s\n", "kernel", "ns/call", "ns/sample", "vs baseline");
+  Json results = Json::object();
+  int regressions = 0;
+  int improvements = 0;
+  for (const Case &c : cases)
+  {
+    if (!a.filter.empty() && c.name.find(a.filter) == std::string::npos)
+      continue;
+
+    const double nsCall = measureNsPerCall(c, a.minMs, a.reps);
+    const double nsSample = nsCall / (double)c.frames;
+    results[c.name] = Json{{"nsPerCall", std::round(nsCall * 10.0) / 10.0},
+                           {"nsPerSample", std::round(nsSample * 1000.0) / 1000.0}};
+
+    char cmp[64] = "";
+    if (baseResults.contains(c.name))
+    {
+      const double base = baseResults[c.name].value("nsPerSample", 0.0);
+      if (base > 0.0)
+      {
+        const double delta = nsSample / base - 1.0;
+        const char *flag = "";
+        if (delta > a.tolerance)
+        {
+          flag = " SLOWER";
+          regressions++;
+        }
+        else if (delta < -a.tolerance)
+        {
+          flag = " faster";
+          improvements++;
+        }
+        std::snprintf(cmp, sizeof(cmp), "%+.1f%%%s", delta * 100.0, flag);
+      }
+    }
+    std::printf("%-48s %12.1f %12.3f %12s\n", c.name.c_str(), nsCall, nsSample, cmp);
+    std::fflush(stdout);
+  }
+
+  if (baseline)
+    std::printf("\n%d slower, %d faster than baseline (tolerance %.0f%%)\n", regressions, improvements,
+                a.tolerance * 100.0);
+
+  if (a.writeBaseline)
+  {
+    // Merge, so a --filter run only replaces the kernels it measured.
+    Json merged = baseline ? *baseline : Json::object();
+    if (!merged["results"].is_object())
+      merged["results"] = Json::object();
+    for (auto it = results.begin(); it != results.end(); ++it)
+      merged["results"][it.key()] = it.value();
+    merged["arch"] = kArch;
+    merged["cpu"] = cpuModel();
+    merged["version"] = 1;
+
+    std::ofstream f(a.baselinePath);
+    f << merged.dump(2) << "\n";
+    if (!f)
+    {
+      std::fprintf(stderr, "Failed to write %s\n", a.baselinePath.c_str());
+      return 1;
+    }
+    std::printf("Wrote baseline %s\n", a.baselinePath.c_str());
+    return 0;
+  }
+
+  return (regressions > 0) ? 1 : 0;
+}
@@ -10,10 +10,14 @@
 #include <cerrno>
 #include <filesystem>
 #include <fstream>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
 #include <pthread.h>
 #include <sched.h>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <string>
 #include <thread>
 #include <vector>
@@ -24,17 +28,28 @@
 #include <pmmintrin.h>
 #endif
 
+#include "alsa_convert.h"
+#include "alsa_sched.h"
 #include "fft_convolver.h"
+#include "fftw_planner.h"
 #include "get_dsp.h"
 #include "ir_loader.h"
+#include "ir_spectra_cache.h"
 #include "json.hpp"
 #include "signal_chain.h"
 #include "signal_chain_schema.h"
+#include "asset_cache.h"
 #include "chain_control_server.h"
+#include "cycle_clock.h"
+#include "input_history.h"
+#include "rt_worker_pool.h"
+#include "signal_taps.h"
+#include "telemetry.h"
 
 // UDP
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -231,6 +246,26 @@ static void dump_alsa_device_hints()
                "ALSA: Hint: try 'aplay -l' / 'arecord -l' to find hw:<card>,<device> (or use plughw/plughw).\n");
 }
 
+// Helper threads for pipelined chains. Declared before gChainState so it outlives every chain.
+static pedal::dsp::RtWorkerPool gRtWorkers;
+// Runs the incoming chain beside the outgoing one during a dual-run crossfade (ALSA_XFADE_PERIODS).
+static pedal::dsp::RtWorkerPool gXfadeWorker;
+// Parsed models / prepared IRs shared across chain rebuilds.
+static pedal::dsp::AssetCache gAssetCache;
+// Prepared IR spectra on disk, below gAssetCache (ALSA_IR_CACHE_DIR).
+static pedal::dsp::IrSpectraCache gIrSpectraCache;
+
+// The last few seconds of input, for warming standby chains (preload_chain).
+static pedal::dsp::InputHistory gInputHistory;
+
+// Runtime record points (start_tap / ALSA_TAPS), streamed to disk off the audio thread.
+static pedal::dsp::SignalTaps gTaps;
+
+// Per-period timing/event records off the audio thread (ALSA_TELEMETRY).
+static pedal::telemetry::Telemetry gTelemetry;
+// Capture sanity verdict for the baseline check: 0 = pending, 1 = ok, -1 = silent.
+static std::atomic<int> gCaptureSanity{0};
+
 // v1 orchestration: ordered signal chain with RT-safe swapping.
 static pedal::control::ChainRuntimeState gChainState;
 static std::thread gControlThread;
@@ -243,10 +278,19 @@ static std::shared_ptr<pedal::dsp::SignalChain> gRetireQueue[kRetireQueueSize];
 // Use 64-bit indices to avoid wraparound bugs on long uptimes.
 static std::atomic<uint64_t> gRetireWrite{0};
 static std::atomic<uint64_t> gRetireRead{0};
+// Bumped after every push (and at shutdown); the retire thread futex-waits on it. 32-bit so the
+// wait/notify is a plain futex, like RtWorkerPool's job words.
+static std::atomic<uint32_t> gRetireSignal{0};
 static std::atomic<bool> gRetireRunning{true};
 static std::thread gRetireThread;
 static std::atomic<uint64_t> gRetireQueueFull{0};
 
+static void wakeRetireThread() noexcept
+{
+  gRetireSignal.fetch_add(1, std::memory_order_release);
+  gRetireSignal.notify_one();
+}
+
 static void startRetireThread()
 {
   if (gRetireThread.joinable())
@@ -255,10 +299,21 @@ static void startRetireThread()
   gRetireRunning.store(true, std::memory_order_relaxed);
   gRetireThread = std::thread([]()
                               {
-    while (gRetireRunning.load(std::memory_order_relaxed))
+#ifdef SCHED_IDLE
+    // Teardown is never urgent; it only has to keep the queue from filling up.
+    sched_param sp{};
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &sp) != 0)
+      std::fprintf(stderr, "ALSA: retire thread could not switch to SCHED_IDLE (continuing)\n");
+#endif
+
+    for (;;)
     {
+      // Read the signal before draining: a push after the drain then changes it and the wait returns.
+      const uint32_t seen = gRetireSignal.load(std::memory_order_acquire);
+
       uint64_t r = gRetireRead.load(std::memory_order_relaxed);
       const uint64_t w = gRetireWrite.load(std::memory_order_acquire);
+      const bool freed = (r != w);
       while (r != w)
       {
         const uint32_t idx = (uint32_t)(r % (uint64_t)kRetireQueueSize);
@@ -266,7 +321,18 @@ static void startRetireThread()
         r++;
       }
       gRetireRead.store(r, std::memory_order_release);
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+#if defined(__GLIBC__)
+      // NAM weights and FFT buffers are big; hand the pages back now rather than at the next peak.
+      if (freed)
+        ::malloc_trim(0);
+#else
+      (void)freed;
+#endif
+
+      if (!gRetireRunning.load(std::memory_order_relaxed))
+        break;
+      gRetireSignal.wait(seen, std::memory_order_acquire);
     }
 
     // Drain on shutdown.
@@ -281,6 +347,14 @@ static void startRetireThread()
     gRetireRead.store(r, std::memory_order_release); });
 }
 
+static void stopRetireThread()
+{
+  gRetireRunning.store(false, std::memory_order_relaxed);
+  wakeRetireThread();
+  if (gRetireThread.joinable())
+    gRetireThread.join();
+}
+
 static inline bool retireQueueHasSpace() noexcept
 {
   const uint64_t w = gRetireWrite.load(std::memory_order_relaxed);
@@ -306,6 +380,7 @@ static inline bool retireChainFromAudioThread(std::shared_ptr<pedal::dsp::Signal
   gRetireQueue[idx] = std::move(old);
   gRetireWrite.store(w + 1, std::memory_order_release);
   old.reset();
+  wakeRetireThread(); // a futex wake only when the retire thread is asleep on it
   return true;
 }
 
@@ -326,44 +401,6 @@ static std::atomic<float> namPostGainLin{1.0f};
 static std::atomic<float> namInLimit{0.90f};
 static std::atomic<float> namLevelScaleLin{1.0f};
 
-// Peak metering (updated in RT loop, read by meter thread)
-static std::atomic<float> peakInput{0.0f};
-static std::atomic<float> peakNamOut{0.0f};
-static std::atomic<float> peakIrOut{0.0f};
-static std::atomic<float> peakFinalOut{0.0f};
-
-// Optional realtime dump of the signal going into/out of NAM (for offline analysis).
-// Env:
-//   DUMP_NAM_IN_WAV=/tmp/nam_in.wav
-//   DUMP_NAM_OUT_WAV=/tmp/nam_out.wav
-//   DUMP_NAM_SECONDS=10
-// The dump is collected in the RT loop into a ring buffer and flushed on shutdown.
-static std::string dumpNamInPath;
-static std::string dumpNamOutPath;
-static uint32_t dumpNamMaxFrames = 0;
-static uint32_t dumpNamInitSr = 0;
-static uint32_t dumpNamInitSecs = 0;
-static std::atomic<uint32_t> dumpNamInWritePos{0};
-static std::atomic<uint32_t> dumpNamOutWritePos{0};
-static std::atomic<uint32_t> dumpNamInTotalWritten{0};
-static std::atomic<uint32_t> dumpNamOutTotalWritten{0};
-static std::vector<float> dumpNamIn;
-static std::vector<float> dumpNamOut;
-static std::mutex dumpNamFlushMutex;
-
-// Optional realtime dump of IR output (post-convolver) for offline analysis.
-// Env:
-//   DUMP_IR_OUT_WAV=/tmp/ir_out.wav
-//   DUMP_IR_SECONDS=10
-static std::string dumpIrOutPath;
-static uint32_t dumpIrMaxFrames = 0;
-static uint32_t dumpIrInitSr = 0;
-static uint32_t dumpIrInitSecs = 0;
-static std::atomic<uint32_t> dumpIrOutWritePos{0};
-static std::atomic<uint32_t> dumpIrOutTotalWritten{0};
-static std::vector<float> dumpIrOut;
-static std::mutex dumpIrFlushMutex;
-
 // Config
 static std::atomic<float> inputTrimDb{0.0f};
 static std::atomic<float> inputTrimLin{1.0f};
@@ -417,272 +454,167 @@ static inline uint32_t readEnvU32AllowZero(const char *k, uint32_t def)
   return def;
 }
 
-static void dumpNamInit(uint32_t sr)
+// ALSA_TELEMETRY=0 goes back to printing stats from the audio loop (no histograms, no get_stats).
+static bool telemetryEnabled()
 {
-  const char *inP = std::getenv("DUMP_NAM_IN_WAV");
-  const char *outP = std::getenv("DUMP_NAM_OUT_WAV");
-  if (inP)
-    dumpNamInPath = inP;
-  if (outP)
-    dumpNamOutPath = outP;
-  if (dumpNamInPath.empty() && dumpNamOutPath.empty())
-    return;
-
-  const uint32_t secs = readEnvU32("DUMP_NAM_SECONDS", 10);
-
-  if (dumpNamMaxFrames != 0)
-  {
-    if (sr == dumpNamInitSr && secs == dumpNamInitSecs)
-      return;
-
-    std::printf("Dump: re-init due to SR/secs change (old sr=%u secs=%u -> new sr=%u secs=%u)\n",
-                dumpNamInitSr, dumpNamInitSecs, sr, secs);
-    std::fflush(stdout);
-  }
-
-  dumpNamInitSr = sr;
-  dumpNamInitSecs = secs;
-  dumpNamMaxFrames = sr * secs;
-  dumpNamInWritePos.store(0, std::memory_order_relaxed);
-  dumpNamOutWritePos.store(0, std::memory_order_relaxed);
-  dumpNamInTotalWritten.store(0, std::memory_order_relaxed);
-  dumpNamOutTotalWritten.store(0, std::memory_order_relaxed);
-  if (!dumpNamInPath.empty())
-    dumpNamIn.assign(dumpNamMaxFrames, 0.0f);
-  if (!dumpNamOutPath.empty())
-    dumpNamOut.assign(dumpNamMaxFrames, 0.0f);
-
-  std::printf("Dump: enabled NAM dump for %u seconds (%u frames).\n", secs, dumpNamMaxFrames);
-  if (!dumpNamInPath.empty())
-    std::printf("Dump: DUMP_NAM_IN_WAV=%s\n", dumpNamInPath.c_str());
-  if (!dumpNamOutPath.empty())
-    std::printf("Dump: DUMP_NAM_OUT_WAV=%s\n", dumpNamOutPath.c_str());
-  std::fflush(stdout);
+  static const bool on = readEnvU32AllowZero("ALSA_TELEMETRY", 1) != 0;
+  return on;
 }
 
-static void dumpIrInit(uint32_t sr)
+static void onSignal(int) { running.store(false); }
+
+static void tryEnableRealtime()
 {
-  const char *outP = std::getenv("DUMP_IR_OUT_WAV");
-  if (outP)
-    dumpIrOutPath = outP;
-  if (dumpIrOutPath.empty())
+  const char *envRt = std::getenv("ALSA_ENABLE_RT");
+  const bool enable = (envRt == nullptr) ? true : (std::atoi(envRt) != 0);
+  if (!enable)
     return;
 
-  const uint32_t secs = readEnvU32("DUMP_IR_SECONDS", 10);
+  const int prio = std::getenv("ALSA_RT_PRIORITY") ? std::atoi(std::getenv("ALSA_RT_PRIORITY")) : 80;
 
-  if (dumpIrMaxFrames != 0)
-  {
-    if (sr == dumpIrInitSr && secs == dumpIrInitSecs)
-      return;
+  // Lock memory to avoid page faults in the audio thread.
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    std::fprintf(stderr, "ALSA: mlockall failed (continuing): %s\n", std::strerror(errno));
+  else
+    std::fprintf(stderr, "ALSA: mlockall ok\n");
 
-    std::printf("Dump: IR re-init due to SR/secs change (old sr=%u secs=%u -> new sr=%u secs=%u)\n",
-                dumpIrInitSr, dumpIrInitSecs, sr, secs);
-    std::fflush(stdout);
+  // Try to elevate scheduling policy.
+  sched_param sp{};
+  sp.sched_priority = prio;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+  {
+    std::fprintf(stderr, "ALSA: pthread_setschedparam failed (continuing): %s\n", std::strerror(errno));
   }
-
-  dumpIrInitSr = sr;
-  dumpIrInitSecs = secs;
-  dumpIrMaxFrames = sr * secs;
-  dumpIrOutWritePos.store(0, std::memory_order_relaxed);
-  dumpIrOutTotalWritten.store(0, std::memory_order_relaxed);
-  dumpIrOut.assign(dumpIrMaxFrames, 0.0f);
-
-  std::printf("Dump: enabled IR dump for %u seconds (%u frames).\n", secs, dumpIrMaxFrames);
-  std::printf("Dump: DUMP_IR_OUT_WAV=%s\n", dumpIrOutPath.c_str());
-  std::fflush(stdout);
-}
-
-static inline void dumpNamPushIn(const float *in, uint32_t nframes)
-{
-  if (dumpNamMaxFrames == 0 || dumpNamIn.empty())
-    return;
-  uint32_t wp = dumpNamInWritePos.load(std::memory_order_relaxed);
-  if (wp >= dumpNamMaxFrames)
-    return;
-  const uint32_t toWrite = std::min(nframes, dumpNamMaxFrames - wp);
-  if (toWrite == 0)
-    return;
-  if (in)
-    std::memcpy(&dumpNamIn[wp], in, sizeof(float) * toWrite);
   else
-    std::memset(&dumpNamIn[wp], 0, sizeof(float) * toWrite);
-  dumpNamInWritePos.store(wp + toWrite, std::memory_order_relaxed);
-  dumpNamInTotalWritten.store(wp + toWrite, std::memory_order_relaxed);
-}
+    std::fprintf(stderr, "ALSA: requested realtime (SCHED_FIFO prio=%d)\n", prio);
 
-static inline void dumpNamPushOut(const float *out, uint32_t nframes)
-{
-  if (dumpNamMaxFrames == 0 || dumpNamOut.empty())
-    return;
-  uint32_t wp = dumpNamOutWritePos.load(std::memory_order_relaxed);
-  if (wp >= dumpNamMaxFrames)
-    return;
-  const uint32_t toWrite = std::min(nframes, dumpNamMaxFrames - wp);
-  if (toWrite == 0)
-    return;
-  if (out)
-    std::memcpy(&dumpNamOut[wp], out, sizeof(float) * toWrite);
-  else
-    std::memset(&dumpNamOut[wp], 0, sizeof(float) * toWrite);
-  dumpNamOutWritePos.store(wp + toWrite, std::memory_order_relaxed);
-  dumpNamOutTotalWritten.store(wp + toWrite, std::memory_order_relaxed);
+  // Always log the effective state (policy/priority/affinity).
+  logThreadRtState();
 }
 
-static inline void dumpIrPushOut(const float *out, uint32_t nframes)
-{
-  if (dumpIrMaxFrames == 0 || dumpIrOut.empty())
-    return;
-  uint32_t wp = dumpIrOutWritePos.load(std::memory_order_relaxed);
-  if (wp >= dumpIrMaxFrames)
-    return;
-  const uint32_t toWrite = std::min(nframes, dumpIrMaxFrames - wp);
-  if (toWrite == 0)
-    return;
-  if (out)
-    std::memcpy(&dumpIrOut[wp], out, sizeof(float) * toWrite);
-  else
-    std::memset(&dumpIrOut[wp], 0, sizeof(float) * toWrite);
-  dumpIrOutWritePos.store(wp + toWrite, std::memory_order_relaxed);
-  dumpIrOutTotalWritten.store(wp + toWrite, std::memory_order_relaxed);
-}
+static void configureDenormals();
 
-static bool writeWavPcm16Mono(const std::string &path, const std::vector<float> &y, uint32_t nframes, uint32_t sr)
+// Parses "1,2,3" into CPU indices; anything unparsable is skipped.
+static std::vector<int> parseCpuList(const char *s)
 {
-  if (path.empty() || nframes == 0)
-    return false;
-  SF_INFO info{};
-  info.samplerate = (int)sr;
-  info.channels = 1;
-  info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
-  SNDFILE *sf = sf_open(path.c_str(), SFM_WRITE, &info);
-  if (!sf)
-  {
-    std::fprintf(stderr, "Dump: failed to open %s: %s\n", path.c_str(), sf_strerror(nullptr));
-    return false;
-  }
-  std::vector<short> tmp(nframes);
-  for (uint32_t i = 0; i < nframes; i++)
+  std::vector<int> cpus;
+  while (s && *s)
   {
-    float s = y[i];
-    if (s > 1.0f)
-      s = 1.0f;
-    if (s < -1.0f)
-      s = -1.0f;
-    tmp[i] = (short)std::lround(s * 32767.0f);
+    char *end = nullptr;
+    const long v = std::strtol(s, &end, 10);
+    if (end == s)
+    {
+      s++;
+      continue;
+    }
+    if (v >= 0 && v < CPU_SETSIZE)
+      cpus.push_back((int)v);
+    s = end;
   }
-  const sf_count_t wrote = sf_write_short(sf, tmp.data(), (sf_count_t)tmp.size());
-  sf_close(sf);
-  return wrote == (sf_count_t)tmp.size();
+  return cpus;
 }
 
-static void dumpNamFlush(uint32_t sr)
+static void startRtWorkers()
 {
-  std::lock_guard<std::mutex> lock(dumpNamFlushMutex);
-  if (dumpNamMaxFrames == 0)
+  uint32_t stages = 1;
+  if (const char *e = std::getenv("ALSA_PIPELINE"))
+    stages = (uint32_t)std::max(1, std::atoi(e));
+
+  // One worker per pipeline stage but the last, plus one for IR tail offload.
+  int workers = (int)stages - 1;
+  if (const char *e = std::getenv("ALSA_IR_SPLIT_TAIL"))
+    workers += (std::atoi(e) != 0) ? 1 : 0;
+  if (const char *e = std::getenv("ALSA_RT_WORKERS"))
+    workers = std::max(0, std::atoi(e));
+  if (workers <= 0)
     return;
 
-  const uint32_t inTotal = dumpNamInTotalWritten.load(std::memory_order_relaxed);
-  const uint32_t outTotal = dumpNamOutTotalWritten.load(std::memory_order_relaxed);
-  const uint32_t inWp = dumpNamInWritePos.load(std::memory_order_relaxed);
-  const uint32_t outWp = dumpNamOutWritePos.load(std::memory_order_relaxed);
-
-  std::printf("Dump: flush sr=%u maxFrames=%u in_wp=%u in_total=%u out_wp=%u out_total=%u\n",
-              sr, dumpNamMaxFrames, inWp, inTotal, outWp, outTotal);
-  std::fflush(stdout);
+  pedal::dsp::RtWorkerPool::Config cfg;
+  cfg.workers = std::min(workers, 8);
+  cfg.threadInit = &configureDenormals;
 
-  auto slice = [&](const std::vector<float> &buf, uint32_t total) -> std::vector<float>
+  // Workers run just below the audio thread so a late stage never preempts the period itself.
+  const char *envRt = std::getenv("ALSA_ENABLE_RT");
+  if (envRt == nullptr || std::atoi(envRt) != 0)
   {
-    total = std::min(total, dumpNamMaxFrames);
-    return std::vector<float>(buf.begin(), buf.begin() + total);
-  };
+    const int prio = std::getenv("ALSA_RT_PRIORITY") ? std::atoi(std::getenv("ALSA_RT_PRIORITY")) : 80;
+    cfg.rtPriority = std::max(1, prio - 1);
+  }
 
-  if (!dumpNamInPath.empty() && !dumpNamIn.empty())
+  if (const char *e = std::getenv("ALSA_RT_WORKER_CPUS"))
   {
-    const uint32_t total = inTotal;
-    if (total > 0)
-    {
-      auto y = slice(dumpNamIn, total);
-      if (writeWavPcm16Mono(dumpNamInPath, y, (uint32_t)y.size(), sr))
-        std::printf("Dump: wrote %u frames (%.2fs) to %s\n",
-                    (unsigned)y.size(),
-                    (double)y.size() / (double)sr,
-                    dumpNamInPath.c_str());
-    }
+    cfg.cpus = parseCpuList(e);
   }
-  if (!dumpNamOutPath.empty() && !dumpNamOut.empty())
+  else
   {
-    const uint32_t total = outTotal;
-    if (total > 0)
-    {
-      auto y = slice(dumpNamOut, total);
-      if (writeWavPcm16Mono(dumpNamOutPath, y, (uint32_t)y.size(), sr))
-        std::printf("Dump: wrote %u frames (%.2fs) to %s\n",
-                    (unsigned)y.size(),
-                    (double)y.size() / (double)sr,
-                    dumpNamOutPath.c_str());
-    }
+    // Default: keep core 0 for the audio thread and IRQs, one core per worker after it.
+    const int ncpu = (int)std::thread::hardware_concurrency();
+    for (int i = 0; i < cfg.workers && ncpu > 1; i++)
+      cfg.cpus.push_back(1 + (i % (ncpu - 1)));
   }
-  std::fflush(stdout);
-}
 
-static void dumpIrFlush(uint32_t sr)
-{
-  std::lock_guard<std::mutex> lock(dumpIrFlushMutex);
-  if (dumpIrMaxFrames == 0)
+  if (!gRtWorkers.start(cfg))
     return;
 
-  const uint32_t outTotal = dumpIrOutTotalWritten.load(std::memory_order_relaxed);
-  const uint32_t outWp = dumpIrOutWritePos.load(std::memory_order_relaxed);
-
-  std::printf("Dump: IR flush sr=%u maxFrames=%u out_wp=%u out_total=%u\n",
-              sr, dumpIrMaxFrames, outWp, outTotal);
-  std::fflush(stdout);
-
-  if (!dumpIrOutPath.empty() && !dumpIrOut.empty())
-  {
-    const uint32_t total = std::min(outTotal, dumpIrMaxFrames);
-    if (total > 0)
-    {
-      std::vector<float> y(dumpIrOut.begin(), dumpIrOut.begin() + total);
-      if (writeWavPcm16Mono(dumpIrOutPath, y, (uint32_t)y.size(), sr))
-        std::printf("Dump: wrote %u frames (%.2fs) to %s\n",
-                    (unsigned)y.size(),
-                    (double)y.size() / (double)sr,
-                    dumpIrOutPath.c_str());
-    }
-  }
-  std::fflush(stdout);
+  gChainState.ctx.workers = &gRtWorkers;
+  gChainState.ctx.pipelineStages = stages;
 }
 
-static void onSignal(int) { running.store(false); }
-
-static void tryEnableRealtime()
+// One more RT helper, kept apart from gRtWorkers so the chains' own stage and IR-tail jobs never
+// queue behind a crossfade.
+static void startXfadeWorker()
 {
-  const char *envRt = std::getenv("ALSA_ENABLE_RT");
-  const bool enable = (envRt == nullptr) ? true : (std::atoi(envRt) != 0);
-  if (!enable)
+  if (readEnvU32AllowZero("ALSA_XFADE_PERIODS", 0) == 0)
     return;
 
-  const int prio = std::getenv("ALSA_RT_PRIORITY") ? std::atoi(std::getenv("ALSA_RT_PRIORITY")) : 80;
+  pedal::dsp::RtWorkerPool::Config cfg;
+  cfg.workers = 1;
+  cfg.threadInit = &configureDenormals;
 
-  // Lock memory to avoid page faults in the audio thread.
-  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
-    std::fprintf(stderr, "ALSA: mlockall failed (continuing): %s\n", std::strerror(errno));
-  else
-    std::fprintf(stderr, "ALSA: mlockall ok\n");
+  const char *envRt = std::getenv("ALSA_ENABLE_RT");
+  if (envRt == nullptr || std::atoi(envRt) != 0)
+  {
+    const int prio = std::getenv("ALSA_RT_PRIORITY") ? std::atoi(std::getenv("ALSA_RT_PRIORITY")) : 80;
+    cfg.rtPriority = std::max(1, prio - 1);
+  }
 
-  // Try to elevate scheduling policy.
-  sched_param sp{};
-  sp.sched_priority = prio;
-  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+  if (const char *e = std::getenv("ALSA_XFADE_CPU"))
   {
-    std::fprintf(stderr, "ALSA: pthread_setschedparam failed (continuing): %s\n", std::strerror(errno));
+    cfg.cpus = parseCpuList(e);
   }
   else
-    std::fprintf(stderr, "ALSA: requested realtime (SCHED_FIFO prio=%d)\n", prio);
+  {
+    // Default: the last core, furthest from the audio thread and the first RT workers.
+    const int ncpu = (int)std::thread::hardware_concurrency();
+    if (ncpu > 1)
+      cfg.cpus.push_back(ncpu - 1);
+  }
 
-  // Always log the effective state (policy/priority/affinity).
-  logThreadRtState();
+  if (gXfadeWorker.start(cfg))
+    std::printf("ALSA: dual-run chain crossfade on cpu %d\n", cfg.cpus.empty() ? -1 : cfg.cpus[0]);
+}
+
+// The incoming chain's period during a dual-run crossfade, posted to gXfadeWorker.
+struct XfadeJob
+{
+  pedal::dsp::SignalChain *chain = nullptr;
+  const float *in = nullptr;
+  float *out[2] = {};
+  uint32_t frames = 0;
+  uint64_t ticks = 0;
+};
+
+static void xfadeJob(void *arg) noexcept
+{
+  auto *job = static_cast<XfadeJob *>(arg);
+  // Only the audio thread posts to gRtWorkers: the chain's own stage and tail jobs run inline here.
+  pedal::dsp::RtWorkerPool::setInlineOnThisThread(true);
+  const uint64_t t0 = pedal::dsp::cycleCount();
+  if (job->chain->channels() == 2)
+    job->chain->process(job->in, job->out, job->frames);
+  else
+    job->chain->process(job->in, job->out[0], job->frames);
+  job->ticks = pedal::dsp::cycleCount() - t0;
 }
 
 static void configureDenormals()
@@ -847,8 +779,6 @@ static void applyEnvOverrides()
   {
     const int v = std::atoi(envTanh);
     useTanhSoftclip.store(v != 0);
-    if (v != 0)
-      std::fprintf(stderr, "ALSA: warning: tanh softclip is expensive\n");
   }
 
   if (const char *envSan = std::getenv("ALSA_SANITIZE_OUTPUT"))
@@ -943,6 +873,43 @@ static void applyBypassFlagsToSpec(pedal::chain::ChainSpec &spec)
   }
 }
 
+// ALSA_TAPS=point=path[,point=path...] opens taps at startup (ALSA_TAP_SECONDS each, 0 = until
+// stop_tap); start_tap opens more at runtime.
+static void startTaps(uint32_t sampleRate)
+{
+  pedal::dsp::SignalTaps::Config cfg;
+  cfg.sampleRate = sampleRate;
+  cfg.bufferMs = readEnvU32("ALSA_TAP_BUFFER_MS", 1000);
+  gTaps.start(cfg);
+
+  const char *env = std::getenv("ALSA_TAPS");
+  if (!env || !*env)
+    return;
+  const double secs = (double)readEnvU32AllowZero("ALSA_TAP_SECONDS", 10);
+  std::string list = env;
+  size_t pos = 0;
+  while (pos <= list.size())
+  {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos)
+      end = list.size();
+    const std::string item = list.substr(pos, end - pos);
+    pos = end + 1;
+    if (item.empty())
+      continue;
+    const size_t eq = item.find('=');
+    std::string err;
+    const std::string point = (eq == std::string::npos) ? item : item.substr(0, eq);
+    const std::string path = (eq == std::string::npos) ? std::string() : item.substr(eq + 1);
+    const bool raw = path.size() > 4 && path.compare(path.size() - 4, 4, ".raw") == 0;
+    const int id = gTaps.open(point, path, raw, secs, err);
+    if (id < 0)
+      std::fprintf(stderr, "Taps: ALSA_TAPS %s: %s\n", item.c_str(), err.c_str());
+    else
+      std::fprintf(stderr, "Taps: tap %d records %s to %s\n", id, point.c_str(), path.c_str());
+  }
+}
+
 static void initChainRuntime(uint32_t sampleRate, uint32_t maxBlockFrames)
 {
   pedal::chain::ChainSpec spec;
@@ -986,6 +953,32 @@ static void initChainRuntime(uint32_t sampleRate, uint32_t maxBlockFrames)
   gChainState.ctx.inputTrimDb = &inputTrimDb;
   gChainState.ctx.inputTrimLin = &inputTrimLin;
 
+  gAssetCache.setMaxEntries(readEnvU32AllowZero("ALSA_ASSET_CACHE_ENTRIES", 8));
+  gChainState.ctx.assets = &gAssetCache;
+
+  const char *irCacheDir = std::getenv("ALSA_IR_CACHE_DIR");
+  gIrSpectraCache.setDir(irCacheDir ? irCacheDir : "/opt/pedal/cache/ir");
+  gChainState.ctx.irSpectra = gIrSpectraCache.enabled() ? &gIrSpectraCache : nullptr;
+
+  // Helpers for parallel node builds in the control server's chain builder (0 = serial).
+  gChainState.buildThreads = (int)readEnvU32AllowZero("ALSA_BUILD_THREADS", 2);
+
+  // preload_chain slots, kept fed with the live input.
+  gChainState.standbySlots = readEnvU32AllowZero("ALSA_STANDBY_CHAINS", 8);
+  gChainState.standbyWarmMs = readEnvU32AllowZero("ALSA_STANDBY_WARM_MS", 250);
+  gChainState.standbyThreadInit = &configureDenormals;
+  gChainState.inputHistory = &gInputHistory;
+
+  startTaps(sampleRate);
+  gChainState.ctx.taps = &gTaps;
+  gChainState.taps = &gTaps;
+
+  // Per-node cost accounting (two cycle-counter reads per plan step); cheap enough to stay on.
+  gChainState.ctx.nodeTicks = telemetryEnabled() && readEnvU32AllowZero("ALSA_NODE_TIMING", 1) != 0;
+  gChainState.telemetry = telemetryEnabled() ? &gTelemetry : nullptr;
+
+  startRtWorkers();
+  startXfadeWorker();
   startRetireThread();
 
   // Socket path can be overridden for integration with Node backend.
@@ -1009,6 +1002,7 @@ static void initChainRuntime(uint32_t sampleRate, uint32_t maxBlockFrames)
     {
       std::atomic_store_explicit(&gChainState.activeChain, fbBuilt->chain, std::memory_order_release);
       gChainState.lastSpec = fb;
+      gChainState.latestChain = fbBuilt->chain;
     }
     else
     {
@@ -1019,8 +1013,15 @@ static void initChainRuntime(uint32_t sampleRate, uint32_t maxBlockFrames)
   {
     std::atomic_store_explicit(&gChainState.activeChain, built->chain, std::memory_order_release);
     gChainState.lastSpec = spec;
+    gChainState.latestChain = built->chain;
     if (!built->warning.empty())
       std::fprintf(stderr, "Chain: warning: %s\n", built->warning.c_str());
+    if (built->chain->pipelineStages() > 1)
+      std::fprintf(stderr, "Chain: pipelined (stages=%zu, +%u period(s) latency)\n",
+                   built->chain->pipelineStages(), built->chain->latencyPeriods());
+    std::fprintf(stderr, "Chain: buffers %zu KiB\n", built->chain->arenaBytes() / 1024);
+    if (built->chain->channels() > 1)
+      std::fprintf(stderr, "Chain: stereo output\n");
   }
 
   if (!gControlThread.joinable())
@@ -1057,7 +1058,7 @@ static void udpControlThread()
     return;
   }
 
-  std::printf("Control: UDP localhost:9000 (send: TRIM_DB <value>)\n");
+  std::printf("Control: UDP localhost:9000 (send: TRIM_DB <value>, or set_trim on the control socket)\n");
 
   char buf[256];
   while (running.load(std::memory_order_relaxed))
@@ -1076,8 +1077,18 @@ static void udpControlThread()
     }
     buf[n] = '\0';
 
+    // "TRIM_DB <value>": a prefix compare and strtof, no scanf format parsing per datagram.
+    static constexpr char kTrimCmd[] = "TRIM_DB";
+    constexpr size_t kTrimLen = sizeof(kTrimCmd) - 1;
     float valDb = 0.0f;
-    if (std::sscanf(buf, "TRIM_DB %f", &valDb) == 1)
+    bool isTrim = std::strncmp(buf, kTrimCmd, kTrimLen) == 0;
+    if (isTrim)
+    {
+      char *end = nullptr;
+      valDb = std::strtof(buf + kTrimLen, &end);
+      isTrim = end != buf + kTrimLen;
+    }
+    if (isTrim)
     {
       valDb = clampf(valDb, -24.0f, 24.0f);
       inputTrimDb.store(valDb);
@@ -1096,25 +1107,80 @@ static void udpControlThread()
   ::close(sock);
 }
 
+static snd_pcm_format_t toAlsaFormat(alsa_convert::Format f)
+{
+  switch (f)
+  {
+  case alsa_convert::Format::S32LE:
+    return SND_PCM_FORMAT_S32_LE;
+  case alsa_convert::Format::S24_3LE:
+    return SND_PCM_FORMAT_S24_3LE;
+  case alsa_convert::Format::S16LE:
+    return SND_PCM_FORMAT_S16_LE;
+  }
+  return SND_PCM_FORMAT_S32_LE;
+}
+
+// wantMmap asks for MMAP_INTERLEAVED and falls back to RW_INTERLEAVED; mmap reports what was set.
+// With forcedFormat null the first of S32_LE, S24_3LE, S16_LE the device accepts is used.
 static int setup_pcm(snd_pcm_t *pcm,
                      snd_pcm_stream_t stream,
                      unsigned int &rate,
                      unsigned int channels,
                      snd_pcm_uframes_t &periodSize,
                      unsigned int &periods,
-                     snd_pcm_uframes_t &bufferSize)
+                     snd_pcm_uframes_t &bufferSize,
+                     bool wantMmap,
+                     const alsa_convert::Format *forcedFormat,
+                     bool &mmap,
+                     alsa_convert::Format &format)
 {
+  const char *label = (stream == SND_PCM_STREAM_CAPTURE) ? "capture" : "playback";
+
   snd_pcm_hw_params_t *hw = nullptr;
   snd_pcm_hw_params_alloca(&hw);
   int err = snd_pcm_hw_params_any(pcm, hw);
   if (err < 0)
     return err;
 
-  err = snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED);
-  if (err < 0)
-    return err;
+  mmap = false;
+  if (wantMmap)
+  {
+    err = snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED);
+    if (err == 0)
+      mmap = true;
+    else
+      std::fprintf(stderr, "ALSA: %s: mmap access unavailable (%s), using read/write\n", label, snd_strerror(err));
+  }
+  if (!mmap)
+  {
+    err = snd_pcm_hw_params_set_access(pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED);
+    if (err < 0)
+      return err;
+  }
 
-  err = snd_pcm_hw_params_set_format(pcm, hw, SND_PCM_FORMAT_S32_LE);
+  if (forcedFormat)
+  {
+    format = *forcedFormat;
+  }
+  else
+  {
+    static constexpr alsa_convert::Format kPreference[] = {
+        alsa_convert::Format::S32LE,
+        alsa_convert::Format::S24_3LE,
+        alsa_convert::Format::S16LE,
+    };
+    format = kPreference[0];
+    for (alsa_convert::Format f : kPreference)
+    {
+      if (snd_pcm_hw_params_test_format(pcm, hw, toAlsaFormat(f)) == 0)
+      {
+        format = f;
+        break;
+      }
+    }
+  }
+  err = snd_pcm_hw_params_set_format(pcm, hw, toAlsaFormat(format));
   if (err < 0)
     return err;
 
@@ -1151,16 +1217,20 @@ static int setup_pcm(snd_pcm_t *pcm,
   bufferSize = 0;
   snd_pcm_hw_params_get_buffer_size(hw, &bufferSize);
 
-  std::printf("ALSA %s: rate=%u ch=%u period=%lu periods=%u buffer=%lu\n",
-              (stream == SND_PCM_STREAM_CAPTURE) ? "capture" : "playback",
-              setRate, channels, (unsigned long)periodSize, periods, (unsigned long)bufferSize);
+  std::printf("ALSA %s: rate=%u ch=%u period=%lu periods=%u buffer=%lu access=%s format=%s\n",
+              label, setRate, channels, (unsigned long)periodSize, periods, (unsigned long)bufferSize,
+              mmap ? "mmap" : "rw", alsa_convert::formatName(format));
   return 0;
 }
 
+// startThreshold: playback start fill; 0 = buffer less one period. timestamps enables monotonic
+// snd_pcm_htimestamp() for the poll scheduler.
 static int setup_sw_params(snd_pcm_t *pcm,
                            snd_pcm_stream_t stream,
                            snd_pcm_uframes_t periodSize,
-                           snd_pcm_uframes_t bufferSize)
+                           snd_pcm_uframes_t bufferSize,
+                           snd_pcm_uframes_t startThreshold = 0,
+                           bool timestamps = false)
 {
   snd_pcm_sw_params_t *sw = nullptr;
   snd_pcm_sw_params_alloca(&sw);
@@ -1173,9 +1243,18 @@ static int setup_sw_params(snd_pcm_t *pcm,
   if (err < 0)
     return err;
 
+  if (timestamps)
+  {
+    err = snd_pcm_sw_params_set_tstamp_mode(pcm, sw, SND_PCM_TSTAMP_ENABLE);
+    if (err == 0)
+      err = snd_pcm_sw_params_set_tstamp_type(pcm, sw, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+    if (err < 0)
+      return err;
+  }
+
   // Start playback once the buffer has enough data to avoid immediate underruns.
   if (stream == SND_PCM_STREAM_PLAYBACK)
-    err = snd_pcm_sw_params_set_start_threshold(pcm, sw, bufferSize - periodSize);
+    err = snd_pcm_sw_params_set_start_threshold(pcm, sw, startThreshold ? startThreshold : bufferSize - periodSize);
   else
     // Start capture only after a full period is available.
     err = snd_pcm_sw_params_set_start_threshold(pcm, sw, periodSize);
@@ -1234,198 +1313,472 @@ static bool recover_pcm(snd_pcm_t *pcm, const char *label, int err)
   return true;
 }
 
-int main()
+// ALSA_MMAP capture: decodes up to want frames straight out of the DMA ring into mono (no readi
+// copy), metering them into `meter`. May return fewer frames at the ring wrap. Returns the frame
+// count, or a negative ALSA error for recover_pcm().
+static snd_pcm_sframes_t mmapReadMono(snd_pcm_t *pcm,
+                                      alsa_convert::Format format,
+                                      unsigned int channels,
+                                      float *mono,
+                                      snd_pcm_uframes_t want,
+                                      alsa_convert::Meter &meter)
 {
-  setvbuf(stdout, nullptr, _IONBF, 0);
-  setvbuf(stderr, nullptr, _IONBF, 0);
-
-  logBuildBanner();
-
-  tryEnableRealtime();
-  configureDenormals();
-
-  loadConfig();
-  applyEnvOverrides();
+  snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+  if (avail < 0)
+    return avail;
+  if ((snd_pcm_uframes_t)avail < want)
+  {
+    // readi starts a prepared capture stream on its own; mmap access has to do it by hand.
+    if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED)
+    {
+      const int err = snd_pcm_start(pcm);
+      if (err < 0)
+        return err;
+    }
+    const int err = snd_pcm_wait(pcm, 1000);
+    if (err < 0)
+      return err;
+    avail = snd_pcm_avail_update(pcm);
+    if (avail <= 0)
+      return avail;
+  }
+
+  const snd_pcm_channel_area_t *areas = nullptr;
+  snd_pcm_uframes_t offset = 0;
+  snd_pcm_uframes_t frames = std::min<snd_pcm_uframes_t>((snd_pcm_uframes_t)avail, want);
+  int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+  if (err < 0)
+    return err;
 
-  std::signal(SIGINT, onSignal);
-  std::signal(SIGTERM, onSignal);
+  // Interleaved: one area describes every channel of the frame.
+  const uint8_t *src = (const uint8_t *)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+  alsa_convert::decodeInput(src, format, channels, mono, (uint32_t)frames, meter);
 
-  const char *dev = std::getenv("ALSA_DEVICE");
-  const char *devDefault = (dev && dev[0]) ? dev : "hw:0,0";
+  const snd_pcm_sframes_t done = snd_pcm_mmap_commit(pcm, offset, frames);
+  if (done < 0)
+    return done;
+  if ((snd_pcm_uframes_t)done != frames)
+    return -EPIPE;
+  return done;
+}
 
-  const char *envCapDev = std::getenv("ALSA_CAPTURE_DEVICE");
-  const char *envPbDev = std::getenv("ALSA_PLAYBACK_DEVICE");
-  const char *capDevName = (envCapDev && envCapDev[0]) ? envCapDev : devDefault;
-  const char *pbDevName = (envPbDev && envPbDev[0]) ? envPbDev : devDefault;
+// Output gain, sanitizing and metering, applied by alsa_convert::encodeOutput on the way into the
+// playback buffer (or straight into the DMA ring with ALSA_MMAP). The meters and nonFinite
+// accumulate over every encodeOutput call of a period.
+struct OutputStage
+{
+  float gain = 1.0f;
+  bool sanitize = false;
+  alsa_convert::Meter chain; // chain output, before the gain
+  alsa_convert::Meter out;   // what gets converted (before the clamp)
+  uint64_t nonFinite = 0;
+};
+
+// ALSA_MMAP playback: runs the output stage straight into the DMA ring, fanned out to every
+// channel (or, with right != nullptr, mono as the left channel and right as the right one).
+// Starts a prepared stream once startThreshold frames are queued, as writei would. Same return
+// convention as mmapReadMono().
+static snd_pcm_sframes_t mmapWriteFanout(snd_pcm_t *pcm,
+                                         alsa_convert::Format format,
+                                         unsigned int channels,
+                                         const float *mono,
+                                         const float *right,
+                                         snd_pcm_uframes_t want,
+                                         snd_pcm_uframes_t bufferSize,
+                                         snd_pcm_uframes_t startThreshold,
+                                         OutputStage &stage)
+{
+  snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+  if (avail < 0)
+    return avail;
+  if (avail == 0)
+  {
+    const int err = snd_pcm_wait(pcm, 1000);
+    if (err < 0)
+      return err;
+    avail = snd_pcm_avail_update(pcm);
+    if (avail <= 0)
+      return avail;
+  }
+
+  const snd_pcm_channel_area_t *areas = nullptr;
+  snd_pcm_uframes_t offset = 0;
+  snd_pcm_uframes_t frames = std::min<snd_pcm_uframes_t>((snd_pcm_uframes_t)avail, want);
+  int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &frames);
+  if (err < 0)
+    return err;
 
-  std::fprintf(stderr, "ALSA: devices capture='%s' playback='%s'\n", capDevName, pbDevName);
+  uint8_t *dst = (uint8_t *)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+  alsa_convert::encodeOutput(mono, right, stage.gain, stage.sanitize, format, channels, dst, (uint32_t)frames,
+                             stage.chain, stage.out, stage.nonFinite);
 
-  unsigned int rate = 48000;
-  unsigned int captureChannels = 1;
-  unsigned int playbackChannels = 2;
-  snd_pcm_uframes_t periodSize = 128;
-  unsigned int periods = 3;
+  const snd_pcm_sframes_t done = snd_pcm_mmap_commit(pcm, offset, frames);
+  if (done < 0)
+    return done;
+  if ((snd_pcm_uframes_t)done != frames)
+    return -EPIPE;
 
-  if (const char *envRate = std::getenv("ALSA_RATE"))
-    rate = (unsigned int)std::max(8000, std::atoi(envRate));
-  if (const char *envCh = std::getenv("ALSA_CHANNELS"))
+  if (snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED)
   {
-    const unsigned int ch = (unsigned int)std::max(1, std::atoi(envCh));
-    captureChannels = ch;
-    playbackChannels = ch;
+    const snd_pcm_sframes_t left = snd_pcm_avail_update(pcm);
+    if (left >= 0 && bufferSize - (snd_pcm_uframes_t)left >= startThreshold)
+    {
+      err = snd_pcm_start(pcm);
+      if (err < 0)
+        return err;
+    }
   }
-  if (const char *envCapCh = std::getenv("ALSA_CAPTURE_CHANNELS"))
-    captureChannels = (unsigned int)std::max(1, std::atoi(envCapCh));
-  if (const char *envPbCh = std::getenv("ALSA_PLAYBACK_CHANNELS"))
-    playbackChannels = (unsigned int)std::max(1, std::atoi(envPbCh));
-  if (const char *envPeriod = std::getenv("ALSA_PERIOD"))
-    periodSize = (snd_pcm_uframes_t)std::max(16, std::atoi(envPeriod));
-  if (const char *envPeriods = std::getenv("ALSA_PERIODS"))
-    periods = (unsigned int)std::max(2, std::atoi(envPeriods));
+  return done;
+}
 
+// Both PCMs of the duplex pair plus what configureDuplex() negotiated for them.
+struct DuplexConfig
+{
   snd_pcm_t *cap = nullptr;
   snd_pcm_t *pb = nullptr;
 
-  int err = snd_pcm_open(&cap, capDevName, SND_PCM_STREAM_CAPTURE, 0);
-  if (err < 0)
-  {
-    std::fprintf(stderr, "ALSA: failed to open capture %s: %s\n", capDevName, snd_strerror(err));
-    dump_alsa_device_hints();
-    return 1;
-  }
-  err = snd_pcm_open(&pb, pbDevName, SND_PCM_STREAM_PLAYBACK, 0);
-  if (err < 0)
-  {
-    std::fprintf(stderr, "ALSA: failed to open playback %s: %s\n", pbDevName, snd_strerror(err));
-    dump_alsa_device_hints();
-    snd_pcm_close(cap);
-    return 1;
-  }
-
+  // Requested. rate is updated to what both devices agreed on.
+  unsigned int rate = 48000;
+  unsigned int captureChannels = 1;
+  unsigned int playbackChannels = 2;
+  unsigned int periods = 3;
+  bool wantMmap = false;
+  const alsa_convert::Format *forcedFormat = nullptr;
+  bool link = true;
+  bool timestamps = false;
+  snd_pcm_uframes_t pbStartThreshold = 0; // 0 = buffer less one period
+
+  // Negotiated.
+  snd_pcm_uframes_t periodSize = 0;
+  unsigned int pbPeriods = 0;
   snd_pcm_uframes_t capBuffer = 0;
   snd_pcm_uframes_t pbBuffer = 0;
+  bool capMmap = false;
+  bool pbMmap = false;
+  alsa_convert::Format capFmt = alsa_convert::Format::S32LE;
+  alsa_convert::Format pbFmt = alsa_convert::Format::S32LE;
+  bool linked = false;
+  bool configured = false;
+};
+
+// Negotiates both PCMs for the given period and leaves them prepared (and linked when asked). On a
+// pair that is already configured this is a live period change: both streams are dropped first.
+// Logs and returns false if the devices can't agree; the caller decides whether that is fatal.
+static bool configureDuplex(DuplexConfig &d, snd_pcm_uframes_t period)
+{
+  if (d.configured)
+  {
+    snd_pcm_drop(d.cap);
+    snd_pcm_drop(d.pb);
+    if (d.linked)
+      snd_pcm_unlink(d.cap);
+    d.linked = false;
+    d.configured = false;
+  }
 
-  snd_pcm_uframes_t capPeriod = periodSize;
-  snd_pcm_uframes_t pbPeriod = periodSize;
-  unsigned int capPeriods = periods;
-  unsigned int pbPeriods = periods;
+  int err = 0;
+  snd_pcm_uframes_t capPeriod = period;
+  snd_pcm_uframes_t pbPeriod = period;
+  unsigned int capPeriods = d.periods;
+  unsigned int pbPeriods = d.periods;
 
-  unsigned int capRate = rate;
-  if ((err = setup_pcm(cap, SND_PCM_STREAM_CAPTURE, capRate, captureChannels, capPeriod, capPeriods, capBuffer)) < 0)
+  unsigned int capRate = d.rate;
+  if ((err = setup_pcm(d.cap, SND_PCM_STREAM_CAPTURE, capRate, d.captureChannels, capPeriod, capPeriods, d.capBuffer,
+                       d.wantMmap, d.forcedFormat, d.capMmap, d.capFmt)) < 0)
   {
     std::fprintf(stderr, "ALSA: capture setup failed: %s\n", snd_strerror(err));
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    return false;
   }
-  if ((err = setup_sw_params(cap, SND_PCM_STREAM_CAPTURE, capPeriod, capBuffer)) < 0)
+  if ((err = setup_sw_params(d.cap, SND_PCM_STREAM_CAPTURE, capPeriod, d.capBuffer, 0, d.timestamps)) < 0)
   {
     std::fprintf(stderr, "ALSA: capture sw_params failed: %s\n", snd_strerror(err));
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    return false;
   }
-  unsigned int pbRate = rate;
-  if ((err = setup_pcm(pb, SND_PCM_STREAM_PLAYBACK, pbRate, playbackChannels, pbPeriod, pbPeriods, pbBuffer)) < 0)
+  unsigned int pbRate = d.rate;
+  if ((err = setup_pcm(d.pb, SND_PCM_STREAM_PLAYBACK, pbRate, d.playbackChannels, pbPeriod, pbPeriods, d.pbBuffer,
+                       d.wantMmap, d.forcedFormat, d.pbMmap, d.pbFmt)) < 0)
   {
     std::fprintf(stderr, "ALSA: playback setup failed: %s\n", snd_strerror(err));
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    return false;
   }
-  if ((err = setup_sw_params(pb, SND_PCM_STREAM_PLAYBACK, pbPeriod, pbBuffer)) < 0)
+  if ((err = setup_sw_params(d.pb, SND_PCM_STREAM_PLAYBACK, pbPeriod, d.pbBuffer, d.pbStartThreshold, d.timestamps)) < 0)
   {
     std::fprintf(stderr, "ALSA: playback sw_params failed: %s\n", snd_strerror(err));
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    return false;
   }
 
   // Log what ALSA actually negotiated (baseline invariant).
-  logPcmNegotiated(cap, "capture");
-  logPcmNegotiated(pb, "playback");
+  logPcmNegotiated(d.cap, "capture");
+  logPcmNegotiated(d.pb, "playback");
 
   if (capRate != pbRate)
   {
-    std::fprintf(stderr, "ALSA: cap/pb rate mismatch (cap=%u pb=%u) — aborting.\n", capRate, pbRate);
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    std::fprintf(stderr, "ALSA: cap/pb rate mismatch (cap=%u pb=%u)\n", capRate, pbRate);
+    return false;
   }
-  rate = capRate;
-
   if (capPeriod != pbPeriod)
   {
     std::fprintf(stderr, "ALSA: capture/playback period mismatch (cap=%lu pb=%lu)\n",
                  (unsigned long)capPeriod, (unsigned long)pbPeriod);
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    return false;
   }
-  periodSize = capPeriod;
-  periods = capPeriods;
-
   if (capPeriods != pbPeriods)
   {
     std::fprintf(stderr, "ALSA: capture/playback periods mismatch (cap=%u pb=%u)\n",
                  capPeriods, pbPeriods);
-    snd_pcm_close(cap);
-    snd_pcm_close(pb);
-    return 1;
+    return false;
   }
+  d.rate = capRate;
+  d.periodSize = capPeriod;
+  d.pbPeriods = pbPeriods;
 
   // Link capture + playback to keep them in sync when possible (optional).
-  const bool disableLink = std::getenv("ALSA_DISABLE_LINK") != nullptr;
-  bool linkOk = false;
-  if (!disableLink)
+  if (d.link)
   {
-    if ((err = snd_pcm_link(cap, pb)) < 0)
+    if ((err = snd_pcm_link(d.cap, d.pb)) < 0)
     {
       std::fprintf(stderr, "ALSA: snd_pcm_link failed (continuing): %s\n", snd_strerror(err));
       std::fprintf(stderr, "ALSA: proceeding in unlinked mode\n");
     }
     else
     {
-      linkOk = true;
+      d.linked = true;
     }
   }
+
+  std::fprintf(stderr, "ALSA: snd_pcm_link attempted=%s ok=%s\n",
+               d.link ? "true" : "false",
+               d.linked ? "true" : "false");
+
+  if ((err = snd_pcm_prepare(d.cap)) < 0)
+  {
+    std::fprintf(stderr, "ALSA: capture prepare failed: %s\n", snd_strerror(err));
+    return false;
+  }
+  if ((err = snd_pcm_prepare(d.pb)) < 0)
+  {
+    std::fprintf(stderr, "ALSA: playback prepare failed: %s\n", snd_strerror(err));
+    return false;
+  }
+
+  // After prepare, query again (some devices finalize params here).
+  logPcmNegotiated(d.cap, "capture(prepared)");
+  logPcmNegotiated(d.pb, "playback(prepared)");
+
+  d.configured = true;
+  return true;
+}
+
+// ALSA_SCHED=poll: sleeps in poll() on the capture descriptors until a period is readable. Only
+// capture is polled; playback has room most of the time once its fill is trimmed, so polling it
+// would spin. Returns 0 when ready or on timeout/error (the read that follows reports the ALSA
+// error and goes through recover_pcm()).
+static int pollCaptureReady(snd_pcm_t *cap, pollfd *fds, unsigned int nfds, int timeoutMs)
+{
+  // readi would start a prepared stream by itself; poll never fires on one.
+  if (snd_pcm_state(cap) == SND_PCM_STATE_PREPARED)
+  {
+    const int err = snd_pcm_start(cap);
+    if (err < 0)
+      return err;
+  }
+
+  for (;;)
+  {
+    const int pr = ::poll(fds, nfds, timeoutMs);
+    if (pr <= 0)
+      return 0;
+    unsigned short revents = 0;
+    const int err = snd_pcm_poll_descriptors_revents(cap, fds, nfds, &revents);
+    if (err < 0)
+      return err;
+    if (revents & (POLLIN | POLLERR | POLLNVAL))
+      return 0;
+  }
+}
+
+// Frames the device holds right now: captured but not read yet (capture), or written but not played
+// yet (playback). Based on snd_pcm_htimestamp(), i.e. the last hardware pointer update, advanced by
+// the time elapsed since then on a running stream. Needs setup_sw_params(timestamps).
+static bool pcmQueuedNow(snd_pcm_t *pcm,
+                         bool playback,
+                         snd_pcm_uframes_t bufferSize,
+                         unsigned int rate,
+                         const timespec &now,
+                         double &frames)
+{
+  snd_pcm_uframes_t avail = 0;
+  snd_htimestamp_t ts{};
+  if (snd_pcm_htimestamp(pcm, &avail, &ts) < 0)
+    return false;
+
+  double moved = 0.0;
+  if ((ts.tv_sec != 0 || ts.tv_nsec != 0) && snd_pcm_state(pcm) == SND_PCM_STATE_RUNNING)
+  {
+    const double elapsed = (double)(now.tv_sec - ts.tv_sec) + (double)(now.tv_nsec - ts.tv_nsec) * 1e-9;
+    moved = std::max(0.0, elapsed) * (double)rate;
+  }
+
+  if (playback)
+    frames = std::max(0.0, (double)(bufferSize - std::min(avail, bufferSize)) - moved);
   else
+    frames = (double)avail + moved;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  // Background FFTW measurements re-run this binary (fftw_planner).
+  if (const int rc = fftw_planner::runMeasureChild(argc, argv); rc >= 0)
+    return rc;
+
+  setvbuf(stdout, nullptr, _IONBF, 0);
+  setvbuf(stderr, nullptr, _IONBF, 0);
+
+  logBuildBanner();
+
+  tryEnableRealtime();
+  configureDenormals();
+
+  loadConfig();
+  applyEnvOverrides();
+  fftw_planner::configure();
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  const char *dev = std::getenv("ALSA_DEVICE");
+  const char *devDefault = (dev && dev[0]) ? dev : "hw:0,0";
+
+  const char *envCapDev = std::getenv("ALSA_CAPTURE_DEVICE");
+  const char *envPbDev = std::getenv("ALSA_PLAYBACK_DEVICE");
+  const char *capDevName = (envCapDev && envCapDev[0]) ? envCapDev : devDefault;
+  const char *pbDevName = (envPbDev && envPbDev[0]) ? envPbDev : devDefault;
+
+  std::fprintf(stderr, "ALSA: devices capture='%s' playback='%s'\n", capDevName, pbDevName);
+
+  unsigned int rate = 48000;
+  unsigned int captureChannels = 1;
+  unsigned int playbackChannels = 2;
+  snd_pcm_uframes_t periodSize = 128;
+  unsigned int periods = 3;
+
+  if (const char *envRate = std::getenv("ALSA_RATE"))
+    rate = (unsigned int)std::max(8000, std::atoi(envRate));
+  if (const char *envCh = std::getenv("ALSA_CHANNELS"))
   {
-    std::printf("ALSA: link disabled via ALSA_DISABLE_LINK\n");
+    const unsigned int ch = (unsigned int)std::max(1, std::atoi(envCh));
+    captureChannels = ch;
+    playbackChannels = ch;
   }
+  if (const char *envCapCh = std::getenv("ALSA_CAPTURE_CHANNELS"))
+    captureChannels = (unsigned int)std::max(1, std::atoi(envCapCh));
+  if (const char *envPbCh = std::getenv("ALSA_PLAYBACK_CHANNELS"))
+    playbackChannels = (unsigned int)std::max(1, std::atoi(envPbCh));
+  if (const char *envPeriod = std::getenv("ALSA_PERIOD"))
+    periodSize = (snd_pcm_uframes_t)std::max(16, std::atoi(envPeriod));
+  if (const char *envPeriods = std::getenv("ALSA_PERIODS"))
+    periods = (unsigned int)std::max(2, std::atoi(envPeriods));
 
-  std::fprintf(stderr, "ALSA: snd_pcm_link attempted=%s ok=%s\n",
-               disableLink ? "false" : "true",
-               linkOk ? "true" : "false");
+  const bool wantMmap = std::getenv("ALSA_MMAP") != nullptr;
+  alsa_convert::Format forcedFormat = alsa_convert::Format::S32LE;
+  bool haveForcedFormat = false;
+  if (const char *envFmt = std::getenv("ALSA_FORMAT"))
+  {
+    haveForcedFormat = alsa_convert::parseFormat(envFmt, forcedFormat);
+    if (!haveForcedFormat)
+      std::fprintf(stderr, "ALSA: ignoring ALSA_FORMAT='%s' (expected S32_LE, S24_3LE or S16_LE)\n", envFmt);
+  }
+
+  // ALSA_SCHED: "block" (default; readi/writei pace the loop), "poll" (poll() on the capture
+  // descriptors, htimestamp round-trip tracking, playback fill trimmed to a margin) or "adaptive"
+  // (poll, plus period stepping within ALSA_PERIOD_MIN..ALSA_PERIOD_MAX).
+  const char *envSched = std::getenv("ALSA_SCHED");
+  const bool schedAdaptive = envSched && std::strcmp(envSched, "adaptive") == 0;
+  const bool schedPoll = schedAdaptive || (envSched && std::strcmp(envSched, "poll") == 0);
+  const uint32_t periodMin = std::max(16u, readEnvU32("ALSA_PERIOD_MIN", 32));
+  const uint32_t periodMax = std::max(periodMin, readEnvU32("ALSA_PERIOD_MAX", 512));
+  if (schedAdaptive)
+    periodSize = std::clamp<snd_pcm_uframes_t>(periodSize, periodMin, periodMax);
+  const uint32_t envFillMargin = readEnvU32("ALSA_FILL_MARGIN", 0);
+  auto fillMarginFor = [&](snd_pcm_uframes_t period) -> snd_pcm_uframes_t
+  {
+    return envFillMargin ? envFillMargin : period / 2;
+  };
+  if (envSched && !schedPoll && std::strcmp(envSched, "block") != 0)
+    std::fprintf(stderr, "ALSA: ignoring ALSA_SCHED='%s' (expected block, poll or adaptive)\n", envSched);
+
+  snd_pcm_t *cap = nullptr;
+  snd_pcm_t *pb = nullptr;
 
-  if ((err = snd_pcm_prepare(cap)) < 0)
+  int err = snd_pcm_open(&cap, capDevName, SND_PCM_STREAM_CAPTURE, 0);
+  if (err < 0)
   {
-    std::fprintf(stderr, "ALSA: capture prepare failed: %s\n", snd_strerror(err));
+    std::fprintf(stderr, "ALSA: failed to open capture %s: %s\n", capDevName, snd_strerror(err));
+    dump_alsa_device_hints();
+    return 1;
+  }
+  err = snd_pcm_open(&pb, pbDevName, SND_PCM_STREAM_PLAYBACK, 0);
+  if (err < 0)
+  {
+    std::fprintf(stderr, "ALSA: failed to open playback %s: %s\n", pbDevName, snd_strerror(err));
+    dump_alsa_device_hints();
     snd_pcm_close(cap);
-    snd_pcm_close(pb);
     return 1;
   }
-  if ((err = snd_pcm_prepare(pb)) < 0)
+
+  DuplexConfig duplex;
+  duplex.cap = cap;
+  duplex.pb = pb;
+  duplex.rate = rate;
+  duplex.captureChannels = captureChannels;
+  duplex.playbackChannels = playbackChannels;
+  duplex.periods = periods;
+  duplex.wantMmap = wantMmap;
+  duplex.forcedFormat = haveForcedFormat ? &forcedFormat : nullptr;
+  duplex.link = std::getenv("ALSA_DISABLE_LINK") == nullptr;
+  duplex.timestamps = schedPoll;
+  duplex.pbStartThreshold = schedPoll ? periodSize + fillMarginFor(periodSize) : 0;
+  if (!configureDuplex(duplex, periodSize))
   {
-    std::fprintf(stderr, "ALSA: playback prepare failed: %s\n", snd_strerror(err));
     snd_pcm_close(cap);
     snd_pcm_close(pb);
     return 1;
   }
-
-  // After prepare, query again (some devices finalize params here).
-  logPcmNegotiated(cap, "capture(prepared)");
-  logPcmNegotiated(pb, "playback(prepared)");
+  if (!duplex.link)
+    std::printf("ALSA: link disabled via ALSA_DISABLE_LINK\n");
+  rate = duplex.rate;
+  periodSize = duplex.periodSize;
+  periods = duplex.periods;
 
   // Build + activate the ordered chain once ALSA is configured.
   initChainRuntime(rate, (uint32_t)periodSize);
 
   std::thread ctl(udpControlThread);
 
-  std::vector<int32_t> inI32((size_t)periodSize * captureChannels);
-  std::vector<int32_t> outI32((size_t)periodSize * playbackChannels);
-  std::vector<float> inMono((size_t)periodSize);
-  std::vector<float> dspOut((size_t)periodSize);
+  // Device-format staging for read/write access; mmap access converts in the DMA ring instead.
+  // Sized for the widest format and, with adaptive periods, the largest period, so a period change
+  // never reallocates.
+  const size_t bufFrames = std::max<size_t>(periodSize, schedAdaptive ? periodMax : 0);
+  std::vector<uint8_t> inRaw(bufFrames * captureChannels * sizeof(int32_t));
+  std::vector<uint8_t> outRaw(bufFrames * playbackChannels * sizeof(int32_t));
+  const std::vector<uint8_t> silenceRaw(outRaw.size(), 0);
+  std::vector<float> inMono(bufFrames);
+  std::vector<float> dspOut(bufFrames);
+  std::vector<float> dspOutR(bufFrames); // right channel of a stereo chain
+
+  // Reblocking: after an adaptive period change the active chain keeps running in blocks of its own
+  // size until the rebuild for the new one is swapped in. Input queues in rbIn until a whole block is
+  // there; output is primed with rbLead = block - gcd(block, period) frames, the most a period can
+  // run ahead of the last finished block, and plays that far behind.
+  const size_t rbFrames = schedAdaptive ? bufFrames : 0;
+  std::vector<float> rbIn(2 * rbFrames);
+  std::vector<float> rbOut(3 * rbFrames);
+  std::vector<float> rbOutR(3 * rbFrames);
+  uint32_t rbInFill = 0;
+  uint32_t rbOutFill = 0;
+  uint32_t rbLead = 0;
+  uint64_t rbSerial = 0; // chain the queues belong to; 0 while unused
 
   inputTrimLin.store(dbToLin(inputTrimDb.load()));
 
@@ -1453,41 +1806,53 @@ int main()
               verboseXruns.load() ? "true" : "false");
   std::printf("Runtime: logStats=%s\n", logStats.load() ? "true" : "false");
 
-  // Optional NAM input/output dump for offline inspection.
-  dumpNamInit(rate);
-  dumpIrInit(rate);
-
   std::printf("ALSA DSP engine running. Capture=%s Playback=%s\n", capDevName, pbDevName);
   std::printf("Ctrl+C to stop.\n");
 
-  // Prime playback with silence to reduce initial underruns.
-  // Avoid priming the entire hardware buffer (can be large / slow). Default: prime ~1 buffer less one period.
-  std::fill(outI32.begin(), outI32.end(), 0);
-  const snd_pcm_uframes_t defaultPrime = periodSize * (snd_pcm_uframes_t)std::max(1u, pbPeriods - 1);
-  const snd_pcm_uframes_t primeTarget = (snd_pcm_uframes_t)readEnvU32AllowZero("ALSA_PRIME_FRAMES", (uint32_t)defaultPrime);
-  snd_pcm_uframes_t primed = 0;
-  const snd_pcm_uframes_t primeLimit = std::min(pbBuffer, primeTarget);
-  while (primed < primeLimit)
-  {
-    const snd_pcm_uframes_t chunk = std::min<snd_pcm_uframes_t>(periodSize, primeLimit - primed);
-    snd_pcm_sframes_t w = snd_pcm_writei(pb, outI32.data(), chunk);
-    if (w < 0)
+  // Queues frames of silence on the playback device (boot priming, re-priming after a period change
+  // or a playback xrun with the poll scheduler).
+  auto writeSilence = [&](snd_pcm_uframes_t frames) noexcept
+  {
+    snd_pcm_uframes_t done = 0;
+    const snd_pcm_uframes_t limit = std::min(duplex.pbBuffer, frames);
+    while (done < limit)
     {
-      w = snd_pcm_recover(pb, (int)w, 1);
+      const snd_pcm_uframes_t chunk = std::min<snd_pcm_uframes_t>(periodSize, limit - done);
+      snd_pcm_sframes_t w = duplex.pbMmap ? snd_pcm_mmap_writei(pb, silenceRaw.data(), chunk)
+                                          : snd_pcm_writei(pb, silenceRaw.data(), chunk);
       if (w < 0)
-        break;
-    }
-    else
-    {
-      primed += (snd_pcm_uframes_t)w;
+      {
+        w = snd_pcm_recover(pb, (int)w, 1);
+        if (w < 0)
+          break;
+      }
+      else
+      {
+        done += (snd_pcm_uframes_t)w;
+      }
     }
-  }
+  };
+
+  // Prime playback with silence to reduce initial underruns.
+  // Avoid priming the entire hardware buffer (can be large / slow). Default: prime ~1 buffer less one
+  // period, or just the start threshold (one period plus the fill margin) with the poll scheduler.
+  auto primeFrames = [&]() -> snd_pcm_uframes_t
+  {
+    const snd_pcm_uframes_t defaultPrime = schedPoll ? duplex.pbStartThreshold
+                                                     : periodSize * (snd_pcm_uframes_t)std::max(1u, duplex.pbPeriods - 1);
+    return (snd_pcm_uframes_t)readEnvU32AllowZero("ALSA_PRIME_FRAMES", (uint32_t)defaultPrime);
+  };
+  writeSilence(primeFrames());
 
   // Let read/write start the streams to avoid start-state errors.
 
   uint64_t xrunsRead = 0;
   uint64_t xrunsWrite = 0;
   uint64_t nonFinite = 0;
+  // Levels over the current stats window (the non-telemetry log line).
+  alsa_convert::Meter winIn;
+  alsa_convert::Meter winChain;
+  alsa_convert::Meter winOut;
   uint64_t shortRead = 0;
   uint64_t shortWrite = 0;
   auto lastReport = std::chrono::steady_clock::now();
@@ -1498,8 +1863,36 @@ int main()
   std::shared_ptr<pedal::dsp::SignalChain> deferredRetire;
   std::shared_ptr<pedal::dsp::SignalChain> deferredSwap;
 
-  const double deadlineUs = ((double)periodSize * 1000000.0) / (double)rate;
-  const uint64_t deadlineUsInt = (uint64_t)std::llround(deadlineUs);
+  double deadlineUs = ((double)periodSize * 1000000.0) / (double)rate;
+  uint64_t deadlineUsInt = (uint64_t)std::llround(deadlineUs);
+
+  // Poll scheduler state (ALSA_SCHED=poll|adaptive).
+  pollfd capFds[8];
+  unsigned int capNfds = 0;
+  auto refreshPollFds = [&]()
+  {
+    const int n = snd_pcm_poll_descriptors(cap, capFds, 8);
+    capNfds = (n > 0) ? (unsigned int)n : 0;
+  };
+  if (schedPoll)
+    refreshPollFds();
+  alsa_sched::FillTrimmer trimmer;
+  trimmer.reset((uint32_t)fillMarginFor(periodSize), (uint32_t)periodSize);
+  alsa_sched::PeriodAdvisor advisor;
+  advisor.reset((uint32_t)periodSize, periodMin, periodMax, readEnvU32("ALSA_ADAPT_STABLE_SECS", 20));
+  alsa_sched::Window rttMs;
+  alsa_sched::Window fillFrames;
+  uint32_t trimPending = 0;
+  uint64_t trimmedFrames = 0;
+  uint32_t pendingPeriod = 0;
+  uint64_t xrunsAtReview = 0;
+  uint64_t reviewMaxUs = 0;
+  auto lastReview = std::chrono::steady_clock::now();
+  if (schedPoll)
+    std::fprintf(stderr, "ALSA: sched=%s margin=%u period_range=%u..%u\n",
+                 schedAdaptive ? "adaptive" : "poll",
+                 trimmer.margin(), schedAdaptive ? periodMin : (uint32_t)periodSize,
+                 schedAdaptive ? periodMax : (uint32_t)periodSize);
 
   // Capture sanity check (first N seconds): detects “processing silence” false positives.
   const float silentPeakThresh = []() -> float
@@ -1522,12 +1915,29 @@ int main()
   {
     Idle,
     FadeOut,
-    FadeIn
+    FadeIn,
+    Dual // both chains run, mixed equal-power (ALSA_XFADE_PERIODS)
   };
 
-  // Optional click-safe swap smoothing (disabled by default).
+  // Dual-run crossfade (optional): for xfadePeriods periods the incoming chain runs on gXfadeWorker
+  // while this thread runs the outgoing one, and the two are mixed with a cos/sin curve spanning the
+  // whole window. It is only started when max(old, new) chain cost fits ALSA_XFADE_BUDGET_PCT of the
+  // deadline, and a period that goes over anyway ends the window with the ramp below.
+  const uint32_t xfadePeriods = (gXfadeWorker.size() > 0) ? readEnvU32AllowZero("ALSA_XFADE_PERIODS", 0) : 0;
+  const double xfadeBudget = (double)std::min<uint32_t>(readEnvU32("ALSA_XFADE_BUDGET_PCT", 70), 100) / 100.0;
+  std::vector<float> xfOut(bufFrames);
+  std::vector<float> xfOutR(bufFrames);
+  XfadeJob xfJob;
+  std::shared_ptr<pedal::dsp::SignalChain> xfNext;
+  uint32_t xfDone = 0; // periods of the window mixed so far
+  uint64_t lastChainTicks = 0;
+  const double usPerCycle = pedal::dsp::nsPerCycle() / 1000.0;
+  uint64_t xfadeCount = 0;
+  uint64_t xfadeFallbacks = 0;
+
+  // Optional click-safe swap smoothing (disabled by default; the dual-run crossfade's fallback).
   // Unlike the old crossfade implementation, this never processes two chains in the same audio period.
-  const bool chainXfade = (std::getenv("ALSA_CHAIN_XFADE") != nullptr);
+  const bool chainXfade = (std::getenv("ALSA_CHAIN_XFADE") != nullptr) || xfadePeriods > 0;
   const uint32_t swapRampSamples = chainXfade ? readEnvU32AllowZero("ALSA_SWAP_RAMP_SAMPLES", 32) : 0;
   SwapRampState swapState = SwapRampState::Idle;
   std::shared_ptr<pedal::dsp::SignalChain> swapNext;
@@ -1573,19 +1983,228 @@ int main()
     }
   };
 
+  // Fill trim: drops `cut` frames from the head of the block without a jump. The first samples
+  // after the cut are blended from what would have played there (buf[0..]) into what plays from the
+  // cut on (buf[cut..]), so the stream continues from the last block; write from buf + cut.
+  constexpr uint32_t kTrimSpliceFrames = 32;
+  auto spliceHead = [&](float *buf, uint32_t frames, uint32_t cut) noexcept
+  {
+    const uint32_t fade = std::min(kTrimSpliceFrames, frames - cut);
+    for (uint32_t i = 0; i < fade; i++)
+    {
+      const float t = (float)(i + 1) / (float)(fade + 1); // 0..1
+      buf[cut + i] = (1.0f - t) * buf[i] + t * buf[cut + i];
+    }
+  };
+
+  // Whether `next` can run beside activeChain this period size: same shape, and the slower of the
+  // two (its standby-warmed node ticks if it has them, else assumed as heavy as the old one) within
+  // the budget.
+  auto xfadeAffordable = [&](const pedal::dsp::SignalChain &next, uint32_t frames) noexcept
+  {
+    if (!activeChain || next.maxBlockFrames() != frames || activeChain->maxBlockFrames() != frames ||
+        next.channels() != activeChain->channels() || lastChainTicks == 0 || deadlineUs <= 0.0)
+      return false;
+    uint32_t ticks[pedal::telemetry::PeriodRecord::kMaxNodes];
+    const size_t n = next.copyNodeTicks(ticks, pedal::telemetry::PeriodRecord::kMaxNodes);
+    uint64_t nextTicks = 0;
+    for (size_t i = 0; i < n; i++)
+      nextTicks += ticks[i];
+    if (nextTicks == 0)
+      nextTicks = lastChainTicks;
+    return (double)std::max(lastChainTicks, nextTicks) * usPerCycle <= xfadeBudget * deadlineUs;
+  };
+
+  // Telemetry: the audio loop only fills one PeriodRecord per period; percentiles and the periodic
+  // log lines are produced on the telemetry thread.
+  const bool telemetryOn = telemetryEnabled();
+  if (telemetryOn)
+  {
+    pedal::telemetry::Telemetry::Config tcfg;
+    tcfg.sampleRate = rate;
+    tcfg.activeChain = []
+    { return std::atomic_load_explicit(&gChainState.activeChain, std::memory_order_acquire); };
+    tcfg.log = [=](const pedal::telemetry::Summary &t)
+    {
+      const bool events =
+          t.xrunsRead || t.xrunsWrite || t.nonFinite || t.shortReads || t.shortWrites || t.dropped || t.retireQueueFull;
+      if (!logStats.load(std::memory_order_relaxed) && !events)
+        return;
+
+      std::fprintf(stderr,
+                   "ALSA: xruns(read=%llu write=%llu) short(read=%llu write=%llu) nonFinite=%llu swaps=%llu nframes=%u peakIn=%.3f peakChain=%.3f peakOut=%.3f rmsIn=%.3f rmsOut=%.3f periods=%llu dropped=%llu\n",
+                   (unsigned long long)t.xrunsRead,
+                   (unsigned long long)t.xrunsWrite,
+                   (unsigned long long)t.shortReads,
+                   (unsigned long long)t.shortWrites,
+                   (unsigned long long)t.nonFinite,
+                   (unsigned long long)t.swaps,
+                   t.frames,
+                   (double)t.peakIn,
+                   (double)t.peakChain,
+                   (double)t.peakOut,
+                   (double)t.rmsIn,
+                   (double)t.rmsOut,
+                   (unsigned long long)t.periods,
+                   (unsigned long long)t.dropped);
+      if (t.crossfades || t.crossfadeFallbacks)
+        std::fprintf(stderr, "ALSA: crossfades=%llu ramp_fallbacks=%llu\n", (unsigned long long)t.crossfades,
+                     (unsigned long long)t.crossfadeFallbacks);
+      if (t.retireQueueFull)
+        std::fprintf(stderr, "ALSA: retire queue full %llu time(s); swaps were deferred\n",
+                     (unsigned long long)t.retireQueueFull);
+
+      if (logTiming.load(std::memory_order_relaxed))
+      {
+        const double deadline = (t.sampleRate > 0) ? (double)t.frames * 1e6 / (double)t.sampleRate : 0.0;
+        std::fprintf(stderr,
+                     "ALSA: chain_us(p50=%.1f p99=%.1f p999=%.1f max=%.1f) cycle_us(p99=%.1f max=%.1f) wake_us(p50=%.1f p999=%.1f max=%.1f) deadline_us=%.1f chain_max_pct=%.1f chain_overruns=%llu retireQ_full=%llu\n",
+                     t.chainNs.p50 / 1000.0,
+                     t.chainNs.p99 / 1000.0,
+                     t.chainNs.p999 / 1000.0,
+                     t.chainNs.max / 1000.0,
+                     t.cycleNs.p99 / 1000.0,
+                     t.cycleNs.max / 1000.0,
+                     t.wakeNs.p50 / 1000.0,
+                     t.wakeNs.p999 / 1000.0,
+                     t.wakeNs.max / 1000.0,
+                     deadline,
+                     (deadline > 0.0) ? (t.chainNs.max / 1000.0) * 100.0 / deadline : 0.0,
+                     (unsigned long long)t.overruns,
+                     (unsigned long long)gRetireQueueFull.load(std::memory_order_relaxed));
+
+        if (baselineCheck)
+        {
+          const uint64_t chainUsMax = t.chainNs.max / 1000;
+          const bool okXruns = (t.xrunsRead == 0 && t.xrunsWrite == 0);
+          const bool okOverruns = (t.overruns == 0);
+          const bool okMax = (baselineChainUsMax == 0) ? true : (chainUsMax < baselineChainUsMax);
+          const bool okCapture = gCaptureSanity.load(std::memory_order_relaxed) >= 0;
+          std::fprintf(stderr,
+                       "ALSA: baseline_check ok=%s xruns_ok=%s overruns_ok=%s chain_us_max_ok=%s capture_ok=%s (chain_us_max=%llu thresh=%llu)\n",
+                       (okXruns && okOverruns && okMax && okCapture) ? "true" : "false",
+                       okXruns ? "true" : "false",
+                       okOverruns ? "true" : "false",
+                       okMax ? "true" : "false",
+                       okCapture ? "true" : "false",
+                       (unsigned long long)chainUsMax,
+                       (unsigned long long)baselineChainUsMax);
+        }
+
+        if (!t.nodesNs.empty())
+        {
+          std::fprintf(stderr, "ALSA: node_us p99/max");
+          for (const auto &[id, p] : t.nodesNs)
+            std::fprintf(stderr, " %s=%.1f/%.1f", id.c_str(), p.p99 / 1000.0, p.max / 1000.0);
+          std::fprintf(stderr, "\n");
+        }
+      }
+
+      if (t.rttUs.count > 0)
+        std::fprintf(stderr,
+                     "ALSA: sched period=%u floor=%u margin=%u fill_min=%u rtt_ms(p50=%.2f p99=%.2f max=%.2f)\n",
+                     t.frames,
+                     t.floor,
+                     t.margin,
+                     t.fillMin,
+                     t.rttUs.p50 / 1000.0,
+                     t.rttUs.p99 / 1000.0,
+                     t.rttUs.max / 1000.0);
+    };
+    gTelemetry.start(std::move(tcfg));
+  }
+  // Counters as of the last pushed record (records carry deltas).
+  uint64_t telXrunsRead = 0;
+  uint64_t telXrunsWrite = 0;
+  uint64_t telShortRead = 0;
+  uint64_t telShortWrite = 0;
+  uint64_t telSwaps = 0;
+  uint64_t telXfades = 0;
+  uint64_t telXfadeFallbacks = 0;
+  uint64_t telRetireFull = 0;
+  uint64_t telNonFinite = 0;
+  bool telPeriodChange = false;
+  auto delta16 = [](uint64_t now, uint64_t &last) noexcept
+  {
+    const uint64_t d = now - last;
+    last = now;
+    return (uint16_t)std::min<uint64_t>(d, 0xffff);
+  };
+
   while (running.load())
   {
     // Try to retire any deferred old chain first; if this can't be done, avoid piling on more swaps.
     if (deferredRetire)
       (void)retireChainFromAudioThread(deferredRetire);
 
+    // Adaptive period change, decided by the last review. Both streams are renegotiated in place;
+    // a size the device won't take becomes a limit and the old one is restored.
+    if (pendingPeriod != 0)
+    {
+      const snd_pcm_uframes_t oldPeriod = periodSize;
+      std::fprintf(stderr, "ALSA: sched: period %lu -> %u\n", (unsigned long)oldPeriod, pendingPeriod);
+      duplex.pbStartThreshold = pendingPeriod + fillMarginFor(pendingPeriod);
+      if (configureDuplex(duplex, pendingPeriod) && duplex.periodSize == pendingPeriod)
+      {
+        advisor.switched(pendingPeriod);
+      }
+      else
+      {
+        advisor.rejected(pendingPeriod);
+        duplex.pbStartThreshold = oldPeriod + fillMarginFor(oldPeriod);
+        if (!configureDuplex(duplex, oldPeriod))
+        {
+          std::fprintf(stderr, "ALSA: sched: could not restore period %lu\n", (unsigned long)oldPeriod);
+          running.store(false);
+          break;
+        }
+        std::fprintf(stderr, "ALSA: sched: period %u rejected, staying at %lu\n",
+                     pendingPeriod, (unsigned long)duplex.periodSize);
+      }
+      pendingPeriod = 0;
+
+      periodSize = duplex.periodSize;
+      deadlineUs = ((double)periodSize * 1000000.0) / (double)rate;
+      deadlineUsInt = (uint64_t)std::llround(deadlineUs);
+      trimmer.reset((uint32_t)fillMarginFor(periodSize), (uint32_t)periodSize);
+      trimPending = 0;
+      refreshPollFds();
+
+      // Chains are built for one block size. The control thread rebuilds the current spec for the
+      // new one; until it is swapped in the old chain runs reblocked (see chainFits below).
+      rbSerial = 0;
+      gChainState.requestedBlockFrames.store((uint32_t)periodSize, std::memory_order_release);
+
+      writeSilence(primeFrames());
+      telPeriodChange = true;
+      xrunsAtReview = xrunsRead + xrunsWrite;
+      reviewMaxUs = 0;
+      lastReview = std::chrono::steady_clock::now();
+      continue;
+    }
+
+    if (schedPoll && capNfds > 0)
+    {
+      const int timeoutMs = std::max(10, (int)(2000 * periodSize / rate));
+      (void)pollCaptureReady(cap, capFds, capNfds, timeoutMs);
+    }
+
+    alsa_convert::Meter meterIn;
     uint32_t filled = 0;
     while (filled < periodSize && running.load())
     {
-      snd_pcm_sframes_t r = snd_pcm_readi(
-          cap,
-          inI32.data() + (size_t)filled * captureChannels,
-          periodSize - filled);
+      snd_pcm_sframes_t r;
+      if (duplex.capMmap)
+      {
+        r = mmapReadMono(cap, duplex.capFmt, captureChannels, inMono.data() + filled, periodSize - filled, meterIn);
+      }
+      else
+      {
+        r = snd_pcm_readi(cap, inRaw.data(), periodSize - filled);
+        if (r > 0)
+          alsa_convert::decodeInput(inRaw.data(), duplex.capFmt, captureChannels, inMono.data() + filled,
+                                    (uint32_t)r, meterIn);
+      }
       if (r < 0)
       {
         xrunsRead++;
@@ -1611,56 +2230,27 @@ int main()
       continue;
     }
 
+    const uint64_t wakeTicks = pedal::dsp::cycleCount();
     const uint32_t nframes = (uint32_t)periodSize;
     const bool passthrough = passthroughMode.load(std::memory_order_relaxed);
 
-    float pkIn = 0.0f;
-    constexpr float invI32 = 1.0f / 2147483648.0f;
-    if (captureChannels == 1)
+    // Capture side of the round-trip measurement: what is already queued behind this block.
+    timespec capTs{};
+    double capQueued = 0.0;
+    bool haveCapQueued = false;
+    if (schedPoll)
     {
-      for (uint32_t i = 0; i < nframes; i++)
-      {
-        const float mono = (float)inI32[i] * invI32;
-        inMono[i] = mono;
-        const float absVal = std::fabs(mono);
-        if (absVal > pkIn)
-          pkIn = absVal;
-
-        if (sanityFramesRemaining > 0)
-        {
-          sanitySumSq += (double)mono * (double)mono;
-          if (absVal > sanityPeak)
-            sanityPeak = absVal;
-          sanityFramesRemaining--;
-          sanityFramesSeen++;
-        }
-      }
+      ::clock_gettime(CLOCK_MONOTONIC, &capTs);
+      haveCapQueued = pcmQueuedNow(cap, false, duplex.capBuffer, rate, capTs, capQueued);
     }
-    else
-    {
-      for (uint32_t i = 0; i < nframes; i++)
-      {
-        double acc = 0.0;
-        for (unsigned int c = 0; c < captureChannels; c++)
-        {
-          const int32_t v = inI32[(size_t)i * captureChannels + c];
-          acc += (double)v * (double)invI32;
-        }
-        const float mono = (captureChannels > 0) ? (float)(acc / (double)captureChannels) : 0.0f;
-        inMono[i] = mono;
-        const float absVal = std::fabs(mono);
-        if (absVal > pkIn)
-          pkIn = absVal;
 
-        if (sanityFramesRemaining > 0)
-        {
-          sanitySumSq += (double)mono * (double)mono;
-          if (absVal > sanityPeak)
-            sanityPeak = absVal;
-          sanityFramesRemaining--;
-          sanityFramesSeen++;
-        }
-      }
+    // Whole periods, metered by the decode.
+    if (sanityFramesRemaining > 0)
+    {
+      sanitySumSq += meterIn.sumSq;
+      sanityPeak = std::max(sanityPeak, meterIn.peak);
+      sanityFramesRemaining -= std::min<uint64_t>(nframes, sanityFramesRemaining);
+      sanityFramesSeen += nframes;
     }
 
     if (!sanityReported && sanityFramesRemaining == 0)
@@ -1673,6 +2263,7 @@ int main()
                    (unsigned long long)sanityFramesSeen,
                    (double)sanityPeak,
                    rms);
+      gCaptureSanity.store((sanityPeak < silentPeakThresh) ? -1 : 1, std::memory_order_relaxed);
       if (sanityPeak < silentPeakThresh)
       {
         std::fprintf(stderr,
@@ -1681,9 +2272,14 @@ int main()
       }
     }
 
-    float currentPeak = peakInput.load(std::memory_order_relaxed);
-    if (pkIn > currentPeak)
-      peakInput.store(pkIn, std::memory_order_relaxed);
+    winIn.add(meterIn);
+
+    gInputHistory.write(inMono.data(), nframes);
+    if (gTaps.any())
+    {
+      const float *in[1] = {inMono.data()};
+      gTaps.push(gTaps.find(pedal::dsp::SignalTaps::kInput), in, 1, nframes);
+    }
 
     // Pull any pending chain swap request at a safe boundary (period boundary).
     // If a previous swap request was deferred (retire queue full), keep retrying and coalesce to the latest.
@@ -1725,11 +2321,14 @@ int main()
       }
     }
 
-    // If a swap is requested, either swap immediately (default) or do a click-safe 2-block ramp
-    // without ever processing both chains in the same audio callback.
+    // If a swap is requested, either swap immediately (default), crossfade with both chains running
+    // (ALSA_XFADE_PERIODS, when affordable), or do a click-safe 2-block ramp without ever processing
+    // both chains in the same audio callback.
     if (pending)
     {
-      const bool canSwapNow = (!activeChain) || (!deferredRetire && retireQueueHasSpace());
+      // A crossfade in progress finishes first; the newest request waits for it in deferredSwap.
+      const bool canSwapNow =
+          (!activeChain) || (!deferredRetire && retireQueueHasSpace() && swapState != SwapRampState::Dual);
       if (!canSwapNow)
       {
         deferredSwap = pending;
@@ -1738,8 +2337,18 @@ int main()
       {
         deferredSwap.reset();
 
-        if (!passthrough && swapRampSamples > 0 && activeChain)
+        if (!passthrough && xfadePeriods > 0 && swapState == SwapRampState::Idle &&
+            xfadeAffordable(*pending, nframes))
+        {
+          xfNext = std::move(pending);
+          xfDone = 0;
+          swapState = SwapRampState::Dual;
+          xfadeCount++;
+        }
+        else if (!passthrough && swapRampSamples > 0 && activeChain)
         {
+          if (xfadePeriods > 0)
+            xfadeFallbacks++;
           swapNext = std::move(pending);
           if (swapState == SwapRampState::Idle)
             swapState = SwapRampState::FadeOut;
@@ -1757,38 +2366,184 @@ int main()
       }
     }
 
-    const bool wantTiming = logTiming.load(std::memory_order_relaxed);
+    const bool wantTiming =
+        logTiming.load(std::memory_order_relaxed) || schedAdaptive || telemetryOn || xfadePeriods > 0;
+    uint64_t chainTicks = 0;
+
+    // After a period change the active chain may still be built for the old block size until the
+    // rebuild arrives; it then runs reblocked, which only the adaptive scheduler sizes buffers for.
+    const bool chainFits = activeChain && activeChain->maxBlockFrames() == nframes;
+    const bool chainRuns = chainFits || (activeChain && rbFrames > 0 && activeChain->maxBlockFrames() <= rbFrames);
+    // A stereo chain fills dspOut/dspOutR for this period; everything else is mono in dspOut.
+    const bool stereoOut = !passthrough && chainRuns && activeChain->channels() == 2;
 
-    if (!passthrough && activeChain)
+    // Dual-run crossfade: the incoming chain's period starts on its own core first.
+    uint32_t xfTicket = 0;
+    if (swapState == SwapRampState::Dual)
     {
-      std::chrono::steady_clock::time_point t0;
-      if (wantTiming)
-        t0 = std::chrono::steady_clock::now();
+      if (!passthrough && chainFits && xfNext->maxBlockFrames() == nframes)
+      {
+        xfJob.chain = xfNext.get();
+        xfJob.in = inMono.data();
+        xfJob.out[0] = xfOut.data();
+        xfJob.out[1] = xfOutR.data();
+        xfJob.frames = nframes;
+        xfTicket = gXfadeWorker.post(0, &xfadeJob, &xfJob);
+      }
+      if (xfTicket == 0)
+      {
+        // Period size or passthrough changed under us (or the worker is stuck): plain ramp.
+        xfadeFallbacks++;
+        swapNext = std::move(xfNext);
+        swapState = SwapRampState::FadeOut;
+      }
+    }
+    const uint64_t periodT0 = (xfTicket != 0) ? pedal::dsp::cycleCount() : 0;
+
+    // Node taps follow activeChain; the incoming chain of a crossfade records once it takes over.
+    if (chainRuns)
+      gTaps.setLiveChain(activeChain->serial());
 
-      activeChain->process(inMono.data(), dspOut.data(), nframes);
+    if (!passthrough && chainRuns)
+    {
+      const uint64_t t0 = wantTiming ? pedal::dsp::cycleCount() : 0;
+
+      if (chainFits)
+      {
+        if (stereoOut)
+        {
+          float *outs[2] = {dspOut.data(), dspOutR.data()};
+          activeChain->process(inMono.data(), outs, nframes);
+        }
+        else
+        {
+          activeChain->process(inMono.data(), dspOut.data(), nframes);
+        }
+      }
+      else
+      {
+        const uint32_t block = activeChain->maxBlockFrames();
+        if (rbSerial != activeChain->serial())
+        {
+          rbSerial = activeChain->serial();
+          rbLead = block - std::gcd(block, nframes);
+          rbInFill = 0;
+          rbOutFill = rbLead;
+          std::memset(rbOut.data(), 0, sizeof(float) * rbLead);
+          std::memset(rbOutR.data(), 0, sizeof(float) * rbLead);
+        }
+
+        std::memcpy(rbIn.data() + rbInFill, inMono.data(), sizeof(float) * nframes);
+        rbInFill += nframes;
+        uint32_t used = 0;
+        for (; rbInFill - used >= block; used += block)
+        {
+          if (stereoOut)
+          {
+            float *outs[2] = {rbOut.data() + rbOutFill, rbOutR.data() + rbOutFill};
+            activeChain->process(rbIn.data() + used, outs, block);
+          }
+          else
+          {
+            activeChain->process(rbIn.data() + used, rbOut.data() + rbOutFill, block);
+          }
+          rbOutFill += block;
+        }
+        rbInFill -= used;
+        std::memmove(rbIn.data(), rbIn.data() + used, sizeof(float) * rbInFill);
+
+        // rbLead guarantees a full period is queued.
+        rbOutFill -= nframes;
+        std::memcpy(dspOut.data(), rbOut.data(), sizeof(float) * nframes);
+        std::memmove(rbOut.data(), rbOut.data() + nframes, sizeof(float) * rbOutFill);
+        if (stereoOut)
+        {
+          std::memcpy(dspOutR.data(), rbOutR.data(), sizeof(float) * nframes);
+          std::memmove(rbOutR.data(), rbOutR.data() + nframes, sizeof(float) * rbOutFill);
+        }
+      }
 
       if (wantTiming)
       {
-        const auto t1 = std::chrono::steady_clock::now();
-        const uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+        chainTicks = pedal::dsp::cycleCount() - t0;
+        lastChainTicks = chainTicks;
+        const uint64_t us = (uint64_t)((double)chainTicks * usPerCycle);
         chainProcCalls++;
         chainProcSumUs += us;
         if (us > chainProcMaxUs)
           chainProcMaxUs = us;
         if (deadlineUsInt > 0 && us > deadlineUsInt)
           chainOverruns++;
+        if (us > reviewMaxUs)
+          reviewMaxUs = us;
       }
     }
+    else if (!passthrough && activeChain)
+    {
+      std::memset(dspOut.data(), 0, sizeof(float) * nframes);
+    }
     else
     {
       std::memcpy(dspOut.data(), inMono.data(), sizeof(float) * nframes);
     }
 
+    if (xfTicket != 0)
+    {
+      gXfadeWorker.waitFor(0, xfTicket);
+
+      // theta runs 0..pi/2 over the whole window, one step per sample; past it, only the new chain.
+      // The window ends on a period boundary, so (cos, sin) is seeded exactly once per period and
+      // rotated by one step per sample from there.
+      const double total = (double)xfadePeriods * (double)nframes;
+      const double base = (double)xfDone * (double)nframes;
+      const double step = 1.5707963267948966 / total;
+      const bool inWindow = base < total;
+      double gOld = inWindow ? std::cos((base + 1.0) * step) : 0.0;
+      double gNew = inWindow ? std::sin((base + 1.0) * step) : 1.0;
+      const double rotC = inWindow ? std::cos(step) : 1.0;
+      const double rotS = inWindow ? std::sin(step) : 0.0;
+      const uint32_t outs = stereoOut ? 2 : 1;
+      float *oldBuf[2] = {dspOut.data(), dspOutR.data()};
+      const float *newBuf[2] = {xfOut.data(), xfOutR.data()};
+      for (uint32_t i = 0; i < nframes; i++)
+      {
+        for (uint32_t c = 0; c < outs; c++)
+          oldBuf[c][i] = (float)gOld * oldBuf[c][i] + (float)gNew * newBuf[c][i];
+        const double nextOld = gOld * rotC - gNew * rotS;
+        gNew = gNew * rotC + gOld * rotS;
+        gOld = nextOld;
+      }
+      xfDone++;
+
+      const double periodUs = (double)(pedal::dsp::cycleCount() - periodT0) * usPerCycle;
+      if (periodUs > xfadeBudget * deadlineUs && xfDone < xfadePeriods)
+      {
+        // Both chains together are too much for this period size after all: finish with the ramp.
+        xfadeFallbacks++;
+        swapNext = std::move(xfNext);
+        swapState = SwapRampState::FadeOut;
+      }
+      else if (xfDone >= xfadePeriods && !deferredRetire && retireQueueHasSpace())
+      {
+        auto old = activeChain;
+        activeChain = std::move(xfNext);
+        std::atomic_store_explicit(&gChainState.activeChain, activeChain, std::memory_order_release);
+        chainSwapCount++;
+
+        deferredRetire = std::move(old);
+        (void)retireChainFromAudioThread(deferredRetire);
+        swapState = SwapRampState::Idle;
+      }
+      // else: window done but nowhere to retire the old chain yet; keep running both at full gain.
+    }
+
     if (!passthrough && swapRampSamples > 0)
     {
       if (swapState == SwapRampState::FadeOut)
       {
         applyFadeOut(dspOut.data(), nframes, swapRampSamples);
+        if (stereoOut)
+          applyFadeOut(dspOutR.data(), nframes, swapRampSamples);
 
         if (swapNext)
         {
@@ -1814,58 +2569,80 @@ int main()
       else if (swapState == SwapRampState::FadeIn)
       {
         applyFadeIn(dspOut.data(), nframes, swapRampSamples);
+        if (stereoOut)
+          applyFadeIn(dspOutR.data(), nframes, swapRampSamples);
         swapState = SwapRampState::Idle;
       }
     }
 
-    // Stage metering: v1 uses chain output as "IR" peak placeholder.
-    float pkChain = 0.0f;
-    for (uint32_t i = 0; i < nframes; i++)
+    // Excess fill (poll scheduler): drop it from the head of this block, spliced so it doesn't click.
+    uint32_t written = 0;
+    if (schedPoll && trimPending > 0)
     {
-      const float absVal = std::fabs(dspOut[i]);
-      if (absVal > pkChain)
-        pkChain = absVal;
+      written = std::min(trimPending, nframes / 2);
+      spliceHead(dspOut.data(), nframes, written);
+      if (stereoOut)
+        spliceHead(dspOutR.data(), nframes, written);
+      trimmedFrames += written;
+      trimPending = 0;
     }
-    float currentIrPeak = peakIrOut.load(std::memory_order_relaxed);
-    if (pkChain > currentIrPeak)
-      peakIrOut.store(pkChain, std::memory_order_relaxed);
-    float currentNamPeak = peakNamOut.load(std::memory_order_relaxed);
-    if (pkChain > currentNamPeak)
-      peakNamOut.store(pkChain, std::memory_order_relaxed);
-
-    float pkOut = 0.0f;
-    const float outG = outputGainLin.load(std::memory_order_relaxed);
-    const bool doSan = sanitizeOutput.load(std::memory_order_relaxed);
-    for (uint32_t i = 0; i < nframes; i++)
+
+    // Meter, gain, sanitize, meter, clamp, convert and channel fan-out (or L/R interleave) in one
+    // pass. With mmap access it runs inside the writes, straight into the DMA ring, so frames a trim
+    // drops are not metered there.
+    OutputStage stage;
+    stage.gain = outputGainLin.load(std::memory_order_relaxed);
+    stage.sanitize = sanitizeOutput.load(std::memory_order_relaxed);
+    if (gTaps.any())
     {
-      const float s = dspOut[i] * outG;
-      float outS = s;
-      if (doSan && !std::isfinite(outS))
+      const float *out[2] = {dspOut.data(), dspOutR.data()};
+      gTaps.push(gTaps.find(pedal::dsp::SignalTaps::kOutput), out, stereoOut ? 2 : 1, nframes, stage.gain);
+    }
+    if (!duplex.pbMmap)
+      alsa_convert::encodeOutput(dspOut.data(), stereoOut ? dspOutR.data() : nullptr, stage.gain, stage.sanitize,
+                                 duplex.pbFmt, playbackChannels, outRaw.data(), nframes, stage.chain, stage.out,
+                                 stage.nonFinite);
+
+    uint32_t recRttUs = 0;
+    uint32_t recFill = 0;
+    if (schedPoll)
+    {
+      timespec pbTs{};
+      ::clock_gettime(CLOCK_MONOTONIC, &pbTs);
+      double pbQueued = 0.0;
+      if (pcmQueuedNow(pb, true, duplex.pbBuffer, rate, pbTs, pbQueued))
       {
-        outS = 0.0f;
-        nonFinite++;
+        trimmer.observe(pbQueued);
+        fillFrames.add(pbQueued);
+        recFill = (uint32_t)pbQueued;
+        if (haveCapQueued && snd_pcm_state(pb) == SND_PCM_STATE_RUNNING)
+        {
+          // First sample of this block: it has waited capQueued + nframes frames in capture plus the
+          // time since, and plays once the pbQueued frames ahead of it have drained. A pipelined
+          // chain delays it by whole periods on top.
+          const double sinceCap = (double)(pbTs.tv_sec - capTs.tv_sec) + (double)(pbTs.tv_nsec - capTs.tv_nsec) * 1e-9;
+          const double chainFrames =
+              !chainRuns ? 0.0
+              : chainFits ? (double)activeChain->latencyPeriods() * (double)nframes
+                          : (double)activeChain->latencyPeriods() * (double)activeChain->maxBlockFrames() + rbLead;
+          const double frames = capQueued + (double)nframes + sinceCap * (double)rate + pbQueued + chainFrames;
+          rttMs.add(frames * 1000.0 / (double)rate);
+          recRttUs = std::max(1u, (uint32_t)(frames * 1e6 / (double)rate));
+        }
       }
-      const float absVal = std::fabs(outS);
-      if (absVal > pkOut)
-        pkOut = absVal;
-
-      const float clamped = clampf(outS, -1.0f, 1.0f);
-      const int32_t v = (int32_t)std::lrintf(clamped * 2147483647.0f);
-      for (unsigned int c = 0; c < playbackChannels; c++)
-        outI32[(size_t)i * playbackChannels + c] = v;
     }
 
-    float currentOutPeak = peakFinalOut.load(std::memory_order_relaxed);
-    if (pkOut > currentOutPeak)
-      peakFinalOut.store(pkOut, std::memory_order_relaxed);
-
-    uint32_t written = 0;
+    const size_t pbFrameBytes = (size_t)playbackChannels * alsa_convert::bytesPerSample(duplex.pbFmt);
+    const snd_pcm_uframes_t pbStart = duplex.pbStartThreshold ? duplex.pbStartThreshold : duplex.pbBuffer - periodSize;
     while (written < nframes && running.load())
     {
-      snd_pcm_sframes_t w = snd_pcm_writei(
-          pb,
-          outI32.data() + (size_t)written * playbackChannels,
-          nframes - written);
+      snd_pcm_sframes_t w;
+      if (duplex.pbMmap)
+        w = mmapWriteFanout(pb, duplex.pbFmt, playbackChannels, dspOut.data() + written,
+                            stereoOut ? dspOutR.data() + written : nullptr, nframes - written, duplex.pbBuffer,
+                            pbStart, stage);
+      else
+        w = snd_pcm_writei(pb, outRaw.data() + (size_t)written * pbFrameBytes, nframes - written);
       if (w < 0)
       {
         xrunsWrite++;
@@ -1877,6 +2654,13 @@ int main()
           running.store(false);
           break;
         }
+        if (schedPoll)
+        {
+          // The margin was too thin: widen it and refill so the stream restarts with this block
+          // instead of waiting for more periods to reach the start threshold.
+          trimmer.onXrun((uint32_t)(duplex.pbBuffer - periodSize));
+          writeSilence(trimmer.margin());
+        }
         continue;
       }
       if (w == 0)
@@ -1887,11 +2671,69 @@ int main()
       break;
     if (written != nframes)
       shortWrite++;
+    nonFinite += stage.nonFinite;
+    winChain.add(stage.chain);
+    winOut.add(stage.out);
+    const uint64_t writtenTicks = pedal::dsp::cycleCount();
+
+    if (telemetryOn)
+    {
+      if (pedal::telemetry::PeriodRecord *rec = gTelemetry.beginRecord())
+      {
+        rec->wake = wakeTicks;
+        rec->chainTicks = (uint32_t)std::min<uint64_t>(chainTicks, UINT32_MAX);
+        rec->cycleTicks = (uint32_t)std::min<uint64_t>(writtenTicks - wakeTicks, UINT32_MAX);
+        rec->frames = nframes;
+        rec->flags = (chainTicks ? pedal::telemetry::kChainRan : 0u) |
+                     (telPeriodChange ? pedal::telemetry::kPeriodChange : 0u);
+        rec->xrunsRead = delta16(xrunsRead, telXrunsRead);
+        rec->xrunsWrite = delta16(xrunsWrite, telXrunsWrite);
+        rec->shortReads = delta16(shortRead, telShortRead);
+        rec->shortWrites = delta16(shortWrite, telShortWrite);
+        rec->swaps = delta16(chainSwapCount, telSwaps);
+        rec->crossfades = delta16(xfadeCount, telXfades);
+        rec->crossfadeFallbacks = delta16(xfadeFallbacks, telXfadeFallbacks);
+        rec->retireQueueFull = delta16(gRetireQueueFull.load(std::memory_order_relaxed), telRetireFull);
+        rec->nonFinite = delta16(nonFinite, telNonFinite);
+        rec->peakIn = meterIn.peak;
+        rec->peakChain = stage.chain.peak;
+        rec->peakOut = stage.out.peak;
+        rec->rmsIn = meterIn.rms();
+        rec->rmsChain = stage.chain.rms();
+        rec->rmsOut = stage.out.rms();
+        rec->rttUs = recRttUs;
+        rec->fillFrames = recFill;
+        rec->marginFrames = (uint16_t)std::min<uint32_t>(trimmer.margin(), 0xffff);
+        rec->floorFrames = (uint16_t)std::min<uint32_t>(advisor.floor(), 0xffff);
+        rec->chainSerial = chainRuns ? activeChain->serial() : 0;
+        rec->nodeCount = chainRuns ? (uint32_t)activeChain->copyNodeTicks(rec->nodeTicks, pedal::telemetry::PeriodRecord::kMaxNodes) : 0;
+        gTelemetry.push();
+        telPeriodChange = false;
+      }
+    }
+
+    // Period is queued; use the wait for the next capture to pre-sum work that only needs past input.
+    if (!passthrough && chainFits)
+      activeChain->idle();
 
     const auto now = std::chrono::steady_clock::now();
+    if (schedPoll && now - lastReview >= std::chrono::seconds(1))
+    {
+      lastReview = now;
+      trimPending = trimmer.review();
+      const uint64_t xruns = xrunsRead + xrunsWrite;
+      if (schedAdaptive)
+      {
+        const double loadPct = (deadlineUs > 0.0) ? ((double)reviewMaxUs * 100.0 / deadlineUs) : 0.0;
+        pendingPeriod = advisor.review(xruns - xrunsAtReview, loadPct);
+      }
+      xrunsAtReview = xruns;
+      reviewMaxUs = 0;
+    }
     if (now - lastReport > std::chrono::seconds(2))
     {
-      if (logStats.load() || xrunsRead || xrunsWrite || nonFinite || shortRead || shortWrite)
+      // With telemetry on, stats lines come from the telemetry thread; only the window meters reset here.
+      if (!telemetryOn && (logStats.load() || xrunsRead || xrunsWrite || nonFinite || shortRead || shortWrite))
       {
         if (logTiming.load(std::memory_order_relaxed))
         {
@@ -1899,7 +2741,7 @@ int main()
           const double chainPct = (deadlineUs > 0.0) ? ((double)chainProcMaxUs * 100.0 / deadlineUs) : 0.0;
 
           std::fprintf(stderr,
-                       "ALSA: xruns(read=%llu write=%llu) short(read=%llu write=%llu) nonFinite=%llu swaps=%llu nframes=%u peakIn=%.3f peakNam=%.3f peakIr=%.3f peakOut=%.3f chain_us_avg=%.1f chain_us_max=%llu deadline_us=%.1f chain_max_pct=%.1f chain_overruns=%llu retireQ_full=%llu\n",
+                       "ALSA: xruns(read=%llu write=%llu) short(read=%llu write=%llu) nonFinite=%llu swaps=%llu nframes=%u peakIn=%.3f peakChain=%.3f peakOut=%.3f rmsIn=%.3f rmsOut=%.3f chain_us_avg=%.1f chain_us_max=%llu deadline_us=%.1f chain_max_pct=%.1f chain_overruns=%llu retireQ_full=%llu\n",
                        (unsigned long long)xrunsRead,
                        (unsigned long long)xrunsWrite,
                        (unsigned long long)shortRead,
@@ -1907,10 +2749,11 @@ int main()
                        (unsigned long long)nonFinite,
                        (unsigned long long)chainSwapCount,
                        nframes,
-                       (double)peakInput.load(),
-                       (double)peakNamOut.load(),
-                       (double)peakIrOut.load(),
-                       (double)peakFinalOut.load(),
+                       (double)winIn.peak,
+                       (double)winChain.peak,
+                       (double)winOut.peak,
+                       (double)winIn.rms(),
+                       (double)winOut.rms(),
                        chainAvgUs,
                        (unsigned long long)chainProcMaxUs,
                        deadlineUs,
@@ -1934,28 +2777,11 @@ int main()
                          (unsigned long long)chainProcMaxUs,
                          (unsigned long long)baselineChainUsMax);
           }
-
-          // Optional per-node-type timing (debug). Printed as a single compact line.
-          if (activeChain && activeChain->nodeTimingEnabled())
-          {
-            pedal::dsp::SignalChain::NodeTimingStat stats[16];
-            const size_t n = activeChain->snapshotNodeTiming(stats, 16, true /*reset*/);
-            if (n > 0)
-            {
-              std::fprintf(stderr, "ALSA: node_us_max");
-              for (size_t i = 0; i < n; i++)
-              {
-                const char *t = stats[i].type ? stats[i].type : "?";
-                std::fprintf(stderr, " %s=%llu", t, (unsigned long long)stats[i].maxUs);
-              }
-              std::fprintf(stderr, "\n");
-            }
-          }
         }
         else
         {
           std::fprintf(stderr,
-                       "ALSA: xruns(read=%llu write=%llu) short(read=%llu write=%llu) nonFinite=%llu swaps=%llu nframes=%u peakIn=%.3f peakNam=%.3f peakIr=%.3f peakOut=%.3f\n",
+                       "ALSA: xruns(read=%llu write=%llu) short(read=%llu write=%llu) nonFinite=%llu swaps=%llu nframes=%u peakIn=%.3f peakChain=%.3f peakOut=%.3f rmsIn=%.3f rmsOut=%.3f\n",
                        (unsigned long long)xrunsRead,
                        (unsigned long long)xrunsWrite,
                        (unsigned long long)shortRead,
@@ -1963,29 +2789,54 @@ int main()
                        (unsigned long long)nonFinite,
                        (unsigned long long)chainSwapCount,
                        nframes,
-                       (double)peakInput.load(),
-                       (double)peakNamOut.load(),
-                       (double)peakIrOut.load(),
-                       (double)peakFinalOut.load());
+                       (double)winIn.peak,
+                       (double)winChain.peak,
+                       (double)winOut.peak,
+                       (double)winIn.rms(),
+                       (double)winOut.rms());
         }
-      }
 
-      chainSwapCount = 0;
-      chainProcCalls = 0;
-      chainProcSumUs = 0;
-      chainProcMaxUs = 0;
-      chainOverruns = 0;
+        if (xfadeCount || xfadeFallbacks)
+          std::fprintf(stderr, "ALSA: crossfades=%llu ramp_fallbacks=%llu\n", (unsigned long long)xfadeCount,
+                       (unsigned long long)xfadeFallbacks);
+
+        if (schedPoll)
+          std::fprintf(stderr,
+                       "ALSA: sched period=%u floor=%u margin=%u fill_min=%.0f rtt_ms(min=%.2f avg=%.2f max=%.2f) trimmed=%llu\n",
+                       nframes,
+                       advisor.floor(),
+                       trimmer.margin(),
+                       fillFrames.min,
+                       rttMs.min,
+                       rttMs.avg(),
+                       rttMs.max,
+                       (unsigned long long)trimmedFrames);
+      }
+      if (!telemetryOn)
+      {
+        rttMs.reset();
+        fillFrames.reset();
+
+        chainSwapCount = 0;
+        xfadeCount = 0;
+        xfadeFallbacks = 0;
+        chainProcCalls = 0;
+        chainProcSumUs = 0;
+        chainProcMaxUs = 0;
+        chainOverruns = 0;
+      }
 
-      peakInput.store(0.0f, std::memory_order_relaxed);
-      peakNamOut.store(0.0f, std::memory_order_relaxed);
-      peakIrOut.store(0.0f, std::memory_order_relaxed);
-      peakFinalOut.store(0.0f, std::memory_order_relaxed);
+      winIn = {};
+      winChain = {};
+      winOut = {};
       lastReport = now;
     }
   }
 
   running.store(false);
 
+  gTelemetry.stop();
+
   gChainState.running.store(false, std::memory_order_relaxed);
   if (gControlThread.joinable())
     gControlThread.join();
@@ -1993,12 +2844,12 @@ int main()
   if (ctl.joinable())
     ctl.join();
 
-  gRetireRunning.store(false, std::memory_order_relaxed);
-  if (gRetireThread.joinable())
-    gRetireThread.join();
+  stopRetireThread();
+
+  gRtWorkers.stop();
+  fftw_planner::shutdown();
 
-  dumpNamFlush(rate);
-  dumpIrFlush(rate);
+  gTaps.stop();
 
   snd_pcm_close(cap);
   snd_pcm_close(pb);
@@ -0,0 +1,46 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pedal::dsp
+{
+
+  std::shared_ptr<const MappedFile> MappedFile::open(const std::string &path, std::string &err)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      err = "open " + path + ": " + std::strerror(errno);
+      return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+      ::close(fd);
+      err = "empty or unreadable file: " + path;
+      return nullptr;
+    }
+    const size_t size = (size_t)st.st_size;
+    void *p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    const int mapErr = errno;
+    ::close(fd);
+    if (p == MAP_FAILED)
+    {
+      err = "mmap " + path + ": " + std::strerror(mapErr);
+      return nullptr;
+    }
+    return std::shared_ptr<const MappedFile>(new MappedFile(static_cast<const unsigned char *>(p), size));
+  }
+
+  MappedFile::~MappedFile()
+  {
+    ::munmap(const_cast<unsigned char *>(data_), size_);
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace pedal::dsp
+{
+
+  // Read-only mapping of a whole file, prefaulted (MAP_POPULATE) so reads from the audio thread
+  // never take a major fault; under mlockall(MCL_FUTURE) it is locked as well. Unmapped when the
+  // last reference goes. Files are replaced by rename, never rewritten in place, so a live mapping
+  // stays valid.
+  class MappedFile
+  {
+  public:
+    // nullptr + err on failure (missing, empty or unmappable file).
+    static std::shared_ptr<const MappedFile> open(const std::string &path, std::string &err);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const unsigned char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+  private:
+    MappedFile(const unsigned char *data, size_t size) : data_(data), size_(size) {}
+
+    const unsigned char *data_;
+    size_t size_;
+  };
+
+} // namespace pedal::dsp
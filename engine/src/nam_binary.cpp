@@ -0,0 +1,192 @@
+#include "nam_binary.h"
+
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "get_dsp.h"
+#include "hash64.h"
+#include "mapped_file.h"
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+
+    constexpr char kMagic[8] = {'P', 'D', 'L', 'N', 'A', 'M', 'B', '\0'};
+    constexpr uint32_t kVersion = 1;
+    constexpr size_t kAlign = 64; // weights start on a cache line / widest SIMD load
+
+    struct NambHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t headerBytes;
+      uint64_t fileBytes;
+      uint64_t metaBytes; // meta JSON follows the header directly
+      uint64_t weightsOffset;
+      uint64_t weightCount;
+      uint64_t weightsHash;
+      double sampleRate; // dspData::expected_sample_rate
+    };
+    static_assert(sizeof(NambHeader) == 64, "NambHeader is part of the file format");
+
+  } // namespace
+
+  bool isNamBinaryPath(const std::string &path)
+  {
+    return std::filesystem::path(path).extension() == kNamBinaryExt;
+  }
+
+  std::string resolveNamPath(const std::string &path)
+  {
+    std::filesystem::path p(path);
+    if (p.extension() != ".nam")
+      return path;
+    std::filesystem::path packed = p;
+    packed.replace_extension(kNamBinaryExt);
+
+    std::error_code ec;
+    const auto packedTime = std::filesystem::last_write_time(packed, ec);
+    if (ec)
+      return path;
+    const auto jsonTime = std::filesystem::last_write_time(p, ec);
+    if (!ec && packedTime < jsonTime)
+    {
+      std::fprintf(stderr, "NAM: ignoring stale %s (older than the .nam)\n", packed.c_str());
+      return path;
+    }
+    return packed.string();
+  }
+
+  void readNamBinary(const std::string &path, nam::dspData &out)
+  {
+    if constexpr (std::endian::native != std::endian::little)
+      throw std::runtime_error(".namb is little-endian; not supported on this host");
+
+    std::string err;
+    const auto map = MappedFile::open(path, err);
+    if (!map)
+      throw std::runtime_error(err);
+    const unsigned char *base = map->data();
+    const size_t size = map->size();
+
+    NambHeader h;
+    if (size < sizeof(h))
+      throw std::runtime_error("truncated .namb header: " + path);
+    std::memcpy(&h, base, sizeof(h));
+
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0)
+      throw std::runtime_error("not a .namb file: " + path);
+    if (h.version != kVersion)
+      throw std::runtime_error("unsupported .namb version " + std::to_string(h.version) + ": " + path);
+    if (h.headerBytes < sizeof(h) || h.fileBytes != size || h.metaBytes > size ||
+        h.weightsOffset % kAlign != 0 || h.headerBytes + h.metaBytes > h.weightsOffset || h.weightsOffset > size ||
+        h.weightCount > (size - h.weightsOffset) / sizeof(float))
+      throw std::runtime_error("corrupt or truncated .namb: " + path);
+
+    const unsigned char *weights = base + h.weightsOffset;
+    const size_t weightBytes = (size_t)h.weightCount * sizeof(float);
+    if (hash64(weights, weightBytes) != h.weightsHash)
+      throw std::runtime_error(".namb weight checksum mismatch: " + path);
+
+    const auto *meta = reinterpret_cast<const char *>(base + h.headerBytes);
+    const auto j = nlohmann::json::parse(meta, meta + h.metaBytes);
+    out.version = j.at("version").get<std::string>();
+    out.architecture = j.at("architecture").get<std::string>();
+    out.config = j.at("config");
+    out.metadata = j.contains("metadata") ? j["metadata"] : nlohmann::json();
+    out.expected_sample_rate = h.sampleRate;
+
+    // The one copy: get_dsp wants a std::vector it can read layers out of.
+    out.weights.resize((size_t)h.weightCount);
+    std::memcpy(out.weights.data(), weights, weightBytes);
+  }
+
+  bool writeNamBinary(const nam::dspData &data, const std::string &path, std::string &err)
+  {
+    if constexpr (std::endian::native != std::endian::little)
+    {
+      err = ".namb is little-endian; not supported on this host";
+      return false;
+    }
+
+    nlohmann::json meta = {
+        {"version", data.version},
+        {"architecture", data.architecture},
+        {"config", data.config},
+    };
+    if (!data.metadata.is_null())
+      meta["metadata"] = data.metadata;
+    const std::string metaText = meta.dump();
+
+    NambHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.headerBytes = sizeof(h);
+    h.metaBytes = metaText.size();
+    h.weightsOffset = (sizeof(h) + metaText.size() + kAlign - 1) / kAlign * kAlign;
+    h.weightCount = data.weights.size();
+    h.weightsHash = hash64(data.weights.data(), data.weights.size() * sizeof(float));
+    h.sampleRate = data.expected_sample_rate;
+    h.fileBytes = h.weightsOffset + h.weightCount * sizeof(float);
+
+    const std::string tmp = path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f)
+    {
+      err = "open " + tmp + ": " + std::strerror(errno);
+      return false;
+    }
+    const std::vector<char> pad(h.weightsOffset - sizeof(h) - metaText.size(), 0);
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+              std::fwrite(metaText.data(), 1, metaText.size(), f) == metaText.size() &&
+              std::fwrite(pad.data(), 1, pad.size(), f) == pad.size() &&
+              std::fwrite(data.weights.data(), sizeof(float), data.weights.size(), f) == data.weights.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+    {
+      err = "write " + tmp + " failed";
+      std::remove(tmp.c_str());
+      return false;
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+      err = "rename " + tmp + ": " + std::strerror(errno);
+      std::remove(tmp.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  void loadNamData(const std::string &file, nam::dspData &out)
+  {
+    if (isNamBinaryPath(file))
+    {
+      readNamBinary(file, out);
+      return;
+    }
+    std::ifstream f(file);
+    if (!f)
+      throw std::runtime_error("can't open NAM model " + file);
+    nlohmann::json j;
+    f >> j;
+    out.version = j.at("version").get<std::string>();
+    nam::verify_config_version(out.version);
+    out.architecture = j.at("architecture").get<std::string>();
+    out.config = j.at("config");
+    out.metadata = j.contains("metadata") ? j["metadata"] : nlohmann::json();
+    out.weights = nam::GetWeights(j);
+    out.expected_sample_rate = (j.contains("sample_rate") && j["sample_rate"].is_number()) ? j["sample_rate"].get<double>()
+                                                                                              : -1.0;
+  }
+
+} // namespace pedal::dsp
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace nam
+{
+  class DSP;
+  struct dspData;
+}
+
+namespace pedal::dsp
+{
+
+  // .namb: a .nam model with the JSON weight array replaced by raw float32 data, so loading is an
+  // mmap plus one copy instead of parsing a few hundred thousand JSON numbers. Layout (little-endian):
+  //
+  //   NambHeader                       64 bytes
+  //   meta JSON                        {"version","architecture","config","metadata"} (small)
+  //   zero padding                     to a 64-byte boundary
+  //   float32 weights[weightCount]     in nam::get_dsp's read order (the .nam array order)
+  //
+  // Written by nam_pack; the header carries a hash of the weight bytes.
+  inline constexpr const char *kNamBinaryExt = ".namb";
+
+  bool isNamBinaryPath(const std::string &path);
+
+  // The file to load for a configured model path: "X.namb" next to "X.nam" if it exists and isn't
+  // older than the .nam, otherwise `path` unchanged.
+  std::string resolveNamPath(const std::string &path);
+
+  // Fills `out` from a .namb file. Throws std::runtime_error on a malformed or truncated file.
+  void readNamBinary(const std::string &path, nam::dspData &out);
+
+  // Writes `data` (as filled by nam::get_dsp(path, data)) to `path` via a temp file + rename.
+  bool writeNamBinary(const nam::dspData &data, const std::string &path, std::string &err);
+
+  // Reads `file` (normally resolveNamPath's result) into `out` without building a model: .namb
+  // through readNamBinary, anything else as .nam JSON, filled the way nam::get_dsp fills it. Throws
+  // like nam::get_dsp.
+  void loadNamData(const std::string &file, nam::dspData &out);
+
+} // namespace pedal::dsp
@@ -0,0 +1,1029 @@
+#include "nam_inference.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "get_dsp.h"
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+
+    using Json = nlohmann::json;
+
+    // Widest layer the runtime-sized kernels take (z lives on the stack).
+    constexpr int kMaxWnChannels = 64;
+    constexpr int kMaxLstmHidden = 128;
+
+    enum class Act
+    {
+      Tanh,
+      FastTanh,
+      Hardtanh,
+      ReLU,
+      LeakyReLU,
+      Sigmoid,
+      SiLU,
+      Hardswish,
+      LeakyHardtanh,
+    };
+
+    std::optional<Act> parseAct(const std::string &name, bool fastTanh)
+    {
+      if (name == "Tanh")
+        return fastTanh ? Act::FastTanh : Act::Tanh;
+      if (name == "Fasttanh")
+        return Act::FastTanh;
+      if (name == "Hardtanh")
+        return Act::Hardtanh;
+      if (name == "ReLU")
+        return Act::ReLU;
+      if (name == "LeakyReLU")
+        return Act::LeakyReLU;
+      if (name == "Sigmoid")
+        return Act::Sigmoid;
+      if (name == "SiLU")
+        return Act::SiLU;
+      if (name == "Hardswish")
+        return Act::Hardswish;
+      if (name == "LeakyHardtanh")
+        return Act::LeakyHardtanh;
+      return std::nullopt;
+    }
+
+    // nam::activations::fast_tanh / fast_sigmoid.
+    inline float fastTanh(float x)
+    {
+      const float ax = std::fabs(x);
+      const float x2 = x * x;
+      return (x * (2.45550750702956f + 2.45550750702956f * ax + (0.893229853513558f + 0.821226666969744f * ax) * x2) /
+              (2.44506634652299f + (2.44506634652299f + x2) * std::fabs(x + 0.814642734961073f * x * ax)));
+    }
+
+    inline float fastSigmoid(float x) { return 0.5f * (fastTanh(x * 0.5f) + 1.0f); }
+    inline float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+    void activate(Act a, float *x, int n)
+    {
+      switch (a)
+      {
+      case Act::Tanh:
+        for (int i = 0; i < n; i++)
+          x[i] = std::tanh(x[i]);
+        break;
+      case Act::FastTanh:
+        for (int i = 0; i < n; i++)
+          x[i] = fastTanh(x[i]);
+        break;
+      case Act::Hardtanh:
+        for (int i = 0; i < n; i++)
+          x[i] = std::clamp(x[i], -1.0f, 1.0f);
+        break;
+      case Act::ReLU:
+        for (int i = 0; i < n; i++)
+          x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+        break;
+      case Act::LeakyReLU:
+        for (int i = 0; i < n; i++)
+          x[i] = x[i] > 0.0f ? x[i] : 0.01f * x[i];
+        break;
+      case Act::Sigmoid:
+        for (int i = 0; i < n; i++)
+          x[i] = sigmoid(x[i]);
+        break;
+      case Act::SiLU:
+        for (int i = 0; i < n; i++)
+          x[i] = x[i] * sigmoid(x[i]);
+        break;
+      case Act::Hardswish:
+        for (int i = 0; i < n; i++)
+        {
+          const float v = x[i];
+          x[i] = v <= -3.0f ? 0.0f : (v >= 3.0f ? v : v * (v + 3.0f) / 6.0f);
+        }
+        break;
+      case Act::LeakyHardtanh:
+        for (int i = 0; i < n; i++)
+        {
+          const float v = x[i];
+          x[i] = v < -1.0f ? (v + 1.0f) * 0.01f - 1.0f : (v > 1.0f ? (v - 1.0f) * 0.01f + 1.0f : v);
+        }
+        break;
+      }
+    }
+
+    uint32_t nextPow2(uint32_t v)
+    {
+      uint32_t p = 1;
+      while (p < v)
+        p <<= 1;
+      return p;
+    }
+
+    // Reads the flat weight vector in nam::get_dsp's order; any over-read marks the model unsupported.
+    struct WeightReader
+    {
+      const std::vector<float> &w;
+      size_t pos = 0;
+      bool ok = true;
+
+      float next()
+      {
+        if (pos >= w.size())
+        {
+          ok = false;
+          return 0.0f;
+        }
+        return w[pos++];
+      }
+
+      // PyTorch (out x in) row-major into [in][out], so a matrix-vector product walks columns.
+      void matrix(std::vector<float> &dst, int out, int in)
+      {
+        dst.assign((size_t)out * in, 0.0f);
+        for (int i = 0; i < out; i++)
+          for (int j = 0; j < in; j++)
+            dst[(size_t)j * out + i] = next();
+      }
+
+      void vector(std::vector<float> &dst, int n)
+      {
+        dst.resize((size_t)n);
+        for (int i = 0; i < n; i++)
+          dst[(size_t)i] = next();
+      }
+    };
+
+    bool onlyKeys(const Json &j, std::initializer_list<const char *> keys, std::string &why)
+    {
+      for (auto it = j.begin(); it != j.end(); ++it)
+      {
+        if (std::none_of(keys.begin(), keys.end(), [&](const char *k) { return it.key() == k; }))
+        {
+          why = "unsupported config key '" + it.key() + "'";
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Four floats in one SSE/NEON register; GCC and Clang lower the arithmetic directly. The layer
+    // loops are axpy over output rows, which the auto-vectorizer turns into shuffles instead.
+    using f32x4 = float __attribute__((vector_size(16)));
+
+    inline f32x4 load4(const float *p)
+    {
+      f32x4 v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    inline void store4(float *p, f32x4 v) { std::memcpy(p, &v, sizeof(v)); }
+
+    using Precision = NamInference::Precision;
+
+    // Reduced-precision weights are widened to fp32 four output lanes at a time, so only the bytes
+    // streamed from memory shrink. GCC's generic vector conversions scalarize these; intrinsics don't.
+    inline f32x4 loadW(const float *p) { return load4(p); }
+
+    inline f32x4 loadW(const int8_t *p)
+    {
+#if defined(__SSE2__)
+      int32_t bits;
+      std::memcpy(&bits, p, sizeof(bits));
+      __m128i v = _mm_cvtsi32_si128(bits);
+      v = _mm_unpacklo_epi8(v, v);
+      v = _mm_unpacklo_epi16(v, v); // each byte now in the top of its lane
+      return (f32x4)_mm_cvtepi32_ps(_mm_srai_epi32(v, 24));
+#elif defined(__ARM_NEON)
+      uint32_t bits;
+      std::memcpy(&bits, p, sizeof(bits));
+      const int16x8_t w = vmovl_s8(vreinterpret_s8_u32(vdup_n_u32(bits)));
+      return (f32x4)vcvtq_f32_s32(vmovl_s16(vget_low_s16(w)));
+#else
+      return f32x4{(float)p[0], (float)p[1], (float)p[2], (float)p[3]};
+#endif
+    }
+
+    // fp16 needs a hardware half -> float convert: F16C (when compiled in, e.g. -march=native) or
+    // AArch64. Weights are kept as raw IEEE half bits.
+#if defined(__F16C__) || defined(__aarch64__)
+#define PEDAL_NAM_FP16 1
+    constexpr bool kHaveFp16 = true;
+
+    inline f32x4 loadW(const uint16_t *p)
+    {
+#if defined(__F16C__)
+      return (f32x4)_mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+#else
+      return (f32x4)vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(p)));
+#endif
+    }
+
+    uint16_t toHalf(float f)
+    {
+#if defined(__F16C__)
+      return (uint16_t)_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT);
+#else
+      const __fp16 h = (__fp16)f;
+      uint16_t bits;
+      std::memcpy(&bits, &h, sizeof(bits));
+      return bits;
+#endif
+    }
+#else
+    constexpr bool kHaveFp16 = false;
+#endif
+
+    // A weight matrix stored [..][out lane], `width` lanes per row, in the precision its kernel
+    // reads. Built in fp32, then convert() swaps it for the reduced copy.
+    struct QWeights
+    {
+      std::vector<float> f32;
+#ifdef PEDAL_NAM_FP16
+      std::vector<uint16_t> h; // fp16 bits
+#endif
+      std::vector<int8_t> q;
+      std::vector<float> scale; // int8: per out lane, w = q * scale
+
+      template <typename W>
+      const W *data() const
+      {
+        if constexpr (std::is_same_v<W, int8_t>)
+          return q.data();
+#ifdef PEDAL_NAM_FP16
+        else if constexpr (std::is_same_v<W, uint16_t>)
+          return h.data();
+#endif
+        else
+          return f32.data();
+      }
+
+      void convert(Precision p, int width)
+      {
+        if (p == Precision::Int8)
+        {
+          // Symmetric per output channel: each lane's largest weight maps to +-127.
+          scale.assign((size_t)width, 0.0f);
+          for (size_t k = 0; k < f32.size(); k++)
+            scale[k % width] = std::max(scale[k % width], std::fabs(f32[k]));
+          for (float &sc : scale)
+            sc = sc > 0.0f ? sc / 127.0f : 1.0f;
+          q.resize(f32.size());
+          for (size_t k = 0; k < f32.size(); k++)
+            q[k] = (int8_t)std::clamp(std::lround(f32[k] / scale[k % width]), -127L, 127L);
+        }
+#ifdef PEDAL_NAM_FP16
+        else if (p == Precision::Fp16)
+        {
+          h.resize(f32.size());
+          for (size_t k = 0; k < f32.size(); k++)
+            h[k] = toHalf(f32[k]);
+        }
+#endif
+        else
+        {
+          return;
+        }
+        std::vector<float>().swap(f32);
+      }
+    };
+
+    const char *precisionSuffix(Precision p)
+    {
+      return p == Precision::Int8 ? " int8" : (p == Precision::Fp16 ? " fp16" : "");
+    }
+
+    constexpr int pad4(int n) { return (n + 3) & ~3; }
+
+    // -------------------- WaveNet --------------------
+
+    // Channel vectors are stored padded to a multiple of four (P = pad4(C)) with zero weights in the
+    // padding, so every kernel runs on whole vectors. Padded z lanes are never read back.
+    struct WnLayer
+    {
+      uint32_t dilation = 1;
+      QWeights conv;               // [tap k, oldest first][in j][out i], ZP = P (2P gated) rows
+      std::vector<float> convBias; // ZP
+      std::vector<float> mixin;    // ZP, condition -> z
+      QWeights w1x1;               // [j][i], C x P
+      std::vector<float> b1x1;     // P
+      std::vector<float> ring;     // [frame][P] layer input history
+      uint32_t mask = 0;           // ring frames - 1
+    };
+
+    struct WnArray;
+
+    // One layer over a block: z = conv(x) + mixin * cond, activation, head += z, and, when `next` is
+    // set, next = x + 1x1(z). Frame t goes to next[((nextPos + t) & nextMask) * P]: the following
+    // layer's ring, or the linear array output (nextPos 0, mask ~0).
+    using LayerFn = void (*)(const WnArray &a, const WnLayer &l, const float *cond, float *head, float *next,
+                             uint32_t nextPos, uint32_t nextMask, uint32_t pos, uint32_t n);
+
+    struct WnArray
+    {
+      int inSize = 1;
+      int inStride = 1; // floats per frame of the array input (the previous array's P)
+      int channels = 0;
+      int stride = 0; // P
+      int headSize = 0;
+      int headStride = 1; // floats per frame of the head output (the next array's P; 1 at the end)
+      int kernel = 0;
+      bool gated = false;
+      Act act = Act::Tanh;
+      std::vector<float> rechannel; // [j][i], inSize -> P, no bias
+      std::vector<WnLayer> layers;
+      std::vector<float> headW; // [j][i], C -> headSize
+      std::vector<float> headB; // headSize, or empty
+      LayerFn run = nullptr;
+      long receptiveField = 0;
+    };
+
+    // CT/KT: channels and kernel size fixed at compile time (0 = read from the array). W: conv and
+    // 1x1 weight storage.
+    template <int CT, int KT, bool Gated, typename W>
+    void layerKernel(const WnArray &a, const WnLayer &l, const float *cond, float *head, float *next,
+                     uint32_t nextPos, uint32_t nextMask, uint32_t pos, uint32_t n)
+    {
+      const int C = CT ? CT : a.channels;
+      const int P = CT ? pad4(CT) : a.stride;
+      const int K = KT ? KT : a.kernel;
+      const int V = P / 4;
+      const int ZV = Gated ? 2 * V : V;
+      constexpr int kZV = (Gated ? 2 : 1) * (CT ? pad4(CT) : kMaxWnChannels) / 4;
+
+      const float *__restrict ring = l.ring.data();
+      const float *__restrict bias = l.convBias.data();
+      const float *__restrict mixin = l.mixin.data();
+      const float *__restrict b1 = l.b1x1.data();
+      const uint32_t mask = l.mask;
+      const uint32_t d = l.dilation;
+
+      for (uint32_t t = 0; t < n; t++)
+      {
+        f32x4 z[kZV];
+        for (int v = 0; v < ZV; v++)
+          z[v] = f32x4{};
+
+        const W *__restrict w = l.conv.template data<W>();
+        for (int k = 0; k < K; k++)
+        {
+          const float *__restrict x = ring + (size_t)((pos + t - d * (uint32_t)(K - 1 - k)) & mask) * P;
+          for (int j = 0; j < C; j++, w += 4 * ZV)
+          {
+            const float s = x[j];
+            for (int v = 0; v < ZV; v++)
+              z[v] += loadW(w + 4 * v) * s;
+          }
+        }
+        if constexpr (std::is_same_v<W, int8_t>)
+        {
+          for (int v = 0; v < ZV; v++)
+            z[v] *= load4(l.conv.scale.data() + 4 * v);
+        }
+        const float c = cond[t];
+        for (int v = 0; v < ZV; v++)
+          z[v] = z[v] + load4(bias + 4 * v) + load4(mixin + 4 * v) * c;
+
+        alignas(16) float zs[4 * kZV];
+        std::memcpy(zs, z, sizeof(float) * 4 * ZV);
+        activate(a.act, zs, P);
+        if constexpr (Gated)
+        {
+          for (int i = 0; i < P; i++)
+            zs[i] *= sigmoid(zs[P + i]);
+        }
+
+        float *__restrict h = head + (size_t)t * P;
+        for (int v = 0; v < V; v++)
+          store4(h + 4 * v, load4(h + 4 * v) + load4(zs + 4 * v));
+
+        if (!next)
+          continue;
+        const float *__restrict xt = ring + (size_t)((pos + t) & mask) * P;
+        f32x4 acc[kZV];
+        for (int v = 0; v < V; v++)
+          acc[v] = f32x4{};
+        const W *__restrict w1 = l.w1x1.template data<W>();
+        for (int j = 0; j < C; j++, w1 += P)
+        {
+          const float s = zs[j];
+          for (int v = 0; v < V; v++)
+            acc[v] += loadW(w1 + 4 * v) * s;
+        }
+        if constexpr (std::is_same_v<W, int8_t>)
+        {
+          for (int v = 0; v < V; v++)
+            acc[v] *= load4(l.w1x1.scale.data() + 4 * v);
+        }
+        float *__restrict o = next + (size_t)((nextPos + t) & nextMask) * P;
+        for (int v = 0; v < V; v++)
+          store4(o + 4 * v, load4(xt + 4 * v) + (acc[v] + load4(b1 + 4 * v)));
+      }
+    }
+
+    // The standard/lite/feather/nano layer arrays; everything else takes the runtime-sized kernel.
+    template <typename W>
+    LayerFn pickLayerKernel(int channels, int kernel, bool gated, bool &specialized)
+    {
+      specialized = true;
+      if (!gated && kernel == 3)
+      {
+        switch (channels)
+        {
+        case 2:
+          return layerKernel<2, 3, false, W>;
+        case 4:
+          return layerKernel<4, 3, false, W>;
+        case 6:
+          return layerKernel<6, 3, false, W>;
+        case 8:
+          return layerKernel<8, 3, false, W>;
+        case 12:
+          return layerKernel<12, 3, false, W>;
+        case 16:
+          return layerKernel<16, 3, false, W>;
+        default:
+          break;
+        }
+      }
+      specialized = false;
+      return gated ? layerKernel<0, 0, true, W> : layerKernel<0, 0, false, W>;
+    }
+
+    LayerFn pickLayerKernel(Precision p, int channels, int kernel, bool gated, bool &specialized)
+    {
+      switch (p)
+      {
+      case Precision::Int8:
+        return pickLayerKernel<int8_t>(channels, kernel, gated, specialized);
+#ifdef PEDAL_NAM_FP16
+      case Precision::Fp16:
+        return pickLayerKernel<uint16_t>(channels, kernel, gated, specialized);
+#endif
+      default:
+        return pickLayerKernel<float>(channels, kernel, gated, specialized);
+      }
+    }
+
+    class WaveNetInference final : public NamInference
+    {
+    public:
+      // nullptr (with `why`) if the config isn't the plain layer-array WaveNet nam::wavenet implements.
+      static std::unique_ptr<WaveNetInference> build(const nam::dspData &data, uint32_t maxFrames, bool fast,
+                                                     Precision precision, std::string &why)
+      {
+        auto m = std::unique_ptr<WaveNetInference>(new WaveNetInference());
+        m->maxFrames_ = maxFrames;
+        const Json &cfg = data.config;
+        if (!cfg.is_object() || !onlyKeys(cfg, {"layers", "head", "head_scale"}, why))
+          return nullptr;
+        if (cfg.contains("head") && !cfg["head"].is_null())
+        {
+          why = "WaveNet head";
+          return nullptr;
+        }
+        const Json &layers = cfg.at("layers");
+        if (!layers.is_array() || layers.empty())
+        {
+          why = "no layer arrays";
+          return nullptr;
+        }
+
+        WeightReader rd{data.weights};
+        std::string shape;
+        bool allSpecialized = true;
+        int maxStride = 4;
+        for (size_t ai = 0; ai < layers.size(); ai++)
+        {
+          const Json &lc = layers[ai];
+          if (!onlyKeys(lc, {"input_size", "condition_size", "head_size", "channels", "kernel_size", "dilations",
+                             "activation", "gated", "head_bias"},
+                        why))
+            return nullptr;
+          WnArray a;
+          a.inSize = lc.at("input_size").get<int>();
+          const int condSize = lc.at("condition_size").get<int>();
+          a.channels = lc.at("channels").get<int>();
+          a.headSize = lc.at("head_size").get<int>();
+          a.kernel = lc.at("kernel_size").get<int>();
+          a.gated = lc.at("gated").get<bool>();
+          const bool headBias = lc.at("head_bias").get<bool>();
+          const auto act = parseAct(lc.at("activation").get<std::string>(), fast);
+          if (!act)
+          {
+            why = "activation " + lc.at("activation").get<std::string>();
+            return nullptr;
+          }
+          a.act = *act;
+
+          // The same consistency nam::wavenet::WaveNet enforces, plus our kernel limits.
+          const int expectIn = ai == 0 ? 1 : m->arrays_.back().channels;
+          if (condSize != 1 || a.inSize != expectIn || a.channels <= 0 || a.channels > kMaxWnChannels ||
+              a.headSize <= 0 || a.kernel <= 0 || (ai > 0 && a.channels != m->arrays_.back().headSize))
+          {
+            why = "layer array " + std::to_string(ai) + " shape";
+            return nullptr;
+          }
+          const int C = a.channels;
+          const int P = pad4(C);
+          a.stride = P;
+          a.inStride = ai == 0 ? 1 : m->arrays_.back().stride;
+          if (ai > 0)
+            m->arrays_.back().headStride = P;
+
+          // Conv1x1 (in -> C), rows padded to P.
+          a.rechannel.assign((size_t)a.inSize * P, 0.0f);
+          for (int i = 0; i < C; i++)
+            for (int j = 0; j < a.inSize; j++)
+              a.rechannel[(size_t)j * P + i] = rd.next();
+
+          // Gated convs put the sigmoid half at row P + i.
+          const int Z = a.gated ? 2 * C : C;
+          const int ZP = a.gated ? 2 * P : P;
+          auto row = [&](int i) { return (a.gated && i >= C) ? P + (i - C) : i; };
+          for (const auto &dj : lc.at("dilations"))
+          {
+            WnLayer l;
+            const int dil = dj.get<int>();
+            if (dil <= 0)
+            {
+              why = "dilation " + std::to_string(dil);
+              return nullptr;
+            }
+            l.dilation = (uint32_t)dil;
+            // Conv1D: for out i, for in j, for tap k; then the bias.
+            l.conv.f32.assign((size_t)a.kernel * C * ZP, 0.0f);
+            for (int i = 0; i < Z; i++)
+              for (int j = 0; j < C; j++)
+                for (int k = 0; k < a.kernel; k++)
+                  l.conv.f32[((size_t)k * C + j) * ZP + row(i)] = rd.next();
+            l.convBias.assign((size_t)ZP, 0.0f);
+            for (int i = 0; i < Z; i++)
+              l.convBias[(size_t)row(i)] = rd.next();
+            // Input mixin (condition -> Z), no bias.
+            l.mixin.assign((size_t)ZP, 0.0f);
+            for (int i = 0; i < Z; i++)
+              l.mixin[(size_t)row(i)] = rd.next();
+            // 1x1 (C -> C) with bias.
+            l.w1x1.f32.assign((size_t)C * P, 0.0f);
+            for (int i = 0; i < C; i++)
+              for (int j = 0; j < C; j++)
+                l.w1x1.f32[(size_t)j * P + i] = rd.next();
+            l.b1x1.assign((size_t)P, 0.0f);
+            for (int i = 0; i < C; i++)
+              l.b1x1[(size_t)i] = rd.next();
+            l.conv.convert(precision, ZP);
+            l.w1x1.convert(precision, P);
+
+            const uint32_t span = l.dilation * (uint32_t)(a.kernel - 1);
+            const uint32_t frames = nextPow2(span + maxFrames);
+            l.ring.assign((size_t)frames * P, 0.0f);
+            l.mask = frames - 1;
+            a.receptiveField += (long)span;
+            a.layers.push_back(std::move(l));
+          }
+          if (a.layers.empty())
+          {
+            why = "layer array " + std::to_string(ai) + " has no layers";
+            return nullptr;
+          }
+          rd.matrix(a.headW, a.headSize, C);
+          if (headBias)
+            rd.vector(a.headB, a.headSize);
+
+          bool specialized = false;
+          a.run = pickLayerKernel(precision, C, a.kernel, a.gated, specialized);
+          allSpecialized = allSpecialized && specialized;
+          maxStride = std::max(maxStride, P);
+          shape += (shape.empty() ? "" : ",") + std::to_string(C);
+          m->prewarmSamples_ += a.receptiveField;
+          m->arrays_.push_back(std::move(a));
+        }
+        if (m->arrays_.back().headSize != 1)
+        {
+          why = "final head size " + std::to_string(m->arrays_.back().headSize);
+          return nullptr;
+        }
+        m->headScale_ = rd.next();
+        if (!rd.ok || rd.pos != data.weights.size())
+        {
+          why = "weight count mismatch";
+          return nullptr;
+        }
+
+        for (int i = 0; i < 2; i++)
+        {
+          m->layerOut_[i].assign((size_t)maxFrames * maxStride, 0.0f);
+          m->head_[i].assign((size_t)maxFrames * maxStride, 0.0f);
+        }
+        m->name_ = "wavenet[" + shape + "]" + (allSpecialized ? "" : " generic") + precisionSuffix(precision);
+        return m;
+      }
+
+      void resetAndPrewarm() override
+      {
+        for (auto &a : arrays_)
+          for (auto &l : a.layers)
+            std::fill(l.ring.begin(), l.ring.end(), 0.0f);
+        pos_ = 0;
+        const std::vector<float> zeros(maxFrames_, 0.0f);
+        std::vector<float> sink(maxFrames_);
+        for (long done = 0; done < prewarmSamples_; done += maxFrames_)
+          process(zeros.data(), sink.data(), maxFrames_);
+      }
+
+      void process(const float *in, float *out, uint32_t n) noexcept override
+      {
+        int cur = 0; // layerOut_/head_ index holding the previous array's results
+        for (size_t ai = 0; ai < arrays_.size(); ai++)
+        {
+          WnArray &a = arrays_[ai];
+          const int P = a.stride;
+          const bool last = ai + 1 == arrays_.size();
+
+          // Rechannel the array input into the first layer's ring.
+          WnLayer &first = a.layers.front();
+          const float *src = ai == 0 ? in : layerOut_[cur].data();
+          for (uint32_t t = 0; t < n; t++)
+          {
+            const float *x = src + (size_t)t * a.inStride;
+            float *dst = first.ring.data() + (size_t)((pos_ + t) & first.mask) * P;
+            for (int v = 0; v < P; v += 4)
+            {
+              f32x4 acc{};
+              for (int j = 0; j < a.inSize; j++)
+                acc += load4(a.rechannel.data() + (size_t)j * P + v) * x[j];
+              store4(dst + v, acc);
+            }
+          }
+
+          // Head sum: zero for the first array, the previous array's head output after that.
+          float *head = head_[cur].data();
+          if (ai == 0)
+            std::fill(head, head + (size_t)n * P, 0.0f);
+
+          float *arrayOut = layerOut_[cur ^ 1].data();
+          for (size_t li = 0; li < a.layers.size(); li++)
+          {
+            // The final array's last layer feeds nothing; only its head sum is used.
+            float *next = nullptr;
+            uint32_t nextPos = 0;
+            uint32_t nextMask = ~0u;
+            if (li + 1 < a.layers.size())
+            {
+              next = a.layers[li + 1].ring.data();
+              nextPos = pos_;
+              nextMask = a.layers[li + 1].mask;
+            }
+            else if (!last)
+            {
+              next = arrayOut;
+            }
+            a.run(a, a.layers[li], in, head, next, nextPos, nextMask, pos_, n);
+          }
+
+          // Head 1x1 (C -> headSize) into the other head buffer, laid out for the next array.
+          float *headOut = head_[cur ^ 1].data();
+          const int H = a.headSize;
+          const int HS = a.headStride;
+          for (uint32_t t = 0; t < n; t++)
+          {
+            const float *x = head + (size_t)t * P;
+            float *o = headOut + (size_t)t * HS;
+            for (int i = 0; i < HS; i++)
+              o[i] = 0.0f;
+            for (int j = 0; j < a.channels; j++)
+            {
+              const float s = x[j];
+              const float *w = a.headW.data() + (size_t)j * H;
+              for (int i = 0; i < H; i++)
+                o[i] += w[i] * s;
+            }
+            if (!a.headB.empty())
+              for (int i = 0; i < H; i++)
+                o[i] += a.headB[(size_t)i];
+          }
+          cur ^= 1;
+        }
+
+        const float *y = head_[cur].data();
+        for (uint32_t t = 0; t < n; t++)
+          out[t] = headScale_ * y[t];
+        pos_ += n;
+      }
+
+    private:
+      WaveNetInference() = default;
+
+      std::vector<WnArray> arrays_;
+      float headScale_ = 1.0f;
+      long prewarmSamples_ = 1;
+      uint32_t pos_ = 0;               // frames processed; ring slot = (pos_ + t) & mask
+      std::vector<float> layerOut_[2]; // [frame][P] last-layer outputs between arrays
+      std::vector<float> head_[2];     // [frame][P] head sums / head outputs, ping-pong
+    };
+
+    // -------------------- LSTM --------------------
+
+    struct LstmCell
+    {
+      int in = 1;
+      int hidden = 0;
+      QWeights w;            // [j][i], 4H rows (i, f, g, o gates) x (in + H) columns
+      std::vector<float> b;  // 4H
+      std::vector<float> h0; // initial state from the weights
+      std::vector<float> c0;
+      std::vector<float> xh; // [x | h]
+      std::vector<float> c;
+    };
+
+    template <int HT, bool Fast, typename W>
+    float lstmSample(std::vector<LstmCell> &cells, const std::vector<float> &headW, float headB, float x) noexcept
+    {
+      const float *input = &x;
+      for (LstmCell &cell : cells)
+      {
+        const int H = HT ? HT : cell.hidden;
+        constexpr int kGV = HT ? HT : kMaxLstmHidden; // 4H gates = H vectors
+        float *__restrict xh = cell.xh.data();
+        for (int j = 0; j < cell.in; j++)
+          xh[j] = input[j];
+
+        f32x4 gv[kGV];
+        for (int v = 0; v < H; v++)
+          gv[v] = f32x4{};
+        const W *__restrict w = cell.w.template data<W>();
+        const int cols = cell.in + H;
+        for (int j = 0; j < cols; j++, w += 4 * H)
+        {
+          const float s = xh[j];
+          for (int v = 0; v < H; v++)
+            gv[v] += loadW(w + 4 * v) * s;
+        }
+        if constexpr (std::is_same_v<W, int8_t>)
+        {
+          for (int v = 0; v < H; v++)
+            gv[v] *= load4(cell.w.scale.data() + 4 * v);
+        }
+        const float *__restrict b = cell.b.data();
+        alignas(16) float g[4 * kGV];
+        for (int v = 0; v < H; v++)
+          store4(g + 4 * v, gv[v] + load4(b + 4 * v));
+
+        float *__restrict c = cell.c.data();
+        float *__restrict h = xh + cell.in;
+        for (int i = 0; i < H; i++)
+        {
+          if constexpr (Fast)
+            c[i] = fastSigmoid(g[H + i]) * c[i] + fastSigmoid(g[i]) * fastTanh(g[2 * H + i]);
+          else
+            c[i] = sigmoid(g[H + i]) * c[i] + sigmoid(g[i]) * std::tanh(g[2 * H + i]);
+        }
+        for (int i = 0; i < H; i++)
+        {
+          if constexpr (Fast)
+            h[i] = fastSigmoid(g[3 * H + i]) * fastTanh(c[i]);
+          else
+            h[i] = sigmoid(g[3 * H + i]) * std::tanh(c[i]);
+        }
+        input = h;
+      }
+
+      const int H = (int)headW.size();
+      float y = 0.0f;
+      for (int i = 0; i < H; i++)
+        y += headW[(size_t)i] * input[i];
+      return y + headB;
+    }
+
+    using LstmFn = float (*)(std::vector<LstmCell> &, const std::vector<float> &, float, float) noexcept;
+
+    template <bool Fast, typename W>
+    LstmFn pickLstmKernel(int hidden, bool &specialized)
+    {
+      specialized = true;
+      switch (hidden)
+      {
+      case 8:
+        return lstmSample<8, Fast, W>;
+      case 12:
+        return lstmSample<12, Fast, W>;
+      case 16:
+        return lstmSample<16, Fast, W>;
+      case 24:
+        return lstmSample<24, Fast, W>;
+      case 32:
+        return lstmSample<32, Fast, W>;
+      default:
+        specialized = false;
+        return lstmSample<0, Fast, W>;
+      }
+    }
+
+    template <bool Fast>
+    LstmFn pickLstmKernel(Precision p, int hidden, bool &specialized)
+    {
+      switch (p)
+      {
+      case Precision::Int8:
+        return pickLstmKernel<Fast, int8_t>(hidden, specialized);
+#ifdef PEDAL_NAM_FP16
+      case Precision::Fp16:
+        return pickLstmKernel<Fast, uint16_t>(hidden, specialized);
+#endif
+      default:
+        return pickLstmKernel<Fast, float>(hidden, specialized);
+      }
+    }
+
+    class LstmInference final : public NamInference
+    {
+    public:
+      static std::unique_ptr<LstmInference> build(const nam::dspData &data, uint32_t maxFrames, bool fast,
+                                                  Precision precision, std::string &why)
+      {
+        auto m = std::unique_ptr<LstmInference>(new LstmInference());
+        m->maxFrames_ = maxFrames;
+        const Json &cfg = data.config;
+        if (!cfg.is_object() || !onlyKeys(cfg, {"num_layers", "input_size", "hidden_size"}, why))
+          return nullptr;
+        const int layers = cfg.at("num_layers").get<int>();
+        const int inSize = cfg.at("input_size").get<int>();
+        const int hidden = cfg.at("hidden_size").get<int>();
+        if (layers <= 0 || inSize != 1 || hidden <= 0 || hidden > kMaxLstmHidden)
+        {
+          why = "LSTM shape";
+          return nullptr;
+        }
+
+        WeightReader rd{data.weights};
+        for (int li = 0; li < layers; li++)
+        {
+          LstmCell cell;
+          cell.in = li == 0 ? inSize : hidden;
+          cell.hidden = hidden;
+          rd.matrix(cell.w.f32, 4 * hidden, cell.in + hidden);
+          cell.w.convert(precision, 4 * hidden);
+          rd.vector(cell.b, 4 * hidden);
+          rd.vector(cell.h0, hidden);
+          rd.vector(cell.c0, hidden);
+          cell.xh.assign((size_t)(cell.in + hidden), 0.0f);
+          cell.c.assign((size_t)hidden, 0.0f);
+          m->cells_.push_back(std::move(cell));
+        }
+        rd.vector(m->headW_, hidden);
+        m->headB_ = rd.next();
+        if (!rd.ok || rd.pos != data.weights.size())
+        {
+          why = "weight count mismatch";
+          return nullptr;
+        }
+
+        bool specialized = false;
+        m->run_ = fast ? pickLstmKernel<true>(precision, hidden, specialized)
+                       : pickLstmKernel<false>(precision, hidden, specialized);
+        // nam::lstm::LSTM primes for half a second at the model's rate.
+        const double sr = data.expected_sample_rate > 0.0 ? data.expected_sample_rate : 48000.0;
+        m->prewarmSamples_ = (long)(sr * 0.5);
+        m->name_ = "lstm[" + std::to_string(layers) + "x" + std::to_string(hidden) + "]" +
+                   (specialized ? "" : " generic") + precisionSuffix(precision);
+        return m;
+      }
+
+      void resetAndPrewarm() override
+      {
+        for (auto &cell : cells_)
+        {
+          std::copy(cell.h0.begin(), cell.h0.end(), cell.xh.begin() + cell.in);
+          cell.c = cell.c0;
+        }
+        const std::vector<float> zeros(maxFrames_, 0.0f);
+        std::vector<float> sink(maxFrames_);
+        for (long done = 0; done < prewarmSamples_; done += maxFrames_)
+          process(zeros.data(), sink.data(), maxFrames_);
+      }
+
+      void process(const float *in, float *out, uint32_t n) noexcept override
+      {
+        for (uint32_t i = 0; i < n; i++)
+          out[i] = run_(cells_, headW_, headB_, in[i]);
+      }
+
+    private:
+      LstmInference() = default;
+
+      std::vector<LstmCell> cells_;
+      std::vector<float> headW_;
+      float headB_ = 0.0f;
+      LstmFn run_ = nullptr;
+      long prewarmSamples_ = 0;
+    };
+
+    // -------------------- nam::DSP --------------------
+
+    class ReferenceInference final : public NamInference
+    {
+    public:
+      ReferenceInference(std::unique_ptr<nam::DSP> model, uint32_t sampleRate, uint32_t maxFrames)
+          : model_(std::move(model)), sampleRate_(sampleRate)
+      {
+        maxFrames_ = maxFrames;
+        name_ = "nam::DSP";
+        expectedSampleRate_ = model_->GetExpectedSampleRate();
+        hasInputLevel_ = model_->HasInputLevel();
+        if (hasInputLevel_)
+          inputLevelDbu_ = model_->GetInputLevel();
+      }
+
+      void resetAndPrewarm() override { model_->ResetAndPrewarm((double)sampleRate_, (int)maxFrames_); }
+
+      void process(const float *in, float *out, uint32_t n) noexcept override
+      {
+        try
+        {
+          // nam::DSP takes a non-const input but only reads it.
+          model_->process(const_cast<float *>(in), out, (int)n);
+        }
+        catch (...)
+        {
+          std::memcpy(out, in, sizeof(float) * n);
+        }
+      }
+
+    private:
+      std::unique_ptr<nam::DSP> model_;
+      uint32_t sampleRate_;
+    };
+
+  } // namespace
+
+  std::unique_ptr<NamInference> NamInference::create(const nam::dspData &data, uint32_t sampleRate,
+                                                      uint32_t maxFrames, const Options &opts, std::string &note)
+  {
+    maxFrames = std::max<uint32_t>(maxFrames, 1);
+    // Without a hardware half convert fp16 weights would cost more than they save; keep fp32.
+    const Precision precision = (opts.precision == Precision::Fp16 && !kHaveFp16) ? Precision::Fp32 : opts.precision;
+    std::string why;
+    std::unique_ptr<NamInference> model;
+    if (opts.engine == Engine::Auto)
+    {
+      try
+      {
+        if (data.architecture == "WaveNet")
+          model = WaveNetInference::build(data, maxFrames, opts.fastTanh, precision, why);
+        else if (data.architecture == "LSTM")
+          model = LstmInference::build(data, maxFrames, opts.fastTanh, precision, why);
+        else
+          why = "architecture " + data.architecture;
+      }
+      catch (const std::exception &e)
+      {
+        // Missing or mistyped config fields: leave the verdict to nam::get_dsp.
+        model.reset();
+        why = std::string("config: ") + e.what();
+      }
+    }
+
+    if (model)
+    {
+      // Same metadata nam::get_dsp applies to the DSP it builds.
+      model->expectedSampleRate_ = data.expected_sample_rate;
+      if (data.metadata.is_object() && data.metadata.contains("input_level_dbu") &&
+          data.metadata["input_level_dbu"].is_number())
+      {
+        model->hasInputLevel_ = true;
+        model->inputLevelDbu_ = data.metadata["input_level_dbu"].get<double>();
+      }
+      note = "NAM: " + model->engineName() + " inference";
+      if (precision != opts.precision)
+        note += " (fp16 weights need F16C or AArch64; using fp32)";
+      return model;
+    }
+
+    // get_dsp takes the data by non-const reference; a copy keeps the caller's (cached) data as is.
+    nam::dspData copy = data;
+    auto dsp = nam::get_dsp(copy);
+    if (!dsp)
+      return nullptr;
+    note = opts.engine == Engine::Reference ? "NAM: nam::DSP inference (requested)"
+                                            : "NAM: nam::DSP inference (" + why + ")";
+    if (opts.precision != Precision::Fp32)
+      note += ", weights stay fp32";
+    return std::make_unique<ReferenceInference>(std::move(dsp), sampleRate, maxFrames);
+  }
+
+} // namespace pedal::dsp
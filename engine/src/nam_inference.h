@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace nam
+{
+  struct dspData;
+}
+
+namespace pedal::dsp
+{
+
+  // A NAM model sized for one maximum block, as nam_model runs it. The standard WaveNet and LSTM
+  // configs get our own inference: every buffer allocated at create(), one ring per dilated conv
+  // (no per-block shifting, no rewinds), and each layer's conv, activation, head sum and 1x1 mix
+  // fused into a single pass per frame, with the channel counts of the common sizes (nano .. standard)
+  // and kernel size 3 fixed at compile time. Anything else (ConvNet, heads, unknown config keys)
+  // runs through the vendored nam::DSP, exactly as before.
+  //
+  // Ours matches nam::DSP to float rounding (summation order differs from Eigen's); the optional
+  // fast tanh is the approximation the NAM plugin ships with and is not bit-compatible. Reduced
+  // precision halves (fp16) or quarters (int8) the weight bytes each block streams through, at an
+  // accuracy cost worth measuring per model (nam_synth_test --compare).
+  class NamInference
+  {
+  public:
+    enum class Engine
+    {
+      Auto,      // ours when the config is supported, nam::DSP otherwise
+      Reference, // always nam::DSP
+    };
+
+    // Storage of the conv, 1x1 and LSTM gate weights (the bulk of a model); arithmetic stays fp32.
+    enum class Precision
+    {
+      Fp32,
+      Fp16, // IEEE half; fp32 unless the build has F16C (x86) or is AArch64
+      Int8, // symmetric, one scale per output channel
+    };
+
+    struct Options
+    {
+      Engine engine = Engine::Auto;
+      bool fastTanh = false; // ours only: NAM's rational tanh (and sigmoid) instead of libm's
+      Precision precision = Precision::Fp32; // ours only
+    };
+
+    virtual ~NamInference() = default;
+
+    // Throws like nam::get_dsp when the model can't be loaded at all. `note` says which engine runs
+    // and, on a fallback, why ours didn't take the model.
+    static std::unique_ptr<NamInference> create(const nam::dspData &data, uint32_t sampleRate, uint32_t maxFrames,
+                                                const Options &opts, std::string &note);
+
+    // Fresh post-load state, then zeros in maxFrames blocks until the receptive field is settled,
+    // like nam::DSP::ResetAndPrewarm. Not RT-safe for the nam::DSP engine.
+    virtual void resetAndPrewarm() = 0;
+
+    // n <= maxFrames. RT-safe; never throws (a throwing nam::DSP passes the input through).
+    virtual void process(const float *in, float *out, uint32_t n) noexcept = 0;
+
+    // e.g. "wavenet[16,8]", "lstm[1x16] int8", "nam::DSP".
+    const std::string &engineName() const { return name_; }
+    uint32_t maxFrames() const { return maxFrames_; }
+
+    double expectedSampleRate() const { return expectedSampleRate_; } // <= 0 = unknown
+    bool hasInputLevel() const { return hasInputLevel_; }
+    double inputLevelDbu() const { return inputLevelDbu_; }
+
+  protected:
+    std::string name_;
+    uint32_t maxFrames_ = 0;
+    double expectedSampleRate_ = -1.0;
+    bool hasInputLevel_ = false;
+    double inputLevelDbu_ = 0.0;
+  };
+
+} // namespace pedal::dsp
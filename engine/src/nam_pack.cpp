@@ -0,0 +1,128 @@
+// nam_pack: convert .nam JSON models to the .namb binary container (see nam_binary.h).
+//
+//   nam_pack model.nam...            writes model.namb next to each input
+//   nam_pack -o out.namb model.nam   explicit output (single input)
+//
+// Each output is read back and checked against the JSON parse (config and weights, bit for bit).
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "get_dsp.h"
+#include "nam_binary.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+static void usage(const char *argv0)
+{
+  std::fprintf(stderr, "Usage: %s [-o <out.namb>] <model.nam>...\n", argv0);
+}
+
+static bool packOne(const std::string &in, const std::string &out)
+{
+  nam::dspData json;
+  auto t0 = Clock::now();
+  try
+  {
+    if (!nam::get_dsp(std::filesystem::path(in), json))
+    {
+      std::fprintf(stderr, "%s: get_dsp returned null\n", in.c_str());
+      return false;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::fprintf(stderr, "%s: %s\n", in.c_str(), e.what());
+    return false;
+  }
+  const double jsonMs = msSince(t0);
+
+  std::string err;
+  if (!pedal::dsp::writeNamBinary(json, out, err))
+  {
+    std::fprintf(stderr, "%s: %s\n", out.c_str(), err.c_str());
+    return false;
+  }
+
+  nam::dspData packed;
+  t0 = Clock::now();
+  try
+  {
+    pedal::dsp::readNamBinary(out, packed);
+  }
+  catch (const std::exception &e)
+  {
+    std::fprintf(stderr, "%s: read back failed: %s\n", out.c_str(), e.what());
+    return false;
+  }
+  const double binMs = msSince(t0);
+
+  const bool same = packed.architecture == json.architecture && packed.version == json.version &&
+                    packed.config == json.config && packed.weights.size() == json.weights.size() &&
+                    std::memcmp(packed.weights.data(), json.weights.data(), json.weights.size() * sizeof(float)) == 0;
+  if (!same)
+  {
+    std::fprintf(stderr, "%s: read back differs from %s\n", out.c_str(), in.c_str());
+    std::remove(out.c_str());
+    return false;
+  }
+
+  std::error_code ec;
+  const auto inBytes = std::filesystem::file_size(in, ec);
+  const auto outBytes = std::filesystem::file_size(out, ec);
+  std::printf("%s -> %s: %s, %zu weights, %.1f -> %.1f KiB, load %.2f ms (json) vs %.2f ms (namb)\n",
+              in.c_str(), out.c_str(), json.architecture.c_str(), json.weights.size(), (double)inBytes / 1024.0,
+              (double)outBytes / 1024.0, jsonMs, binMs);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::string outPath;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string k = argv[i];
+    if (k == "-o" && i + 1 < argc)
+      outPath = argv[++i];
+    else if (k == "-h" || k == "--help")
+    {
+      usage(argv[0]);
+      return 0;
+    }
+    else if (!k.empty() && k[0] == '-')
+    {
+      std::fprintf(stderr, "Unknown arg: %s\n", k.c_str());
+      usage(argv[0]);
+      return 2;
+    }
+    else
+      inputs.push_back(k);
+  }
+  if (inputs.empty() || (!outPath.empty() && inputs.size() != 1))
+  {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int failed = 0;
+  for (const auto &in : inputs)
+  {
+    std::string out = outPath;
+    if (out.empty())
+      out = std::filesystem::path(in).replace_extension(pedal::dsp::kNamBinaryExt).string();
+    if (!packOne(in, out))
+      failed++;
+  }
+  return failed ? 1 : 0;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
@@ -11,6 +12,7 @@
 #include <sndfile.h>
 
 #include "get_dsp.h"
+#include "nam_inference.h"
 
 static inline float clampf(float v, float lo, float hi) { return (v < lo) ? lo : (v > hi) ? hi
                                                                                           : v; }
@@ -30,13 +32,19 @@ struct Args
   float toneHz = 110.0f;
   bool pcm16 = false;
   bool normalize = false;
+  std::string engine = "auto"; // auto | reference
+  bool fastTanh = false;
+  std::string precision = "fp32"; // fp32 | fp16 | int8
+  bool compare = false;
 };
 
 static void usage(const char *argv0)
 {
   std::fprintf(stderr,
                "Usage: %s --model <path.nam> --out <out.wav> [--seconds 5] [--sr 48000] [--block 128] "
-               "[--gain-db -12] [--tone-hz 110] [--pcm16] [--normalize]\n",
+               "[--gain-db -12] [--tone-hz 110] [--pcm16] [--normalize] [--engine auto|reference] [--fast-tanh] "
+               "[--precision fp32|fp16|int8] [--compare]\n"
+               "  --compare also renders through nam::DSP (fp32) and reports the difference\n",
                argv0);
 }
 
@@ -112,6 +120,38 @@ static bool parseArgs(int argc, char **argv, Args &a)
     {
       a.normalize = true;
     }
+    else if (k == "--engine")
+    {
+      const char *v = need("--engine");
+      if (!v)
+        return false;
+      a.engine = v;
+      if (a.engine != "auto" && a.engine != "reference")
+      {
+        std::fprintf(stderr, "--engine must be auto or reference\n");
+        return false;
+      }
+    }
+    else if (k == "--fast-tanh")
+    {
+      a.fastTanh = true;
+    }
+    else if (k == "--precision")
+    {
+      const char *v = need("--precision");
+      if (!v)
+        return false;
+      a.precision = v;
+      if (a.precision != "fp32" && a.precision != "fp16" && a.precision != "int8")
+      {
+        std::fprintf(stderr, "--precision must be fp32, fp16 or int8\n");
+        return false;
+      }
+    }
+    else if (k == "--compare")
+    {
+      a.compare = true;
+    }
     else if (k == "-h" || k == "--help")
     {
       return false;
@@ -213,6 +253,38 @@ static bool writeWavMono(const std::string &path, const std::vector<float> &y, i
   return true;
 }
 
+// Runs x through `model` in blockSize chunks (the last one short). Stops early on SIGINT.
+static std::vector<float> render(pedal::dsp::NamInference &model, const std::vector<float> &x, int blockSize, int sr)
+{
+  std::vector<float> y(x.size());
+  size_t idx = 0;
+  const size_t total = x.size();
+  const size_t reportEvery = (size_t)sr; // ~1 second
+  size_t nextReport = reportEvery;
+
+  while (idx < total)
+  {
+    if (g_shouldStop)
+    {
+      std::fprintf(stderr, "Interrupted; stopping early at %zu/%zu samples\n", idx, total);
+      y.resize(idx);
+      break;
+    }
+
+    const uint32_t n = (uint32_t)std::min(total - idx, (size_t)blockSize);
+    model.process(x.data() + idx, y.data() + idx, n);
+    idx += n;
+
+    if (idx >= nextReport)
+    {
+      const float pct = 100.0f * (float)idx / (float)total;
+      std::fprintf(stderr, "... %zu/%zu samples (%.1f%%)\n", idx, total, pct);
+      nextReport += reportEvery;
+    }
+  }
+  return y;
+}
+
 static void computeStats(const std::vector<float> &y, float &peak, float &rms)
 {
   peak = 0.0f;
@@ -252,55 +324,67 @@ int main(int argc, char **argv)
               (double)a.toneHz);
   std::printf("  wav:   %s%s\n", a.pcm16 ? "pcm16" : "float32", a.normalize ? " normalized" : "");
 
-  auto model = nam::get_dsp(std::filesystem::path(a.modelPath));
-  if (!model)
+  nam::dspData data;
+  if (!nam::get_dsp(std::filesystem::path(a.modelPath), data))
   {
     std::fprintf(stderr, "nam::get_dsp returned null\n");
     return 1;
   }
 
-  model->ResetAndPrewarm((double)a.sampleRate, a.blockSize);
+  using pedal::dsp::NamInference;
+  NamInference::Options opts;
+  opts.engine = a.engine == "reference" ? NamInference::Engine::Reference : NamInference::Engine::Auto;
+  opts.fastTanh = a.fastTanh;
+  opts.precision = a.precision == "int8"   ? NamInference::Precision::Int8
+                   : a.precision == "fp16" ? NamInference::Precision::Fp16
+                                           : NamInference::Precision::Fp32;
+  std::string note;
+  auto model = NamInference::create(data, (uint32_t)a.sampleRate, (uint32_t)a.blockSize, opts, note);
+  if (!model)
+  {
+    std::fprintf(stderr, "nam::get_dsp returned null\n");
+    return 1;
+  }
+  std::printf("  %s\n", note.c_str());
+  model->resetAndPrewarm();
 
   std::vector<float> x;
   makeSynth(x, a.sampleRate, a.seconds, a.toneHz, a.inputGainDb);
 
-  std::vector<float> y(x.size());
-  std::vector<float> in(a.blockSize);
-  std::vector<float> out(a.blockSize);
-
-  // Process in fixed blocks.
-  size_t idx = 0;
-  const size_t total = x.size();
-  const size_t reportEvery = (size_t)a.sampleRate; // ~1 second
-  size_t nextReport = reportEvery;
+  std::vector<float> y = render(*model, x, a.blockSize, a.sampleRate);
 
-  while (idx < total)
+  if (a.compare)
   {
-    if (g_shouldStop)
+    NamInference::Options refOpts;
+    refOpts.engine = NamInference::Engine::Reference;
+    std::string refNote;
+    auto ref = NamInference::create(data, (uint32_t)a.sampleRate, (uint32_t)a.blockSize, refOpts, refNote);
+    if (!ref)
     {
-      std::fprintf(stderr, "Interrupted; stopping early at %zu/%zu samples\n", idx, total);
-      y.resize(idx);
-      break;
+      std::fprintf(stderr, "nam::get_dsp returned null\n");
+      return 1;
     }
-
-    const size_t remain = x.size() - idx;
-    const int n = (int)std::min(remain, (size_t)a.blockSize);
-
-    std::memset(in.data(), 0, sizeof(float) * (size_t)a.blockSize);
-    std::memset(out.data(), 0, sizeof(float) * (size_t)a.blockSize);
-    std::memcpy(in.data(), x.data() + idx, sizeof(float) * (size_t)n);
-
-    model->process(in.data(), out.data(), a.blockSize);
-
-    std::memcpy(y.data() + idx, out.data(), sizeof(float) * (size_t)n);
-    idx += (size_t)n;
-
-    if (idx >= nextReport)
+    ref->resetAndPrewarm();
+    const std::vector<float> yRef = render(*ref, x, a.blockSize, a.sampleRate);
+
+    const size_t n = std::min(y.size(), yRef.size());
+    float maxErr = 0.0f;
+    float refPeak = 0.0f;
+    double errEnergy = 0.0;
+    double refEnergy = 0.0;
+    for (size_t i = 0; i < n; i++)
     {
-      const float pct = 100.0f * (float)idx / (float)total;
-      std::fprintf(stderr, "... %zu/%zu samples (%.1f%%)\n", idx, total, pct);
-      nextReport += reportEvery;
+      const float e = y[i] - yRef[i];
+      maxErr = std::max(maxErr, std::fabs(e));
+      refPeak = std::max(refPeak, std::fabs(yRef[i]));
+      errEnergy += (double)e * (double)e;
+      refEnergy += (double)yRef[i] * (double)yRef[i];
     }
+    const double peakDb = (maxErr > 0.0f && refPeak > 0.0f) ? 20.0 * std::log10((double)maxErr / refPeak) : -INFINITY;
+    const double rmsDb = (errEnergy > 0.0 && refEnergy > 0.0) ? 10.0 * std::log10(errEnergy / refEnergy) : -INFINITY;
+    std::printf("  compare %s vs nam::DSP: max|err|=%.3g (%.1f dB re peak %.4f), error rms %.1f dB re signal, "
+                "over %zu samples\n",
+                model->engineName().c_str(), (double)maxErr, peakDb, (double)refPeak, rmsDb, n);
   }
 
   if (a.normalize && !y.empty())
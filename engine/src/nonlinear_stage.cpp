@@ -0,0 +1,238 @@
+#include "nonlinear_stage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "softclip.h"
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+
+    // Half taps per octave. The first octave sets the passband (~18 kHz at 48 kHz); the second sits
+    // two octaves above the audio and only has to reject images far from it.
+    constexpr int kOctave1HalfTaps = 12;
+    constexpr int kOctave2HalfTaps = 4;
+    constexpr double kKaiserBeta = 7.86; // ~80 dB
+    constexpr double kPi = 3.14159265358979323846;
+
+    double besselI0(double x)
+    {
+      double sum = 1.0;
+      double term = 1.0;
+      const double q = x * x / 4.0;
+      for (int k = 1; k < 64 && term > sum * 1e-17; k++)
+      {
+        term *= q / ((double)k * (double)k);
+        sum += term;
+      }
+      return sum;
+    }
+
+  } // namespace
+
+  void NonlinearStage::HalfBand::init(int halfTaps, uint32_t maxFrames)
+  {
+    // Windowed sinc at a quarter of the upper rate: every even offset but the centre is zero.
+    coef_.assign((size_t)halfTaps, 0.0f);
+    const double span = 2.0 * halfTaps; // window half-length, one past the last tap
+    const double i0Beta = besselI0(kKaiserBeta);
+    double sum = 0.0;
+    std::vector<double> h((size_t)halfTaps);
+    for (int j = 0; j < halfTaps; j++)
+    {
+      const double d = 2.0 * j + 1.0;
+      const double r = d / span;
+      const double sinc = std::sin(kPi * d / 2.0) / (kPi * d / 2.0);
+      h[(size_t)j] = 0.5 * sinc * besselI0(kKaiserBeta * std::sqrt(1.0 - r * r)) / i0Beta;
+      sum += h[(size_t)j];
+    }
+    // Unity DC gain: 0.5 (centre) + 2 * sum == 1.
+    for (int j = 0; j < halfTaps; j++)
+      coef_[(size_t)j] = (float)(h[(size_t)j] * 0.25 / sum);
+
+    hist_ = 2 * (size_t)halfTaps;
+    upBuf_.assign(hist_ + maxFrames, 0.0f);
+    evenBuf_.assign(hist_ + maxFrames, 0.0f);
+    oddBuf_.assign(hist_ + maxFrames, 0.0f);
+    acc_.assign(maxFrames, 0.0f);
+  }
+
+  void NonlinearStage::HalfBand::reset() noexcept
+  {
+    std::fill(upBuf_.begin(), upBuf_.end(), 0.0f);
+    std::fill(evenBuf_.begin(), evenBuf_.end(), 0.0f);
+    std::fill(oddBuf_.begin(), oddBuf_.end(), 0.0f);
+  }
+
+  void NonlinearStage::HalfBand::up(const float *in, float *out, uint32_t n) noexcept
+  {
+    const int k = halfTaps();
+    float *x = upBuf_.data() + hist_;
+    std::memcpy(x, in, sizeof(float) * n);
+
+    // Odd phase: the point halfway between x[i - K] and x[i - K + 1]. The zero-stuffed input has
+    // gain 1/2, hence 2 * h.
+    float *__restrict acc = acc_.data();
+    std::fill(acc, acc + n, 0.0f);
+    for (int j = 0; j < k; j++)
+    {
+      const float c = 2.0f * coef_[(size_t)j];
+      const float *__restrict a = x - k + 1 + j;
+      const float *__restrict b = x - k - j;
+      for (uint32_t i = 0; i < n; i++)
+        acc[i] += c * (a[i] + b[i]);
+    }
+
+    // Even phase: the centre tap, i.e. the input itself K samples late.
+    const float *centre = x - k;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      out[2 * i] = centre[i];
+      out[2 * i + 1] = acc[i];
+    }
+
+    std::memmove(upBuf_.data(), upBuf_.data() + n, sizeof(float) * hist_);
+  }
+
+  void NonlinearStage::HalfBand::down(const float *in, float *out, uint32_t n) noexcept
+  {
+    const int k = halfTaps();
+    float *e = evenBuf_.data() + hist_;
+    float *o = oddBuf_.data() + hist_;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      e[i] = in[2 * i];
+      o[i] = in[2 * i + 1];
+    }
+
+    // Output m is centred on e[m - K + 1]; the odd phase holds all other non-zero taps.
+    float *__restrict acc = acc_.data();
+    const float *centre = e - k + 1;
+    for (uint32_t i = 0; i < n; i++)
+      acc[i] = 0.5f * centre[i];
+    for (int j = 0; j < k; j++)
+    {
+      const float c = coef_[(size_t)j];
+      const float *__restrict a = o - k + 1 + j;
+      const float *__restrict b = o - k - j;
+      for (uint32_t i = 0; i < n; i++)
+        acc[i] += c * (a[i] + b[i]);
+    }
+    std::memcpy(out, acc, sizeof(float) * n);
+
+    std::memmove(evenBuf_.data(), evenBuf_.data() + n, sizeof(float) * hist_);
+    std::memmove(oddBuf_.data(), oddBuf_.data() + n, sizeof(float) * hist_);
+  }
+
+  void NonlinearStage::init(int factor, Curve curve, uint32_t maxFrames)
+  {
+    factor_ = factor >= 4 ? 4 : (factor >= 2 ? 2 : 1);
+    curve_ = curve;
+    maxFrames_ = std::max<uint32_t>(maxFrames, 1);
+
+    latency_ = 0;
+    if (factor_ >= 2)
+    {
+      octave1_.init(kOctave1HalfTaps, maxFrames_);
+      buf2x_.assign(2 * (size_t)maxFrames_, 0.0f);
+      latency_ = 2 * kOctave1HalfTaps - 1;
+    }
+    if (factor_ == 4)
+    {
+      octave2_.init(kOctave2HalfTaps, 2 * maxFrames_);
+      buf4x_.assign(4 * (size_t)maxFrames_, 0.0f);
+      // 2 * K2 - 1 samples at 2x, plus inner_, is K2 base samples.
+      latency_ += kOctave2HalfTaps;
+    }
+    dry_.assign(latency_, 0.0f);
+    reset();
+  }
+
+  void NonlinearStage::reset() noexcept
+  {
+    octave1_.reset();
+    octave2_.reset();
+    inner_ = 0.0f;
+    std::fill(dry_.begin(), dry_.end(), 0.0f);
+    dryPos_ = 0;
+  }
+
+  void NonlinearStage::shape(float *x, uint32_t n, float limit) const noexcept
+  {
+    if (curve_ == Curve::Tanh)
+    {
+      for (uint32_t i = 0; i < n; i++)
+        x[i] = tanhFast(std::clamp(x[i], -limit, limit));
+    }
+    else
+    {
+      for (uint32_t i = 0; i < n; i++)
+        x[i] = softclipFast(std::clamp(x[i], -limit, limit));
+    }
+  }
+
+  void NonlinearStage::processChunk(const float *in, float *out, uint32_t n, float limit) noexcept
+  {
+    if (factor_ == 1)
+    {
+      if (out != in)
+        std::memcpy(out, in, sizeof(float) * n);
+      shape(out, n, limit);
+      return;
+    }
+
+    float *x2 = buf2x_.data();
+    octave1_.up(in, x2, n);
+    if (factor_ == 2)
+    {
+      shape(x2, 2 * n, limit);
+    }
+    else
+    {
+      float *x4 = buf4x_.data();
+      octave2_.up(x2, x4, 2 * n);
+      shape(x4, 4 * n, limit);
+      octave2_.down(x4, x2, 2 * n);
+      const float last = x2[2 * n - 1];
+      std::memmove(x2 + 1, x2, sizeof(float) * (2 * n - 1));
+      x2[0] = inner_;
+      inner_ = last;
+    }
+    octave1_.down(x2, out, n);
+  }
+
+  void NonlinearStage::process(const float *in, float *out, uint32_t n, float limit) noexcept
+  {
+    while (n > 0)
+    {
+      const uint32_t chunk = std::min(n, maxFrames_);
+      processChunk(in, out, chunk, limit);
+      in += chunk;
+      out += chunk;
+      n -= chunk;
+    }
+  }
+
+  void NonlinearStage::delayDry(const float *in, float *out, uint32_t n) noexcept
+  {
+    if (dry_.empty())
+    {
+      if (out != in)
+        std::memcpy(out, in, sizeof(float) * n);
+      return;
+    }
+    const size_t len = dry_.size();
+    for (uint32_t i = 0; i < n; i++)
+    {
+      const float v = in[i];
+      out[i] = dry_[dryPos_];
+      dry_[dryPos_] = v;
+      dryPos_ = (dryPos_ + 1 == len) ? 0 : dryPos_ + 1;
+    }
+  }
+
+} // namespace pedal::dsp
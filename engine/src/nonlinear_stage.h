@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace pedal::dsp
+{
+
+  // Static waveshaper (clamp, then a soft-clip curve) run at 1x, 2x or 4x the base rate so its
+  // harmonics above Nyquist are filtered out instead of folding back. Up/down sampling is a
+  // polyphase half-band FIR per octave (Kaiser, ~-80 dB stopband), so each stage only touches the
+  // odd taps; 4x cascades a short second octave. The loops run tap by tap over the whole block so
+  // the compiler vectorizes them, and the curves are branch-free for the same reason.
+  //
+  // Oversampling delays the output by latency() base samples; delayDry() lines the dry path of a
+  // mix up with it. process() is RT-safe; init() allocates.
+  class NonlinearStage
+  {
+  public:
+    enum class Curve
+    {
+      Cubic, // softclipFast
+      Tanh,  // tanhFast
+    };
+
+    // factor: 1, 2 or 4 (anything else rounds down to one of those).
+    void init(int factor, Curve curve, uint32_t maxFrames);
+    void reset() noexcept;
+
+    int factor() const { return factor_; }
+    uint32_t latency() const { return latency_; }
+
+    // out = curve(clamp(in, +-limit)) at factor() x the rate, back at the base rate. in may alias out.
+    void process(const float *in, float *out, uint32_t n,
+                 float limit = std::numeric_limits<float>::infinity()) noexcept;
+
+    // out = in delayed by latency() samples. in may alias out.
+    void delayDry(const float *in, float *out, uint32_t n) noexcept;
+
+  private:
+    // One octave: 2x up (zero-stuffed, interpolated odd phase) and 2x down (decimated to the even
+    // phase), both with the same half-band. Up delays by K samples of the lower rate, down by K - 1.
+    class HalfBand
+    {
+    public:
+      void init(int halfTaps, uint32_t maxFrames);
+      void reset() noexcept;
+      int halfTaps() const { return (int)coef_.size(); }
+
+      // n samples in, 2n out.
+      void up(const float *in, float *out, uint32_t n) noexcept;
+      // 2n samples in, n out.
+      void down(const float *in, float *out, uint32_t n) noexcept;
+
+    private:
+      std::vector<float> coef_; // h at odd offsets 1, 3, 5, ... from the centre tap (0.5)
+      // [history | block]: up input, and the even/odd phases of the down input.
+      std::vector<float> upBuf_;
+      std::vector<float> evenBuf_;
+      std::vector<float> oddBuf_;
+      std::vector<float> acc_;
+      size_t hist_ = 0;
+    };
+
+    void shape(float *x, uint32_t n, float limit) const noexcept;
+    void processChunk(const float *in, float *out, uint32_t n, float limit) noexcept;
+
+    int factor_ = 1;
+    Curve curve_ = Curve::Cubic;
+    uint32_t maxFrames_ = 0;
+    uint32_t latency_ = 0;
+    HalfBand octave1_;
+    HalfBand octave2_;
+    std::vector<float> buf2x_;
+    std::vector<float> buf4x_;
+    float inner_ = 0.0f; // 4x: one 2x-rate sample of delay so the total stays whole base samples
+    std::vector<float> dry_; // ring of latency_ samples
+    size_t dryPos_ = 0;
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace pedal::dsp
+{
+
+  // One realtime parameter slot. A control thread stores a new target with set() at any time; the
+  // audio thread calls begin() once per block and next() once per sample, which ramps linearly from
+  // the current value to the latest target over rampFrames samples so knob sweeps don't zipper.
+  // Lock-free, one writer and one reader.
+  class RtParam
+  {
+  public:
+    explicit RtParam(float v = 0.0f, uint32_t rampFrames = 0) noexcept { reset(v, rampFrames); }
+
+    RtParam(const RtParam &) = delete;
+    RtParam &operator=(const RtParam &) = delete;
+
+    // Not concurrent with the audio thread: jumps straight to v.
+    void reset(float v, uint32_t rampFrames) noexcept
+    {
+      target_.store(v, std::memory_order_relaxed);
+      goal_ = v;
+      cur_ = v;
+      step_ = 0.0f;
+      ramp_ = rampFrames;
+      left_ = 0;
+    }
+
+    // Any thread.
+    void set(float v) noexcept { target_.store(v, std::memory_order_relaxed); }
+    float target() const noexcept { return target_.load(std::memory_order_relaxed); }
+
+    // Audio thread. Picks up the latest target; a target that moves mid-ramp restarts the ramp
+    // from wherever the value currently is.
+    void begin() noexcept
+    {
+      const float t = target_.load(std::memory_order_relaxed);
+      if (t == goal_)
+        return;
+      goal_ = t;
+      if (ramp_ == 0)
+      {
+        cur_ = t;
+        left_ = 0;
+        return;
+      }
+      step_ = (goal_ - cur_) / (float)ramp_;
+      left_ = ramp_;
+    }
+
+    bool steady() const noexcept { return left_ == 0; }
+    float value() const noexcept { return cur_; }
+
+    float next() noexcept
+    {
+      if (left_ != 0)
+        cur_ = (--left_ == 0) ? goal_ : cur_ + step_;
+      return cur_;
+    }
+
+  private:
+    std::atomic<float> target_{0.0f};
+    float goal_ = 0.0f;
+    float cur_ = 0.0f;
+    float step_ = 0.0f;
+    uint32_t ramp_ = 0;
+    uint32_t left_ = 0;
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,202 @@
+#include "rt_worker_pool.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+    inline void cpuRelax() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    // A job posted at the start of a period normally finishes well inside it; spin that long before
+    // paying for a futex sleep/wake round trip.
+    constexpr int kSpinIterations = 4000;
+
+    thread_local bool tInlineOnly = false; // setInlineOnThisThread
+  } // namespace
+
+  RtWorkerPool::~RtWorkerPool() { stop(); }
+
+  bool RtWorkerPool::start(const Config &cfg)
+  {
+    stop();
+    cfg_ = cfg;
+    stop_.store(false, std::memory_order_relaxed);
+
+    for (int i = 0; i < cfg_.workers; i++)
+    {
+      auto w = std::make_unique<Worker>();
+      Worker *raw = w.get();
+      try
+      {
+        w->thread = std::thread([this, raw, i] { run(*raw, i); });
+      }
+      catch (const std::exception &e)
+      {
+        std::fprintf(stderr, "RT workers: failed to start worker %d: %s\n", i, e.what());
+        break;
+      }
+      workers_.push_back(std::move(w));
+    }
+
+    if (!workers_.empty())
+      std::fprintf(stderr, "RT workers: %zu started (prio=%d)\n", workers_.size(), cfg_.rtPriority);
+    return !workers_.empty();
+  }
+
+  void RtWorkerPool::stop()
+  {
+    if (workers_.empty())
+      return;
+
+    stop_.store(true, std::memory_order_release);
+    for (auto &w : workers_)
+    {
+      // Let the last real job finish, then wake the worker with an empty one so it sees stop_.
+      waitFor((int)(&w - workers_.data()), w->posted.load(std::memory_order_relaxed));
+      w->fn = nullptr;
+      w->arg = nullptr;
+      w->posted.fetch_add(1, std::memory_order_release);
+      w->posted.notify_all();
+    }
+    for (auto &w : workers_)
+    {
+      if (w->thread.joinable())
+        w->thread.join();
+    }
+    workers_.clear();
+  }
+
+  void RtWorkerPool::run(Worker &w, int index)
+  {
+    if (cfg_.threadInit)
+      cfg_.threadInit();
+
+    // post() has a single producer. A job that would post again (a pipeline stage holding a
+    // split-tail convolver) runs its own jobs inline here instead of racing the audio thread.
+    tInlineOnly = true;
+
+    char name[16];
+    std::snprintf(name, sizeof(name), "pedal-rt%d", index);
+    pthread_setname_np(pthread_self(), name);
+
+    if (!cfg_.cpus.empty())
+    {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cfg_.cpus[(size_t)index % cfg_.cpus.size()], &set);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        std::fprintf(stderr, "RT workers: worker %d: failed to pin to cpu %d\n", index,
+                     cfg_.cpus[(size_t)index % cfg_.cpus.size()]);
+    }
+
+    if (cfg_.rtPriority > 0)
+    {
+      sched_param sp{};
+      sp.sched_priority = cfg_.rtPriority;
+      if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) != 0)
+        std::fprintf(stderr, "RT workers: worker %d: SCHED_FIFO failed (continuing): %s\n", index,
+                     std::strerror(errno));
+    }
+
+    uint32_t seen = 0;
+    for (;;)
+    {
+      w.posted.wait(seen, std::memory_order_acquire);
+      const uint32_t ticket = w.posted.load(std::memory_order_acquire);
+
+      if (w.fn)
+        w.fn(w.arg);
+
+      w.finished.store(ticket, std::memory_order_release);
+      w.finished.notify_all();
+      seen = ticket;
+
+      if (stop_.load(std::memory_order_acquire))
+        return;
+    }
+  }
+
+  void RtWorkerPool::setInlineOnThisThread(bool on) noexcept
+  {
+    tInlineOnly = on;
+  }
+
+  uint32_t RtWorkerPool::post(int worker, JobFn fn, void *arg) noexcept
+  {
+    if (tInlineOnly)
+      return 0;
+    if (worker < 0 || worker >= (int)workers_.size() || stop_.load(std::memory_order_relaxed))
+      return 0;
+
+    Worker &w = *workers_[(size_t)worker];
+    const uint32_t last = w.posted.load(std::memory_order_relaxed);
+    if (w.finished.load(std::memory_order_acquire) != last)
+      return 0; // still busy
+
+    uint32_t ticket = last + 1;
+    if (ticket == 0)
+      ticket = 1;
+
+    w.fn = fn;
+    w.arg = arg;
+    w.posted.store(ticket, std::memory_order_release);
+    w.posted.notify_one();
+    return ticket;
+  }
+
+  bool RtWorkerPool::done(int worker, uint32_t ticket) const noexcept
+  {
+    if (ticket == 0 || worker < 0 || worker >= (int)workers_.size())
+      return true;
+    const uint32_t f = workers_[(size_t)worker]->finished.load(std::memory_order_acquire);
+    return (int32_t)(f - ticket) >= 0;
+  }
+
+  void RtWorkerPool::waitFor(int worker, uint32_t ticket) const noexcept
+  {
+    if (done(worker, ticket))
+      return;
+
+    for (int i = 0; i < kSpinIterations; i++)
+    {
+      cpuRelax();
+      if (done(worker, ticket))
+        return;
+    }
+
+    const Worker &w = *workers_[(size_t)worker];
+    for (;;)
+    {
+      const uint32_t f = w.finished.load(std::memory_order_acquire);
+      if ((int32_t)(f - ticket) >= 0)
+        return;
+      w.finished.wait(f, std::memory_order_acquire);
+    }
+  }
+
+  void dropToNormalPriority(const char *who) noexcept
+  {
+    sched_param sp{};
+    if (const int rc = pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp); rc != 0)
+      std::fprintf(stderr, "%s: could not switch to SCHED_OTHER (continuing): %s\n", who, std::strerror(rc));
+  }
+
+} // namespace pedal::dsp
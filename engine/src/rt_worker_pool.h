@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace pedal::dsp
+{
+
+  // Persistent helper threads for the audio thread: SCHED_FIFO, optionally CPU-pinned, one job slot
+  // per worker.
+  //
+  // Only the audio thread posts; post() refuses on worker threads, so whatever a job would offload
+  // runs inline on its worker. Posting is a release store plus a futex wake, finishing a job is the
+  // same in the other direction, so the audio thread never takes a lock. If a worker is still busy
+  // with an earlier job, post() refuses and the caller is expected to run the job inline.
+  class RtWorkerPool
+  {
+  public:
+    using JobFn = void (*)(void *arg) noexcept;
+
+    struct Config
+    {
+      int workers = 1;
+      int rtPriority = 0;             // SCHED_FIFO priority; 0 = leave the default policy
+      std::vector<int> cpus;          // worker i pins to cpus[i % size]; empty = no pinning
+      void (*threadInit)() = nullptr; // runs first on each worker (denormal flags etc.)
+    };
+
+    RtWorkerPool() = default;
+    ~RtWorkerPool();
+
+    RtWorkerPool(const RtWorkerPool &) = delete;
+    RtWorkerPool &operator=(const RtWorkerPool &) = delete;
+
+    // Not realtime-safe. Returns false if no worker could be started.
+    bool start(const Config &cfg);
+    // Not realtime-safe. Lets running jobs finish, then joins.
+    void stop();
+
+    int size() const noexcept { return (int)workers_.size(); }
+
+    // Returns a non-zero ticket for waitFor(), or 0 if the worker is busy or doesn't exist.
+    uint32_t post(int worker, JobFn fn, void *arg) noexcept;
+
+    // For threads besides the audio thread that process chains (standby warming): while set, post()
+    // refuses on the calling thread, so every job runs inline and the workers stay the audio thread's.
+    static void setInlineOnThisThread(bool on) noexcept;
+
+    // True once job `ticket` (and everything posted before it) has finished. Ticket 0 is always done.
+    bool done(int worker, uint32_t ticket) const noexcept;
+
+    // Blocks until done(worker, ticket): spins briefly, then futex-waits.
+    void waitFor(int worker, uint32_t ticket) const noexcept;
+
+  private:
+    struct Worker
+    {
+      alignas(64) std::atomic<uint32_t> posted{0};
+      alignas(64) std::atomic<uint32_t> finished{0};
+      JobFn fn = nullptr;
+      void *arg = nullptr;
+      std::thread thread;
+    };
+
+    void run(Worker &w, int index);
+
+    Config cfg_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stop_{false};
+  };
+
+  // Threads started after the audio thread went SCHED_FIFO inherit its priority. Background threads
+  // (telemetry, builds, tap writers) call this first to go back to SCHED_OTHER; `who` prefixes the
+  // log line if that fails.
+  void dropToNormalPriority(const char *who) noexcept;
+
+} // namespace pedal::dsp
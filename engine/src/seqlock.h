@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace pedal::dsp
+{
+
+  // Single-writer snapshot cell: the writer never blocks and readers copy the latest complete value
+  // (retrying while a store is in flight).
+  //
+  // The payload lives in relaxed atomic words, so torn copies are discarded by the sequence check
+  // instead of being a data race. Meant for small tables published a few times per second.
+  template <typename T>
+  class Seqlock
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock payload must be trivially copyable");
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  public:
+    Seqlock() = default;
+
+    Seqlock(const Seqlock &) = delete;
+    Seqlock &operator=(const Seqlock &) = delete;
+
+    // Writer only.
+    void store(const T &v) noexcept
+    {
+      uint64_t w[kWords] = {};
+      std::memcpy(w, &v, sizeof(T));
+
+      const uint64_t s = seq_.load(std::memory_order_relaxed);
+      seq_.store(s + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for (size_t i = 0; i < kWords; i++)
+        words_[i].store(w[i], std::memory_order_relaxed);
+      seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // Any thread. False if nothing was stored yet.
+    bool load(T &out) const noexcept
+    {
+      uint64_t w[kWords];
+      for (;;)
+      {
+        const uint64_t s0 = seq_.load(std::memory_order_acquire);
+        if (s0 & 1)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        for (size_t i = 0; i < kWords; i++)
+          w[i] = words_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != s0)
+          continue;
+        if (s0 == 0)
+          return false;
+        std::memcpy(&out, w, sizeof(T));
+        return true;
+      }
+    }
+
+  private:
+    std::atomic<uint64_t> seq_{0}; // odd while a store is in progress
+    std::atomic<uint64_t> words_[kWords] = {};
+  };
+
+} // namespace pedal::dsp
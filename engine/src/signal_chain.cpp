@@ -1,166 +1,643 @@
 #include "signal_chain.h"
 
-#include <chrono>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
-#include <unordered_map>
 #include <utility>
 
+#include "cycle_clock.h"
+#include "rt_worker_pool.h"
+#include "signal_taps.h"
+
 namespace pedal::dsp
 {
 
+  namespace
+  {
+    // Nodes worth a pipeline stage of their own.
+    bool isHeavyNodeType(const std::string &t) { return t == "nam_model" || t == "ir_convolver"; }
+
+    std::atomic<uint64_t> gNextSerial{1};
+  } // namespace
+
   SignalChain::SignalChain(pedal::chain::ChainSpec spec,
                            std::vector<std::unique_ptr<INode>> nodes,
                            ProcessContext ctx)
-      : spec_(std::move(spec)), nodes_(std::move(nodes)), ctx_(ctx)
+      : spec_(std::move(spec)), nodes_(std::move(nodes)), ctx_(ctx),
+        serial_(gNextSerial.fetch_add(1, std::memory_order_relaxed))
   {
-    bufA_.assign(ctx_.maxBlockFrames, 0.0f);
-    bufB_.assign(ctx_.maxBlockFrames, 0.0f);
+    nodeTicks_ = ctx_.nodeTicks;
+    if (nodeTicks_)
+      lastTicks_ = std::vector<std::atomic<uint32_t>>(nodes_.size());
+    if (ctx_.taps)
+      tapOf_.assign(nodes_.size(), -1);
+
+    // Channels into each node: mono until the node that widens the chain (buildChain checks there
+    // is at most one, and that what follows takes stereo).
+    inChannels_.resize(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+      inChannels_[i] = channels_;
+      channels_ = std::max(channels_, std::min(nodes_[i]->outputChannels(), kMaxChannels));
+    }
 
-    if (const char *e = std::getenv("ALSA_NODE_TIMING"))
-      nodeTimingEnabled_ = (std::atoi(e) != 0);
+    setupPipeline();
+    setupArena();
 
-    if (nodeTimingEnabled_)
+    // Bypassed() depends on the scratch binding, so the plan comes last.
+    if (stages_.empty())
+      compile(0, nodes_.size());
+    for (auto &st : stages_)
     {
-      // Precompute node->bucket mapping (non-RT) so the audio thread only does array lookups.
-      std::unordered_map<std::string, uint32_t> typeToBucket;
-      typeToBucket.reserve(nodes_.size());
+      st.stepFirst = steps_.size();
+      compile(st.first, st.last);
+      st.stepLast = steps_.size();
+    }
+  }
 
-      nodeToBucket_.assign(nodes_.size(), 0);
-      for (size_t i = 0; i < nodes_.size(); i++)
+  SignalChain::~SignalChain()
+  {
+    // A worker may still be running this chain's last stage job.
+    for (const auto &st : stages_)
+    {
+      if (st.worker >= 0)
+        ctx_.workers->waitFor(st.worker, st.ticket);
+    }
+  }
+
+  void SignalChain::setupPipeline()
+  {
+    if (!ctx_.workers || ctx_.pipelineStages < 2 || ctx_.workers->size() < 1 || nodes_.size() < 2)
+      return;
+
+    // Start a new stage at every heavy node after the first one, as long as there are workers left.
+    const size_t maxStages = std::min<size_t>(ctx_.pipelineStages, (size_t)ctx_.workers->size() + 1);
+    std::vector<size_t> cuts;
+    bool heavySeen = false;
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+      if (!isHeavyNodeType(nodes_[i]->type()))
+        continue;
+      if (heavySeen && cuts.size() + 1 < maxStages)
+        cuts.push_back(i);
+      heavySeen = true;
+    }
+    if (cuts.empty())
+      return;
+
+    cuts.push_back(nodes_.size());
+    stages_.resize(cuts.size());
+    size_t first = 0;
+    for (size_t k = 0; k < stages_.size(); k++)
+    {
+      Stage &st = stages_[k];
+      st.chain = this;
+      st.first = first;
+      st.last = cuts[k];
+      st.worker = (k + 1 < stages_.size()) ? (int)k : -1;
+      st.inChannels = inChannels_[st.first];
+      first = st.last;
+    }
+
+    // rings_[k] feeds stage k; stage 0 is fed by the audio thread. Slot buffers and priming come
+    // with the arena.
+    rings_.resize(stages_.size());
+    for (size_t k = 0; k < rings_.size(); k++)
+      rings_[k] = std::make_unique<SpscRing<PipeBlock>>(4);
+  }
+
+  void SignalChain::setupArena()
+  {
+    // Per stage (the whole chain when serial): two ping-pong buffers, a block per channel the stage
+    // carries, plus one scratch region shared by the stage's nodes, which never run at the same time.
+    // Then the pipeline ring slots, as wide as the stage they feed. Stages do run concurrently, so
+    // they don't share.
+    const size_t block = ctx_.maxBlockFrames;
+    struct Layout
+    {
+      size_t a, b, scratch;
+      uint32_t channels;
+    };
+    std::vector<Layout> layout(pipelineStages());
+    for (size_t k = 0; k < layout.size(); k++)
+    {
+      const size_t first = stages_.empty() ? 0 : stages_[k].first;
+      const size_t last = stages_.empty() ? nodes_.size() : stages_[k].last;
+      size_t scratch = 0;
+      uint32_t channels = 1;
+      for (size_t i = first; i < last; i++)
       {
-        const std::string &t = nodes_[i]->type();
-        auto it = typeToBucket.find(t);
-        if (it == typeToBucket.end())
-        {
-          const uint32_t idx = (uint32_t)timingTypes_.size();
-          timingTypes_.push_back(t);
-          typeToBucket.emplace(timingTypes_.back(), idx);
-          it = typeToBucket.find(timingTypes_.back());
-        }
-        nodeToBucket_[i] = it->second;
+        scratch = std::max(scratch, nodes_[i]->scratchFloats());
+        channels = std::max({channels, inChannels_[i], std::min(nodes_[i]->outputChannels(), kMaxChannels)});
+      }
+
+      layout[k].channels = channels;
+      layout[k].a = arena_.reserve(block * channels);
+      layout[k].b = arena_.reserve(block * channels);
+      layout[k].scratch = scratch ? arena_.reserve(scratch) : 0;
+    }
+
+    std::vector<std::vector<size_t>> slots(rings_.size());
+    for (size_t k = 0; k < rings_.size(); k++)
+      rings_[k]->forEachSlot([&](PipeBlock &) { slots[k].push_back(arena_.reserve(block * stages_[k].inChannels)); });
+
+    const size_t stereoOut = channels_ > 1 ? arena_.reserve(block * channels_) : 0;
+
+    arena_.commit();
+
+    for (size_t k = 0; k < layout.size(); k++)
+    {
+      const size_t first = stages_.empty() ? 0 : stages_[k].first;
+      const size_t last = stages_.empty() ? nodes_.size() : stages_[k].last;
+      for (size_t i = first; i < last; i++)
+      {
+        if (nodes_[i]->scratchFloats() > 0)
+          nodes_[i]->bindScratch(arena_.at(layout[k].scratch));
       }
 
-      timingBuckets_.assign(timingTypes_.size(), TimingBucket{});
+      float **a = stages_.empty() ? bufA_ : stages_[k].bufA;
+      float **b = stages_.empty() ? bufB_ : stages_[k].bufB;
+      for (uint32_t c = 0; c < layout[k].channels; c++)
+      {
+        a[c] = arena_.at(layout[k].a) + c * block;
+        b[c] = arena_.at(layout[k].b) + c * block;
+      }
     }
+
+    if (channels_ > 1)
+      for (uint32_t c = 0; c < channels_; c++)
+        stereoOut_[c] = arena_.at(stereoOut) + c * block;
+
+    for (size_t k = 0; k < rings_.size(); k++)
+    {
+      size_t j = 0;
+      rings_[k]->forEachSlot([&](PipeBlock &b)
+                             {
+                               float *p = arena_.at(slots[k][j++]);
+                               for (uint32_t c = 0; c < stages_[k].inChannels; c++)
+                                 b.data[c] = p + c * block; });
+      if (k > 0)
+      {
+        PipeBlock *b = rings_[k]->writeSlot();
+        b->frames = ctx_.maxBlockFrames;
+        rings_[k]->publish();
+      }
+    }
+  }
+
+  void SignalChain::idle() noexcept
+  {
+    // Worker stages idle their nodes themselves, right after processing (see runStage).
+    const size_t first = stages_.empty() ? 0 : stages_.back().first;
+    for (size_t i = first; i < nodes_.size(); i++)
+      nodes_[i]->idle();
+  }
+
+  bool SignalChain::updateNodeParams(const pedal::chain::NodeSpec &node)
+  {
+    // Nodes are built 1:1 from spec_.chain.
+    for (size_t i = 0; i < nodes_.size() && i < spec_.chain.size(); i++)
+    {
+      auto &ns = spec_.chain[i];
+      if (ns.id != node.id)
+        continue;
+      const bool sameAsset = ns.asset.has_value() == node.asset.has_value() &&
+                             (!ns.asset || ns.asset->path == node.asset->path);
+      if (ns.type != node.type || !sameAsset || !nodes_[i]->updateParams(node))
+        return false;
+      ns = node;
+      return true;
+    }
+    return false;
   }
 
-  size_t SignalChain::snapshotNodeTiming(NodeTimingStat *out, size_t cap, bool reset) noexcept
+  void SignalChain::refreshTaps() noexcept
   {
-    if (!nodeTimingEnabled_ || !out || cap == 0)
+    tapping_ = ctx_.taps && ctx_.taps->any() && ctx_.taps->live(serial_);
+    if (!tapping_)
+      return;
+    const uint32_t gen = ctx_.taps->generation();
+    if (gen == tapGen_)
+      return;
+    tapGen_ = gen;
+    for (size_t i = 0; i < nodes_.size(); i++)
+    {
+      const std::string &id = nodes_[i]->id();
+      tapOf_[i] = (int8_t)ctx_.taps->find(id.data(), id.size());
+    }
+  }
+
+  size_t SignalChain::copyNodeTicks(uint32_t *out, size_t cap) const noexcept
+  {
+    if (!nodeTicks_ || !out)
       return 0;
-    const size_t n = std::min(cap, timingBuckets_.size());
+    const size_t n = std::min(cap, lastTicks_.size());
     for (size_t i = 0; i < n; i++)
+      out[i] = lastTicks_[i].load(std::memory_order_relaxed);
+    return n;
+  }
+
+  void SignalChain::compile(size_t first, size_t last)
+  {
+    // Plain plan: every node, in order (ALSA_CHAIN_COMPILE=0, for A/B comparisons).
+    bool fold = true;
+    if (const char *e = std::getenv("ALSA_CHAIN_COMPILE"))
+      fold = (std::atoi(e) != 0);
+
+    // The node that widens the chain stays in the plan even when bypassed: its copy to every channel
+    // is what the nodes after it expect. Mono-only nodes after it are disabled (buildChain checks),
+    // so they are always left out.
+    auto widens = [&](size_t i) { return std::min(nodes_[i]->outputChannels(), kMaxChannels) > inChannels_[i]; };
+    auto skip = [&](size_t i)
+    {
+      if (inChannels_[i] > 1 && !nodes_[i]->acceptsStereo())
+        return true;
+      return fold && nodes_[i]->bypassed() && !widens(i);
+    };
+    auto nodeStep = [&](size_t i)
+    {
+      Step s;
+      s.node = (uint32_t)i;
+      s.channels = inChannels_[i];
+      s.outChannels = std::max(s.channels, std::min(nodes_[i]->outputChannels(), kMaxChannels));
+      return s;
+    };
+
+    for (size_t i = first; i < last;)
     {
-      out[i].type = timingTypes_[i].c_str();
-      out[i].calls = timingBuckets_[i].calls;
-      out[i].sumUs = timingBuckets_[i].sumUs;
-      out[i].maxUs = timingBuckets_[i].maxUs;
-      if (reset)
+      if (skip(i))
+      {
+        i++;
+        continue;
+      }
+
+      if (!fold || !nodes_[i]->scalesOnly())
+      {
+        steps_.push_back(nodeStep(i));
+        i++;
+        continue;
+      }
+
+      // A run of gain stages, bypassed nodes in between don't break it.
+      Step s;
+      s.kind = Step::kGain;
+      s.channels = s.outChannels = inChannels_[i];
+      s.gainFirst = (uint32_t)gainNodes_.size();
+      for (; i < last && (skip(i) || nodes_[i]->scalesOnly()); i++)
+      {
+        if (!skip(i))
+          gainNodes_.push_back((uint32_t)i);
+      }
+      s.gainLast = (uint32_t)gainNodes_.size();
+
+      // ...which the next node may take into its own input loop.
+      if (i < last && s.channels == 1 && inChannels_[i] == 1 && nodes_[i]->foldsInputGain())
       {
-        timingBuckets_[i].calls = 0;
-        timingBuckets_[i].sumUs = 0;
-        timingBuckets_[i].maxUs = 0;
+        s.kind = Step::kScaled;
+        s.node = (uint32_t)i;
+        i++;
       }
+      steps_.push_back(s);
     }
-    return n;
   }
 
-  void SignalChain::process(const float *in, float *out, uint32_t nframes) noexcept
+  bool SignalChain::foldedGain(const Step &s, float &gain) noexcept
   {
-    const uint32_t frames = (nframes <= ctx_.maxBlockFrames) ? nframes : ctx_.maxBlockFrames;
-    if (nodes_.empty())
+    float g = 1.0f;
+    for (uint32_t k = s.gainFirst; k < s.gainLast; k++)
     {
-      if (out != in)
-        std::memcpy(out, in, sizeof(float) * nframes);
-      return;
+      float gk = 1.0f;
+      if (!nodes_[gainNodes_[k]]->steadyGain(gk))
+        return false;
+      g *= gk;
     }
+    gain = g;
+    return true;
+  }
 
-    float *a = bufA_.data();
-    float *b = bufB_.data();
+  void SignalChain::runSteps(size_t first, size_t last, const float *const *in, uint32_t inChannels,
+                             float *const *out, uint32_t outChannels, uint32_t frames, float *const *a,
+                             float *const *b) noexcept
+  {
+    // Every step reads src and writes the ping-pong buffer src isn't in; the last one writes out.
+    // Buffers hold one block per channel; ch is the number src currently carries.
+    const float *src[kMaxChannels] = {in[0], inChannels > 1 ? in[1] : in[0]};
+    uint32_t ch = inChannels;
+    auto dstFor = [&](bool toOut) -> float *const *
+    { return toOut ? out : (src[0] == a[0] ? b : a); };
+    auto advance = [&](float *const *dst, uint32_t n)
+    {
+      for (uint32_t c = 0; c < n; c++)
+        src[c] = dst[c];
+      ch = n;
+    };
+    // A node's output into its tap. Gain nodes merged into a run all record the run's output.
+    auto tap = [&](uint32_t node, uint32_t n, float scale)
+    {
+      if (tapOf_[node] >= 0)
+        ctx_.taps->push(tapOf_[node], src, n, frames, scale);
+    };
 
-    if (!nodeTimingEnabled_)
+    // A gain run whose parameters are ramping this block: its nodes one by one.
+    auto runGainNodes = [&](const Step &s, bool toOut)
     {
-      // Node 0: in -> a
-      nodes_[0]->process(in, a, frames);
-      for (size_t i = 1; i < nodes_.size(); i++)
+      for (uint32_t k = s.gainFirst; k < s.gainLast; k++)
       {
-        nodes_[i]->process(a, b, frames);
-        std::swap(a, b);
+        float *const *dst = dstFor(toOut && k + 1 == s.gainLast);
+        if (ch == 1)
+          nodes_[gainNodes_[k]]->process(src[0], dst[0], frames);
+        else
+          nodes_[gainNodes_[k]]->processChannels(src, ch, dst, frames);
+        advance(dst, ch);
+        if (tapping_)
+          tap(gainNodes_[k], ch, 1.0f);
       }
-    }
-    else
+    };
+
+    for (size_t k = first; k < last; k++)
     {
-      using Clock = std::chrono::steady_clock;
+      const Step &s = steps_[k];
+      const bool lastStep = (k + 1 == last);
+      const uint64_t t0 = nodeTicks_ ? cycleCount() : 0;
 
-      // Node 0: in -> a
+      float g = 1.0f;
+      switch (s.kind)
+      {
+      case Step::kNode:
+      {
+        float *const *dst = dstFor(lastStep);
+        if (s.outChannels == 1)
+          nodes_[s.node]->process(src[0], dst[0], frames);
+        else
+          nodes_[s.node]->processChannels(src, s.channels, dst, frames);
+        advance(dst, s.outChannels);
+        if (tapping_)
+          tap(s.node, ch, 1.0f);
+        break;
+      }
+      case Step::kGain:
       {
-        const auto t0 = Clock::now();
-        nodes_[0]->process(in, a, frames);
-        const auto t1 = Clock::now();
-        const uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
-        const uint32_t bi = nodeToBucket_.empty() ? 0u : nodeToBucket_[0];
-        if (bi < timingBuckets_.size())
+        const bool folded = foldedGain(s, g);
+        if (!folded)
         {
-          auto &bkt = timingBuckets_[bi];
-          bkt.calls++;
-          bkt.sumUs += us;
-          if (us > bkt.maxUs)
-            bkt.maxUs = us;
+          runGainNodes(s, lastStep);
         }
+        else if (g != 1.0f)
+        {
+          float *const *dst = dstFor(lastStep);
+          for (uint32_t c = 0; c < ch; c++)
+          {
+            const float *x = src[c];
+            float *y = dst[c];
+            for (uint32_t i = 0; i < frames; i++)
+              y[i] = x[i] * g;
+          }
+          advance(dst, ch);
+        }
+        if (tapping_ && folded)
+        {
+          for (uint32_t j = s.gainFirst; j < s.gainLast; j++)
+            tap(gainNodes_[j], ch, 1.0f);
+        }
+        break;
       }
-
-      for (size_t i = 1; i < nodes_.size(); i++)
+      case Step::kScaled:
       {
-        const auto t0 = Clock::now();
-        nodes_[i]->process(a, b, frames);
-        const auto t1 = Clock::now();
-        const uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
-        const uint32_t bi = nodeToBucket_.empty() ? 0u : nodeToBucket_[i];
-        if (bi < timingBuckets_.size())
+        // Mono only (see compile).
+        if (!foldedGain(s, g))
         {
-          auto &bkt = timingBuckets_[bi];
-          bkt.calls++;
-          bkt.sumUs += us;
-          if (us > bkt.maxUs)
-            bkt.maxUs = us;
+          runGainNodes(s, false);
+          g = 1.0f;
         }
-        std::swap(a, b);
+        else if (tapping_)
+        {
+          // The run's output is the node's input times g; it never exists as a buffer.
+          for (uint32_t j = s.gainFirst; j < s.gainLast; j++)
+            tap(gainNodes_[j], 1, g);
+        }
+        float *const *dst = dstFor(lastStep);
+        nodes_[s.node]->processScaled(src[0], g, dst[0], frames);
+        advance(dst, 1);
+        if (tapping_)
+          tap(s.node, 1, 1.0f);
+        break;
+      }
+      }
+
+      if (nodeTicks_)
+      {
+        const uint64_t ticks = cycleCount() - t0;
+        const uint32_t owner = (s.kind == Step::kGain) ? gainNodes_[s.gainFirst] : s.node;
+        lastTicks_[owner].store((uint32_t)std::min<uint64_t>(ticks, UINT32_MAX), std::memory_order_relaxed);
       }
     }
 
-    if (a != out)
-      std::memcpy(out, a, sizeof(float) * frames);
+    // Empty plan, or a unity gain run at the end. A mono src fills every output channel.
+    for (uint32_t c = 0; c < outChannels; c++)
+    {
+      const float *from = src[std::min(c, ch - 1)];
+      if (from != out[c])
+        std::memcpy(out[c], from, sizeof(float) * frames);
+    }
+  }
 
-    // Safety: if caller ever provides more frames than our internal buffers, passthrough the tail.
+  void SignalChain::process(const float *in, float *out, uint32_t nframes) noexcept
+  {
+    if (channels_ == 1)
+    {
+      float *o[1] = {out};
+      process(in, o, nframes);
+      return;
+    }
+
+    // Mono view of a stereo chain.
+    const uint32_t frames = (nframes <= ctx_.maxBlockFrames) ? nframes : ctx_.maxBlockFrames;
+    process(in, stereoOut_, frames);
+    const float *l = stereoOut_[0];
+    const float *r = stereoOut_[1];
+    for (uint32_t i = 0; i < frames; i++)
+      out[i] = 0.5f * (l[i] + r[i]);
     if (frames < nframes)
       std::memcpy(out + frames, in + frames, sizeof(float) * (nframes - frames));
   }
 
+  void SignalChain::process(const float *in, float *const *out, uint32_t nframes) noexcept
+  {
+    const uint32_t frames = (nframes <= ctx_.maxBlockFrames) ? nframes : ctx_.maxBlockFrames;
+    if (nodes_.empty())
+    {
+      if (out[0] != in)
+        std::memcpy(out[0], in, sizeof(float) * nframes);
+      return;
+    }
+
+    if (!stages_.empty())
+    {
+      processPipelined(in, out, frames);
+    }
+    else
+    {
+      refreshTaps();
+      runSteps(0, steps_.size(), &in, 1, out, channels_, frames, bufA_, bufB_);
+    }
+
+    // Safety: if caller ever provides more frames than our internal buffers, passthrough the tail.
+    if (frames < nframes)
+      for (uint32_t c = 0; c < channels_; c++)
+        std::memcpy(out[c] + frames, in + frames, sizeof(float) * (nframes - frames));
+  }
+
+  void SignalChain::stageJob(void *arg) noexcept
+  {
+    Stage *st = static_cast<Stage *>(arg);
+    st->chain->runStage(*st);
+  }
+
+  void SignalChain::runStage(Stage &st) noexcept
+  {
+    const size_t k = (size_t)(&st - stages_.data());
+    auto &src = *rings_[k];
+    auto &dst = *rings_[k + 1];
+
+    PipeBlock *in = src.readSlot();
+    if (!in)
+      return;
+    PipeBlock *out = dst.writeSlot();
+    if (out)
+    {
+      runSteps(st.stepFirst, st.stepLast, in->data, st.inChannels, out->data, stages_[k + 1].inChannels,
+               in->frames, st.bufA, st.bufB);
+      out->frames = in->frames;
+      dst.publish();
+    }
+    src.consume();
+
+    // Between blocks for these nodes, on the thread that owns them.
+    for (size_t i = st.first; i < st.last; i++)
+      nodes_[i]->idle();
+  }
+
+  void SignalChain::processPipelined(const float *in, float *const *out, uint32_t frames) noexcept
+  {
+    // Last period's stage jobs normally finished long ago; this keeps every ring at a known depth.
+    for (const auto &st : stages_)
+    {
+      if (st.worker >= 0)
+        ctx_.workers->waitFor(st.worker, st.ticket);
+    }
+    // No stage is running now, so the workers see this period's tap lookup.
+    refreshTaps();
+
+    if (PipeBlock *b = rings_[0]->writeSlot())
+    {
+      std::memcpy(b->data[0], in, sizeof(float) * frames);
+      b->frames = frames;
+      rings_[0]->publish();
+    }
+
+    // Worker stages; a worker still busy (e.g. finishing a previous chain's job) means run inline.
+    for (auto &st : stages_)
+    {
+      if (st.worker < 0)
+        continue;
+      st.ticket = ctx_.workers->post(st.worker, &SignalChain::stageJob, &st);
+      if (st.ticket == 0)
+        runStage(st);
+    }
+
+    // Final stage on the audio thread, on the block the previous stage finished last period.
+    Stage &last = stages_.back();
+    auto &src = *rings_.back();
+    PipeBlock *b = src.readSlot();
+    if (!b)
+    {
+      for (uint32_t c = 0; c < channels_; c++)
+        std::memset(out[c], 0, sizeof(float) * frames);
+      return;
+    }
+    const uint32_t n = std::min(frames, b->frames);
+    if (n < frames)
+      for (uint32_t c = 0; c < last.inChannels; c++)
+        std::memset(b->data[c] + n, 0, sizeof(float) * (frames - n));
+    runSteps(last.stepFirst, last.stepLast, b->data, last.inChannels, out, channels_, frames,
+             last.bufA, last.bufB);
+    src.consume();
+  }
+
   std::optional<BuildChainResult> buildChain(const pedal::chain::ChainSpec &spec,
                                              const ProcessContext &ctx,
-                                             std::string &err)
+                                             std::string &err,
+                                             const BuildChainOptions &opts)
   {
+    const size_t total = spec.chain.size();
+    std::vector<std::optional<NodeBuildResult>> built(total);
+    std::vector<std::string> errors(total);
+    std::atomic<size_t> done{0};
+    std::atomic<bool> cancelled{false};
+
+    auto buildOne = [&](size_t i)
+    {
+      if (opts.cancel && opts.cancel->load(std::memory_order_relaxed))
+      {
+        cancelled.store(true, std::memory_order_relaxed);
+        return;
+      }
+      built[i] = buildNode(spec.chain[i], ctx, errors[i]);
+      const size_t n = done.fetch_add(1, std::memory_order_relaxed) + 1;
+      if (opts.progress)
+        opts.progress(n, total);
+    };
+    if (opts.parallelFor)
+      opts.parallelFor(total, buildOne);
+    else
+      for (size_t i = 0; i < total; i++)
+        buildOne(i);
+
+    if (cancelled.load(std::memory_order_relaxed))
+    {
+      err = "cancelled";
+      return std::nullopt;
+    }
+
     std::vector<std::unique_ptr<INode>> nodes;
-    nodes.reserve(spec.chain.size());
+    nodes.reserve(total);
 
     std::string warnings;
 
-    for (const auto &ns : spec.chain)
+    uint32_t channels = 1;
+    for (size_t i = 0; i < total; i++)
     {
-      std::string nodeErr;
-      auto built = buildNode(ns, ctx, nodeErr);
-      if (!built || !built->node)
+      const auto &ns = spec.chain[i];
+      if (!built[i] || !built[i]->node)
       {
-        err = "Failed to build node '" + ns.id + "' (" + ns.type + "): " + nodeErr;
+        err = "Failed to build node '" + ns.id + "' (" + ns.type + "): " + errors[i];
         return std::nullopt;
       }
-      if (!built->warning.empty())
+      if (!built[i]->warning.empty())
       {
         if (!warnings.empty())
           warnings += "\n";
-        warnings += built->warning;
+        warnings += built[i]->warning;
+      }
+
+      // One node may make the chain stereo; everything enabled after it must take stereo. The spec's
+      // flag, not bypassed(): that also depends on the scratch the chain binds later.
+      const INode &node = *built[i]->node;
+      if (node.outputChannels() > 1)
+      {
+        if (channels > 1)
+        {
+          err = "Node '" + ns.id + "' (" + ns.type + "): the chain is already stereo";
+          return std::nullopt;
+        }
+        channels = node.outputChannels();
+      }
+      else if (channels > 1 && ns.enabled && !node.acceptsStereo())
+      {
+        err = "Node '" + ns.id + "' (" + ns.type + ") is mono-only and can't follow a stereo node";
+        return std::nullopt;
       }
-      nodes.push_back(std::move(built->node));
+      nodes.push_back(std::move(built[i]->node));
     }
 
     BuildChainResult r;
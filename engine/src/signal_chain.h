@@ -1,13 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "chain_arena.h"
 #include "signal_chain_schema.h"
 #include "signal_chain_nodes.h"
+#include "spsc_ring.h"
 
 namespace pedal::dsp
 {
@@ -15,48 +19,130 @@ namespace pedal::dsp
   class SignalChain
   {
   public:
-    struct NodeTimingStat
-    {
-      const char *type = nullptr; // stable for chain lifetime
-      uint64_t calls = 0;
-      uint64_t sumUs = 0;
-      uint64_t maxUs = 0;
-    };
-
     SignalChain(pedal::chain::ChainSpec spec, std::vector<std::unique_ptr<INode>> nodes, ProcessContext ctx);
+    ~SignalChain();
+
+    SignalChain(const SignalChain &) = delete;
+    SignalChain &operator=(const SignalChain &) = delete;
 
     const pedal::chain::ChainSpec &spec() const { return spec_; }
 
-    // Realtime-safe processing
+    // Realtime-safe processing. The input is always mono. A stereo chain (channels() == 2) writes
+    // out[0] / out[1]; through the single-buffer overload it writes their mean.
     void process(const float *in, float *out, uint32_t nframes) noexcept;
-
-    bool nodeTimingEnabled() const noexcept { return nodeTimingEnabled_; }
-    // Copies timing stats into caller-provided buffer. If reset=true, clears counters after snapshot.
-    // Returns number of entries written.
-    size_t snapshotNodeTiming(NodeTimingStat *out, size_t cap, bool reset) noexcept;
+    void process(const float *in, float *const *out, uint32_t nframes) noexcept;
+    // Realtime-safe; between periods (see INode::idle)
+    void idle() noexcept;
+
+    // Control thread: applies an edited spec to the running node with the same id (INode::updateParams)
+    // and records it in spec(). Returns false if there is no such node or the edit needs a rebuild.
+    bool updateNodeParams(const pedal::chain::NodeSpec &node);
+
+    // Unique per chain instance (never reused), so telemetry can tell rebuilds apart.
+    uint64_t serial() const noexcept { return serial_; }
+    size_t nodeCount() const noexcept { return nodes_.size(); }
+    const std::string &nodeId(size_t i) const { return nodes_[i]->id(); }
+    const std::string &nodeType(size_t i) const { return nodes_[i]->type(); }
+
+    // Realtime-safe. With ProcessContext::nodeTicks: each node's cycleCount() ticks in its latest
+    // period, by node index (0 for nodes left out of the plan; a merged gain run counts under its
+    // first node). Pipelined worker stages may still be writing theirs; values are then one period
+    // old. Returns the number of entries written.
+    size_t copyNodeTicks(uint32_t *out, size_t cap) const noexcept;
+    bool nodeTicksEnabled() const noexcept { return nodeTicks_; }
+
+    // Output channels: 1, or 2 after a node that widens the chain (INode::outputChannels).
+    uint32_t channels() const noexcept { return channels_; }
 
     uint32_t sampleRate() const { return ctx_.sampleRate; }
     uint32_t maxBlockFrames() const { return ctx_.maxBlockFrames; }
 
+    // Stages this chain runs as (1 = plain serial processing) and the latency that adds, in periods.
+    size_t pipelineStages() const noexcept { return stages_.empty() ? 1 : stages_.size(); }
+    uint32_t latencyPeriods() const noexcept { return (uint32_t)(pipelineStages() - 1); }
+
+    // Size of the block all per-period buffers live in (see setupArena).
+    size_t arenaBytes() const noexcept { return arena_.bytes(); }
+
   private:
+    // Pipelined mode: stage k runs nodes [first, last) on a block popped from rings_[k] and pushes
+    // the result into rings_[k + 1]. All stages but the last run on workers; the last runs on the
+    // audio thread and writes the output. Rings between stages are primed with one silent block, so
+    // every stage works on the previous stage's output from the previous period.
+    struct PipeBlock
+    {
+      float *data[kMaxChannels] = {}; // arena, one block per channel the next stage takes
+      uint32_t frames = 0;
+    };
+
+    // One entry of the compiled execution plan (see compile()). Bypassed nodes have no step.
+    struct Step
+    {
+      enum Kind
+      {
+        kNode,   // nodes_[node]->process()
+        kGain,   // scalesOnly nodes gainNodes_[gainFirst, gainLast) as one multiply
+        kScaled, // same, folded into nodes_[node]->processScaled()
+      };
+      Kind kind = kNode;
+      uint32_t node = 0;
+      uint32_t gainFirst = 0;
+      uint32_t gainLast = 0;
+      uint32_t channels = 1;    // in
+      uint32_t outChannels = 1; // > channels for the node that widens the chain
+    };
+
+    struct Stage
+    {
+      SignalChain *chain = nullptr;
+      size_t first = 0;
+      size_t last = 0;
+      size_t stepFirst = 0;
+      size_t stepLast = 0;
+      int worker = -1; // -1 = audio thread
+      uint32_t ticket = 0;
+      uint32_t inChannels = 1;
+      float *bufA[kMaxChannels] = {}; // arena
+      float *bufB[kMaxChannels] = {};
+    };
+
+    void setupPipeline();
+    void setupArena();
+    void compile(size_t first, size_t last);
+    bool foldedGain(const Step &s, float &gain) noexcept;
+    void runSteps(size_t first, size_t last, const float *const *in, uint32_t inChannels, float *const *out,
+                  uint32_t outChannels, uint32_t frames, float *const *a, float *const *b) noexcept;
+    void runStage(Stage &st) noexcept;
+    static void stageJob(void *arg) noexcept;
+    void processPipelined(const float *in, float *const *out, uint32_t nframes) noexcept;
+    // Once per period, before any step runs: whether nodes record into ctx_.taps, and which tap.
+    void refreshTaps() noexcept;
+
     pedal::chain::ChainSpec spec_;
     std::vector<std::unique_ptr<INode>> nodes_;
     ProcessContext ctx_;
 
-    std::vector<float> bufA_;
-    std::vector<float> bufB_;
+    ChainArena arena_;
+    float *bufA_[kMaxChannels] = {}; // arena; serial mode
+    float *bufB_[kMaxChannels] = {};
+    float *stereoOut_[kMaxChannels] = {}; // arena; stereo chains behind the mono process()
 
-    struct TimingBucket
-    {
-      uint64_t calls = 0;
-      uint64_t sumUs = 0;
-      uint64_t maxUs = 0;
-    };
+    std::vector<uint32_t> inChannels_; // per node
+    uint32_t channels_ = 1;
 
-    bool nodeTimingEnabled_ = false;
-    std::vector<std::string> timingTypes_;
-    std::vector<TimingBucket> timingBuckets_;
-    std::vector<uint32_t> nodeToBucket_;
+    uint64_t serial_ = 0;
+
+    bool nodeTicks_ = false;                       // ctx_.nodeTicks
+    std::vector<std::atomic<uint32_t>> lastTicks_; // per node; see copyNodeTicks
+
+    bool tapping_ = false;      // this period
+    uint32_t tapGen_ = 0;       // SignalTaps::generation() tapOf_ was looked up for
+    std::vector<int8_t> tapOf_; // per node: tap id, -1 = none
+
+    std::vector<Step> steps_;
+    std::vector<uint32_t> gainNodes_;
+    std::vector<Stage> stages_; // empty = serial
+    std::vector<std::unique_ptr<SpscRing<PipeBlock>>> rings_;
   };
 
   struct BuildChainResult
@@ -65,9 +151,22 @@ namespace pedal::dsp
     std::string warning;
   };
 
+  struct BuildChainOptions
+  {
+    // Calls fn(0) .. fn(n - 1), possibly concurrently, and returns once all of them returned.
+    // Empty = one after the other on the calling thread. Nodes are independent until assembly, so
+    // each index builds one node.
+    std::function<void(size_t n, const std::function<void(size_t)> &fn)> parallelFor;
+    // Checked before each node; once set, the build stops with err = "cancelled".
+    const std::atomic<bool> *cancel = nullptr;
+    // Called after each node with (nodes built so far, total), from the thread that built it.
+    std::function<void(size_t, size_t)> progress;
+  };
+
   // Build a chain (heavy work allowed). Returns nullopt on failure.
   std::optional<BuildChainResult> buildChain(const pedal::chain::ChainSpec &spec,
                                              const ProcessContext &ctx,
-                                             std::string &err);
+                                             std::string &err,
+                                             const BuildChainOptions &opts = {});
 
 } // namespace pedal::dsp
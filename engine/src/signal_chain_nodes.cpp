@@ -9,59 +9,32 @@
 #include <string>
 #include <utility>
 
+#include "asset_cache.h"
 #include "fft_convolver.h"
 #include "get_dsp.h"
 #include "ir_loader.h"
+#include "ir_prep.h"
+#include "ir_spectra_cache.h"
+#include "nam_binary.h"
+#include "nam_inference.h"
+#include "nonlinear_stage.h"
+#include "rt_param.h"
+#include "rt_worker_pool.h"
+#include "softclip.h"
 
 namespace pedal::dsp
 {
 
   static inline float dbToLin(float db) { return std::pow(10.0f, db / 20.0f); }
 
-  class PassthroughNode final : public INode
-  {
-  public:
-    PassthroughNode(std::string id, std::string type, NodeStandardParams sp)
-        : id_(std::move(id)), type_(std::move(type)), std_(sp)
-    {
-    }
-
-    const std::string &id() const override { return id_; }
-    const std::string &type() const override { return type_; }
-
-    void process(const float *in, float *out, uint32_t nframes) noexcept override
-    {
-      if (!std_.enabled)
-      {
-        std::memcpy(out, in, sizeof(float) * nframes);
-        return;
-      }
-      const float level = std_.levelLin;
-      const float wetG = std_.mixWet;
-      const float dryG = std_.mixDry;
-      for (uint32_t i = 0; i < nframes; i++)
-      {
-        const float wet = in[i] * level;
-        out[i] = in[i] * dryG + wet * wetG;
-      }
-    }
-
-  private:
-    std::string id_;
-    std::string type_;
-    NodeStandardParams std_;
-  };
   static inline float clampf(float v, float lo, float hi) { return (v < lo) ? lo : (v > hi) ? hi
                                                                                             : v; }
 
-  static inline float softclipFast(float x)
+  static std::optional<float> numParam(const pedal::chain::NodeSpec &spec, const char *k)
   {
-    if (x > 1.0f)
-      return 1.0f;
-    if (x < -1.0f)
-      return -1.0f;
-    const float b = 0.3333333f;
-    return x - b * x * x * x;
+    if (!spec.params.is_object() || !spec.params.contains(k) || !spec.params[k].is_number())
+      return std::nullopt;
+    return (float)spec.params[k].get<double>();
   }
 
   static NodeStandardParams parseStd(const pedal::chain::NodeSpec &spec)
@@ -90,109 +63,291 @@ namespace pedal::dsp
     return p;
   }
 
-  class InputNode final : public INode
+  // Clip stage oversampling factor: 1 (off), 2 or 4.
+  static int oversampleParam(const pedal::chain::NodeSpec &spec)
+  {
+    const long v = std::lround(numParam(spec, "oversample").value_or(1.0f));
+    return v >= 4 ? 4 : (v >= 2 ? 2 : 1);
+  }
+
+  // Live parameter edits ramp over this long.
+  static uint32_t smoothFrames(const ProcessContext &ctx) { return ctx.sampleRate / 100; } // 10 ms
+
+  // Base for nodes that take live edits (INode::updateParams). The enabled flag and every param not
+  // in the live key list are fixed at build time. The standard level/mix params are always live and
+  // applied by mixOut(); subclasses pick up their own live keys in applyParams().
+  class LiveParamNode : public INode
   {
   public:
-    explicit InputNode(std::string id,
-                       NodeStandardParams sp,
-                       std::atomic<float> *inputTrimLin,
-                       float fallbackTrimLin)
-        : id_(std::move(id)), std_(sp), inputTrimLin_(inputTrimLin), fallbackTrimLin_(fallbackTrimLin)
+    const std::string &id() const override { return id_; }
+    const std::string &type() const override { return type_; }
+
+    bool updateParams(const pedal::chain::NodeSpec &spec) override
     {
-      type_ = "input";
+      if (spec.enabled != specEnabled_ || fixedParams(spec.params) != fixed_)
+        return false;
+
+      const auto sp = parseStd(spec);
+      level_.set(sp.levelLin);
+      mix_.set(sp.mix);
+      applyParams(spec);
+      return true;
     }
 
-    const std::string &id() const override { return id_; }
-    const std::string &type() const override { return type_; }
+    bool bypassed() const override { return !std_.enabled; }
 
-    void process(const float *in, float *out, uint32_t nframes) noexcept override
+  protected:
+    LiveParamNode(const pedal::chain::NodeSpec &spec, std::string type, NodeStandardParams sp,
+                  uint32_t smooth, std::vector<std::string> liveKeys)
+        : id_(spec.id), type_(std::move(type)), std_(sp), liveKeys_(std::move(liveKeys)),
+          level_(sp.levelLin, smooth), mix_(sp.mix, smooth)
     {
-      const bool en = std_.enabled;
-      const float trim = inputTrimLin_ ? inputTrimLin_->load(std::memory_order_relaxed) : fallbackTrimLin_;
-      const float level = std_.levelLin;
-      const float wetG = std_.mixWet;
-      const float dryG = std_.mixDry;
+      liveKeys_.insert(liveKeys_.end(), {"levelDb", "outputGainDb", "mix"});
+      specEnabled_ = spec.enabled;
+      fixed_ = fixedParams(spec.params);
+    }
 
-      if (!en)
+    // Control thread; only RtParam::set() from here.
+    virtual void applyParams(const pedal::chain::NodeSpec &) {}
+
+    // out = in * dryScale * (1 - mix) + wet * level * mix. wet may alias out.
+    void mixOut(const float *in, const float *wet, float *out, uint32_t n, float dryScale = 1.0f) noexcept
+    {
+      level_.begin();
+      mix_.begin();
+      if (level_.steady() && mix_.steady())
       {
-        std::memcpy(out, in, sizeof(float) * nframes);
+        const float wetG = level_.value() * mix_.value();
+        const float dryG = (1.0f - mix_.value()) * dryScale;
+        for (uint32_t i = 0; i < n; i++)
+          out[i] = in[i] * dryG + wet[i] * wetG;
         return;
       }
 
-      // Wet = in * trim * level
-      for (uint32_t i = 0; i < nframes; i++)
+      for (uint32_t i = 0; i < n; i++)
       {
-        const float wet = in[i] * trim * level;
-        out[i] = in[i] * dryG + wet * wetG;
+        const float m = mix_.next();
+        out[i] = in[i] * dryScale * (1.0f - m) + wet[i] * level_.next() * m;
       }
     }
 
-  private:
+    // mixOut() for two channels; the ramps advance once per frame for both.
+    void mixOutStereo(const float *const *in, const float *const *wet, float *const *out, uint32_t n) noexcept
+    {
+      level_.begin();
+      mix_.begin();
+      const float *inL = in[0];
+      const float *inR = in[1];
+      const float *wetL = wet[0];
+      const float *wetR = wet[1];
+      float *outL = out[0];
+      float *outR = out[1];
+      if (level_.steady() && mix_.steady())
+      {
+        const float wetG = level_.value() * mix_.value();
+        const float dryG = 1.0f - mix_.value();
+        for (uint32_t i = 0; i < n; i++)
+        {
+          outL[i] = inL[i] * dryG + wetL[i] * wetG;
+          outR[i] = inR[i] * dryG + wetR[i] * wetG;
+        }
+        return;
+      }
+
+      for (uint32_t i = 0; i < n; i++)
+      {
+        const float m = mix_.next();
+        const float wetG = level_.next() * m;
+        outL[i] = inL[i] * (1.0f - m) + wetL[i] * wetG;
+        outR[i] = inR[i] * (1.0f - m) + wetR[i] * wetG;
+      }
+    }
+
+    // Stereo pass for the plain level/mix nodes: out = mixOut(in, in) per channel, or a copy when disabled.
+    void levelStereo(const float *const *in, float *const *out, uint32_t n) noexcept
+    {
+      if (!std_.enabled)
+      {
+        for (uint32_t c = 0; c < 2; c++)
+          if (out[c] != in[c])
+            std::memcpy(out[c], in[c], sizeof(float) * n);
+        return;
+      }
+      mixOutStereo(in, in, out, n);
+    }
+
+    // For nodes whose wet signal is in * wetGain: the overall gain mixOut() would apply, if level and
+    // mix are not ramping this block.
+    bool steadyMix(float wetGain, float &gain) noexcept
+    {
+      level_.begin();
+      mix_.begin();
+      if (!level_.steady() || !mix_.steady())
+        return false;
+      gain = (1.0f - mix_.value()) + wetGain * level_.value() * mix_.value();
+      return true;
+    }
+
     std::string id_;
     std::string type_;
     NodeStandardParams std_;
-    std::atomic<float> *inputTrimLin_ = nullptr;
-    float fallbackTrimLin_ = 1.0f;
+
+  private:
+    Json fixedParams(const Json &params) const
+    {
+      if (!params.is_object())
+        return params;
+      Json j = params;
+      for (const auto &k : liveKeys_)
+        j.erase(k);
+      return j;
+    }
+
+    std::vector<std::string> liveKeys_;
+    bool specEnabled_ = true;
+    Json fixed_;
+    RtParam level_;
+    RtParam mix_;
   };
 
-  class OutputNode final : public INode
+  class PassthroughNode final : public LiveParamNode
   {
   public:
-    explicit OutputNode(std::string id, NodeStandardParams sp)
-        : id_(std::move(id)), std_(sp)
+    PassthroughNode(const pedal::chain::NodeSpec &spec, NodeStandardParams sp, uint32_t smooth)
+        : LiveParamNode(spec, spec.type, sp, smooth, {})
     {
-      type_ = "output";
     }
 
-    const std::string &id() const override { return id_; }
-    const std::string &type() const override { return type_; }
-
     void process(const float *in, float *out, uint32_t nframes) noexcept override
     {
-      const bool en = std_.enabled;
-      const float level = std_.levelLin;
-      const float wetG = std_.mixWet;
-      const float dryG = std_.mixDry;
-
-      if (!en)
+      if (!std_.enabled)
       {
         std::memcpy(out, in, sizeof(float) * nframes);
         return;
       }
+      mixOut(in, in, out, nframes);
+    }
 
-      for (uint32_t i = 0; i < nframes; i++)
+    bool acceptsStereo() const override { return true; }
+    void processChannels(const float *const *in, uint32_t inChannels, float *const *out,
+                         uint32_t nframes) noexcept override
+    {
+      if (inChannels < 2)
+        process(in[0], out[0], nframes);
+      else
+        levelStereo(in, out, nframes);
+    }
+
+    bool scalesOnly() const override { return true; }
+    bool steadyGain(float &gain) noexcept override { return steadyMix(1.0f, gain); }
+  };
+
+  class InputNode final : public LiveParamNode
+  {
+  public:
+    // inputTrimDb/inputTrimLin: the engine's realtime trim (ProcessContext), shared with other
+    // controls. Without them the node keeps its own trim.
+    explicit InputNode(const pedal::chain::NodeSpec &spec,
+                       NodeStandardParams sp,
+                       uint32_t smooth,
+                       std::atomic<float> *inputTrimDb,
+                       std::atomic<float> *inputTrimLin,
+                       float trimLin)
+        : LiveParamNode(spec, "input", sp, smooth, {"inputTrimDb"}),
+          inputTrimDb_(inputTrimDb), inputTrimLin_(inputTrimLin), trim_(trimLin, smooth)
+    {
+    }
+
+    void process(const float *in, float *out, uint32_t nframes) noexcept override
+    {
+      if (!std_.enabled)
       {
-        const float wet = in[i] * level;
-        out[i] = in[i] * dryG + wet * wetG;
+        std::memcpy(out, in, sizeof(float) * nframes);
+        return;
       }
+
+      // Wet = in * trim * level
+      if (inputTrimLin_)
+        trim_.set(inputTrimLin_->load(std::memory_order_relaxed));
+      trim_.begin();
+      for (uint32_t i = 0; i < nframes; i++)
+        out[i] = in[i] * trim_.next();
+      mixOut(in, out, out, nframes);
+    }
+
+    bool scalesOnly() const override { return true; }
+    bool steadyGain(float &gain) noexcept override
+    {
+      if (inputTrimLin_)
+        trim_.set(inputTrimLin_->load(std::memory_order_relaxed));
+      trim_.begin();
+      return trim_.steady() && steadyMix(trim_.value(), gain);
+    }
+
+  protected:
+    void applyParams(const pedal::chain::NodeSpec &spec) override
+    {
+      const float trimDb = clampf(numParam(spec, "inputTrimDb").value_or(0.0f), -24.0f, 24.0f);
+      if (inputTrimDb_)
+        inputTrimDb_->store(trimDb, std::memory_order_relaxed);
+      if (inputTrimLin_)
+        inputTrimLin_->store(dbToLin(trimDb), std::memory_order_relaxed);
+      else
+        trim_.set(dbToLin(trimDb));
     }
 
   private:
-    std::string id_;
-    std::string type_;
-    NodeStandardParams std_;
+    std::atomic<float> *inputTrimDb_ = nullptr;
+    std::atomic<float> *inputTrimLin_ = nullptr;
+    RtParam trim_;
   };
 
-  class OverdriveNode final : public INode
+  class OutputNode final : public LiveParamNode
   {
   public:
-    explicit OverdriveNode(std::string id, NodeStandardParams sp, float drive, float tone, float outDb)
-        : id_(std::move(id)), std_(sp)
+    explicit OutputNode(const pedal::chain::NodeSpec &spec, NodeStandardParams sp, uint32_t smooth)
+        : LiveParamNode(spec, "output", sp, smooth, {})
     {
-      type_ = "overdrive";
+    }
 
-      drive_ = clampf(drive, 0.0f, 1.0f);
-      tone_ = clampf(tone, 0.0f, 1.0f);
-      outDb_ = outDb;
+    void process(const float *in, float *out, uint32_t nframes) noexcept override
+    {
+      if (!std_.enabled)
+      {
+        std::memcpy(out, in, sizeof(float) * nframes);
+        return;
+      }
+      mixOut(in, in, out, nframes);
+    }
 
-      pre_ = 1.0f + drive_ * 20.0f;
-      a_ = 0.02f + (1.0f - tone_) * 0.2f;
-      toneInv_ = 1.0f - tone_;
-      postLin_ = dbToLin(outDb_) * std_.levelLin;
+    bool acceptsStereo() const override { return true; }
+    void processChannels(const float *const *in, uint32_t inChannels, float *const *out,
+                         uint32_t nframes) noexcept override
+    {
+      if (inChannels < 2)
+        process(in[0], out[0], nframes);
+      else
+        levelStereo(in, out, nframes);
     }
 
-    const std::string &id() const override { return id_; }
-    const std::string &type() const override { return type_; }
+    bool scalesOnly() const override { return true; }
+    bool steadyGain(float &gain) noexcept override { return steadyMix(1.0f, gain); }
+  };
+
+  class OverdriveNode final : public LiveParamNode
+  {
+  public:
+    // oversample/curve: the clip stage (NonlinearStage); 1x cubic is the original voicing.
+    OverdriveNode(const pedal::chain::NodeSpec &spec, NodeStandardParams sp, uint32_t smooth,
+                  int oversample, NonlinearStage::Curve curve, uint32_t maxFrames)
+        : LiveParamNode(spec, "overdrive", sp, smooth, {"drive", "tone"}), maxFrames_(maxFrames)
+    {
+      const Targets t = targets(spec);
+      drive_.reset(t.drive, smooth);
+      tone_.reset(t.tone, smooth);
+      outLin_.reset(t.outLin, smooth);
+      clip_.init(oversample, curve, maxFrames);
+    }
 
     void process(const float *in, float *out, uint32_t nframes) noexcept override
     {
@@ -202,212 +357,375 @@ namespace pedal::dsp
         return;
       }
 
-      const float wetG = std_.mixWet;
-      const float dryG = std_.mixDry;
+      // The dry buffer only covers maxFrames; the chain never hands out more.
+      const uint32_t frames = (clip_.latency() && nframes > maxFrames_) ? maxFrames_ : nframes;
+
+      drive_.begin();
+      tone_.begin();
+      outLin_.begin();
+
+      for (uint32_t i = 0; i < frames; i++)
+        out[i] = in[i] * (1.0f + drive_.next() * 20.0f);
+      clip_.process(out, out, frames);
 
       // Cheap tilt-ish: blend between lowpassed-ish and bright; implemented as simple one-pole.
       float z = z1_;
 
-      for (uint32_t i = 0; i < nframes; i++)
+      for (uint32_t i = 0; i < frames; i++)
       {
-        float x = in[i] * pre_;
-        float y = softclipFast(x);
-        z = z + a_ * (y - z);
-        float wet = (z * toneInv_ + y * tone_) * postLin_;
-        out[i] = in[i] * dryG + wet * wetG;
+        const float tone = tone_.next();
+        const float a = 0.02f + (1.0f - tone) * 0.2f;
+        const float y = out[i];
+        z = z + a * (y - z);
+        out[i] = (z * (1.0f - tone) + y * tone) * outLin_.next();
       }
 
       z1_ = z;
+      if (clip_.latency())
+      {
+        // Line the dry path up with the oversampled wet one, or mix < 1 would comb.
+        clip_.delayDry(in, dry_, frames);
+        mixOut(dry_, out, out, frames);
+      }
+      else
+      {
+        mixOut(in, out, out, frames);
+      }
+
+      for (uint32_t i = frames; i < nframes; i++)
+        out[i] = in[i];
+    }
+
+    size_t scratchFloats() const override { return clip_.latency() ? maxFrames_ : 0; }
+    void bindScratch(float *p) noexcept override { dry_ = p; }
+
+  protected:
+    void applyParams(const pedal::chain::NodeSpec &spec) override
+    {
+      const Targets t = targets(spec);
+      drive_.set(t.drive);
+      tone_.set(t.tone);
+      outLin_.set(t.outLin);
     }
 
   private:
-    std::string id_;
-    std::string type_;
-    NodeStandardParams std_;
-    float drive_ = 0.5f;
-    float tone_ = 0.5f;
-    float outDb_ = 0.0f;
-    float pre_ = 1.0f;
-    float postLin_ = 1.0f;
-    float a_ = 0.12f;
-    float toneInv_ = 0.5f;
+    struct Targets
+    {
+      float drive;
+      float tone;
+      float outLin;
+    };
+
+    static Targets targets(const pedal::chain::NodeSpec &spec)
+    {
+      return Targets{clampf(numParam(spec, "drive").value_or(0.6f), 0.0f, 1.0f),
+                     clampf(numParam(spec, "tone").value_or(0.5f), 0.0f, 1.0f),
+                     dbToLin(numParam(spec, "levelDb").value_or(0.0f))};
+    }
+
+    uint32_t maxFrames_ = 256;
+    NonlinearStage clip_;
+    float *dry_ = nullptr; // scratch
+    RtParam drive_;
+    RtParam tone_;
+    RtParam outLin_;
     float z1_ = 0.0f;
   };
 
-  class NamModelNode final : public INode
+  class NamModelNode final : public LiveParamNode
   {
   public:
-    NamModelNode(std::string id,
+    NamModelNode(const pedal::chain::NodeSpec &spec,
                  NodeStandardParams sp,
-                 std::unique_ptr<nam::DSP> model,
-                 uint32_t sampleRate,
+                 uint32_t smooth,
+                 std::unique_ptr<NamInference> model,
                  uint32_t maxFrames,
-                 float preGainDb,
-                 float postGainDb,
-                 float inLimit,
                  bool softclip,
                  bool softclipTanh,
+                 int oversample,
                  bool useInputLevel)
-        : id_(std::move(id)), std_(sp), model_(std::move(model)), sr_(sampleRate), maxFrames_(maxFrames)
+        : LiveParamNode(spec, "nam_model", sp, smooth, {"preGainDb", "postGainDb", "inLimit"}),
+          model_(std::move(model)), maxFrames_(maxFrames)
     {
-      type_ = "nam_model";
-      in_.assign(maxFrames_, 0.0f);
-      out_.assign(maxFrames_, 0.0f);
-
-      preGainDb_ = preGainDb;
-      postGainDb_ = postGainDb;
-      inLimit_ = inLimit;
       softclip_ = softclip;
-      softclipTanh_ = softclipTanh;
       useInputLevel_ = useInputLevel;
+      if (softclip_)
+        clip_.init(oversample, softclipTanh ? NonlinearStage::Curve::Tanh : NonlinearStage::Curve::Cubic, maxFrames_);
 
       if (model_)
       {
-        model_->ResetAndPrewarm((double)sr_, (int)maxFrames_);
-        if (useInputLevel_ && model_->HasInputLevel())
+        model_->resetAndPrewarm();
+        if (useInputLevel_ && model_->hasInputLevel())
         {
           constexpr float refDbu = 12.2f;
-          const float modelDbu = (float)model_->GetInputLevel();
+          const float modelDbu = (float)model_->inputLevelDbu();
           levelScaleLin_ = std::pow(10.0f, (refDbu - modelDbu) / 20.0f);
         }
       }
 
-      preLin_ = dbToLin(preGainDb_) * levelScaleLin_;
-      postLin_ = dbToLin(postGainDb_) * std_.levelLin;
-      lim_ = clampf(inLimit_, 0.05f, 1.0f);
+      const Targets t = targets(spec);
+      preLin_.reset(t.preLin, smooth);
+      postLin_.reset(t.postLin, smooth);
+      lim_.reset(t.lim, smooth);
     }
 
-    const std::string &id() const override { return id_; }
-    const std::string &type() const override { return type_; }
-
     void process(const float *in, float *out, uint32_t nframes) noexcept override
+    {
+      processScaled(in, 1.0f, out, nframes);
+    }
+
+    bool bypassed() const override { return !std_.enabled || !model_ || !in_; }
+    bool foldsInputGain() const override { return true; }
+
+    void processScaled(const float *in, float inGain, float *out, uint32_t nframes) noexcept override
     {
       const uint32_t frames = (nframes <= maxFrames_) ? nframes : maxFrames_;
-      if (!std_.enabled || !model_)
+      if (bypassed())
       {
-        std::memcpy(out, in, sizeof(float) * nframes);
+        for (uint32_t i = 0; i < nframes; i++)
+          out[i] = in[i] * inGain;
         return;
       }
 
-      const float pre = preLin_;
-      const float post = postLin_;
-      const float lim = lim_;
-      const float wetG = std_.mixWet;
-      const float dryG = std_.mixDry;
+      prepareInput(in, inGain, frames);
+
+      model_->process(in_, out_, frames);
 
-      // Prepare input
+      postLin_.begin();
       for (uint32_t i = 0; i < frames; i++)
+        out_[i] *= postLin_.next();
+      if (clip_.latency())
       {
-        float x = in[i] * pre;
-        if (x > lim)
-          x = lim;
-        else if (x < -lim)
-          x = -lim;
-
-        if (!softclip_)
-          in_[i] = x;
-        else
-          in_[i] = softclipTanh_ ? std::tanh(x) : softclipFast(x);
+        // in_ is free again: the dry path, delayed like the oversampled clip.
+        clip_.delayDry(in, in_, frames);
+        mixOut(in_, out_, out, frames, inGain);
+      }
+      else
+      {
+        mixOut(in, out_, out, frames, inGain);
       }
 
-      try
+      // Safety: if caller ever provides more frames than our internal buffers, passthrough the tail.
+      for (uint32_t i = frames; i < nframes; i++)
+        out[i] = in[i] * inGain;
+    }
+
+    // Model input and output.
+    size_t scratchFloats() const override { return 2 * (size_t)maxFrames_; }
+    void bindScratch(float *p) noexcept override
+    {
+      in_ = p;
+      out_ = p + maxFrames_;
+    }
+
+  protected:
+    void applyParams(const pedal::chain::NodeSpec &spec) override
+    {
+      const Targets t = targets(spec);
+      preLin_.set(t.preLin);
+      postLin_.set(t.postLin);
+      lim_.set(t.lim);
+    }
+
+  private:
+    // in_ = clip(in * inGain * pre), where clip clamps to +-lim and then, with softclip, shapes
+    // through clip_ (oversampled when asked).
+    void prepareInput(const float *in, float inGain, uint32_t n) noexcept
+    {
+      preLin_.begin();
+      lim_.begin();
+      if (preLin_.steady())
       {
-        model_->process(in_.data(), out_.data(), (int)frames);
+        const float pre = preLin_.value() * inGain;
+        for (uint32_t i = 0; i < n; i++)
+          in_[i] = in[i] * pre;
       }
-      catch (...)
+      else
       {
-        std::memcpy(out_.data(), in_.data(), sizeof(float) * frames);
+        for (uint32_t i = 0; i < n; i++)
+          in_[i] = in[i] * inGain * preLin_.next();
       }
 
-      for (uint32_t i = 0; i < frames; i++)
+      if (softclip_)
       {
-        const float wet = out_[i] * post;
-        out[i] = in[i] * dryG + wet * wetG;
+        // The stage takes one limit per block, so an inLimit ramp moves in block steps (~10 ms).
+        float lim = lim_.value();
+        if (!lim_.steady())
+          for (uint32_t i = 0; i < n; i++)
+            lim = lim_.next();
+        clip_.process(in_, in_, n, lim);
+        return;
       }
 
-      // Safety: if caller ever provides more frames than our internal buffers, passthrough the tail.
-      for (uint32_t i = frames; i < nframes; i++)
-        out[i] = in[i];
+      if (lim_.steady())
+      {
+        const float lim = lim_.value();
+        for (uint32_t i = 0; i < n; i++)
+          in_[i] = std::clamp(in_[i], -lim, lim);
+        return;
+      }
+      for (uint32_t i = 0; i < n; i++)
+      {
+        const float lim = lim_.next();
+        in_[i] = std::clamp(in_[i], -lim, lim);
+      }
     }
 
-  private:
-    std::string id_;
-    std::string type_;
-    NodeStandardParams std_;
-    std::unique_ptr<nam::DSP> model_;
-    uint32_t sr_ = 48000;
+    struct Targets
+    {
+      float preLin;
+      float postLin;
+      float lim;
+    };
+
+    Targets targets(const pedal::chain::NodeSpec &spec) const
+    {
+      return Targets{dbToLin(numParam(spec, "preGainDb").value_or(-12.0f)) * levelScaleLin_,
+                     dbToLin(numParam(spec, "postGainDb").value_or(0.0f)),
+                     clampf(numParam(spec, "inLimit").value_or(0.90f), 0.05f, 1.0f)};
+    }
+
+    std::unique_ptr<NamInference> model_;
     uint32_t maxFrames_ = 256;
-    std::vector<float> in_;
-    std::vector<float> out_;
+    float *in_ = nullptr; // scratch
+    float *out_ = nullptr;
 
-    float preGainDb_ = -12.0f;
-    float postGainDb_ = 0.0f;
-    float inLimit_ = 0.90f;
     bool softclip_ = true;
-    bool softclipTanh_ = false;
+    NonlinearStage clip_;
     bool useInputLevel_ = true;
     float levelScaleLin_ = 1.0f;
 
-    float preLin_ = 1.0f;
-    float postLin_ = 1.0f;
-    float lim_ = 0.90f;
+    RtParam preLin_;
+    RtParam postLin_;
+    RtParam lim_;
   };
 
-  class IrConvolverNode final : public INode
+  class IrConvolverNode final : public LiveParamNode
   {
   public:
-    IrConvolverNode(std::string id, NodeStandardParams sp, FFTConvolverPartitioned convolver, uint32_t maxFrames)
-        : id_(std::move(id)), std_(sp), conv_(std::move(convolver)), maxFrames_(maxFrames)
+    // workers != nullptr: convolver was initialized with offloadTail and its tail work runs on
+    // workers->post(worker) while this thread finishes the block. A stereo convolver (two filters)
+    // makes this the node that widens the chain: mono in, L/R out.
+    IrConvolverNode(const pedal::chain::NodeSpec &spec, NodeStandardParams sp, uint32_t smooth,
+                    FFTConvolverNonUniform convolver, uint32_t maxFrames,
+                    RtWorkerPool *workers = nullptr, int worker = -1)
+        : LiveParamNode(spec, "ir_convolver", sp, smooth, {}), conv_(std::move(convolver)), maxFrames_(maxFrames),
+          workers_(workers), worker_(worker)
     {
-      type_ = "ir_convolver";
-      out_.assign(maxFrames_, 0.0f);
+      channels_ = (uint32_t)std::max(1, conv_.channels());
     }
 
-    const std::string &id() const override { return id_; }
-    const std::string &type() const override { return type_; }
+    ~IrConvolverNode() override
+    {
+      if (workers_)
+        workers_->waitFor(worker_, ticket_);
+    }
 
     void process(const float *in, float *out, uint32_t nframes) noexcept override
     {
-      if (!std_.enabled || !conv_.ready())
+      if (channels_ == 1)
+      {
+        float *o[1] = {out};
+        processChannels(&in, 1, o, nframes);
+        return;
+      }
+      // Stereo node asked for mono: channel 0 only; channel 1 is mixed in place in its scratch.
+      if (bypassed())
       {
         std::memcpy(out, in, sizeof(float) * nframes);
         return;
       }
+      const uint32_t frames = (nframes <= maxFrames_) ? nframes : maxFrames_;
+      float *o[2] = {out, wet_[1]};
+      processChannels(&in, 1, o, frames);
+      for (uint32_t i = frames; i < nframes; i++)
+        out[i] = in[i];
+    }
+
+    uint32_t outputChannels() const override { return channels_; }
+
+    void processChannels(const float *const *inCh, uint32_t, float *const *out, uint32_t nframes) noexcept override
+    {
+      const float *in = inCh[0];
+      if (bypassed())
+      {
+        for (uint32_t c = 0; c < channels_; c++)
+          std::memcpy(out[c], in, sizeof(float) * nframes);
+        return;
+      }
 
       const uint32_t frames = (nframes <= maxFrames_) ? nframes : maxFrames_;
 
-      bool ok = conv_.processBlock(in, out_.data(), (int)frames);
+      bool ok = false;
+      if (workers_)
+      {
+        // Last period's tail work; normally finished long before this period started.
+        workers_->waitFor(worker_, ticket_);
+        ticket_ = 0;
+
+        ok = conv_.pushInput(in, (int)frames);
+        if (ok)
+        {
+          ticket_ = workers_->post(worker_, &IrConvolverNode::tailJob, this);
+          ok = conv_.finishBlock(wet_, (int)frames);
+          if (ticket_ == 0)
+            conv_.tailWork(); // helper busy: same work, inline
+        }
+      }
+      else
+      {
+        ok = conv_.processBlock(in, wet_, (int)frames);
+      }
       if (!ok)
-        std::memcpy(out_.data(), in, sizeof(float) * frames);
+      {
+        for (uint32_t c = 0; c < channels_; c++)
+          std::memcpy(wet_[c], in, sizeof(float) * frames);
+      }
 
-      const float level = std_.levelLin;
-      const float wetG = std_.mixWet;
-      const float dryG = std_.mixDry;
-      for (uint32_t i = 0; i < frames; i++)
+      if (channels_ == 1)
       {
-        const float wet = out_.data()[i] * level;
-        out[i] = in[i] * dryG + wet * wetG;
+        mixOut(in, wet_[0], out[0], frames);
+      }
+      else
+      {
+        const float *dry[2] = {in, in};
+        const float *wet[2] = {wet_[0], wet_[1]};
+        mixOutStereo(dry, wet, out, frames);
       }
 
-      for (uint32_t i = frames; i < nframes; i++)
-        out[i] = in[i];
+      for (uint32_t c = 0; c < channels_; c++)
+        for (uint32_t i = frames; i < nframes; i++)
+          out[c][i] = in[i];
+    }
+
+    // Convolver output, one block per channel.
+    size_t scratchFloats() const override { return (size_t)channels_ * maxFrames_; }
+    void bindScratch(float *p) noexcept override
+    {
+      for (uint32_t c = 0; c < channels_; c++)
+        wet_[c] = p + (size_t)c * maxFrames_;
+    }
+    bool bypassed() const override { return !std_.enabled || !conv_.ready() || !wet_[0]; }
+
+    void idle() noexcept override
+    {
+      // Offloaded: the helper already pre-summed the head.
+      if (std_.enabled && !workers_)
+        conv_.presumTail();
     }
 
   private:
-    std::string id_;
-    std::string type_;
-    NodeStandardParams std_;
-    FFTConvolverPartitioned conv_;
+    static void tailJob(void *arg) noexcept { static_cast<IrConvolverNode *>(arg)->conv_.tailWork(); }
+
+    FFTConvolverNonUniform conv_;
     uint32_t maxFrames_ = 256;
-    std::vector<float> out_;
-  };
+    uint32_t channels_ = 1;
+    float *wet_[kMaxChannels] = {nullptr, nullptr}; // scratch
 
-  static std::optional<float> numParam(const pedal::chain::NodeSpec &spec, const char *k)
-  {
-    if (!spec.params.is_object() || !spec.params.contains(k) || !spec.params[k].is_number())
-      return std::nullopt;
-    return (float)spec.params[k].get<double>();
-  }
+    RtWorkerPool *workers_ = nullptr;
+    int worker_ = -1;
+    uint32_t ticket_ = 0;
+  };
 
   std::optional<NodeBuildResult> buildNode(const pedal::chain::NodeSpec &spec,
                                            const ProcessContext &ctx,
@@ -431,24 +749,26 @@ namespace pedal::dsp
       if (ctx.inputTrimLin)
         ctx.inputTrimLin->store(trimLin, std::memory_order_relaxed);
 
-      r.node = std::make_unique<InputNode>(spec.id, sp, ctx.inputTrimLin, trimLin);
+      r.node = std::make_unique<InputNode>(spec, sp, smoothFrames(ctx), ctx.inputTrimDb, ctx.inputTrimLin, trimLin);
       return r;
     }
 
     if (spec.type == "output")
     {
       const auto sp = parseStd(spec);
-      r.node = std::make_unique<OutputNode>(spec.id, sp);
+      r.node = std::make_unique<OutputNode>(spec, sp, smoothFrames(ctx));
       return r;
     }
 
     if (spec.type == "overdrive")
     {
       const auto sp = parseStd(spec);
-      const float drive = numParam(spec, "drive").value_or(0.6f);
-      const float tone = numParam(spec, "tone").value_or(0.5f);
-      const float outDb = numParam(spec, "levelDb").value_or(0.0f);
-      r.node = std::make_unique<OverdriveNode>(spec.id, sp, drive, tone, outDb);
+      bool tanhCurve = false;
+      if (spec.params.is_object() && spec.params.contains("softclipTanh") && spec.params["softclipTanh"].is_boolean())
+        tanhCurve = spec.params["softclipTanh"].get<bool>();
+      r.node = std::make_unique<OverdriveNode>(spec, sp, smoothFrames(ctx), oversampleParam(spec),
+                                               tanhCurve ? NonlinearStage::Curve::Tanh : NonlinearStage::Curve::Cubic,
+                                               ctx.maxBlockFrames);
       return r;
     }
 
@@ -458,7 +778,7 @@ namespace pedal::dsp
       {
         auto sp = parseStd(spec);
         sp.enabled = false;
-        r.node = std::make_unique<PassthroughNode>(spec.id, "nam_model", sp);
+        r.node = std::make_unique<PassthroughNode>(spec, sp, smoothFrames(ctx));
         return r;
       }
 
@@ -469,14 +789,56 @@ namespace pedal::dsp
         auto sp = parseStd(spec);
         sp.enabled = false;
         r.warning = "nam_model missing asset.path (bypassing)";
-        r.node = std::make_unique<PassthroughNode>(spec.id, "nam_model", sp);
+        r.node = std::make_unique<PassthroughNode>(spec, sp, smoothFrames(ctx));
         return r;
       }
 
-      std::unique_ptr<nam::DSP> model;
+      // Inference engine: ours for the standard WaveNet/LSTM configs, nam::DSP for the rest
+      // ("reference" forces nam::DSP, e.g. to A/B the two).
+      NamInference::Options opts;
+      std::string engine;
+      if (spec.params.is_object() && spec.params.contains("inference") && spec.params["inference"].is_string())
+        engine = spec.params["inference"].get<std::string>();
+      else if (const char *e = std::getenv("ALSA_NAM_INFERENCE"))
+        engine = e;
+      if (engine == "reference")
+        opts.engine = NamInference::Engine::Reference;
+      else if (!engine.empty() && engine != "auto")
+        r.warning = "nam_model unknown inference '" + engine + "' (using auto)";
+      if (spec.params.is_object() && spec.params.contains("fastTanh") && spec.params["fastTanh"].is_boolean())
+        opts.fastTanh = spec.params["fastTanh"].get<bool>();
+      else if (const char *e = std::getenv("ALSA_NAM_FAST_TANH"))
+        opts.fastTanh = (std::atoi(e) != 0);
+      // Weight storage for ours; trades accuracy for memory traffic on bandwidth-bound boards.
+      std::string precision;
+      if (spec.params.is_object() && spec.params.contains("precision") && spec.params["precision"].is_string())
+        precision = spec.params["precision"].get<std::string>();
+      else if (const char *e = std::getenv("ALSA_NAM_PRECISION"))
+        precision = e;
+      if (precision == "fp16")
+        opts.precision = NamInference::Precision::Fp16;
+      else if (precision == "int8")
+        opts.precision = NamInference::Precision::Int8;
+      else if (!precision.empty() && precision != "fp32")
+        r.warning += (r.warning.empty() ? "" : "; ") + std::string("nam_model unknown precision '") + precision +
+                     "' (using fp32)";
+
+      std::unique_ptr<NamInference> model;
+      std::string note;
       try
       {
-        model = nam::get_dsp(std::filesystem::path(spec.asset->path));
+        std::shared_ptr<const nam::dspData> data;
+        if (ctx.assets)
+        {
+          data = ctx.assets->namData(spec.asset->path);
+        }
+        else
+        {
+          auto loaded = std::make_shared<nam::dspData>();
+          loadNamData(resolveNamPath(spec.asset->path), *loaded);
+          data = std::move(loaded);
+        }
+        model = NamInference::create(*data, ctx.sampleRate, ctx.maxBlockFrames, opts, note);
       }
       catch (const std::exception &e)
       {
@@ -489,20 +851,17 @@ namespace pedal::dsp
         err = "Failed to load NAM model (get_dsp returned null)";
         return std::nullopt;
       }
+      std::fprintf(stderr, "%s\n", note.c_str());
 
       // Optional safety: warn on SR mismatch but keep running (NAM can be tolerant).
-      const double expSR = model->GetExpectedSampleRate();
+      const double expSR = model->expectedSampleRate();
       if (expSR > 0.0 && std::llround(expSR) != (long long)ctx.sampleRate)
       {
-        r.warning = "NAM expected sampleRate=" + std::to_string((int)std::llround(expSR)) +
-                    " but engine is " + std::to_string(ctx.sampleRate);
+        r.warning += (r.warning.empty() ? "" : "; ") + std::string("NAM expected sampleRate=") +
+                     std::to_string((int)std::llround(expSR)) + " but engine is " + std::to_string(ctx.sampleRate);
       }
 
       const auto sp = parseStd(spec);
-      const float preGainDb = numParam(spec, "preGainDb").value_or(-12.0f);
-      const float postGainDb = numParam(spec, "postGainDb").value_or(0.0f);
-      const float inLimit = numParam(spec, "inLimit").value_or(0.90f);
-
       bool softclip = true;
       bool softclipTanh = false;
       bool useInputLevel = true;
@@ -516,16 +875,14 @@ namespace pedal::dsp
           useInputLevel = spec.params["useInputLevel"].get<bool>();
       }
 
-      r.node = std::make_unique<NamModelNode>(spec.id,
+      r.node = std::make_unique<NamModelNode>(spec,
                                               sp,
+                                              smoothFrames(ctx),
                                               std::move(model),
-                                              ctx.sampleRate,
                                               ctx.maxBlockFrames,
-                                              preGainDb,
-                                              postGainDb,
-                                              inLimit,
                                               softclip,
                                               softclipTanh,
+                                              oversampleParam(spec),
                                               useInputLevel);
       return r;
     }
@@ -536,7 +893,7 @@ namespace pedal::dsp
       {
         auto sp = parseStd(spec);
         sp.enabled = false;
-        r.node = std::make_unique<PassthroughNode>(spec.id, "ir_convolver", sp);
+        r.node = std::make_unique<PassthroughNode>(spec, sp, smoothFrames(ctx));
         return r;
       }
 
@@ -545,26 +902,11 @@ namespace pedal::dsp
         auto sp = parseStd(spec);
         sp.enabled = false;
         r.warning = "ir_convolver missing asset.path (bypassing)";
-        r.node = std::make_unique<PassthroughNode>(spec.id, "ir_convolver", sp);
+        r.node = std::make_unique<PassthroughNode>(spec, sp, smoothFrames(ctx));
         return r;
       }
 
-      IRData ir{};
-      std::string loadErr;
-      if (!load_ir_mono(spec.asset->path, ir, loadErr))
-      {
-        err = std::string("Failed to load IR: ") + loadErr;
-        return std::nullopt;
-      }
-
-      if (ir.sampleRate != (int)ctx.sampleRate)
-      {
-        err = "IR sample-rate mismatch (IR=" + std::to_string(ir.sampleRate) +
-              " engine=" + std::to_string(ctx.sampleRate) + ")";
-        return std::nullopt;
-      }
-
-      // Apply optional normalize/gain (non-RT)
+      // Resolve everything that shapes the prepared IR first: it is also the cache key.
       float gainDb = 0.0f;
       float targetDb = -6.0f;
       bool useTarget = false;
@@ -576,28 +918,6 @@ namespace pedal::dsp
         useTarget = true;
       }
 
-      const float gainLin = dbToLin(clampf(gainDb, -24.0f, 24.0f));
-      if (gainLin != 1.0f)
-      {
-        for (float &v : ir.mono)
-          v *= gainLin;
-      }
-
-      if (useTarget)
-      {
-        float peak = 0.0f;
-        for (float v : ir.mono)
-          peak = std::max(peak, std::fabs(v));
-
-        const float target = dbToLin(clampf(targetDb, -24.0f, 0.0f));
-        if (peak > 0.0f)
-        {
-          const float normG = target / peak;
-          for (float &v : ir.mono)
-            v *= normG;
-        }
-      }
-
       // Optional IR trimming (non-RT). Cab IRs are typically short; long IRs can be prohibitively expensive
       // for uniform partitioned convolution. Enable via node params or env.
       uint32_t maxSamples = 0;
@@ -629,36 +949,197 @@ namespace pedal::dsp
         }
       }
 
-      if (maxSamples > 0 && ir.mono.size() > (size_t)maxSamples)
+      // Tail cut by energy: drops the part of the IR holding less than tailTrimDb of its energy
+      // (padded commercial IRs often carry hundreds of ms of near-silence). Opt-in; >= 0 disables.
+      float tailTrimDb = 0.0f;
+      if (auto v = numParam(spec, "tailTrimDb"))
+        tailTrimDb = *v;
+      else if (const char *e = std::getenv("ALSA_IR_TAIL_TRIM_DB"))
+        tailTrimDb = std::strtof(e, nullptr);
+
+      bool minPhase = false;
+      if (spec.params.is_object() && spec.params.contains("minPhase") && spec.params["minPhase"].is_boolean())
+        minPhase = spec.params["minPhase"].get<bool>();
+      else if (const char *e = std::getenv("ALSA_IR_MIN_PHASE"))
+        minPhase = (std::atoi(e) != 0);
+
+      // Long IRs (rooms/reverbs) switch to non-uniform partitioning so per-period cost stays flat.
+      // Short cab IRs keep the plain uniform path. 0 disables non-uniform mode.
+      uint32_t nonUniformMin = 4096;
+      if (auto v = numParam(spec, "nonUniformMinSamples"))
+        nonUniformMin = (*v > 0.0f) ? (uint32_t)std::llround(*v) : 0u;
+      else if (const char *e = std::getenv("ALSA_IR_NONUNIFORM_MIN_SAMPLES"))
+      {
+        const long v = std::strtol(e, nullptr, 10);
+        if (v >= 0)
+          nonUniformMin = (uint32_t)v;
+      }
+
+      // Optionally move everything but the newest partition (and the non-uniform tail stages) onto
+      // an RT helper. Uses the last worker so it stays clear of pipeline stage 0 where possible.
+      bool splitTail = false;
+      if (spec.params.is_object() && spec.params.contains("splitTail") && spec.params["splitTail"].is_boolean())
+        splitTail = spec.params["splitTail"].get<bool>();
+      else if (const char *e = std::getenv("ALSA_IR_SPLIT_TAIL"))
+        splitTail = (std::atoi(e) != 0);
+      RtWorkerPool *workers = (splitTail && ctx.workers && ctx.workers->size() > 0) ? ctx.workers : nullptr;
+
+      // Stereo output, from the two channels of the asset (stereo: true) or from two files hard-panned
+      // (rightPath: the right-hand cab; the asset, downmixed, is the left). Each side is prepared and
+      // cached on its own, and the convolver runs both off one input FFT.
+      std::string rightPath;
+      bool stereo = false;
+      if (spec.params.is_object())
+      {
+        if (spec.params.contains("rightPath") && spec.params["rightPath"].is_string())
+          rightPath = spec.params["rightPath"].get<std::string>();
+        if (spec.params.contains("stereo") && spec.params["stereo"].is_boolean())
+          stereo = spec.params["stereo"].get<bool>();
+      }
+
+      char baseParams[192];
+      std::snprintf(baseParams, sizeof(baseParams),
+                    "|sr=%u|block=%u|gain=%.4f|target=%d:%.4f|max=%u|trim=%.2f|minphase=%d|nu=%u|offload=%d",
+                    ctx.sampleRate, ctx.maxBlockFrames, (double)gainDb, useTarget ? 1 : 0, (double)targetDb,
+                    maxSamples, (double)std::min(tailTrimDb, 0.0f), minPhase ? 1 : 0, nonUniformMin, workers ? 1 : 0);
+
+      // channel: file channel to use, -1 = downmix (the mono key stays as it always was).
+      auto prepare = [&](const std::string &path, int channel, std::string &perr) -> std::shared_ptr<const CachedIr>
       {
-        // Taper the end to reduce truncation artifacts.
-        const uint32_t taper = std::min<uint32_t>(128u, maxSamples);
-        if (taper > 1)
+        std::string params = baseParams;
+        if (channel >= 0)
+          params += "|ch=" + std::to_string(channel);
+
+        std::string diskKey;
+        if (ctx.irSpectra)
+        {
+          diskKey = ctx.irSpectra->key(path, params);
+          if (auto hit = ctx.irSpectra->load(diskKey))
+          {
+            std::fprintf(stderr, "Assets: IR spectra from disk cache %s\n", path.c_str());
+            return hit;
+          }
+        }
+
+        IRData ir{};
+        std::string loadErr;
+        if (!load_ir_channel(path, channel, ir, loadErr))
+        {
+          perr = std::string("Failed to load IR: ") + loadErr;
+          return nullptr;
+        }
+
+        auto out = std::make_shared<CachedIr>();
+
+        if (ir.sampleRate != (int)ctx.sampleRate)
+        {
+          ir.mono = resampleIr(ir.mono, ir.sampleRate, (int)ctx.sampleRate);
+          out->warning = "IR resampled from " + std::to_string(ir.sampleRate) + " to " +
+                         std::to_string(ctx.sampleRate) + " Hz";
+        }
+
+        if (minPhase && !toMinimumPhase(ir.mono))
+        {
+          perr = "IR minimum-phase conversion failed";
+          return nullptr;
+        }
+
+        // Apply optional normalize/gain (non-RT)
+        const float gainLin = dbToLin(clampf(gainDb, -24.0f, 24.0f));
+        if (gainLin != 1.0f)
+        {
+          for (float &v : ir.mono)
+            v *= gainLin;
+        }
+
+        if (useTarget)
         {
-          constexpr float kPi = 3.14159265358979323846f;
-          const size_t start = (size_t)maxSamples - (size_t)taper;
-          for (uint32_t i = 0; i < taper; i++)
+          float peak = 0.0f;
+          for (float v : ir.mono)
+            peak = std::max(peak, std::fabs(v));
+
+          const float target = dbToLin(clampf(targetDb, -24.0f, 0.0f));
+          if (peak > 0.0f)
           {
-            const float t = (float)i / (float)(taper - 1);
-            const float g = 0.5f * (1.0f + std::cos(kPi * t)); // 1..0
-            ir.mono[start + i] *= g;
+            const float normG = target / peak;
+            for (float &v : ir.mono)
+              v *= normG;
           }
         }
 
-        const size_t oldLen = ir.mono.size();
-        ir.mono.resize((size_t)maxSamples);
-        r.warning = "IR trimmed from " + std::to_string(oldLen) + " to " + std::to_string(maxSamples) + " samples";
+        const size_t trimmed = energyTrimLength(ir.mono, tailTrimDb, (size_t)ctx.maxBlockFrames);
+        if (trimmed < ir.mono.size())
+        {
+          std::fprintf(stderr, "IR: %s tail below %.0f dB trimmed, %zu -> %zu samples\n", path.c_str(),
+                       (double)tailTrimDb, ir.mono.size(), trimmed);
+          truncateWithTaper(ir.mono, trimmed);
+        }
+
+        if (maxSamples > 0 && ir.mono.size() > (size_t)maxSamples)
+        {
+          // Taper the end to reduce truncation artifacts.
+          const size_t oldLen = ir.mono.size();
+          truncateWithTaper(ir.mono, (size_t)maxSamples);
+          if (!out->warning.empty())
+            out->warning += "; ";
+          out->warning += "IR trimmed from " + std::to_string(oldLen) + " to " + std::to_string(maxSamples) + " samples";
+        }
+
+        const bool nonUniform = (nonUniformMin > 0 && ir.mono.size() >= (size_t)nonUniformMin);
+        out->filter = NonUniformFilter::build(ir.mono, (int)ctx.maxBlockFrames,
+                                              nonUniform ? NonUniformFilter::kMaxTailStages : 0, workers != nullptr);
+        if (!out->filter)
+        {
+          perr = "IR convolver init failed";
+          return nullptr;
+        }
+        if (!diskKey.empty())
+          ctx.irSpectra->store(diskKey, *out);
+        return out;
+      };
+
+      auto prepared = [&](const std::string &path, int channel) -> std::shared_ptr<const CachedIr>
+      {
+        if (!ctx.assets)
+          return prepare(path, channel, err);
+        std::string key = AssetCache::fileKey(path);
+        if (!key.empty())
+        {
+          key += baseParams;
+          if (channel >= 0)
+            key += "|ch=" + std::to_string(channel);
+        }
+        return ctx.assets->ir(key, [&](std::string &perr) { return prepare(path, channel, perr); }, err);
+      };
+
+      const bool dual = !rightPath.empty();
+      auto left = prepared(spec.asset->path, (stereo && !dual) ? 0 : -1);
+      if (!left)
+        return std::nullopt;
+      std::shared_ptr<const CachedIr> right;
+      if (dual || stereo)
+      {
+        right = prepared(dual ? rightPath : spec.asset->path, dual ? -1 : 1);
+        if (!right)
+        {
+          err = (dual ? "rightPath: " : "stereo: ") + err;
+          return std::nullopt;
+        }
       }
+      r.warning = left->warning;
+      if (right && !right->warning.empty() && right->warning != left->warning)
+        r.warning += (r.warning.empty() ? "" : "; ") + std::string("right: ") + right->warning;
 
-      FFTConvolverPartitioned conv;
-      if (!conv.init(ir.mono, (int)ctx.maxBlockFrames))
+      FFTConvolverNonUniform conv;
+      if (!conv.init(left->filter, right ? right->filter : nullptr))
       {
         err = "IR convolver init failed";
         return std::nullopt;
       }
 
       const auto sp = parseStd(spec);
-      r.node = std::make_unique<IrConvolverNode>(spec.id, sp, std::move(conv), ctx.maxBlockFrames);
+      r.node = std::make_unique<IrConvolverNode>(spec, sp, smoothFrames(ctx), std::move(conv), ctx.maxBlockFrames,
+                                                 workers, workers ? workers->size() - 1 : -1);
       return r;
     }
 
@@ -678,10 +1159,12 @@ namespace pedal::dsp
              {"params",
               Json::array({
                   Json{{"key", "enabled"}, {"type", "bool"}, {"default", true}},
-                  Json{{"key", "mix"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 1.0}},
-                  Json{{"key", "levelDb"}, {"type", "float"}, {"min", -48.0}, {"max", 24.0}, {"default", 0.0}},
-                  Json{{"key", "drive"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 0.6}},
-                  Json{{"key", "tone"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 0.5}},
+                  Json{{"key", "mix"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 1.0}, {"live", true}},
+                  Json{{"key", "levelDb"}, {"type", "float"}, {"min", -48.0}, {"max", 24.0}, {"default", 0.0}, {"live", true}},
+                  Json{{"key", "drive"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 0.6}, {"live", true}},
+                  Json{{"key", "tone"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 0.5}, {"live", true}},
+                  Json{{"key", "softclipTanh"}, {"type", "bool"}, {"default", false}},
+                  Json{{"key", "oversample"}, {"type", "float"}, {"min", 1.0}, {"max", 4.0}, {"default", 1.0}},
               })}},
         Json{{"type", "nam_model"},
              {"category", "amp"},
@@ -689,14 +1172,18 @@ namespace pedal::dsp
              {"params",
               Json::array({
                   Json{{"key", "enabled"}, {"type", "bool"}, {"default", true}},
-                  Json{{"key", "mix"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 1.0}},
-                  Json{{"key", "levelDb"}, {"type", "float"}, {"min", -48.0}, {"max", 24.0}, {"default", 0.0}},
-                  Json{{"key", "preGainDb"}, {"type", "float"}, {"min", -24.0}, {"max", 24.0}, {"default", -12.0}},
-                  Json{{"key", "postGainDb"}, {"type", "float"}, {"min", -24.0}, {"max", 24.0}, {"default", 0.0}},
-                  Json{{"key", "inLimit"}, {"type", "float"}, {"min", 0.05}, {"max", 1.0}, {"default", 0.90}},
+                  Json{{"key", "mix"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 1.0}, {"live", true}},
+                  Json{{"key", "levelDb"}, {"type", "float"}, {"min", -48.0}, {"max", 24.0}, {"default", 0.0}, {"live", true}},
+                  Json{{"key", "preGainDb"}, {"type", "float"}, {"min", -24.0}, {"max", 24.0}, {"default", -12.0}, {"live", true}},
+                  Json{{"key", "postGainDb"}, {"type", "float"}, {"min", -24.0}, {"max", 24.0}, {"default", 0.0}, {"live", true}},
+                  Json{{"key", "inLimit"}, {"type", "float"}, {"min", 0.05}, {"max", 1.0}, {"default", 0.90}, {"live", true}},
                   Json{{"key", "softclip"}, {"type", "bool"}, {"default", true}},
                   Json{{"key", "softclipTanh"}, {"type", "bool"}, {"default", false}},
+                  Json{{"key", "oversample"}, {"type", "float"}, {"min", 1.0}, {"max", 4.0}, {"default", 1.0}},
                   Json{{"key", "useInputLevel"}, {"type", "bool"}, {"default", true}},
+                  Json{{"key", "inference"}, {"type", "string"}, {"values", Json::array({"auto", "reference"})}, {"default", "auto"}},
+                  Json{{"key", "fastTanh"}, {"type", "bool"}, {"default", false}},
+                  Json{{"key", "precision"}, {"type", "string"}, {"values", Json::array({"fp32", "fp16", "int8"})}, {"default", "fp32"}},
               })}},
         Json{{"type", "ir_convolver"},
              {"category", "cab"},
@@ -704,12 +1191,18 @@ namespace pedal::dsp
              {"params",
               Json::array({
                   Json{{"key", "enabled"}, {"type", "bool"}, {"default", true}},
-                  Json{{"key", "mix"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 1.0}},
-                  Json{{"key", "levelDb"}, {"type", "float"}, {"min", -48.0}, {"max", 24.0}, {"default", 0.0}},
+                  Json{{"key", "mix"}, {"type", "float"}, {"min", 0.0}, {"max", 1.0}, {"default", 1.0}, {"live", true}},
+                  Json{{"key", "levelDb"}, {"type", "float"}, {"min", -48.0}, {"max", 24.0}, {"default", 0.0}, {"live", true}},
                   Json{{"key", "gainDb"}, {"type", "float"}, {"min", -24.0}, {"max", 24.0}, {"default", 0.0}},
                   Json{{"key", "targetDb"}, {"type", "float"}, {"min", -24.0}, {"max", 0.0}, {"default", -6.0}},
                   Json{{"key", "maxSamples"}, {"type", "float"}, {"min", 0.0}, {"max", 192000.0}, {"default", 0.0}},
                   Json{{"key", "maxMs"}, {"type", "float"}, {"min", 0.0}, {"max", 500.0}, {"default", 0.0}},
+                  Json{{"key", "tailTrimDb"}, {"type", "float"}, {"min", -120.0}, {"max", 0.0}, {"default", 0.0}},
+                  Json{{"key", "minPhase"}, {"type", "bool"}, {"default", false}},
+                  Json{{"key", "nonUniformMinSamples"}, {"type", "float"}, {"min", 0.0}, {"max", 192000.0}, {"default", 4096.0}},
+                  Json{{"key", "splitTail"}, {"type", "bool"}, {"default", false}},
+                  Json{{"key", "stereo"}, {"type", "bool"}, {"default", false}},
+                  Json{{"key", "rightPath"}, {"type", "string"}, {"kind", "ir_wav"}, {"default", ""}},
               })}},
         Json{{"type", "input"}, {"category", "utility"}},
         Json{{"type", "output"}, {"category", "utility"}},
@@ -14,13 +14,21 @@ namespace nam
   class DSP;
 }
 
-class FFTConvolverPartitioned;
+class FFTConvolverNonUniform;
 
 namespace pedal::dsp
 {
 
   using Json = nlohmann::json;
 
+  // Chains start mono; one node may widen them to this many channels (see INode::outputChannels).
+  inline constexpr uint32_t kMaxChannels = 2;
+
+  class AssetCache;
+  class IrSpectraCache;
+  class RtWorkerPool;
+  class SignalTaps;
+
   struct ProcessContext
   {
     uint32_t sampleRate = 48000;
@@ -30,6 +38,24 @@ namespace pedal::dsp
     // These pointers must remain valid for the lifetime of the running engine.
     std::atomic<float> *inputTrimDb = nullptr;
     std::atomic<float> *inputTrimLin = nullptr;
+
+    // Optional helper threads owned by the engine (same lifetime rule as above). With
+    // pipelineStages > 1 a chain may split into that many stages, each heavy stage on its own
+    // worker, at the cost of pipelineStages - 1 periods of latency.
+    RtWorkerPool *workers = nullptr;
+    uint32_t pipelineStages = 1;
+
+    // Optional build-time cache for parsed models / prepared IRs (same lifetime rule).
+    AssetCache *assets = nullptr;
+    // Optional on-disk cache of prepared IR spectra, consulted on an `assets` miss (same lifetime rule).
+    IrSpectraCache *irSpectra = nullptr;
+
+    // Record every node's time (cycle_clock.h ticks) each period for the telemetry ring.
+    bool nodeTicks = false;
+
+    // Optional runtime record points (same lifetime rule): while this chain is the live one, a
+    // node whose id is tapped has its output copied there (see SignalTaps).
+    SignalTaps *taps = nullptr;
   };
 
   struct NodeStandardParams
@@ -54,6 +80,53 @@ namespace pedal::dsp
     // Process mono buffer: in[0..nframes) -> out[0..nframes)
     // Must be realtime-safe: no allocations, no locks, no filesystem.
     virtual void process(const float *in, float *out, uint32_t nframes) noexcept = 0;
+
+    // Channel layout, fixed for the node's lifetime. A node with outputChannels() > 1 widens the
+    // chain: it gets the mono signal and writes that many channels. Nodes after it must
+    // acceptsStereo() (buildChain checks) and keep the channel count.
+    virtual uint32_t outputChannels() const { return 1; }
+    virtual bool acceptsStereo() const { return false; }
+
+    // in[0..inChannels) -> out[0..max(inChannels, outputChannels())), same rules as process(). The
+    // chain only calls it for stereo steps; mono ones keep the single-buffer process().
+    virtual void processChannels(const float *const *in, uint32_t inChannels, float *const *out,
+                                 uint32_t nframes) noexcept
+    {
+      (void)inChannels;
+      process(in[0], out[0], nframes);
+    }
+
+    // Optional: called on the audio thread after the period has been handed to the device, while
+    // waiting for the next capture. Work that only depends on past input can be done here.
+    // Same rules as process().
+    virtual void idle() noexcept {}
+
+    // Optional: per-period scratch, in floats. The chain hands it out of its arena via bindScratch()
+    // before the first process(). Scratch is shared with the other nodes of the same stage, so it
+    // only holds data for the duration of one process() call.
+    virtual size_t scratchFloats() const { return 0; }
+    virtual void bindScratch(float *) noexcept {}
+
+    // Optional hints for the chain compiler (signal_chain.cpp), fixed for the node's lifetime:
+    //   bypassed():        process() is a plain copy; the node is left out of the execution plan.
+    //   scalesOnly():      process() is out = in * gain, so runs of such nodes fold into one multiply.
+    //   foldsInputGain():  processScaled() takes a preceding gain into the node's own input loop.
+    virtual bool bypassed() const { return false; }
+    virtual bool scalesOnly() const { return false; }
+    virtual bool foldsInputGain() const { return false; }
+
+    // Audio thread; same rules as process(). For scalesOnly() nodes: sets the gain and returns true if
+    // it is constant over this block, false while a parameter ramp is running (process() is then used).
+    virtual bool steadyGain(float &) noexcept { return false; }
+    // For foldsInputGain() nodes (only called on those): process(in * inGain) without a separate pass
+    // over in.
+    virtual void processScaled(const float *, float, float *, uint32_t) noexcept {}
+
+    // Optional: apply an edited spec for this node while it keeps running. Called on the control
+    // thread concurrently with process(), so implementations may only store into realtime parameter
+    // slots (rt_param.h). Returns false, leaving the node untouched, if the edit changes anything
+    // that needs a rebuild; the caller then rebuilds the chain.
+    virtual bool updateParams(const pedal::chain::NodeSpec &) { return false; }
   };
 
   struct NodeBuildResult
@@ -68,7 +141,8 @@ namespace pedal::dsp
                                            const ProcessContext &ctx,
                                            std::string &err);
 
-  // Metadata for UI/backends (ranges/defaults). Kept minimal for v1.
+  // Metadata for UI/backends (ranges/defaults). Kept minimal for v1. "live" params can change via
+  // set_param without a chain rebuild.
   Json nodeTypeManifest();
 
 } // namespace pedal::dsp
@@ -0,0 +1,360 @@
+#include "signal_taps.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <sys/types.h>
+
+#include "hash64.h"
+#include "rt_worker_pool.h"
+
+namespace pedal::dsp
+{
+
+  namespace
+  {
+    constexpr uint64_t kHashSeed = 0x7461707374617073ull;
+
+    uint64_t pointHash(const char *p, size_t n)
+    {
+      // 0 marks a free slot.
+      const uint64_t h = hash64(p, n, kHashSeed);
+      return h ? h : 1;
+    }
+
+    void put16(uint8_t *p, uint16_t v) { std::memcpy(p, &v, 2); }
+    void put32(uint8_t *p, uint32_t v) { std::memcpy(p, &v, 4); }
+  } // namespace
+
+  SignalTaps::~SignalTaps()
+  {
+    stop();
+  }
+
+  void SignalTaps::start(const Config &cfg)
+  {
+    stop();
+    cfg_ = cfg;
+    stop_ = false;
+    thread_ = std::thread([this] { run(); });
+  }
+
+  void SignalTaps::stop()
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      for (int i = 0; i < (int)kMaxTaps; i++)
+      {
+        if (taps_[i].file)
+          closeLocked(i, nullptr);
+      }
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  int SignalTaps::open(const std::string &point, const std::string &path, bool raw, double seconds, std::string &err)
+  {
+    if (point.empty() || path.empty())
+    {
+      err = "tap needs a point and a path";
+      return -1;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (!thread_.joinable())
+    {
+      err = "taps are not running";
+      return -1;
+    }
+    int id = -1;
+    for (int i = 0; i < (int)kMaxTaps; i++)
+    {
+      if (taps_[i].file && taps_[i].point == point)
+      {
+        err = "point " + point + " is already recorded by tap " + std::to_string(i);
+        return -1;
+      }
+      if (id < 0 && !taps_[i].file)
+        id = i;
+    }
+    if (id < 0)
+    {
+      err = "all " + std::to_string(kMaxTaps) + " taps are in use";
+      return -1;
+    }
+
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+    {
+      err = "cannot open " + path + ": " + std::strerror(errno);
+      return -1;
+    }
+
+    Tap &t = taps_[id];
+    // The slot is off, so no producer gets past push()'s state check; one may still be leaving.
+    while (t.busy.load(std::memory_order_acquire))
+      std::this_thread::yield();
+
+    const uint64_t frames = (uint64_t)cfg_.bufferMs * cfg_.sampleRate / 1000;
+    t.ring.reset(std::max<uint64_t>(4, (frames + kBlockFrames - 1) / kBlockFrames));
+    t.point = point;
+    t.path = path;
+    t.file = f;
+    t.raw = raw;
+    t.fileChannels = 0;
+    t.limitFrames = (seconds > 0.0) ? (uint64_t)(seconds * (double)cfg_.sampleRate) : 0;
+    t.frames = 0;
+    t.headerAt = 0;
+    t.gap.store(0, std::memory_order_relaxed);
+    t.droppedFrames.store(0, std::memory_order_relaxed);
+    patchHeader(t); // placeholder until the first patch with real sizes
+
+    t.pointHash.store(pointHash(point.data(), point.size()), std::memory_order_relaxed);
+    t.state.store(kArmed, std::memory_order_release);
+    armed_.fetch_add(1, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+    return id;
+  }
+
+  bool SignalTaps::close(int id, nlohmann::json *summary)
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (id < 0 || id >= (int)kMaxTaps || !taps_[id].file)
+      return false;
+    closeLocked(id, summary);
+    return true;
+  }
+
+  void SignalTaps::closeLocked(int id, nlohmann::json *summary)
+  {
+    Tap &t = taps_[id];
+    // seq_cst against push(): either it sees kClosing under busy, or we see its busy.
+    if (t.state.exchange(kClosing) == kArmed)
+      armed_.fetch_sub(1, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+    while (t.busy.load())
+      std::this_thread::yield();
+
+    (void)drainLocked(t);
+    patchHeader(t);
+    std::fclose(t.file);
+    t.file = nullptr;
+    if (summary)
+      *summary = nlohmann::json{{"tap", id},
+                                {"point", t.point},
+                                {"path", t.path},
+                                {"frames", t.frames},
+                                {"droppedFrames", t.droppedFrames.load(std::memory_order_relaxed)}};
+    std::fprintf(stderr, "Taps: closed tap %d (%s -> %s, %.2f s)\n", id, t.point.c_str(), t.path.c_str(),
+                 (double)t.frames / (double)cfg_.sampleRate);
+    t.ring.reset(1);
+    t.pointHash.store(0, std::memory_order_relaxed);
+    t.state.store(kOff, std::memory_order_release);
+  }
+
+  nlohmann::json SignalTaps::status() const
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    nlohmann::json taps = nlohmann::json::array();
+    for (int i = 0; i < (int)kMaxTaps; i++)
+    {
+      const Tap &t = taps_[i];
+      if (!t.file)
+        continue;
+      nlohmann::json j{{"tap", i},
+                       {"point", t.point},
+                       {"path", t.path},
+                       {"format", t.raw ? "raw" : "wav"},
+                       {"channels", t.fileChannels},
+                       {"frames", t.frames},
+                       {"seconds", (double)t.frames / (double)cfg_.sampleRate},
+                       {"droppedFrames", t.droppedFrames.load(std::memory_order_relaxed)}};
+      if (t.limitFrames)
+        j["limitSeconds"] = (double)t.limitFrames / (double)cfg_.sampleRate;
+      taps.push_back(std::move(j));
+    }
+    return nlohmann::json{{"bufferMs", cfg_.bufferMs}, {"sampleRate", cfg_.sampleRate}, {"taps", taps}};
+  }
+
+  int SignalTaps::find(const char *point, size_t len) const noexcept
+  {
+    if (!any())
+      return -1;
+    const uint64_t h = pointHash(point, len);
+    for (int i = 0; i < (int)kMaxTaps; i++)
+    {
+      // State first: open() stores the hash before it arms the slot.
+      if (taps_[i].state.load(std::memory_order_acquire) == kArmed &&
+          taps_[i].pointHash.load(std::memory_order_relaxed) == h)
+        return i;
+    }
+    return -1;
+  }
+
+  int SignalTaps::find(const char *point) const noexcept
+  {
+    return find(point, std::strlen(point));
+  }
+
+  void SignalTaps::push(int id, const float *const *in, uint32_t channels, uint32_t frames, float scale) noexcept
+  {
+    if (id < 0 || id >= (int)kMaxTaps)
+      return;
+    Tap &t = taps_[id];
+    if (t.state.load(std::memory_order_relaxed) != kArmed)
+      return;
+    if (t.busy.exchange(true))
+    {
+      t.gap.fetch_add(frames, std::memory_order_relaxed);
+      t.droppedFrames.fetch_add(frames, std::memory_order_relaxed);
+      return;
+    }
+
+    // Checked again under busy: close() waits for busy before it touches the ring.
+    if (t.state.load() == kArmed)
+    {
+      channels = std::min<uint32_t>(std::max<uint32_t>(channels, 1), 2);
+      for (uint32_t done = 0; done < frames;)
+      {
+        Block *b = t.ring.writeSlot();
+        if (!b)
+        {
+          t.gap.fetch_add(frames - done, std::memory_order_relaxed);
+          t.droppedFrames.fetch_add(frames - done, std::memory_order_relaxed);
+          break;
+        }
+        const uint32_t n = std::min(kBlockFrames, frames - done);
+        b->frames = n;
+        b->channels = channels;
+        b->gap = t.gap.exchange(0, std::memory_order_relaxed);
+        for (uint32_t c = 0; c < channels; c++)
+        {
+          const float *x = in[c] + done;
+          float *y = b->data + (size_t)c * kBlockFrames;
+          if (scale == 1.0f)
+            std::memcpy(y, x, sizeof(float) * n);
+          else
+            for (uint32_t i = 0; i < n; i++)
+              y[i] = x[i] * scale;
+        }
+        t.ring.publish();
+        done += n;
+      }
+    }
+    t.busy.store(false, std::memory_order_release);
+  }
+
+  void SignalTaps::run()
+  {
+    dropToNormalPriority("Taps: writer");
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (!stop_)
+    {
+      cv_.wait_for(lk, std::chrono::milliseconds(20), [this] { return stop_; });
+      for (int i = 0; i < (int)kMaxTaps; i++)
+      {
+        Tap &t = taps_[i];
+        if (!t.file)
+          continue;
+        if (!drainLocked(t))
+        {
+          closeLocked(i, nullptr);
+          continue;
+        }
+        // Once a second: sizes in the header, bytes on disk.
+        if (t.frames - t.headerAt >= cfg_.sampleRate)
+        {
+          patchHeader(t);
+          std::fflush(t.file);
+        }
+      }
+    }
+  }
+
+  bool SignalTaps::drainLocked(Tap &t)
+  {
+    while (const Block *b = t.ring.readSlot())
+    {
+      if (t.limitFrames && t.frames >= t.limitFrames)
+        return false;
+      writeFrames(t, b, b->gap);
+      t.ring.consume();
+    }
+    return !(t.limitFrames && t.frames >= t.limitFrames);
+  }
+
+  void SignalTaps::writeFrames(Tap &t, const Block *b, uint32_t gap)
+  {
+    if (t.fileChannels == 0)
+      t.fileChannels = b->channels;
+    const uint32_t ch = t.fileChannels;
+    const uint64_t room = t.limitFrames ? t.limitFrames - std::min(t.frames, t.limitFrames) : UINT64_MAX;
+
+    float buf[kBlockFrames * 2];
+    uint64_t silence = std::min<uint64_t>(gap, room);
+    t.frames += silence;
+    std::memset(buf, 0, sizeof(buf));
+    while (silence > 0)
+    {
+      const uint32_t n = (uint32_t)std::min<uint64_t>(silence, kBlockFrames);
+      std::fwrite(buf, sizeof(float) * ch, n, t.file);
+      silence -= n;
+    }
+
+    // Interleaved in the file's layout: a mono block fills both channels, a stereo one into a mono
+    // file is averaged.
+    const uint32_t n = (uint32_t)std::min<uint64_t>(b->frames, room - std::min<uint64_t>(room, gap));
+    const float *l = b->data;
+    const float *r = b->data + (b->channels > 1 ? kBlockFrames : 0);
+    for (uint32_t i = 0; i < n; i++)
+    {
+      if (ch == 1)
+      {
+        buf[i] = (b->channels > 1) ? 0.5f * (l[i] + r[i]) : l[i];
+      }
+      else
+      {
+        buf[2 * i] = l[i];
+        buf[2 * i + 1] = r[i];
+      }
+    }
+    std::fwrite(buf, sizeof(float) * ch, n, t.file);
+    t.frames += n;
+  }
+
+  void SignalTaps::patchHeader(Tap &t)
+  {
+    t.headerAt = t.frames;
+    if (t.raw)
+      return;
+
+    // RIFF/WAVE, format 3 (IEEE float), 32-bit.
+    const uint32_t ch = t.fileChannels ? t.fileChannels : 1;
+    const uint64_t bytes = t.frames * ch * sizeof(float);
+    const uint32_t dataBytes = (uint32_t)std::min<uint64_t>(bytes, 0xffffffffull - 36);
+    uint8_t h[44];
+    std::memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + dataBytes);
+    std::memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, 3);
+    put16(h + 22, (uint16_t)ch);
+    put32(h + 24, cfg_.sampleRate);
+    put32(h + 28, cfg_.sampleRate * ch * (uint32_t)sizeof(float));
+    put16(h + 32, (uint16_t)(ch * sizeof(float)));
+    put16(h + 34, 32);
+    std::memcpy(h + 36, "data", 4);
+    put32(h + 40, dataBytes);
+
+    ::fseeko(t.file, 0, SEEK_SET);
+    std::fwrite(h, 1, sizeof(h), t.file);
+    ::fseeko(t.file, 0, SEEK_END);
+  }
+
+} // namespace pedal::dsp
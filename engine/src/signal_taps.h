@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "json.hpp"
+#include "spsc_ring.h"
+
+namespace pedal::dsp
+{
+
+  // Record points enabled at runtime (start_tap / stop_tap) that stream what passes them to a
+  // float32 WAV or raw file while the engine runs. A point is a node id of the live chain (its
+  // output), or kInput / kOutput, which the engine feeds itself. The audio thread (or the worker
+  // running that node's pipeline stage) copies each block into the tap's SPSC ring and never waits:
+  // a full ring drops the block and the file gets that many frames of silence instead, so it stays
+  // time-aligned. A SCHED_OTHER writer thread drains the rings every few ms and keeps the
+  // header sizes current, so a file is playable even if the engine dies mid-capture.
+  //
+  // Memory is one ring per open tap (bufferMs of stereo blocks), allocated by open() and freed by
+  // close(); nothing is kept for taps that aren't running.
+  class SignalTaps
+  {
+  public:
+    static constexpr size_t kMaxTaps = 8;
+    static constexpr uint32_t kBlockFrames = 256;
+
+    static constexpr const char *kInput = "input";   // engine input, mono, before the chain
+    static constexpr const char *kOutput = "output"; // after the output gain, before the clamp
+
+    struct Config
+    {
+      uint32_t sampleRate = 48000;
+      uint32_t bufferMs = 1000; // ring per tap
+    };
+
+    SignalTaps() = default;
+    ~SignalTaps();
+
+    SignalTaps(const SignalTaps &) = delete;
+    SignalTaps &operator=(const SignalTaps &) = delete;
+
+    void start(const Config &cfg);
+    // Closes every tap (flushing what is buffered) and stops the writer.
+    void stop();
+
+    // Control thread. Starts recording `point` to `path` (truncated); seconds > 0 closes the tap on
+    // its own after that much audio. Returns the tap id, or -1 with err set.
+    int open(const std::string &point, const std::string &path, bool raw, double seconds, std::string &err);
+    // Flushes and closes tap `id`. False if it isn't open.
+    bool close(int id, nlohmann::json *summary = nullptr);
+    // {"bufferMs","sampleRate","taps":[{"tap","point","path","format","channels","frames","seconds",
+    //  "droppedFrames"[,"limitSeconds"]}]}
+    nlohmann::json status() const;
+
+    // Realtime-safe, any thread. Bumped whenever a tap opens or closes, so callers can cache find().
+    uint32_t generation() const noexcept { return generation_.load(std::memory_order_acquire); }
+    bool any() const noexcept { return armed_.load(std::memory_order_relaxed) > 0; }
+    // Only the chain with this serial records node points; standby chains, and the old chain of a
+    // crossfade once the new one is live, do not.
+    void setLiveChain(uint64_t serial) noexcept { liveSerial_.store(serial, std::memory_order_relaxed); }
+    bool live(uint64_t serial) const noexcept { return liveSerial_.load(std::memory_order_relaxed) == serial; }
+    // The open tap recording `point`, or -1.
+    int find(const char *point, size_t len) const noexcept;
+    int find(const char *point) const noexcept;
+
+    // Realtime-safe. Copies frames of channels (1 or 2) planar buffers, times scale, into tap id's
+    // ring. A second thread pushing the same tap at the same time has its block dropped.
+    void push(int id, const float *const *in, uint32_t channels, uint32_t frames, float scale = 1.0f) noexcept;
+
+  private:
+    enum State : int
+    {
+      kOff,
+      kArmed,
+      kClosing,
+    };
+
+    struct Block
+    {
+      uint32_t frames = 0;
+      uint32_t channels = 1;
+      uint32_t gap = 0; // frames dropped just before this block
+      float data[kBlockFrames * 2] = {}; // planar
+    };
+
+    struct Tap
+    {
+      std::atomic<int> state{kOff};
+      std::atomic<bool> busy{false}; // a producer is inside push()
+      std::atomic<uint64_t> pointHash{0};
+      std::atomic<uint32_t> gap{0};
+      std::atomic<uint64_t> droppedFrames{0};
+      SpscRing<Block> ring;
+
+      // Writer side, under mutex_.
+      std::string point;
+      std::string path;
+      std::FILE *file = nullptr;
+      bool raw = false;
+      uint32_t fileChannels = 0; // from the first block
+      uint64_t limitFrames = 0;  // 0 = until close()
+      uint64_t frames = 0;       // written to the file, gaps included
+      uint64_t headerAt = 0;     // frames when the header sizes were last patched
+    };
+
+    void run();
+    // Writes what tap t has buffered; false once it reached its limit.
+    bool drainLocked(Tap &t);
+    void writeFrames(Tap &t, const Block *b, uint32_t gap);
+    void patchHeader(Tap &t);
+    void closeLocked(int id, nlohmann::json *summary);
+
+    Config cfg_;
+    Tap taps_[kMaxTaps];
+    std::atomic<uint32_t> generation_{1};
+    std::atomic<uint32_t> armed_{0};
+    std::atomic<uint64_t> liveSerial_{0};
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::thread thread_;
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,37 @@
+#pragma once
+
+namespace pedal::dsp
+{
+
+  // Cubic soft clipper: x - x^3/3 inside [-1, 1], hard limit outside. A cheap stand-in for tanh
+  // ahead of NAM models and in the overdrive stage.
+  inline float softclipFast(float x) noexcept
+  {
+    const float b = 0.3333333f;
+    const float y = x - b * x * x * x;
+    // Selects rather than early returns, so loops over it vectorize.
+    return x > 1.0f ? 1.0f : (x < -1.0f ? -1.0f : y);
+  }
+
+  // tanh as a 13/6 odd rational fit (the one Eigen uses), |error| < 4e-7 everywhere. Branch-free, so
+  // loops over it vectorize.
+  inline float tanhFast(float x) noexcept
+  {
+    constexpr float kClamp = 7.90531110763549805f;
+    x = x < -kClamp ? -kClamp : (x > kClamp ? kClamp : x);
+    const float x2 = x * x;
+    float p = -2.76076847742355e-16f;
+    p = p * x2 + 2.00018790482477e-13f;
+    p = p * x2 - 8.60467152213735e-11f;
+    p = p * x2 + 5.12229709037114e-08f;
+    p = p * x2 + 1.48572235717979e-05f;
+    p = p * x2 + 6.37261928875436e-04f;
+    p = p * x2 + 4.89352455891786e-03f;
+    float q = 1.19825839466702e-06f;
+    q = q * x2 + 1.18534705686654e-04f;
+    q = q * x2 + 2.26843463243900e-03f;
+    q = q * x2 + 4.89352518554385e-03f;
+    return x * p / q;
+  }
+
+} // namespace pedal::dsp
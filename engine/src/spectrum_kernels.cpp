@@ -0,0 +1,444 @@
+#include "spectrum_kernels.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PEDAL_CMAC_X86 1
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define PEDAL_CMAC_NEON 1
+#endif
+
+bool SplitSpectrumArena::allocate(int count, int bins)
+{
+  release();
+  if (count <= 0 || bins <= 0)
+    return false;
+
+  const int stride = strideFor(bins);
+  size_t bytes = (size_t)count * 2u * (size_t)stride * sizeof(float);
+  bytes = (bytes + kAlign - 1) & ~(kAlign - 1);
+
+  float *p = (float *)std::aligned_alloc(kAlign, bytes);
+  if (!p)
+    return false;
+  std::memset(p, 0, bytes);
+
+  mOwner = std::shared_ptr<const void>(p, [](const void *q) { std::free(const_cast<void *>(q)); });
+  mData = p;
+  mCount = count;
+  mBins = bins;
+  mStride = stride;
+  return true;
+}
+
+bool SplitSpectrumArena::adopt(int count, int bins, const float *data, std::shared_ptr<const void> owner)
+{
+  release();
+  if (count <= 0 || bins <= 0 || !data || ((uintptr_t)data & (kAlign - 1)) != 0)
+    return false;
+
+  mOwner = std::move(owner);
+  mData = const_cast<float *>(data);
+  mCount = count;
+  mBins = bins;
+  mStride = strideFor(bins);
+  return true;
+}
+
+void SplitSpectrumArena::release()
+{
+  mOwner.reset();
+  mData = nullptr;
+  mCount = mBins = mStride = 0;
+}
+
+void SplitSpectrumArena::zero()
+{
+  if (mData)
+    std::memset(mData, 0, bytes());
+}
+
+namespace spectral
+{
+
+  static void cmacScalar(float *yRe, float *yIm,
+                         const float *x, std::ptrdiff_t xStep,
+                         const float *h, std::ptrdiff_t hStep,
+                         std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    for (int j = 0; j < parts; j++)
+    {
+      const float *xr = x + (std::ptrdiff_t)j * xStep;
+      const float *hr = h + (std::ptrdiff_t)j * hStep;
+      const float *xi = xr + imOffset;
+      const float *hi = hr + imOffset;
+      for (int b = 0; b < bins; b++)
+      {
+        yRe[b] += xr[b] * hr[b] - xi[b] * hi[b];
+        yIm[b] += xr[b] * hi[b] + xi[b] * hr[b];
+      }
+    }
+  }
+
+  static void cmacDualScalar(float *y0Re, float *y0Im, float *y1Re, float *y1Im,
+                             const float *x, std::ptrdiff_t xStep,
+                             const float *h0, const float *h1, std::ptrdiff_t hStep,
+                             std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    for (int j = 0; j < parts; j++)
+    {
+      const float *xr = x + (std::ptrdiff_t)j * xStep;
+      const float *ar = h0 + (std::ptrdiff_t)j * hStep;
+      const float *br = h1 + (std::ptrdiff_t)j * hStep;
+      const float *xi = xr + imOffset;
+      const float *ai = ar + imOffset;
+      const float *bi = br + imOffset;
+      for (int b = 0; b < bins; b++)
+      {
+        y0Re[b] += xr[b] * ar[b] - xi[b] * ai[b];
+        y0Im[b] += xr[b] * ai[b] + xi[b] * ar[b];
+        y1Re[b] += xr[b] * br[b] - xi[b] * bi[b];
+        y1Im[b] += xr[b] * bi[b] + xi[b] * br[b];
+      }
+    }
+  }
+
+  // Vector kernels walk partitions four at a time so each Y chunk is loaded/stored once per four
+  // partitions; the trailing partitions and bins fall back to the scalar kernel.
+
+#if defined(PEDAL_CMAC_X86)
+  __attribute__((target("sse2"))) static void cmacSse(float *yRe, float *yIm,
+                                                      const float *x, std::ptrdiff_t xStep,
+                                                      const float *h, std::ptrdiff_t hStep,
+                                                      std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    const int vb = bins & ~3;
+    int j = 0;
+    for (; j + 4 <= parts; j += 4)
+    {
+      const float *xr[4], *hr[4];
+      for (int q = 0; q < 4; q++)
+      {
+        xr[q] = x + (std::ptrdiff_t)(j + q) * xStep;
+        hr[q] = h + (std::ptrdiff_t)(j + q) * hStep;
+      }
+      for (int b = 0; b < vb; b += 4)
+      {
+        __m128 accR = _mm_loadu_ps(yRe + b);
+        __m128 accI = _mm_loadu_ps(yIm + b);
+        for (int q = 0; q < 4; q++)
+        {
+          const __m128 ar = _mm_loadu_ps(xr[q] + b);
+          const __m128 ai = _mm_loadu_ps(xr[q] + imOffset + b);
+          const __m128 br = _mm_loadu_ps(hr[q] + b);
+          const __m128 bi = _mm_loadu_ps(hr[q] + imOffset + b);
+          accR = _mm_add_ps(accR, _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi)));
+          accI = _mm_add_ps(accI, _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br)));
+        }
+        _mm_storeu_ps(yRe + b, accR);
+        _mm_storeu_ps(yIm + b, accI);
+      }
+      if (vb < bins)
+        cmacScalar(yRe + vb, yIm + vb, x + (std::ptrdiff_t)j * xStep + vb, xStep,
+                   h + (std::ptrdiff_t)j * hStep + vb, hStep, imOffset, 4, bins - vb);
+    }
+    if (j < parts)
+      cmacScalar(yRe, yIm, x + (std::ptrdiff_t)j * xStep, xStep, h + (std::ptrdiff_t)j * hStep, hStep,
+                 imOffset, parts - j, bins);
+  }
+
+  __attribute__((target("sse2"))) static void cmacDualSse(float *y0Re, float *y0Im, float *y1Re, float *y1Im,
+                                                          const float *x, std::ptrdiff_t xStep,
+                                                          const float *h0, const float *h1, std::ptrdiff_t hStep,
+                                                          std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    const int vb = bins & ~3;
+    int j = 0;
+    for (; j + 4 <= parts; j += 4)
+    {
+      const float *xr[4], *ar[4], *br[4];
+      for (int q = 0; q < 4; q++)
+      {
+        xr[q] = x + (std::ptrdiff_t)(j + q) * xStep;
+        ar[q] = h0 + (std::ptrdiff_t)(j + q) * hStep;
+        br[q] = h1 + (std::ptrdiff_t)(j + q) * hStep;
+      }
+      for (int b = 0; b < vb; b += 4)
+      {
+        __m128 acc0R = _mm_loadu_ps(y0Re + b);
+        __m128 acc0I = _mm_loadu_ps(y0Im + b);
+        __m128 acc1R = _mm_loadu_ps(y1Re + b);
+        __m128 acc1I = _mm_loadu_ps(y1Im + b);
+        for (int q = 0; q < 4; q++)
+        {
+          const __m128 xre = _mm_loadu_ps(xr[q] + b);
+          const __m128 xim = _mm_loadu_ps(xr[q] + imOffset + b);
+          const __m128 hr0 = _mm_loadu_ps(ar[q] + b);
+          const __m128 hi0 = _mm_loadu_ps(ar[q] + imOffset + b);
+          const __m128 hr1 = _mm_loadu_ps(br[q] + b);
+          const __m128 hi1 = _mm_loadu_ps(br[q] + imOffset + b);
+          acc0R = _mm_add_ps(acc0R, _mm_sub_ps(_mm_mul_ps(xre, hr0), _mm_mul_ps(xim, hi0)));
+          acc0I = _mm_add_ps(acc0I, _mm_add_ps(_mm_mul_ps(xre, hi0), _mm_mul_ps(xim, hr0)));
+          acc1R = _mm_add_ps(acc1R, _mm_sub_ps(_mm_mul_ps(xre, hr1), _mm_mul_ps(xim, hi1)));
+          acc1I = _mm_add_ps(acc1I, _mm_add_ps(_mm_mul_ps(xre, hi1), _mm_mul_ps(xim, hr1)));
+        }
+        _mm_storeu_ps(y0Re + b, acc0R);
+        _mm_storeu_ps(y0Im + b, acc0I);
+        _mm_storeu_ps(y1Re + b, acc1R);
+        _mm_storeu_ps(y1Im + b, acc1I);
+      }
+      if (vb < bins)
+        cmacDualScalar(y0Re + vb, y0Im + vb, y1Re + vb, y1Im + vb, x + (std::ptrdiff_t)j * xStep + vb, xStep,
+                       h0 + (std::ptrdiff_t)j * hStep + vb, h1 + (std::ptrdiff_t)j * hStep + vb, hStep, imOffset, 4,
+                       bins - vb);
+    }
+    if (j < parts)
+      cmacDualScalar(y0Re, y0Im, y1Re, y1Im, x + (std::ptrdiff_t)j * xStep, xStep, h0 + (std::ptrdiff_t)j * hStep,
+                     h1 + (std::ptrdiff_t)j * hStep, hStep, imOffset, parts - j, bins);
+  }
+
+  __attribute__((target("avx2,fma"))) static void cmacAvx2(float *yRe, float *yIm,
+                                                           const float *x, std::ptrdiff_t xStep,
+                                                           const float *h, std::ptrdiff_t hStep,
+                                                           std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    const int vb = bins & ~7;
+    int j = 0;
+    for (; j + 4 <= parts; j += 4)
+    {
+      const float *xr[4], *hr[4];
+      for (int q = 0; q < 4; q++)
+      {
+        xr[q] = x + (std::ptrdiff_t)(j + q) * xStep;
+        hr[q] = h + (std::ptrdiff_t)(j + q) * hStep;
+      }
+      for (int b = 0; b < vb; b += 8)
+      {
+        __m256 accR = _mm256_loadu_ps(yRe + b);
+        __m256 accI = _mm256_loadu_ps(yIm + b);
+        for (int q = 0; q < 4; q++)
+        {
+          const __m256 ar = _mm256_loadu_ps(xr[q] + b);
+          const __m256 ai = _mm256_loadu_ps(xr[q] + imOffset + b);
+          const __m256 br = _mm256_loadu_ps(hr[q] + b);
+          const __m256 bi = _mm256_loadu_ps(hr[q] + imOffset + b);
+          accR = _mm256_fmadd_ps(ar, br, accR);
+          accR = _mm256_fnmadd_ps(ai, bi, accR);
+          accI = _mm256_fmadd_ps(ar, bi, accI);
+          accI = _mm256_fmadd_ps(ai, br, accI);
+        }
+        _mm256_storeu_ps(yRe + b, accR);
+        _mm256_storeu_ps(yIm + b, accI);
+      }
+      if (vb < bins)
+        cmacScalar(yRe + vb, yIm + vb, x + (std::ptrdiff_t)j * xStep + vb, xStep,
+                   h + (std::ptrdiff_t)j * hStep + vb, hStep, imOffset, 4, bins - vb);
+    }
+    if (j < parts)
+      cmacScalar(yRe, yIm, x + (std::ptrdiff_t)j * xStep, xStep, h + (std::ptrdiff_t)j * hStep, hStep,
+                 imOffset, parts - j, bins);
+  }
+
+  __attribute__((target("avx2,fma"))) static void cmacDualAvx2(float *y0Re, float *y0Im, float *y1Re, float *y1Im,
+                                                               const float *x, std::ptrdiff_t xStep,
+                                                               const float *h0, const float *h1, std::ptrdiff_t hStep,
+                                                               std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    const int vb = bins & ~7;
+    int j = 0;
+    for (; j + 4 <= parts; j += 4)
+    {
+      const float *xr[4], *ar[4], *br[4];
+      for (int q = 0; q < 4; q++)
+      {
+        xr[q] = x + (std::ptrdiff_t)(j + q) * xStep;
+        ar[q] = h0 + (std::ptrdiff_t)(j + q) * hStep;
+        br[q] = h1 + (std::ptrdiff_t)(j + q) * hStep;
+      }
+      for (int b = 0; b < vb; b += 8)
+      {
+        __m256 acc0R = _mm256_loadu_ps(y0Re + b);
+        __m256 acc0I = _mm256_loadu_ps(y0Im + b);
+        __m256 acc1R = _mm256_loadu_ps(y1Re + b);
+        __m256 acc1I = _mm256_loadu_ps(y1Im + b);
+        for (int q = 0; q < 4; q++)
+        {
+          const __m256 xre = _mm256_loadu_ps(xr[q] + b);
+          const __m256 xim = _mm256_loadu_ps(xr[q] + imOffset + b);
+          const __m256 hr0 = _mm256_loadu_ps(ar[q] + b);
+          const __m256 hi0 = _mm256_loadu_ps(ar[q] + imOffset + b);
+          const __m256 hr1 = _mm256_loadu_ps(br[q] + b);
+          const __m256 hi1 = _mm256_loadu_ps(br[q] + imOffset + b);
+          acc0R = _mm256_fmadd_ps(xre, hr0, acc0R);
+          acc0R = _mm256_fnmadd_ps(xim, hi0, acc0R);
+          acc0I = _mm256_fmadd_ps(xre, hi0, acc0I);
+          acc0I = _mm256_fmadd_ps(xim, hr0, acc0I);
+          acc1R = _mm256_fmadd_ps(xre, hr1, acc1R);
+          acc1R = _mm256_fnmadd_ps(xim, hi1, acc1R);
+          acc1I = _mm256_fmadd_ps(xre, hi1, acc1I);
+          acc1I = _mm256_fmadd_ps(xim, hr1, acc1I);
+        }
+        _mm256_storeu_ps(y0Re + b, acc0R);
+        _mm256_storeu_ps(y0Im + b, acc0I);
+        _mm256_storeu_ps(y1Re + b, acc1R);
+        _mm256_storeu_ps(y1Im + b, acc1I);
+      }
+      if (vb < bins)
+        cmacDualScalar(y0Re + vb, y0Im + vb, y1Re + vb, y1Im + vb, x + (std::ptrdiff_t)j * xStep + vb, xStep,
+                       h0 + (std::ptrdiff_t)j * hStep + vb, h1 + (std::ptrdiff_t)j * hStep + vb, hStep, imOffset, 4,
+                       bins - vb);
+    }
+    if (j < parts)
+      cmacDualScalar(y0Re, y0Im, y1Re, y1Im, x + (std::ptrdiff_t)j * xStep, xStep, h0 + (std::ptrdiff_t)j * hStep,
+                     h1 + (std::ptrdiff_t)j * hStep, hStep, imOffset, parts - j, bins);
+  }
+#endif
+
+#if defined(PEDAL_CMAC_NEON)
+  static void cmacNeon(float *yRe, float *yIm,
+                       const float *x, std::ptrdiff_t xStep,
+                       const float *h, std::ptrdiff_t hStep,
+                       std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    const int vb = bins & ~3;
+    int j = 0;
+    for (; j + 4 <= parts; j += 4)
+    {
+      const float *xr[4], *hr[4];
+      for (int q = 0; q < 4; q++)
+      {
+        xr[q] = x + (std::ptrdiff_t)(j + q) * xStep;
+        hr[q] = h + (std::ptrdiff_t)(j + q) * hStep;
+      }
+      for (int b = 0; b < vb; b += 4)
+      {
+        float32x4_t accR = vld1q_f32(yRe + b);
+        float32x4_t accI = vld1q_f32(yIm + b);
+        for (int q = 0; q < 4; q++)
+        {
+          const float32x4_t ar = vld1q_f32(xr[q] + b);
+          const float32x4_t ai = vld1q_f32(xr[q] + imOffset + b);
+          const float32x4_t br = vld1q_f32(hr[q] + b);
+          const float32x4_t bi = vld1q_f32(hr[q] + imOffset + b);
+          accR = vmlaq_f32(accR, ar, br);
+          accR = vmlsq_f32(accR, ai, bi);
+          accI = vmlaq_f32(accI, ar, bi);
+          accI = vmlaq_f32(accI, ai, br);
+        }
+        vst1q_f32(yRe + b, accR);
+        vst1q_f32(yIm + b, accI);
+      }
+      if (vb < bins)
+        cmacScalar(yRe + vb, yIm + vb, x + (std::ptrdiff_t)j * xStep + vb, xStep,
+                   h + (std::ptrdiff_t)j * hStep + vb, hStep, imOffset, 4, bins - vb);
+    }
+    if (j < parts)
+      cmacScalar(yRe, yIm, x + (std::ptrdiff_t)j * xStep, xStep, h + (std::ptrdiff_t)j * hStep, hStep,
+                 imOffset, parts - j, bins);
+  }
+
+  static void cmacDualNeon(float *y0Re, float *y0Im, float *y1Re, float *y1Im,
+                           const float *x, std::ptrdiff_t xStep,
+                           const float *h0, const float *h1, std::ptrdiff_t hStep,
+                           std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    const int vb = bins & ~3;
+    int j = 0;
+    for (; j + 4 <= parts; j += 4)
+    {
+      const float *xr[4], *ar[4], *br[4];
+      for (int q = 0; q < 4; q++)
+      {
+        xr[q] = x + (std::ptrdiff_t)(j + q) * xStep;
+        ar[q] = h0 + (std::ptrdiff_t)(j + q) * hStep;
+        br[q] = h1 + (std::ptrdiff_t)(j + q) * hStep;
+      }
+      for (int b = 0; b < vb; b += 4)
+      {
+        float32x4_t acc0R = vld1q_f32(y0Re + b);
+        float32x4_t acc0I = vld1q_f32(y0Im + b);
+        float32x4_t acc1R = vld1q_f32(y1Re + b);
+        float32x4_t acc1I = vld1q_f32(y1Im + b);
+        for (int q = 0; q < 4; q++)
+        {
+          const float32x4_t xre = vld1q_f32(xr[q] + b);
+          const float32x4_t xim = vld1q_f32(xr[q] + imOffset + b);
+          const float32x4_t hr0 = vld1q_f32(ar[q] + b);
+          const float32x4_t hi0 = vld1q_f32(ar[q] + imOffset + b);
+          const float32x4_t hr1 = vld1q_f32(br[q] + b);
+          const float32x4_t hi1 = vld1q_f32(br[q] + imOffset + b);
+          acc0R = vmlaq_f32(acc0R, xre, hr0);
+          acc0R = vmlsq_f32(acc0R, xim, hi0);
+          acc0I = vmlaq_f32(acc0I, xre, hi0);
+          acc0I = vmlaq_f32(acc0I, xim, hr0);
+          acc1R = vmlaq_f32(acc1R, xre, hr1);
+          acc1R = vmlsq_f32(acc1R, xim, hi1);
+          acc1I = vmlaq_f32(acc1I, xre, hi1);
+          acc1I = vmlaq_f32(acc1I, xim, hr1);
+        }
+        vst1q_f32(y0Re + b, acc0R);
+        vst1q_f32(y0Im + b, acc0I);
+        vst1q_f32(y1Re + b, acc1R);
+        vst1q_f32(y1Im + b, acc1I);
+      }
+      if (vb < bins)
+        cmacDualScalar(y0Re + vb, y0Im + vb, y1Re + vb, y1Im + vb, x + (std::ptrdiff_t)j * xStep + vb, xStep,
+                       h0 + (std::ptrdiff_t)j * hStep + vb, h1 + (std::ptrdiff_t)j * hStep + vb, hStep, imOffset, 4,
+                       bins - vb);
+    }
+    if (j < parts)
+      cmacDualScalar(y0Re, y0Im, y1Re, y1Im, x + (std::ptrdiff_t)j * xStep, xStep, h0 + (std::ptrdiff_t)j * hStep,
+                     h1 + (std::ptrdiff_t)j * hStep, hStep, imOffset, parts - j, bins);
+  }
+#endif
+
+  struct KernelChoice
+  {
+    CmacFn fn;
+    CmacDualFn dual;
+    const char *name;
+  };
+
+  static KernelChoice pickKernel()
+  {
+    std::string want;
+    if (const char *e = std::getenv("ALSA_CMAC_KERNEL"))
+      want = e;
+
+#if defined(PEDAL_CMAC_X86)
+    __builtin_cpu_init();
+    const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (want == "scalar")
+      return {cmacScalar, cmacDualScalar, "scalar"};
+    if (want == "sse")
+      return {cmacSse, cmacDualSse, "sse"};
+    if (hasAvx2)
+      return {cmacAvx2, cmacDualAvx2, "avx2"};
+    return {cmacSse, cmacDualSse, "sse"};
+#elif defined(PEDAL_CMAC_NEON)
+    if (want == "scalar")
+      return {cmacScalar, cmacDualScalar, "scalar"};
+    return {cmacNeon, cmacDualNeon, "neon"};
+#else
+    return {cmacScalar, cmacDualScalar, "scalar"};
+#endif
+  }
+
+  static const KernelChoice &choice()
+  {
+    static const KernelChoice c = pickKernel();
+    return c;
+  }
+
+  CmacFn cmacKernel() { return choice().fn; }
+  CmacDualFn cmacDualKernel() { return choice().dual; }
+  const char *cmacKernelName() { return choice().name; }
+
+} // namespace spectral
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Split-complex spectra (separate real/imag planes) for `count` partitions, stored in one
+// contiguous 64-byte aligned block. Partition k is [re plane][im plane], each plane padded to a
+// multiple of 16 floats so every plane starts on a cache line and SIMD loads never straddle.
+class SplitSpectrumArena
+{
+public:
+  static constexpr size_t kAlign = 64;
+
+  SplitSpectrumArena() = default;
+  SplitSpectrumArena(const SplitSpectrumArena &) = delete;
+  SplitSpectrumArena &operator=(const SplitSpectrumArena &) = delete;
+  SplitSpectrumArena(SplitSpectrumArena &&other) noexcept { *this = std::move(other); }
+  SplitSpectrumArena &operator=(SplitSpectrumArena &&other) noexcept
+  {
+    if (this != &other)
+    {
+      mData = std::exchange(other.mData, nullptr);
+      mOwner = std::move(other.mOwner);
+      mCount = std::exchange(other.mCount, 0);
+      mBins = std::exchange(other.mBins, 0);
+      mStride = std::exchange(other.mStride, 0);
+    }
+    return *this;
+  }
+
+  bool allocate(int count, int bins);
+  // Uses `data` (kAlign-aligned, count * 2 * strideFor(bins) floats, e.g. inside a mapped cache file)
+  // instead of allocating; `owner` keeps it alive. The arena must then be treated as read-only.
+  bool adopt(int count, int bins, const float *data, std::shared_ptr<const void> owner);
+  void release();
+  void zero();
+
+  static int strideFor(int bins) { return (bins + 15) & ~15; }
+
+  int count() const { return mCount; }
+  int bins() const { return mBins; }
+  int stride() const { return mStride; } // floats per plane
+  size_t bytes() const { return (size_t)mCount * 2u * (size_t)mStride * sizeof(float); }
+
+  float *re(int k) { return mData + (size_t)k * 2u * (size_t)mStride; }
+  float *im(int k) { return re(k) + mStride; }
+  const float *re(int k) const { return mData + (size_t)k * 2u * (size_t)mStride; }
+  const float *im(int k) const { return re(k) + mStride; }
+
+private:
+  float *mData = nullptr;
+  std::shared_ptr<const void> mOwner; // frees (allocate) or unmaps (adopt) mData
+  int mCount = 0;
+  int mBins = 0;
+  int mStride = 0;
+};
+
+namespace spectral
+{
+  // y += sum_{j < parts} X_j * H_j over `bins` complex bins (split layout).
+  // X_j re plane is x + j*xStep (xStep may be negative), H_j re plane is h + j*hStep; both im planes
+  // sit `imOffset` floats after their re plane. yRe/yIm must not alias X or H.
+  using CmacFn = void (*)(float *yRe, float *yIm,
+                          const float *x, std::ptrdiff_t xStep,
+                          const float *h, std::ptrdiff_t hStep,
+                          std::ptrdiff_t imOffset, int parts, int bins);
+
+  // Two filters over one input: y0 += sum X_j * H0_j and y1 += sum X_j * H1_j in one pass, so each X
+  // load feeds both. H0 and H1 share hStep and imOffset (same partition size).
+  using CmacDualFn = void (*)(float *y0Re, float *y0Im, float *y1Re, float *y1Im,
+                              const float *x, std::ptrdiff_t xStep,
+                              const float *h0, const float *h1, std::ptrdiff_t hStep,
+                              std::ptrdiff_t imOffset, int parts, int bins);
+
+  // Kernel picked once at startup from CPU features (override: ALSA_CMAC_KERNEL=scalar|sse|avx2|neon).
+  CmacFn cmacKernel();
+  CmacDualFn cmacDualKernel();
+  const char *cmacKernelName();
+
+  inline void cmacAccumulate(float *yRe, float *yIm,
+                             const float *x, std::ptrdiff_t xStep,
+                             const float *h, std::ptrdiff_t hStep,
+                             std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    static const CmacFn fn = cmacKernel();
+    fn(yRe, yIm, x, xStep, h, hStep, imOffset, parts, bins);
+  }
+
+  inline void cmacAccumulateDual(float *y0Re, float *y0Im, float *y1Re, float *y1Im,
+                                 const float *x, std::ptrdiff_t xStep,
+                                 const float *h0, const float *h1, std::ptrdiff_t hStep,
+                                 std::ptrdiff_t imOffset, int parts, int bins)
+  {
+    static const CmacDualFn fn = cmacDualKernel();
+    fn(y0Re, y0Im, y1Re, y1Im, x, xStep, h0, h1, hStep, imOffset, parts, bins);
+  }
+
+} // namespace spectral
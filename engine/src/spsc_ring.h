@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace pedal::dsp
+{
+
+  // Bounded single-producer/single-consumer ring of preallocated slots.
+  //
+  // Slots are written and read in place (writeSlot/publish, readSlot/consume), so T can own buffers
+  // that are sized once off the audio thread and reused forever. All RT calls are wait-free.
+  template <typename T>
+  class SpscRing
+  {
+  public:
+    SpscRing() = default;
+    explicit SpscRing(size_t capacity) { reset(capacity); }
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // Not realtime-safe. Capacity is rounded up to a power of two; the ring starts empty.
+    void reset(size_t capacity)
+    {
+      size_t n = 1;
+      while (n < capacity)
+        n <<= 1;
+      slots_.assign(n, T{});
+      mask_ = n - 1;
+      head_.store(0, std::memory_order_relaxed);
+      tail_.store(0, std::memory_order_relaxed);
+    }
+
+    // Not realtime-safe; for sizing slot-owned buffers before use.
+    template <typename F>
+    void forEachSlot(F &&f)
+    {
+      for (auto &s : slots_)
+        f(s);
+    }
+
+    size_t capacity() const noexcept { return slots_.size(); }
+
+    size_t size() const noexcept
+    {
+      return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    // Producer: slot to fill, or nullptr if the ring is full.
+    T *writeSlot() noexcept
+    {
+      const size_t h = head_.load(std::memory_order_relaxed);
+      if (h - tail_.load(std::memory_order_acquire) >= slots_.size())
+        return nullptr;
+      return &slots_[h & mask_];
+    }
+
+    void publish() noexcept { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: oldest published slot, or nullptr if the ring is empty.
+    T *readSlot() noexcept
+    {
+      const size_t t = tail_.load(std::memory_order_relaxed);
+      if (head_.load(std::memory_order_acquire) == t)
+        return nullptr;
+      return &slots_[t & mask_];
+    }
+
+    void consume() noexcept { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<size_t> head_{0}; // written by the producer
+    alignas(64) std::atomic<size_t> tail_{0}; // written by the consumer
+  };
+
+} // namespace pedal::dsp
@@ -0,0 +1,242 @@
+#include "standby_chains.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "input_history.h"
+#include "rt_worker_pool.h"
+
+namespace pedal::control
+{
+
+  StandbyChains::~StandbyChains()
+  {
+    stop();
+  }
+
+  void StandbyChains::start(const Config &cfg, const pedal::dsp::InputHistory *history)
+  {
+    stop();
+    cfg_ = cfg;
+    history_ = (cfg.warmMs > 0) ? history : nullptr;
+    stop_ = false;
+    if (!history_)
+      return;
+    thread_ = std::thread([this] { run(); });
+  }
+
+  void StandbyChains::stop()
+  {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  bool StandbyChains::reserve(const std::string &slot, uint64_t jobId, const pedal::chain::ChainSpec &spec,
+                              std::string &err)
+  {
+    std::shared_ptr<pedal::dsp::SignalChain> old;
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto it = slots_.find(slot);
+    if (it == slots_.end())
+    {
+      if (slots_.size() >= cfg_.maxSlots)
+      {
+        err = "all " + std::to_string(cfg_.maxSlots) + " standby slots are in use";
+        return false;
+      }
+      it = slots_.emplace(slot, Slot{}).first;
+    }
+    cv_.wait(lk, [&] { return !it->second.busy; });
+    Slot &s = it->second;
+    s.jobId = jobId;
+    s.spec = spec;
+    old = std::move(s.chain);
+    s.fedTo = 0;
+    lk.unlock();
+    return true; // `old` is freed here, outside the lock
+  }
+
+  bool StandbyChains::install(const std::string &slot, uint64_t jobId, std::shared_ptr<pedal::dsp::SignalChain> chain)
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = slots_.find(slot);
+    if (it == slots_.end() || it->second.jobId != jobId)
+      return false;
+    it->second.chain = std::move(chain);
+    it->second.fedTo = 0;
+    return true;
+  }
+
+  void StandbyChains::release(const std::string &slot, uint64_t jobId)
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = slots_.find(slot);
+    if (it != slots_.end() && it->second.jobId == jobId && !it->second.chain)
+      slots_.erase(it);
+  }
+
+  std::shared_ptr<pedal::dsp::SignalChain> StandbyChains::take(const std::string &slot, pedal::chain::ChainSpec &spec,
+                                                               std::string &err)
+  {
+    std::shared_ptr<pedal::dsp::SignalChain> chain;
+    uint64_t fedTo = 0;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      auto it = slots_.find(slot);
+      if (it == slots_.end())
+      {
+        err = "unknown standby slot: " + slot;
+        return nullptr;
+      }
+      if (!it->second.chain)
+      {
+        err = "standby slot still building: " + slot;
+        return nullptr;
+      }
+      cv_.wait(lk, [&] { return !it->second.busy; });
+      chain = std::move(it->second.chain);
+      spec = std::move(it->second.spec);
+      fedTo = it->second.fedTo;
+      slots_.erase(it);
+    }
+
+    // The chain is ours alone now; the last few blocks run here rather than waiting a round.
+    if (history_)
+    {
+      std::vector<float> scratch;
+      feed(*chain, fedTo, scratch);
+    }
+    return chain;
+  }
+
+  bool StandbyChains::drop(const std::string &slot)
+  {
+    std::shared_ptr<pedal::dsp::SignalChain> old;
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto it = slots_.find(slot);
+    if (it == slots_.end())
+      return false;
+    cv_.wait(lk, [&] { return !it->second.busy; });
+    old = std::move(it->second.chain);
+    slots_.erase(it);
+    lk.unlock();
+    return true;
+  }
+
+  std::vector<std::pair<std::string, pedal::chain::ChainSpec>> StandbyChains::specs() const
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<std::pair<std::string, pedal::chain::ChainSpec>> out;
+    for (const auto &[name, s] : slots_)
+      out.emplace_back(name, s.spec);
+    return out;
+  }
+
+  nlohmann::json StandbyChains::status() const
+  {
+    const uint64_t now = history_ ? history_->written() : 0;
+    std::lock_guard<std::mutex> lk(mutex_);
+    nlohmann::json slots = nlohmann::json::array();
+    for (const auto &[name, s] : slots_)
+    {
+      nlohmann::json j{{"slot", name}, {"state", s.chain ? "ready" : "building"}, {"jobId", s.jobId},
+                       {"nodes", s.spec.chain.size()}};
+      // How far behind the live input the slot's state is.
+      if (s.chain && history_ && s.fedTo > 0)
+        j["lagMs"] = (double)(now - std::min(now, s.fedTo)) * 1000.0 / (double)s.chain->sampleRate();
+      slots.push_back(std::move(j));
+    }
+    return nlohmann::json{{"maxSlots", cfg_.maxSlots}, {"warmMs", history_ ? cfg_.warmMs : 0}, {"slots", slots}};
+  }
+
+  void StandbyChains::feed(pedal::dsp::SignalChain &chain, uint64_t &fedTo, std::vector<float> &scratch)
+  {
+    // Pipeline stages and IR tails run inline here; the RT workers belong to the audio thread.
+    pedal::dsp::RtWorkerPool::setInlineOnThisThread(true);
+
+    const uint32_t block = chain.maxBlockFrames();
+    const uint32_t channels = chain.channels();
+    if (block == 0)
+      return;
+    scratch.resize((size_t)block * (1 + channels));
+    float *in = scratch.data();
+    float *outs[2] = {in + block, in + (channels > 1 ? 2 * (size_t)block : block)};
+
+    const uint64_t warm = (uint64_t)cfg_.warmMs * chain.sampleRate() / 1000;
+    uint64_t end = history_->written();
+    uint64_t from = std::max(fedTo, end - std::min(end, warm));
+    while (end - from >= block)
+    {
+      if (!history_->read(from, in, block))
+      {
+        // Overwritten while we were behind: skip ahead to what is still there.
+        end = history_->written();
+        from = std::max(from, end - std::min(end, std::min<uint64_t>(warm, history_->capacity() / 2)));
+        continue;
+      }
+      if (channels > 1)
+        chain.process(in, outs, block);
+      else
+        chain.process(in, outs[0], block);
+      chain.idle();
+      from += block;
+    }
+    fedTo = from;
+  }
+
+  void StandbyChains::run()
+  {
+    if (cfg_.threadInit)
+      cfg_.threadInit();
+
+#ifdef SCHED_IDLE
+    // Only spare CPU: the audio thread, its workers and the builds all come first.
+    sched_param sp{};
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &sp) != 0)
+      std::fprintf(stderr, "Control: standby warmer could not switch to SCHED_IDLE\n");
+#endif
+
+    std::vector<float> scratch;
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (!stop_)
+    {
+      // One slot at a time so take() and reserve() never wait for more than one slot's round.
+      for (auto it = slots_.begin(); it != slots_.end() && !stop_;)
+      {
+        Slot &s = it->second;
+        if (!s.chain)
+        {
+          ++it;
+          continue;
+        }
+        const std::string name = it->first;
+        std::shared_ptr<pedal::dsp::SignalChain> chain = s.chain;
+        uint64_t fedTo = s.fedTo;
+        s.busy = true;
+        lk.unlock();
+
+        feed(*chain, fedTo, scratch);
+
+        lk.lock();
+        // The slot stays put while busy (drop/take/reserve wait for it).
+        it = slots_.find(name);
+        it->second.fedTo = fedTo;
+        it->second.busy = false;
+        cv_.notify_all();
+        ++it;
+      }
+      cv_.wait_for(lk, std::chrono::milliseconds(cfg_.intervalMs), [&] { return stop_; });
+    }
+  }
+
+} // namespace pedal::control
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "signal_chain.h"
+#include "signal_chain_schema.h"
+
+namespace pedal::dsp
+{
+  class InputHistory;
+}
+
+namespace pedal::control
+{
+
+  // Built chains parked under a name (preload_chain) until activate_chain hands one to pendingChain.
+  // A SCHED_IDLE thread keeps feeding each of them the engine's recent input in maxBlockFrames
+  // blocks, so convolver history, filter and NAM state match what the live chain would have when one
+  // is swapped in. Each round only feeds what a slot hasn't seen, capped at the newest warmMs, so a
+  // busy CPU costs staleness rather than a backlog; take() catches the chain up to the current input
+  // before it returns it.
+  //
+  // Slots are reserved for a build job first and hold its chain once it arrives; a newer reserve()
+  // or drop() for the slot makes the older job's chain stale. Control thread only, except for the
+  // feeding thread this owns.
+  class StandbyChains
+  {
+  public:
+    struct Config
+    {
+      size_t maxSlots = 8;
+      uint32_t warmMs = 250;          // input fed before activation; 0 = no feeding at all
+      uint32_t intervalMs = 20;       // how often the feeding thread catches every slot up
+      void (*threadInit)() = nullptr; // runs first on the feeding thread (denormal flags etc.)
+    };
+
+    StandbyChains() = default;
+    ~StandbyChains();
+
+    StandbyChains(const StandbyChains &) = delete;
+    StandbyChains &operator=(const StandbyChains &) = delete;
+
+    // history may be null (no feeding).
+    void start(const Config &cfg, const pedal::dsp::InputHistory *history);
+    void stop();
+
+    // Claims `slot` for build job `jobId`, dropping any chain it held. False (err set) when all
+    // maxSlots are taken by other slots.
+    bool reserve(const std::string &slot, uint64_t jobId, const pedal::chain::ChainSpec &spec, std::string &err);
+
+    // The chain job `jobId` built. False if the slot has been reserved for a newer job or dropped.
+    bool install(const std::string &slot, uint64_t jobId, std::shared_ptr<pedal::dsp::SignalChain> chain);
+
+    // Job `jobId` failed: frees the slot if it is still reserved for it.
+    void release(const std::string &slot, uint64_t jobId);
+
+    // Removes `slot` and returns its chain, fed up to the newest input. Null (err set) if the slot is
+    // unknown or still building.
+    std::shared_ptr<pedal::dsp::SignalChain> take(const std::string &slot, pedal::chain::ChainSpec &spec,
+                                                  std::string &err);
+
+    bool drop(const std::string &slot);
+
+    // Every slot with its spec (reserved or ready), e.g. to rebuild them for a new period size.
+    std::vector<std::pair<std::string, pedal::chain::ChainSpec>> specs() const;
+
+    // {"maxSlots","warmMs","slots":[{"slot","state":"building"|"ready","jobId","nodes","lagMs"}]},
+    // lagMs (ready slots only) being how far the slot's state is behind the live input.
+    nlohmann::json status() const;
+
+  private:
+    struct Slot
+    {
+      uint64_t jobId = 0;
+      pedal::chain::ChainSpec spec;
+      std::shared_ptr<pedal::dsp::SignalChain> chain; // null while building
+      uint64_t fedTo = 0;                             // InputHistory position fed up to
+      bool busy = false;                              // being fed outside the lock
+    };
+
+    // Runs `chain` over the input since fedTo (at most warmMs of it, whole blocks only).
+    void feed(pedal::dsp::SignalChain &chain, uint64_t &fedTo, std::vector<float> &scratch);
+    void run();
+
+    Config cfg_;
+    const pedal::dsp::InputHistory *history_ = nullptr;
+    std::thread thread_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::map<std::string, Slot> slots_;
+  };
+
+} // namespace pedal::control
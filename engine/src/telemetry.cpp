@@ -0,0 +1,502 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "cycle_clock.h"
+#include "rt_worker_pool.h"
+#include "signal_chain.h"
+
+namespace pedal::telemetry
+{
+
+  // The ring holds ~10 s of 128-frame periods at 48 kHz; draining every 20 ms keeps it nearly empty.
+  static constexpr std::chrono::milliseconds kDrainInterval{20};
+
+  void LatencyHistogram::record(uint64_t v) noexcept
+  {
+    size_t idx;
+    if (v < 2 * kSub)
+    {
+      idx = (size_t)v;
+    }
+    else
+    {
+      const unsigned e = 63u - (unsigned)__builtin_clzll(v);
+      const size_t sub = (size_t)(v >> (e - kSubBits)) - kSub;
+      idx = 2 * kSub + (size_t)(e - kSubBits - 1) * kSub + sub;
+    }
+    counts_[idx]++;
+    count_++;
+    sum_ += v;
+    max_ = std::max(max_, v);
+  }
+
+  void LatencyHistogram::reset() noexcept
+  {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+  }
+
+  uint64_t LatencyHistogram::percentile(double q) const noexcept
+  {
+    if (count_ == 0)
+      return 0;
+    const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(q * (double)count_));
+    uint64_t seen = 0;
+    for (size_t idx = 0; idx < kBuckets; idx++)
+    {
+      seen += counts_[idx];
+      if (seen < rank)
+        continue;
+      if (idx < 2 * kSub)
+        return std::min<uint64_t>(idx, max_);
+      const size_t k = (idx - 2 * kSub) / kSub;
+      const size_t sub = (idx - 2 * kSub) % kSub;
+      const unsigned shift = (unsigned)k + 1;
+      const uint64_t lower = (uint64_t)(kSub + sub) << shift;
+      return std::min<uint64_t>(lower + ((uint64_t(1) << shift) - 1), max_);
+    }
+    return max_;
+  }
+
+  static Percentiles percentilesOf(const LatencyHistogram &h)
+  {
+    Percentiles p;
+    p.count = h.count();
+    p.mean = h.mean();
+    p.p50 = h.percentile(0.50);
+    p.p99 = h.percentile(0.99);
+    p.p999 = h.percentile(0.999);
+    p.max = h.max();
+    return p;
+  }
+
+  static Json percentilesToJson(const Percentiles &p)
+  {
+    return Json{{"count", p.count}, {"mean", std::round(p.mean)}, {"p50", p.p50},
+                {"p99", p.p99},     {"p999", p.p999},             {"max", p.max}};
+  }
+
+  Json summaryToJson(const Summary &s)
+  {
+    Json nodes = Json::array();
+    for (const auto &[id, p] : s.nodesNs)
+    {
+      Json n = percentilesToJson(p);
+      n["id"] = id;
+      nodes.push_back(std::move(n));
+    }
+
+    Json j{{"seconds", s.seconds},
+           {"sampleRate", s.sampleRate},
+           {"frames", s.frames},
+           {"periods", s.periods},
+           {"dropped", s.dropped},
+           {"events", Json{{"xrunsRead", s.xrunsRead},
+                           {"xrunsWrite", s.xrunsWrite},
+                           {"shortReads", s.shortReads},
+                           {"shortWrites", s.shortWrites},
+                           {"swaps", s.swaps},
+                           {"crossfades", s.crossfades},
+                           {"crossfadeFallbacks", s.crossfadeFallbacks},
+                           {"retireQueueFull", s.retireQueueFull},
+                           {"nonFinite", s.nonFinite},
+                           {"overruns", s.overruns}}},
+           {"peakIn", s.peakIn},
+           {"peakChain", s.peakChain},
+           {"peakOut", s.peakOut},
+           {"rmsIn", s.rmsIn},
+           {"rmsChain", s.rmsChain},
+           {"rmsOut", s.rmsOut},
+           {"chainNs", percentilesToJson(s.chainNs)},
+           {"cycleNs", percentilesToJson(s.cycleNs)},
+           {"wakeIntervalNs", percentilesToJson(s.wakeNs)},
+           {"nodesNs", std::move(nodes)}};
+    if (s.sampleRate > 0 && s.frames > 0)
+      j["deadlineNs"] = (uint64_t)((double)s.frames * 1e9 / (double)s.sampleRate);
+    if (s.rttUs.count > 0)
+    {
+      j["rttUs"] = percentilesToJson(s.rttUs);
+      j["fillMinFrames"] = s.fillMin;
+    }
+    return j;
+  }
+
+  void Levels::add(const Levels &o) noexcept
+  {
+    periods += o.periods;
+    peakIn = std::max(peakIn, o.peakIn);
+    peakChain = std::max(peakChain, o.peakChain);
+    peakOut = std::max(peakOut, o.peakOut);
+    sqIn += o.sqIn;
+    sqChain += o.sqChain;
+    sqOut += o.sqOut;
+    sqFrames += o.sqFrames;
+    xruns += o.xruns;
+    nonFinite += o.nonFinite;
+    overruns += o.overruns;
+  }
+
+  Json levelsToJson(const Levels &l)
+  {
+    const auto rms = [&](double sq)
+    { return l.sqFrames ? (float)std::sqrt(sq / (double)l.sqFrames) : 0.0f; };
+    return Json{{"periods", l.periods},
+                {"peakIn", l.peakIn},
+                {"peakChain", l.peakChain},
+                {"peakOut", l.peakOut},
+                {"rmsIn", rms(l.sqIn)},
+                {"rmsChain", rms(l.sqChain)},
+                {"rmsOut", rms(l.sqOut)},
+                {"xruns", l.xruns},
+                {"nonFinite", l.nonFinite},
+                {"overruns", l.overruns}};
+  }
+
+  Json nodeCostsToJson(const NodeCostTable &t)
+  {
+    const auto r2 = [](float v)
+    { return std::round((double)v * 100.0) / 100.0; };
+
+    Json nodes = Json::array();
+    for (uint32_t i = 0; i < t.count; i++)
+    {
+      const NodeCost &n = t.nodes[i];
+      nodes.push_back(Json{{"id", n.id},
+                           {"type", n.type},
+                           {"periods", n.periods},
+                           {"avgUs", r2(n.avgUs)},
+                           {"p99Us", r2(n.p99Us)},
+                           {"maxUs", r2(n.maxUs)},
+                           {"avgPct", r2(n.avgPct)},
+                           {"maxPct", r2(n.maxPct)}});
+    }
+    return Json{{"windowSecs", r2(t.windowSecs)},
+                {"frames", t.frames},
+                {"deadlineUs", r2(t.deadlineUs)},
+                {"periods", t.periods},
+                {"chainAvgPct", r2(t.chainAvgPct)},
+                {"chainMaxPct", r2(t.chainMaxPct)},
+                {"nodes", std::move(nodes)}};
+  }
+
+  void Telemetry::start(Config cfg)
+  {
+    if (thread_.joinable())
+      return;
+    cfg_ = std::move(cfg);
+    nsPerTick_ = pedal::dsp::nsPerCycle();
+    ring_.reset(cfg_.ringRecords);
+    dropped_.store(0, std::memory_order_relaxed);
+    droppedSeen_ = 0;
+    resetWindow(total_);
+    resetWindow(log_);
+    levels_ = Levels{};
+    cost_.serial = 0;
+    run_.store(true, std::memory_order_relaxed);
+    thread_ = std::thread([this]
+                          { run(); });
+  }
+
+  void Telemetry::stop()
+  {
+    run_.store(false, std::memory_order_relaxed);
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+  PeriodRecord *Telemetry::beginRecord() noexcept
+  {
+    PeriodRecord *r = ring_.writeSlot();
+    if (!r)
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    return r;
+  }
+
+  Summary Telemetry::snapshot(bool reset)
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return summarize(total_, reset);
+  }
+
+  Levels Telemetry::takeLevels()
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return std::exchange(levels_, Levels{});
+  }
+
+  void Telemetry::run()
+  {
+    pedal::dsp::dropToNormalPriority("Telemetry");
+
+    auto nextLog = std::chrono::steady_clock::now() + cfg_.logInterval;
+    while (run_.load(std::memory_order_relaxed))
+    {
+      std::this_thread::sleep_for(kDrainInterval);
+      drain();
+
+      const auto now = std::chrono::steady_clock::now();
+      if (now < nextLog)
+        continue;
+      nextLog = now + cfg_.logInterval;
+      Summary s;
+      {
+        std::lock_guard<std::mutex> lk(mutex_);
+        s = summarize(log_, true);
+      }
+      if (cfg_.log)
+        cfg_.log(s);
+    }
+    drain();
+  }
+
+  void Telemetry::drain()
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    total_.counters.dropped += dropped - droppedSeen_;
+    log_.counters.dropped += dropped - droppedSeen_;
+    droppedSeen_ = dropped;
+
+    while (const PeriodRecord *r = ring_.readSlot())
+    {
+      // Wake interval is only meaningful between back-to-back periods of the same size.
+      const uint64_t interval = (lastWake_ != 0 && !(r->flags & kPeriodChange) && r->wake > lastWake_)
+                                    ? r->wake - lastWake_
+                                    : 0;
+      lastWake_ = r->wake;
+      fold(total_, *r, interval);
+      fold(log_, *r, interval);
+      foldCost(*r);
+      foldLevels(*r);
+      ring_.consume();
+    }
+
+    if (cost_.serial != 0 && std::chrono::steady_clock::now() - cost_.since >= cfg_.costWindow)
+      publishCosts();
+  }
+
+  void Telemetry::foldLevels(const PeriodRecord &r)
+  {
+    Levels &l = levels_;
+    l.periods++;
+    l.peakIn = std::max(l.peakIn, r.peakIn);
+    l.peakChain = std::max(l.peakChain, r.peakChain);
+    l.peakOut = std::max(l.peakOut, r.peakOut);
+    l.sqIn += (double)r.rmsIn * r.rmsIn * r.frames;
+    l.sqChain += (double)r.rmsChain * r.rmsChain * r.frames;
+    l.sqOut += (double)r.rmsOut * r.rmsOut * r.frames;
+    l.sqFrames += r.frames;
+    l.xruns += (uint64_t)r.xrunsRead + r.xrunsWrite;
+    l.nonFinite += r.nonFinite;
+    if (overran(r))
+      l.overruns++;
+  }
+
+  // Chain time over the period's deadline.
+  bool Telemetry::overran(const PeriodRecord &r) const noexcept
+  {
+    if (!(r.flags & kChainRan) || cfg_.sampleRate == 0)
+      return false;
+    return (double)r.chainTicks * nsPerTick_ > (double)r.frames * 1e9 / (double)cfg_.sampleRate;
+  }
+
+  void Telemetry::foldCost(const PeriodRecord &r)
+  {
+    if (r.chainSerial == 0 || !(r.flags & kChainRan))
+      return;
+
+    // New chain or period size: the old numbers say nothing about this one.
+    if (r.chainSerial != cost_.serial || r.frames != cost_.frames || r.nodeCount != cost_.nodeCount)
+    {
+      cost_.since = std::chrono::steady_clock::now();
+      cost_.serial = r.chainSerial;
+      cost_.frames = r.frames;
+      cost_.nodeCount = std::min<uint32_t>(r.nodeCount, PeriodRecord::kMaxNodes);
+      cost_.periods = 0;
+      cost_.chain.reset();
+      for (auto &h : cost_.nodes)
+        h.reset();
+    }
+
+    const auto ns = [this](uint64_t ticks)
+    { return (uint64_t)((double)ticks * nsPerTick_); };
+    cost_.periods++;
+    cost_.chain.record(ns(r.chainTicks));
+    for (uint32_t i = 0; i < cost_.nodeCount; i++)
+    {
+      if (r.nodeTicks[i] != 0)
+        cost_.nodes[i].record(ns(r.nodeTicks[i]));
+    }
+  }
+
+  void Telemetry::publishCosts()
+  {
+    const auto now = std::chrono::steady_clock::now();
+    NodeCostTable t;
+    t.chainSerial = cost_.serial;
+    t.windowSecs = std::chrono::duration<float>(now - cost_.since).count();
+    t.frames = cost_.frames;
+    t.deadlineUs = (cfg_.sampleRate > 0) ? (float)((double)cost_.frames * 1e6 / (double)cfg_.sampleRate) : 0.0f;
+    t.periods = cost_.periods;
+
+    const auto pct = [&](double ns)
+    { return (t.deadlineUs > 0.0f) ? (float)(ns / 10.0 / (double)t.deadlineUs) : 0.0f; };
+    t.chainAvgPct = pct(cost_.chain.mean());
+    t.chainMaxPct = pct((double)cost_.chain.max());
+
+    const Labels &labels = labelsFor(cost_.serial, cost_.nodeCount);
+    t.count = cost_.nodeCount;
+    for (uint32_t i = 0; i < t.count; i++)
+    {
+      NodeCost &n = t.nodes[i];
+      std::strncpy(n.id, labels.ids[i].c_str(), sizeof(n.id) - 1);
+      std::strncpy(n.type, labels.types[i].c_str(), sizeof(n.type) - 1);
+
+      // Ticks stay 0 for a node that isn't in the plan, so its histogram is empty.
+      const LatencyHistogram &h = cost_.nodes[i];
+      n.periods = (uint32_t)h.count();
+      n.avgUs = (float)(h.mean() / 1000.0);
+      n.p99Us = (float)((double)h.percentile(0.99) / 1000.0);
+      n.maxUs = (float)((double)h.max() / 1000.0);
+      n.avgPct = pct(h.mean());
+      n.maxPct = pct((double)h.max());
+    }
+    costs_.store(t);
+
+    cost_.since = now;
+    cost_.periods = 0;
+    cost_.chain.reset();
+    for (auto &h : cost_.nodes)
+      h.reset();
+  }
+
+  void Telemetry::fold(Window &w, const PeriodRecord &r, uint64_t wakeTicks)
+  {
+    Summary &c = w.counters;
+    c.periods++;
+    c.frames = r.frames;
+    c.xrunsRead += r.xrunsRead;
+    c.xrunsWrite += r.xrunsWrite;
+    c.shortReads += r.shortReads;
+    c.shortWrites += r.shortWrites;
+    c.swaps += r.swaps;
+    c.crossfades += r.crossfades;
+    c.crossfadeFallbacks += r.crossfadeFallbacks;
+    c.retireQueueFull += r.retireQueueFull;
+    c.nonFinite += r.nonFinite;
+    c.peakIn = std::max(c.peakIn, r.peakIn);
+    c.peakChain = std::max(c.peakChain, r.peakChain);
+    c.peakOut = std::max(c.peakOut, r.peakOut);
+    w.sqIn += (double)r.rmsIn * r.rmsIn * r.frames;
+    w.sqChain += (double)r.rmsChain * r.rmsChain * r.frames;
+    w.sqOut += (double)r.rmsOut * r.rmsOut * r.frames;
+    w.sqFrames += r.frames;
+
+    const auto ns = [this](uint64_t ticks)
+    { return (uint64_t)((double)ticks * nsPerTick_); };
+
+    if (r.flags & kChainRan)
+    {
+      w.chain.record(ns(r.chainTicks));
+      if (overran(r))
+        c.overruns++;
+    }
+    w.cycle.record(ns(r.cycleTicks));
+    if (wakeTicks != 0)
+      w.wake.record(ns(wakeTicks));
+
+    if (r.rttUs != 0)
+    {
+      w.rtt.record(r.rttUs);
+      c.fillMin = w.haveFill ? std::min(c.fillMin, r.fillFrames) : r.fillFrames;
+      w.haveFill = true;
+      c.margin = r.marginFrames;
+      c.floor = r.floorFrames;
+    }
+
+    if (r.nodeCount > 0)
+    {
+      const auto &ids = labelsFor(r.chainSerial, r.nodeCount).ids;
+      for (uint32_t i = 0; i < r.nodeCount && i < ids.size(); i++)
+      {
+        if (r.nodeTicks[i] == 0)
+          continue; // not in the plan (bypassed, folded)
+        auto &h = w.nodes[ids[i]];
+        if (!h)
+          h = std::make_unique<LatencyHistogram>();
+        h->record(ns(r.nodeTicks[i]));
+      }
+    }
+  }
+
+  const Telemetry::Labels &Telemetry::labelsFor(uint64_t serial, uint32_t count)
+  {
+    if (serial == labelSerial_ && labels_.ids.size() == count)
+      return labels_;
+
+    labelSerial_ = serial;
+    labels_.ids.clear();
+    labels_.types.clear();
+    std::shared_ptr<pedal::dsp::SignalChain> chain = cfg_.activeChain ? cfg_.activeChain() : nullptr;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      if (chain && chain->serial() == serial && i < chain->nodeCount())
+      {
+        labels_.ids.push_back(chain->nodeId(i));
+        labels_.types.push_back(chain->nodeType(i));
+      }
+      else
+      {
+        labels_.ids.push_back("#" + std::to_string(i)); // chain already swapped out again
+        labels_.types.push_back("");
+      }
+    }
+    return labels_;
+  }
+
+  Summary Telemetry::summarize(Window &w, bool reset)
+  {
+    Summary s = w.counters;
+    s.sampleRate = cfg_.sampleRate;
+    s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - w.since).count();
+    s.chainNs = percentilesOf(w.chain);
+    s.cycleNs = percentilesOf(w.cycle);
+    s.wakeNs = percentilesOf(w.wake);
+    s.rttUs = percentilesOf(w.rtt);
+    if (w.sqFrames > 0)
+    {
+      s.rmsIn = (float)std::sqrt(w.sqIn / (double)w.sqFrames);
+      s.rmsChain = (float)std::sqrt(w.sqChain / (double)w.sqFrames);
+      s.rmsOut = (float)std::sqrt(w.sqOut / (double)w.sqFrames);
+    }
+    for (const auto &[id, h] : w.nodes)
+      s.nodesNs.emplace_back(id, percentilesOf(*h));
+    if (reset)
+      resetWindow(w);
+    return s;
+  }
+
+  void Telemetry::resetWindow(Window &w)
+  {
+    w.since = std::chrono::steady_clock::now();
+    w.counters = Summary{};
+    w.chain.reset();
+    w.cycle.reset();
+    w.wake.reset();
+    w.rtt.reset();
+    w.haveFill = false;
+    w.sqIn = 0.0;
+    w.sqChain = 0.0;
+    w.sqOut = 0.0;
+    w.sqFrames = 0;
+    w.nodes.clear();
+  }
+
+} // namespace pedal::telemetry
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "seqlock.h"
+#include "spsc_ring.h"
+
+namespace pedal::dsp
+{
+  class SignalChain;
+}
+
+namespace pedal::telemetry
+{
+
+  using Json = nlohmann::json;
+
+  // HDR-style log-linear histogram: exact below 64, then 32 sub-buckets per power of two (~3%
+  // relative error) up to 2^64. Fixed size, so recording never allocates. Not thread-safe.
+  class LatencyHistogram
+  {
+  public:
+    static constexpr unsigned kSubBits = 5;
+    static constexpr size_t kSub = size_t(1) << kSubBits;
+    static constexpr size_t kBuckets = 2 * kSub + (64 - kSubBits - 1) * kSub;
+
+    LatencyHistogram() : counts_(kBuckets, 0) {}
+
+    void record(uint64_t v) noexcept;
+    void reset() noexcept;
+
+    uint64_t count() const noexcept { return count_; }
+    uint64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return count_ ? (double)sum_ / (double)count_ : 0.0; }
+    // Upper edge of the bucket holding quantile q (0..1), capped at max(); 0 when empty.
+    uint64_t percentile(double q) const noexcept;
+
+  private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+  };
+
+  // Event flags of one period.
+  enum PeriodFlags : uint32_t
+  {
+    kChainRan = 1u << 0,     // chainTicks is valid
+    kPeriodChange = 1u << 1, // first period after a period size change
+  };
+
+  // What the audio thread pushes once per period. Plain data; timestamps are cycleCount() ticks.
+  struct PeriodRecord
+  {
+    static constexpr size_t kMaxNodes = 16;
+
+    uint64_t wake = 0;        // capture period in hand
+    uint32_t chainTicks = 0;  // SignalChain::process()
+    uint32_t cycleTicks = 0;  // wake -> playback write done
+    uint32_t frames = 0;
+    uint32_t flags = 0;
+
+    // Events since the previous record (a skipped period's events land in the next one).
+    uint16_t xrunsRead = 0;
+    uint16_t xrunsWrite = 0;
+    uint16_t shortReads = 0;
+    uint16_t shortWrites = 0;
+    uint16_t swaps = 0;
+    uint16_t crossfades = 0;         // dual-run crossfades started (ALSA_XFADE_PERIODS)
+    uint16_t crossfadeFallbacks = 0; // swaps that took the ramp instead of one
+    uint16_t retireQueueFull = 0;    // an old chain had to wait for room in the retire queue
+    uint16_t nonFinite = 0;
+
+    // Levels, metered by the fused input/output conversions (alsa_convert::decodeInput and
+    // encodeOutput). Out is after the output gain and sanitizer, before the clamp.
+    float peakIn = 0.0f;
+    float peakChain = 0.0f; // chain output before the output sanitizer
+    float peakOut = 0.0f;
+    float rmsIn = 0.0f;
+    float rmsChain = 0.0f;
+    float rmsOut = 0.0f;
+
+    // Poll scheduler (ALSA_SCHED); rttUs = 0 when not measured.
+    uint32_t rttUs = 0;
+    uint32_t fillFrames = 0;
+    uint16_t marginFrames = 0;
+    uint16_t floorFrames = 0;
+
+    uint64_t chainSerial = 0;
+    uint32_t nodeCount = 0;
+    uint32_t nodeTicks[kMaxNodes] = {};
+  };
+
+  struct Percentiles
+  {
+    uint64_t count = 0;
+    double mean = 0.0;
+    uint64_t p50 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+    uint64_t max = 0;
+  };
+
+  // Aggregate over a window (the log interval, or everything since the last get_stats reset).
+  // Times in ns, except rttUs.
+  struct Summary
+  {
+    double seconds = 0.0;
+    uint32_t sampleRate = 0;
+    uint32_t frames = 0;
+    uint64_t periods = 0;
+    uint64_t dropped = 0;
+
+    uint64_t xrunsRead = 0;
+    uint64_t xrunsWrite = 0;
+    uint64_t shortReads = 0;
+    uint64_t shortWrites = 0;
+    uint64_t swaps = 0;
+    uint64_t crossfades = 0;
+    uint64_t crossfadeFallbacks = 0;
+    uint64_t retireQueueFull = 0;
+    uint64_t nonFinite = 0;
+    uint64_t overruns = 0; // chain time over the period's deadline
+    float peakIn = 0.0f;
+    float peakChain = 0.0f;
+    float peakOut = 0.0f;
+    float rmsIn = 0.0f; // over the whole window
+    float rmsChain = 0.0f;
+    float rmsOut = 0.0f;
+
+    Percentiles chainNs;
+    Percentiles cycleNs;
+    Percentiles wakeNs; // wake-to-wake interval: scheduling jitter shows up in its tail
+    Percentiles rttUs;
+    uint32_t fillMin = 0;
+    uint32_t margin = 0;
+    uint32_t floor = 0;
+
+    std::vector<std::pair<std::string, Percentiles>> nodesNs; // by node id
+  };
+
+  Json summaryToJson(const Summary &s);
+
+  // Meters and events of the periods drained since the last Telemetry::takeLevels(): what a UI
+  // level meter or overload light streams (subscribe), without the histograms of a Summary.
+  struct Levels
+  {
+    uint64_t periods = 0;
+    float peakIn = 0.0f;
+    float peakChain = 0.0f;
+    float peakOut = 0.0f;
+    // Frame-weighted sums of squared period RMS.
+    double sqIn = 0.0;
+    double sqChain = 0.0;
+    double sqOut = 0.0;
+    uint64_t sqFrames = 0;
+    uint64_t xruns = 0;
+    uint64_t nonFinite = 0;
+    uint64_t overruns = 0;
+
+    void add(const Levels &o) noexcept;
+  };
+
+  // {"periods","peakIn","peakChain","peakOut","rmsIn","rmsChain","rmsOut","xruns","nonFinite","overruns"}
+  Json levelsToJson(const Levels &l);
+
+  // One node instance's cost over the last completed cost window. Share of deadline = time / period.
+  struct NodeCost
+  {
+    char id[48] = {};   // node id (truncated), NUL-terminated
+    char type[24] = {}; // node type
+    uint32_t periods = 0; // periods it ran in (0 = not in the plan: bypassed or merged away)
+    float avgUs = 0.0f;
+    float p99Us = 0.0f;
+    float maxUs = 0.0f;
+    float avgPct = 0.0f;
+    float maxPct = 0.0f;
+  };
+
+  // Per-node costs of the running chain, in chain order. Plain data so it fits a Seqlock.
+  struct NodeCostTable
+  {
+    uint64_t chainSerial = 0;
+    float windowSecs = 0.0f;
+    uint32_t frames = 0;
+    float deadlineUs = 0.0f;
+    uint32_t periods = 0;
+    float chainAvgPct = 0.0f;
+    float chainMaxPct = 0.0f;
+    uint32_t count = 0;
+    NodeCost nodes[PeriodRecord::kMaxNodes];
+  };
+
+  Json nodeCostsToJson(const NodeCostTable &t);
+
+  // Engine telemetry. The audio thread push()es one PeriodRecord per period into an SPSC ring;
+  // a SCHED_OTHER thread (it drops the audio thread's inherited policy) drains it every few ms into
+  // histograms, serves snapshots (get_stats) and calls the log callback every logInterval with that
+  // interval's summary.
+  class Telemetry
+  {
+  public:
+    struct Config
+    {
+      uint32_t sampleRate = 48000;
+      size_t ringRecords = 4096;
+      std::chrono::milliseconds logInterval{2000};
+      // Per-node cost table (nodeCosts()) is republished at the end of every window this long.
+      std::chrono::milliseconds costWindow{1000};
+      // Called on the telemetry thread; null = no periodic log.
+      std::function<void(const Summary &)> log;
+      // Resolves node ids for a chain serial; returns the active chain (may be another one).
+      std::function<std::shared_ptr<pedal::dsp::SignalChain>()> activeChain;
+    };
+
+    Telemetry() = default;
+    ~Telemetry() { stop(); }
+
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+
+    void start(Config cfg);
+    void stop();
+    bool running() const noexcept { return thread_.joinable(); }
+
+    // Audio thread: slot to fill, or nullptr if the ring is full (counted as dropped; then skip
+    // push()).
+    PeriodRecord *beginRecord() noexcept;
+    void push() noexcept { ring_.publish(); }
+
+    // Any non-RT thread. Everything since start or the last reset.
+    Summary snapshot(bool reset);
+
+    // Any non-RT thread. Levels since the previous call (or start), then starts over; a period is
+    // seen here once the telemetry thread drained it, every 20 ms.
+    Levels takeLevels();
+
+    // Any thread, never blocks the telemetry thread. False until the first window completed.
+    bool nodeCosts(NodeCostTable &out) const noexcept { return costs_.load(out); }
+
+  private:
+    struct Window
+    {
+      std::chrono::steady_clock::time_point since;
+      Summary counters; // event counters, peaks; percentiles filled in by summarize()
+      LatencyHistogram chain;
+      LatencyHistogram cycle;
+      LatencyHistogram wake;
+      LatencyHistogram rtt;
+      bool haveFill = false;
+      // Frame-weighted sums of squared period RMS, for the window RMS.
+      double sqIn = 0.0;
+      double sqChain = 0.0;
+      double sqOut = 0.0;
+      uint64_t sqFrames = 0;
+      std::map<std::string, std::unique_ptr<LatencyHistogram>> nodes;
+    };
+
+    void run();
+    void drain();
+    void fold(Window &w, const PeriodRecord &r, uint64_t wakeTicks);
+    void foldCost(const PeriodRecord &r);
+    void foldLevels(const PeriodRecord &r);
+    bool overran(const PeriodRecord &r) const noexcept;
+    void publishCosts();
+    Summary summarize(Window &w, bool reset);
+    void resetWindow(Window &w);
+    struct Labels
+    {
+      std::vector<std::string> ids;
+      std::vector<std::string> types;
+    };
+    const Labels &labelsFor(uint64_t serial, uint32_t count);
+
+    Config cfg_;
+    double nsPerTick_ = 1.0;
+    pedal::dsp::SpscRing<PeriodRecord> ring_;
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t droppedSeen_ = 0;
+    std::atomic<bool> run_{false};
+    std::thread thread_;
+
+    std::mutex mutex_; // total_, log_ and levels_ (telemetry thread vs snapshot()/takeLevels())
+    Window total_;
+    Window log_;
+    Levels levels_;
+
+    // Cost window, by node index of one chain. Telemetry thread only.
+    struct CostWindow
+    {
+      std::chrono::steady_clock::time_point since;
+      uint64_t serial = 0;
+      uint32_t frames = 0;
+      uint32_t nodeCount = 0;
+      uint32_t periods = 0;
+      LatencyHistogram chain;
+      LatencyHistogram nodes[PeriodRecord::kMaxNodes];
+    };
+    CostWindow cost_;
+    pedal::dsp::Seqlock<NodeCostTable> costs_;
+
+    // Telemetry thread only.
+    uint64_t lastWake_ = 0;
+    uint64_t labelSerial_ = 0;
+    Labels labels_;
+  };
+
+} // namespace pedal::telemetry